@@ -259,6 +259,19 @@ function build(settings)
 		tools[i] = Link(settings, toolname, Compile(settings, v), engine, zlib, pnglite)
 	end
 
+	-- build benchmarks, they run the shared game code without a client or server
+	benchmarks_src = Collect("src/benchmarks/*.cpp")
+
+	benchmarks = {}
+	for i,v in ipairs(benchmarks_src) do
+		benchmarkname = PathFilename(PathBase(v))
+		benchmarks[i] = Link(settings, benchmarkname, Compile(settings, v), game_shared, engine, zlib)
+	end
+
+	-- build the load client, it speaks the game protocol to put a server under load
+	loadclient_exe = Link(settings, "load_client", Compile(settings, Collect("src/loadclient/*.cpp")),
+		game_shared, engine, zlib)
+
 	-- build client, server, version server and master server
 	client_exe = Link(client_settings, "openfng", game_shared, game_client,
 		engine, client, game_editor, zlib, pnglite, wavpack,
@@ -286,6 +299,8 @@ function build(settings)
 	v = PseudoTarget("versionserver".."_"..settings.config_name, versionserver_exe)
 	m = PseudoTarget("masterserver".."_"..settings.config_name, masterserver_exe)
 	t = PseudoTarget("tools".."_"..settings.config_name, tools)
+	b = PseudoTarget("benchmarks".."_"..settings.config_name, benchmarks)
+	l = PseudoTarget("loadclient".."_"..settings.config_name, loadclient_exe)
 
 	all = PseudoTarget(settings.config_name, c, s, v, m, t)
 	return all
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
+#include <signal.h>
 
 #include "system.h"
 
@@ -39,6 +40,7 @@
 	#include <ws2tcpip.h>
 	#include <fcntl.h>
 	#include <direct.h>
+	#include <io.h>
 	#include <errno.h>
 #else
 	#error NOT IMPLEMENTED
@@ -64,9 +66,108 @@ static MEMSTATS memory_stats = {0};
 
 static NETSOCKET invalid_socket = {NETTYPE_INVALID, -1, -1};
 
+/* locks for the process wide state in here, they work before anything is set up */
+#if defined(CONF_FAMILY_UNIX)
+typedef pthread_mutex_t STATICLOCK;
+#define STATICLOCK_INIT PTHREAD_MUTEX_INITIALIZER
+
+static void static_lock_wait(STATICLOCK *lock) { pthread_mutex_lock(lock); }
+static void static_lock_release(STATICLOCK *lock) { pthread_mutex_unlock(lock); }
+#elif defined(CONF_FAMILY_WINDOWS)
+typedef struct
+{
+	volatile LONG state;
+	CRITICAL_SECTION section;
+} STATICLOCK;
+#define STATICLOCK_INIT {0}
+
+static void static_lock_wait(STATICLOCK *lock)
+{
+	if(lock->state != 2)
+	{
+		if(InterlockedCompareExchange(&lock->state, 1, 0) == 0)
+		{
+			InitializeCriticalSection(&lock->section);
+			lock->state = 2;
+		}
+		else
+		{
+			while(lock->state != 2)
+				Sleep(0);
+		}
+	}
+	EnterCriticalSection(&lock->section);
+}
+static void static_lock_release(STATICLOCK *lock) { LeaveCriticalSection(&lock->section); }
+#else
+	#error not implemented on this platform
+#endif
+
+static STATICLOCK log_lock = STATICLOCK_INIT;
+static STATICLOCK mem_lock = STATICLOCK_INIT;
+
+/* atomics for the log ring */
+#if defined(CONF_FAMILY_WINDOWS)
+static int atomic_cas(volatile unsigned *p, unsigned expected, unsigned desired)
+{
+	return InterlockedCompareExchange((volatile LONG *)p, (LONG)desired, (LONG)expected) == (LONG)expected;
+}
+static void atomic_inc(volatile unsigned *p) { InterlockedIncrement((volatile LONG *)p); }
+static void memory_barrier() { MemoryBarrier(); }
+#else
+static int atomic_cas(volatile unsigned *p, unsigned expected, unsigned desired)
+{
+	return __sync_bool_compare_and_swap(p, expected, desired);
+}
+static void atomic_inc(volatile unsigned *p) { __sync_fetch_and_add(p, 1); }
+static void memory_barrier() { __sync_synchronize(); }
+#endif
+
+/*
+	With dbg_logger_async the lines are formatted straight into a ring
+	and a thread hands them to the loggers, so a slow stdout never holds
+	up the thread that logs. Every slot carries a sequence number telling
+	whether it is free to write, ready to read or still being worked on,
+	which lets any thread claim one with a single compare and swap. Lines
+	that find the ring full are dropped and counted.
+*/
+enum
+{
+	LOG_RING_SIZE=1024,
+	LOG_LINE_SIZE=1024,
+	LOG_IDLE_MS=5
+};
+
+typedef struct
+{
+	volatile unsigned seq;
+	int msg_offset;
+	char line[LOG_LINE_SIZE];
+} LOG_SLOT;
+
+static LOG_SLOT *log_ring_data = 0;
+static LOG_SLOT *volatile log_ring = 0; /* cleared when the thread stops */
+static volatile unsigned log_head = 0;
+static volatile unsigned log_tail = 0;
+static volatile unsigned log_dropped = 0;
+static unsigned log_dropped_reported = 0;
+static volatile int log_thread_running = 0;
+static void *log_thread = 0;
+static int log_batching = 0;
+static int log_level = DBG_LEVEL_DEBUG;
+static IOHANDLE logfile = 0;
+static int logfile_fd = -1;
+
+/* hold last msg, number of repetitions and time of first occurence*/
+static char last_msg[1024*4];
+static unsigned rep_count;
+static int64 rep_first;
+
 void dbg_logger(DBG_LOGGER logger)
 {
+	static_lock_wait(&log_lock);
 	loggers[num_loggers++] = logger;
+	static_lock_release(&log_lock);
 }
 
 void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
@@ -74,6 +175,7 @@ void dbg_assert_imp(const char *filename, int line, int test, const char *msg)
 	if(!test)
 	{
 		dbg_msg("assert", "%s(%d): %s", filename, line, msg);
+		dbg_logger_flush();
 		dbg_break();
 	}
 }
@@ -83,29 +185,10 @@ void dbg_break()
 	*((volatile unsigned*)0) = 0x0;
 }
 
-void dbg_msg(const char *sys, const char *fmt, ...)
+/* hands a line to the loggers, called with log_lock held */
+static void log_dispatch(const char *str, const char *msg)
 {
-	va_list args;
-	char str[1024*4];
-	char *msg;
-	int i, len;
-
-	/* hold last msg, number of repetitions and time of first occurence*/
-	static char last_msg[1024*4];
-	static unsigned rep_count;
-	static int64 rep_first;
-
-	str_format(str, sizeof(str), "[%08x][%s]: ", (int)time(0), sys);
-	len = strlen(str);
-	msg = (char *)str + len;
-
-	va_start(args, fmt);
-#if defined(CONF_FAMILY_WINDOWS)
-	_vsnprintf(msg, sizeof(str)-len, fmt, args);
-#else
-	vsnprintf(msg, sizeof(str)-len, fmt, args);
-#endif
-	va_end(args);
+	int i;
 
 	//comparing 'msg', not 'str', because timestamp changes every second
 	if (str_comp(msg, last_msg) == 0)
@@ -132,10 +215,200 @@ void dbg_msg(const char *sys, const char *fmt, ...)
 	}
 }
 
+static int log_format(char *str, int size, const char *sys, const char *fmt, va_list args)
+{
+	int len;
+	str_format(str, size, "[%08x][%s]: ", (int)time(0), sys);
+	len = strlen(str);
+#if defined(CONF_FAMILY_WINDOWS)
+	_vsnprintf(str+len, size-len, fmt, args);
+	str[size-1] = 0;
+#else
+	vsnprintf(str+len, size-len, fmt, args);
+#endif
+	return len;
+}
+
+static void log_write(const char *sys, const char *fmt, va_list args)
+{
+	LOG_SLOT *ring = log_ring;
+	if(ring)
+	{
+		unsigned pos = log_head;
+		LOG_SLOT *slot;
+		for(;;)
+		{
+			int dif;
+			slot = &ring[pos&(LOG_RING_SIZE-1)];
+			dif = (int)(slot->seq-pos);
+			if(dif == 0)
+			{
+				if(atomic_cas(&log_head, pos, pos+1))
+					break;
+			}
+			else if(dif < 0)
+			{
+				atomic_inc(&log_dropped);
+				return;
+			}
+			pos = log_head;
+		}
+
+		slot->msg_offset = log_format(slot->line, sizeof(slot->line), sys, fmt, args);
+		memory_barrier();
+		slot->seq = pos+1;
+	}
+	else
+	{
+		char str[1024*4];
+		int len = log_format(str, sizeof(str), sys, fmt, args);
+		static_lock_wait(&log_lock);
+		log_dispatch(str, str+len);
+		static_lock_release(&log_lock);
+	}
+}
+
+/* empties the ring, returns the number of lines written */
+static int log_drain(void)
+{
+	LOG_SLOT *ring = log_ring_data;
+	unsigned dropped;
+	int num = 0;
+
+	static_lock_wait(&log_lock);
+	log_batching = 1;
+
+	while(ring)
+	{
+		unsigned pos = log_tail;
+		LOG_SLOT *slot = &ring[pos&(LOG_RING_SIZE-1)];
+		int dif = (int)(slot->seq-(pos+1));
+		if(dif < 0)
+			break;
+		if(dif > 0 || !atomic_cas(&log_tail, pos, pos+1))
+			continue;
+
+		memory_barrier();
+		log_dispatch(slot->line, slot->line+slot->msg_offset);
+		memory_barrier();
+		slot->seq = pos+LOG_RING_SIZE;
+		num++;
+	}
+
+	dropped = log_dropped;
+	if(dropped != log_dropped_reported)
+	{
+		char str[128];
+		int len;
+		str_format(str, sizeof(str), "[%08x][dbg/logger]: ", (int)time(0));
+		len = strlen(str);
+		str_format(str+len, sizeof(str)-len, "log full, dropped %u lines", dropped-log_dropped_reported);
+		log_dispatch(str, str+len);
+		log_dropped_reported = dropped;
+		num++;
+	}
+
+	log_batching = 0;
+	if(num)
+	{
+		fflush(stdout);
+		if(logfile)
+			io_flush(logfile);
+	}
+	static_lock_release(&log_lock);
+	return num;
+}
+
+static void log_thread_func(void *user)
+{
+	while(log_thread_running)
+	{
+		if(!log_drain())
+			thread_sleep(LOG_IDLE_MS);
+	}
+	log_drain();
+}
+
+static void log_async_stop(void)
+{
+	log_ring = 0;
+	memory_barrier();
+	log_thread_running = 0;
+	thread_wait(log_thread);
+}
+
+static void log_crash_write(int fd, const char *data, unsigned size)
+{
+	while(size > 0)
+	{
+#if defined(CONF_FAMILY_WINDOWS)
+		int written = _write(fd, data, size);
+#else
+		int written = write(fd, data, size);
+#endif
+		if(written <= 0)
+			return;
+		data += written;
+		size -= written;
+	}
+}
+
+/* gets the last lines out before the process goes down. a signal handler
+   can not use stdio or locks, so the lines that are ready are written
+   straight to the file descriptors */
+static void log_crash_handler(int sig)
+{
+	LOG_SLOT *ring = log_ring_data;
+	unsigned tail = log_tail;
+	unsigned pos;
+
+	signal(sig, SIG_DFL);
+	for(pos = tail; ring && pos-tail < LOG_RING_SIZE; pos++)
+	{
+		LOG_SLOT *slot = &ring[pos&(LOG_RING_SIZE-1)];
+		unsigned len;
+		if(slot->seq != pos+1)
+			break;
+		len = strlen(slot->line);
+		log_crash_write(1, slot->line, len);
+		log_crash_write(1, "\n", 1);
+		if(logfile_fd >= 0)
+		{
+			log_crash_write(logfile_fd, slot->line, len);
+			log_crash_write(logfile_fd, "\n", 1);
+		}
+	}
+	raise(sig);
+}
+
+void dbg_msg(const char *sys, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	log_write(sys, fmt, args);
+	va_end(args);
+}
+
+void dbg_msg_level(int level, const char *sys, const char *fmt, ...)
+{
+	va_list args;
+	if(level > log_level)
+		return;
+	va_start(args, fmt);
+	log_write(sys, fmt, args);
+	va_end(args);
+}
+
+void dbg_log_level(int level)
+{
+	log_level = level;
+}
+
 static void logger_stdout(const char *line)
 {
 	printf("%s\n", line);
-	fflush(stdout);
+	if(!log_batching)
+		fflush(stdout);
 }
 
 static void logger_debugger(const char *line)
@@ -146,13 +419,12 @@ static void logger_debugger(const char *line)
 #endif
 }
 
-
-static IOHANDLE logfile = 0;
 static void logger_file(const char *line)
 {
 	io_write(logfile, line, strlen(line));
 	io_write_newline(logfile);
-	io_flush(logfile);
+	if(!log_batching)
+		io_flush(logfile);
 }
 
 void dbg_logger_stdout() { dbg_logger(logger_stdout); }
@@ -161,11 +433,60 @@ void dbg_logger_file(const char *filename)
 {
 	logfile = io_open(filename, IOFLAG_WRITE);
 	if(logfile)
+	{
+#if defined(CONF_FAMILY_WINDOWS)
+		logfile_fd = _fileno((FILE *)logfile);
+#else
+		logfile_fd = fileno((FILE *)logfile);
+#endif
 		dbg_logger(logger_file);
+	}
 	else
 		dbg_msg("dbg/logger", "failed to open '%s' for logging", filename);
 
 }
+
+void dbg_logger_async()
+{
+	LOG_SLOT *ring;
+	unsigned i;
+
+	if(log_ring)
+		return;
+
+	ring = (LOG_SLOT *)malloc(sizeof(LOG_SLOT)*LOG_RING_SIZE);
+	for(i = 0; i < LOG_RING_SIZE; i++)
+		ring[i].seq = i;
+	log_head = 0;
+	log_tail = 0;
+	log_ring_data = ring;
+	memory_barrier();
+	log_ring = ring;
+
+	/* the thread only writes out finished lines, it never reads the configuration */
+	log_thread_running = 1;
+	log_thread = thread_create(log_thread_func, 0);
+	atexit(log_async_stop);
+
+	signal(SIGSEGV, log_crash_handler);
+	signal(SIGILL, log_crash_handler);
+	signal(SIGFPE, log_crash_handler);
+	signal(SIGABRT, log_crash_handler);
+#if defined(SIGBUS)
+	signal(SIGBUS, log_crash_handler);
+#endif
+}
+
+void dbg_logger_flush()
+{
+	if(log_ring_data)
+		log_drain();
+}
+
+unsigned dbg_logger_dropped()
+{
+	return log_dropped;
+}
 /* */
 
 typedef struct MEMHEADER
@@ -199,6 +520,8 @@ void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned al
 	header->filename = filename;
 	header->line = line;
 
+	static_lock_wait(&mem_lock);
+
 	memory_stats.allocated += header->size;
 	memory_stats.total_allocations++;
 	memory_stats.active_allocations++;
@@ -211,6 +534,8 @@ void *mem_alloc_debug(const char *filename, int line, unsigned size, unsigned al
 		first->prev = header;
 	first = header;
 
+	static_lock_release(&mem_lock);
+
 	/*dbg_msg("mem", "++ %p", header+1); */
 	return header+1;
 }
@@ -225,6 +550,7 @@ void mem_free(void *p)
 		if(tail->guard != MEM_GUARD_VAL)
 			dbg_msg("mem", "!! %p", p);
 		/* dbg_msg("mem", "-- %p", p); */
+		static_lock_wait(&mem_lock);
 		memory_stats.allocated -= header->size;
 		memory_stats.active_allocations--;
 
@@ -234,6 +560,7 @@ void mem_free(void *p)
 			first = header->next;
 		if(header->next)
 			header->next->prev = header->prev;
+		static_lock_release(&mem_lock);
 
 		free(header);
 	}
@@ -1446,6 +1773,32 @@ int fs_is_dir(const char *path)
 #endif
 }
 
+int fs_file_time(const char *path, int64 *modified)
+{
+#if defined(CONF_FAMILY_WINDOWS)
+	WIN32_FIND_DATA finddata;
+	HANDLE handle;
+	ULARGE_INTEGER time;
+
+	if ((handle = FindFirstFileA(path, &finddata)) == INVALID_HANDLE_VALUE)
+		return 1;
+	FindClose(handle);
+
+	/* filetime counts 100ns intervals since 1601 */
+	time.LowPart = finddata.ftLastWriteTime.dwLowDateTime;
+	time.HighPart = finddata.ftLastWriteTime.dwHighDateTime;
+	*modified = (int64)((time.QuadPart - 116444736000000000ULL) / 10000000);
+	return 0;
+#else
+	struct stat sb;
+	if (stat(path, &sb) == -1)
+		return 1;
+
+	*modified = (int64)sb.st_mtime;
+	return 0;
+#endif
+}
+
 int fs_chdir(const char *path)
 {
 	if(fs_is_dir(path))
@@ -1562,6 +1915,40 @@ int net_socket_read_wait(NETSOCKET sock, int time)
 	return 0;
 }
 
+int net_socket_read_wait_multi(NETSOCKET *socks, int num, int64 microseconds)
+{
+	struct timeval tv;
+	fd_set readfds;
+	int sockid;
+	int i;
+
+	tv.tv_sec = microseconds/1000000;
+	tv.tv_usec = microseconds%1000000;
+	sockid = 0;
+
+	FD_ZERO(&readfds);
+	for(i = 0; i < num; i++)
+	{
+		if(socks[i].ipv4sock >= 0)
+		{
+			FD_SET(socks[i].ipv4sock, &readfds);
+			if(socks[i].ipv4sock > sockid)
+				sockid = socks[i].ipv4sock;
+		}
+		if(socks[i].ipv6sock >= 0)
+		{
+			FD_SET(socks[i].ipv6sock, &readfds);
+			if(socks[i].ipv6sock > sockid)
+				sockid = socks[i].ipv6sock;
+		}
+	}
+
+	/* don't care about writefds and exceptfds */
+	if(select(sockid+1, &readfds, NULL, NULL, &tv) > 0)
+		return 1;
+	return 0;
+}
+
 int time_timestamp()
 {
 	return time(0);
@@ -69,6 +69,36 @@ void dbg_break();
 */
 void dbg_msg(const char *sys, const char *fmt, ...);
 
+enum
+{
+	DBG_LEVEL_STANDARD=0,
+	DBG_LEVEL_ADDINFO,
+	DBG_LEVEL_DEBUG
+};
+
+/*
+	Function: dbg_msg_level
+		Prints a debug message if the log level allows it.
+
+	Parameters:
+		level - One of the DBG_LEVEL_* values.
+		sys - A string that describes what system the message belongs to
+		fmt - A printf styled format string.
+
+	Remarks:
+		Nothing is formatted for messages above the log level.
+
+	See Also:
+		<dbg_msg>, <dbg_log_level>
+*/
+void dbg_msg_level(int level, const char *sys, const char *fmt, ...);
+
+/*
+	Function: dbg_log_level
+		Sets the highest level that <dbg_msg_level> prints.
+*/
+void dbg_log_level(int level);
+
 /* Group: Memory */
 
 /*
@@ -1060,6 +1090,19 @@ int fs_storage_path(const char *appname, char *path, int max);
 */
 int fs_is_dir(const char *path);
 
+/*
+	Function: fs_file_time
+		Gets the time a file was last modified.
+
+	Parameters:
+		path - Path of the file.
+		modified - Pointer to where the time should be stored, in seconds since the epoch.
+
+	Returns:
+		Returns 0 on success, 1 on failure.
+*/
+int fs_file_time(const char *path, int64 *modified);
+
 /*
 	Function: fs_chdir
 		Changes current working directory
@@ -1166,6 +1209,20 @@ int net_would_block();
 
 int net_socket_read_wait(NETSOCKET sock, int time);
 
+/*
+	Function: net_socket_read_wait_multi
+		Waits until one of several sockets has data to read.
+
+	Parameters:
+		socks - Sockets to wait on.
+		num - Number of sockets.
+		microseconds - Maximum time to wait.
+
+	Returns:
+		1 if there is data to read, 0 if the time ran out.
+*/
+int net_socket_read_wait_multi(NETSOCKET *socks, int num, int64 microseconds);
+
 void mem_debug_dump(IOHANDLE file);
 
 void swap_endian(void *data, unsigned elem_size, unsigned num);
@@ -1178,6 +1235,29 @@ void dbg_logger_stdout();
 void dbg_logger_debugger();
 void dbg_logger_file(const char *filename);
 
+/*
+	Function: dbg_logger_async
+		Hands log lines to the loggers from a thread of their own.
+
+	Remarks:
+		Lines are queued without locking and written in batches. When
+		the queue is full lines are dropped, see <dbg_logger_dropped>.
+		The queue is emptied when the process exits or crashes.
+*/
+void dbg_logger_async();
+
+/*
+	Function: dbg_logger_flush
+		Writes out all queued log lines before returning.
+*/
+void dbg_logger_flush();
+
+/*
+	Function: dbg_logger_dropped
+		Returns the number of log lines dropped because the queue was full.
+*/
+unsigned dbg_logger_dropped();
+
 typedef struct
 {
 	int allocated;
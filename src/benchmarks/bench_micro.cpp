@@ -0,0 +1,638 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/console.h>
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+#include <engine/shared/compression.h>
+#include <engine/shared/config.h>
+#include <engine/shared/netban.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/layers.h>
+#include <game/generated/protocol.h>
+
+/*
+	Microbenchmarks of the code that runs for every client and tick.
+
+	The inputs come from fixed seeds on a real map: the snapshots are
+	taken from players running around in it, the lines and boxes are
+	moved through its collision.
+
+	Every benchmark runs as many operations as fit in RUN_TIME, NUM_RUNS
+	times, and reports the median and the fastest run in nanoseconds per
+	operation, one line each:
+
+		<name> ops=<operations per run> median_ns=<ns> min_ns=<ns>
+
+	Usage: bench_micro <map> [-filter <text>] [-o <results file>]
+
+	Only benchmarks with the filter text in their name are run. The
+	results file gets the same values tab separated, to diff two runs.
+*/
+
+enum
+{
+	NUM_SNAPS=128,
+	NUM_PLAYERS=16,
+	NUM_PROJECTILES=24,
+	NUM_SAMPLES=1024,
+	NUM_BANS=2000,
+	NUM_RANGE_BANS=200,
+
+	NUM_RUNS=9,
+	RUN_TIME_US=20000,
+};
+
+static int NextRandom(unsigned *pSeed)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return (*pSeed>>16)&0x7fff;
+}
+
+class CBenchData
+{
+public:
+	CCollision *m_pCollision;
+	IConsole *m_pConsole;
+	CNetBan *m_pNetBan;
+
+	// snapshots of consecutive ticks and the deltas between every second one
+	CSnapshotDelta *m_pSnapshotDelta;
+	CSnapshot *m_apSnaps[NUM_SNAPS];
+	int m_aSnapSizes[NUM_SNAPS];
+	char *m_apDeltas[NUM_SNAPS];
+	int m_aDeltaSizes[NUM_SNAPS];
+	char *m_apCompressed[NUM_SNAPS];
+	int m_aCompressedSizes[NUM_SNAPS];
+	char *m_apPackets[NUM_SNAPS];
+	int m_aPacketSizes[NUM_SNAPS];
+
+	// world with players that move on their own
+	CWorldCore m_World;
+	CCharacterCore m_aCores[NUM_PLAYERS];
+	vec2 m_aSpawns[NUM_PLAYERS];
+	CNetObj_PlayerInput m_aInputs[NUM_PLAYERS];
+	unsigned m_InputSeed;
+
+	vec2 m_aLineFrom[NUM_SAMPLES];
+	vec2 m_aLineTo[NUM_SAMPLES];
+	vec2 m_aBoxPos[NUM_SAMPLES];
+	vec2 m_aBoxVel[NUM_SAMPLES];
+	NETADDR m_aAddrs[NUM_SAMPLES];
+};
+
+static vec2 FreePosition(CCollision *pCollision, unsigned *pSeed)
+{
+	int Width = pCollision->GetWidth();
+	int Height = pCollision->GetHeight();
+	vec2 Pos;
+	for(int Try = 0; Try < 10000; Try++)
+	{
+		Pos = vec2((NextRandom(pSeed)%Width)*32+16.0f, (NextRandom(pSeed)%Height)*32+16.0f);
+		if(!pCollision->TestBox(Pos, vec2(28.0f, 28.0f)))
+			break;
+	}
+	return Pos;
+}
+
+// plays like a bunch of nervous players, see bench_physics
+static void StepWorld(CBenchData *pData)
+{
+	CCollision *pCollision = pData->m_pCollision;
+	for(int p = 0; p < NUM_PLAYERS; p++)
+	{
+		CNetObj_PlayerInput *pInput = &pData->m_aInputs[p];
+		unsigned *pSeed = &pData->m_InputSeed;
+		if(NextRandom(pSeed)%8 == 0)
+			pInput->m_Direction = NextRandom(pSeed)%3 - 1;
+		if(NextRandom(pSeed)%6 == 0)
+			pInput->m_Jump = NextRandom(pSeed)%3 == 0;
+		if(NextRandom(pSeed)%10 == 0)
+		{
+			pInput->m_Hook = NextRandom(pSeed)%2;
+			pInput->m_TargetX = NextRandom(pSeed)%512 - 256;
+			pInput->m_TargetY = NextRandom(pSeed)%512 - 256;
+		}
+
+		vec2 Pos = pData->m_aCores[p].m_Pos;
+		if(Pos.x < -32.0f || Pos.x >= pCollision->GetWidth()*32+32.0f || Pos.y < -32.0f || Pos.y >= pCollision->GetHeight()*32+32.0f ||
+			(pCollision->GetCollisionAt(Pos.x, Pos.y)&CCollision::COLFLAG_DEATH))
+		{
+			pData->m_aCores[p].Reset();
+			pData->m_aCores[p].m_Pos = pData->m_aSpawns[p];
+		}
+		pData->m_aCores[p].m_Input = *pInput;
+	}
+
+	for(int p = 0; p < NUM_PLAYERS; p++)
+		pData->m_aCores[p].Tick(true);
+	for(int p = 0; p < NUM_PLAYERS; p++)
+	{
+		pData->m_aCores[p].Move();
+		pData->m_aCores[p].Quantize();
+	}
+}
+
+// builds the snapshot a client would get of the world at the given tick
+static int BuildSnapshot(CBenchData *pData, CSnapshotBuilder *pBuilder, int Tick, void *pSnapData)
+{
+	pBuilder->Init();
+
+	CNetObj_GameInfo *pGameInfo = (CNetObj_GameInfo *)pBuilder->NewItem(NETOBJTYPE_GAMEINFO, 0, sizeof(CNetObj_GameInfo));
+	mem_zero(pGameInfo, sizeof(*pGameInfo));
+	pGameInfo->m_GameFlags = GAMEFLAG_TEAMS;
+	pGameInfo->m_ScoreLimit = 800;
+	pGameInfo->m_TimeLimit = 10;
+	pGameInfo->m_RoundNum = 1;
+	pGameInfo->m_RoundCurrent = 1;
+
+	for(int p = 0; p < NUM_PLAYERS; p++)
+	{
+		CNetObj_ClientInfo *pClientInfo = (CNetObj_ClientInfo *)pBuilder->NewItem(NETOBJTYPE_CLIENTINFO, p, sizeof(CNetObj_ClientInfo));
+		mem_zero(pClientInfo, sizeof(*pClientInfo));
+		pClientInfo->m_Name0 = 0x6c6f6164+p;
+		pClientInfo->m_Country = -1;
+		pClientInfo->m_ColorBody = 0xff00+p*4096;
+
+		CNetObj_PlayerInfo *pPlayerInfo = (CNetObj_PlayerInfo *)pBuilder->NewItem(NETOBJTYPE_PLAYERINFO, p, sizeof(CNetObj_PlayerInfo));
+		pPlayerInfo->m_Local = p == 0;
+		pPlayerInfo->m_ClientID = p;
+		pPlayerInfo->m_Team = p&1;
+		pPlayerInfo->m_Score = Tick/(200+p*10);
+		pPlayerInfo->m_Latency = 40+(Tick/50+p)%7;
+
+		CNetObj_Character *pCharacter = (CNetObj_Character *)pBuilder->NewItem(NETOBJTYPE_CHARACTER, p, sizeof(CNetObj_Character));
+		mem_zero(pCharacter, sizeof(*pCharacter));
+		pData->m_aCores[p].Write(pCharacter);
+		pCharacter->m_Tick = Tick;
+		pCharacter->m_Health = 10;
+		pCharacter->m_AmmoCount = 10;
+		pCharacter->m_Weapon = (Tick/100+p)%3;
+		pCharacter->m_AttackTick = Tick-(Tick+p*13)%40;
+	}
+
+	// projectiles fly for a while and get replaced
+	for(int i = 0; i < NUM_PROJECTILES; i++)
+	{
+		int StartTick = Tick-(Tick+i*7)%60;
+		const CCharacterCore *pOwner = &pData->m_aCores[i%NUM_PLAYERS];
+		CNetObj_Projectile *pProj = (CNetObj_Projectile *)pBuilder->NewItem(NETOBJTYPE_PROJECTILE, 100+i*64+StartTick%64, sizeof(CNetObj_Projectile));
+		pProj->m_X = (int)pOwner->m_Pos.x;
+		pProj->m_Y = (int)pOwner->m_Pos.y;
+		pProj->m_VelX = (i%3-1)*1100;
+		pProj->m_VelY = -300+i*25;
+		pProj->m_Type = WEAPON_GRENADE;
+		pProj->m_StartTick = StartTick;
+	}
+
+	return pBuilder->Finish(pSnapData);
+}
+
+static void SetupSnapshots(CBenchData *pData)
+{
+	unsigned Seed = 0x5eed;
+	pData->m_InputSeed = 0x2f6b3a1d;
+	mem_zero(pData->m_aInputs, sizeof(pData->m_aInputs));
+	for(int p = 0; p < NUM_PLAYERS; p++)
+	{
+		pData->m_aSpawns[p] = FreePosition(pData->m_pCollision, &Seed);
+		pData->m_aCores[p].Init(&pData->m_World, pData->m_pCollision);
+		pData->m_aCores[p].Reset();
+		pData->m_aCores[p].m_Pos = pData->m_aSpawns[p];
+		pData->m_World.m_apCharacters[p] = &pData->m_aCores[p];
+	}
+
+	pData->m_pSnapshotDelta = new CSnapshotDelta;
+	CNetObjHandler NetObjHandler;
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		pData->m_pSnapshotDelta->SetStaticsize(i, NetObjHandler.GetObjSize(i));
+
+	// let the players spread out first
+	for(int t = 0; t < 250; t++)
+		StepWorld(pData);
+
+	CSnapshotBuilder *pBuilder = new CSnapshotBuilder;
+	char *pBuffer = (char *)mem_alloc(CSnapshot::MAX_SIZE, 1);
+	for(int i = 0; i < NUM_SNAPS; i++)
+	{
+		StepWorld(pData);
+		int Size = BuildSnapshot(pData, pBuilder, 1000+i, pBuffer);
+		pData->m_apSnaps[i] = (CSnapshot *)mem_alloc(Size, 1);
+		mem_copy(pData->m_apSnaps[i], pBuffer, Size);
+		pData->m_aSnapSizes[i] = Size;
+	}
+
+	for(int i = 0; i < NUM_SNAPS; i++)
+	{
+		// the server sends every second tick and the client acks the last one
+		int Size = pData->m_pSnapshotDelta->CreateDelta(pData->m_apSnaps[max(i-2, 0)], pData->m_apSnaps[i], pBuffer);
+		pData->m_apDeltas[i] = (char *)mem_alloc(max(Size, 1), 1);
+		mem_copy(pData->m_apDeltas[i], pBuffer, Size);
+		pData->m_aDeltaSizes[i] = Size;
+
+		Size = (int)CVariableInt::Compress(pData->m_apDeltas[i], pData->m_aDeltaSizes[i], pBuffer);
+		pData->m_apCompressed[i] = (char *)mem_alloc(max(Size, 1), 1);
+		mem_copy(pData->m_apCompressed[i], pBuffer, Size);
+		pData->m_aCompressedSizes[i] = Size;
+
+		// the first part of the snapshot as it goes into a packet
+		int ChunkSize = min(Size, (int)NET_MAX_PAYLOAD-64);
+		Size = CNetBase::Compress(pData->m_apCompressed[i], ChunkSize, pBuffer, NET_MAX_PACKETSIZE);
+		pData->m_apPackets[i] = (char *)mem_alloc(max(Size, 1), 1);
+		mem_copy(pData->m_apPackets[i], pBuffer, Size);
+		pData->m_aPacketSizes[i] = Size;
+	}
+	mem_free(pBuffer);
+	delete pBuilder;
+}
+
+static void SetupCollision(CBenchData *pData)
+{
+	unsigned Seed = 0xc011;
+	for(int i = 0; i < NUM_SAMPLES; i++)
+	{
+		// laser length lines and boxes at player speed
+		vec2 From = FreePosition(pData->m_pCollision, &Seed);
+		float Angle = (NextRandom(&Seed)%3600)/3600.0f*2*pi;
+		pData->m_aLineFrom[i] = From;
+		pData->m_aLineTo[i] = From+vec2(cosf(Angle), sinf(Angle))*800.0f;
+
+		pData->m_aBoxPos[i] = FreePosition(pData->m_pCollision, &Seed);
+		pData->m_aBoxVel[i] = vec2(NextRandom(&Seed)%61-30.0f, NextRandom(&Seed)%61-30.0f);
+	}
+}
+
+static void RandomAddr(NETADDR *pAddr, unsigned *pSeed)
+{
+	mem_zero(pAddr, sizeof(*pAddr));
+	pAddr->type = NETTYPE_IPV4;
+	pAddr->ip[0] = 1+NextRandom(pSeed)%220;
+	pAddr->ip[1] = NextRandom(pSeed)%256;
+	pAddr->ip[2] = NextRandom(pSeed)%256;
+	pAddr->ip[3] = NextRandom(pSeed)%256;
+}
+
+static void SetupNetBan(CBenchData *pData, IStorage *pStorage)
+{
+	unsigned Seed = 0xba4;
+	pData->m_pNetBan = new CNetBan;
+	pData->m_pNetBan->Init(pData->m_pConsole, pStorage);
+
+	NETADDR aBanned[NUM_BANS];
+	for(int i = 0; i < NUM_BANS; i++)
+	{
+		RandomAddr(&aBanned[i], &Seed);
+		pData->m_pNetBan->BanAddr(&aBanned[i], 0, "bench");
+	}
+	for(int i = 0; i < NUM_RANGE_BANS; i++)
+	{
+		CNetRange Range;
+		RandomAddr(&Range.m_LB, &Seed);
+		Range.m_LB.ip[3] = 0;
+		Range.m_UB = Range.m_LB;
+		Range.m_UB.ip[3] = 255;
+		pData->m_pNetBan->BanRange(&Range, 0, "bench");
+	}
+
+	// one in eight lookups hits a ban
+	for(int i = 0; i < NUM_SAMPLES; i++)
+	{
+		if(i%8 == 0)
+			pData->m_aAddrs[i] = aBanned[NextRandom(&Seed)%NUM_BANS];
+		else
+			RandomAddr(&pData->m_aAddrs[i], &Seed);
+	}
+}
+
+typedef unsigned (*FBenchmark)(CBenchData *pData, int Ops);
+
+static unsigned BenchCreateDelta(CBenchData *pData, int Ops)
+{
+	static char s_aDelta[CSnapshot::MAX_SIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = 2+i%(NUM_SNAPS-2);
+		Sum += pData->m_pSnapshotDelta->CreateDelta(pData->m_apSnaps[s-2], pData->m_apSnaps[s], s_aDelta);
+	}
+	return Sum;
+}
+
+static unsigned BenchUnpackDelta(CBenchData *pData, int Ops)
+{
+	static char s_aSnap[CSnapshot::MAX_SIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = 2+i%(NUM_SNAPS-2);
+		Sum += pData->m_pSnapshotDelta->UnpackDelta(pData->m_apSnaps[s-2], (CSnapshot *)s_aSnap, pData->m_apDeltas[s], pData->m_aDeltaSizes[s]);
+	}
+	return Sum;
+}
+
+static unsigned BenchVarIntCompress(CBenchData *pData, int Ops)
+{
+	static char s_aOut[CSnapshot::MAX_SIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = i%NUM_SNAPS;
+		Sum += (unsigned)CVariableInt::Compress(pData->m_apDeltas[s], pData->m_aDeltaSizes[s], s_aOut);
+	}
+	return Sum;
+}
+
+static unsigned BenchVarIntDecompress(CBenchData *pData, int Ops)
+{
+	static char s_aOut[CSnapshot::MAX_SIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = i%NUM_SNAPS;
+		Sum += (unsigned)CVariableInt::Decompress(pData->m_apCompressed[s], pData->m_aCompressedSizes[s], s_aOut);
+	}
+	return Sum;
+}
+
+static unsigned BenchHuffmanCompress(CBenchData *pData, int Ops)
+{
+	char aOut[NET_MAX_PACKETSIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = i%NUM_SNAPS;
+		int Size = min(pData->m_aCompressedSizes[s], (int)NET_MAX_PAYLOAD-64);
+		Sum += CNetBase::Compress(pData->m_apCompressed[s], Size, aOut, sizeof(aOut));
+	}
+	return Sum;
+}
+
+static unsigned BenchHuffmanDecompress(CBenchData *pData, int Ops)
+{
+	char aOut[NET_MAX_PACKETSIZE];
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = i%NUM_SNAPS;
+		Sum += CNetBase::Decompress(pData->m_apPackets[s], pData->m_aPacketSizes[s], aOut, sizeof(aOut));
+	}
+	return Sum;
+}
+
+// an input message and a chat line, like most of what a client sends
+static void PackMessages(CPacker *pPacker, int Tick, const CNetObj_PlayerInput *pInput)
+{
+	pPacker->Reset();
+	pPacker->AddInt(NETMSG_INPUT);
+	pPacker->AddInt(Tick-2);
+	pPacker->AddInt(Tick);
+	pPacker->AddInt(sizeof(CNetObj_PlayerInput));
+	const int *pData = (const int *)pInput;
+	for(unsigned i = 0; i < sizeof(CNetObj_PlayerInput)/sizeof(int); i++)
+		pPacker->AddInt(pData[i]);
+	pPacker->AddInt(NETMSGTYPE_CL_SAY);
+	pPacker->AddInt(0);
+	pPacker->AddString("gg, one more round on this map?", 128);
+}
+
+static unsigned BenchPacker(CBenchData *pData, int Ops)
+{
+	CPacker Packer;
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		PackMessages(&Packer, i, &pData->m_aInputs[i%NUM_PLAYERS]);
+		Sum += Packer.Size();
+	}
+	return Sum;
+}
+
+static unsigned BenchUnpacker(CBenchData *pData, int Ops)
+{
+	CPacker aPackers[NUM_PLAYERS];
+	for(int p = 0; p < NUM_PLAYERS; p++)
+		PackMessages(&aPackers[p], 1000+p, &pData->m_aInputs[p]);
+
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		const CPacker *pPacker = &aPackers[i%NUM_PLAYERS];
+		CUnpacker Unpacker;
+		Unpacker.Reset(pPacker->Data(), pPacker->Size());
+		for(int n = 0; n < 4+(int)(sizeof(CNetObj_PlayerInput)/sizeof(int)); n++)
+			Sum += Unpacker.GetInt();
+		Sum += Unpacker.GetInt()+Unpacker.GetInt();
+		Sum += Unpacker.GetString(CUnpacker::SANITIZE_CC)[0];
+	}
+	return Sum;
+}
+
+static unsigned BenchIntersectLine(CBenchData *pData, int Ops)
+{
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		vec2 At, Before;
+		int s = i%NUM_SAMPLES;
+		Sum += pData->m_pCollision->IntersectLine(pData->m_aLineFrom[s], pData->m_aLineTo[s], &At, &Before);
+	}
+	return Sum;
+}
+
+static unsigned BenchMoveBox(CBenchData *pData, int Ops)
+{
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+	{
+		int s = i%NUM_SAMPLES;
+		vec2 Pos = pData->m_aBoxPos[s];
+		vec2 Vel = pData->m_aBoxVel[s];
+		pData->m_pCollision->MoveBox(&Pos, &Vel, vec2(28.0f, 28.0f), 0.0f);
+		Sum += (unsigned)Pos.x;
+	}
+	return Sum;
+}
+
+// one operation is a tick of all players
+static unsigned BenchCharacterCore(CBenchData *pData, int Ops)
+{
+	for(int i = 0; i < Ops; i++)
+		StepWorld(pData);
+	return (unsigned)pData->m_aCores[0].m_Pos.x;
+}
+
+static unsigned BenchNetBan(CBenchData *pData, int Ops)
+{
+	unsigned Sum = 0;
+	for(int i = 0; i < Ops; i++)
+		Sum += pData->m_pNetBan->IsBanned(&pData->m_aAddrs[i%NUM_SAMPLES], 0, 0);
+	return Sum;
+}
+
+static unsigned BenchExecuteLine(CBenchData *pData, int Ops)
+{
+	static const char *s_apLines[] = {
+		"sv_scorelimit 800",
+		"sv_name \"bench server\"",
+		"sv_timelimit 10; sv_spectator_slots 2",
+		"sv_motd \"welcome\"",
+	};
+	for(int i = 0; i < Ops; i++)
+		pData->m_pConsole->ExecuteLine(s_apLines[i%(sizeof(s_apLines)/sizeof(s_apLines[0]))]);
+	return g_Config.m_SvScorelimit;
+}
+
+static const struct
+{
+	const char *m_pName;
+	FBenchmark m_pfnBench;
+} s_aBenchmarks[] = {
+	{"snapshot_create_delta", BenchCreateDelta},
+	{"snapshot_unpack_delta", BenchUnpackDelta},
+	{"varint_compress", BenchVarIntCompress},
+	{"varint_decompress", BenchVarIntDecompress},
+	{"huffman_compress", BenchHuffmanCompress},
+	{"huffman_decompress", BenchHuffmanDecompress},
+	{"packer_pack", BenchPacker},
+	{"packer_unpack", BenchUnpacker},
+	{"collision_intersect_line", BenchIntersectLine},
+	{"collision_move_box", BenchMoveBox},
+	{"charactercore_tick_16", BenchCharacterCore},
+	{"netban_is_banned", BenchNetBan},
+	{"console_execute_line", BenchExecuteLine},
+};
+
+static volatile unsigned gs_Sink;
+
+static int64 TimeRun(CBenchData *pData, FBenchmark pfnBench, int Ops)
+{
+	int64 Start = time_get();
+	gs_Sink += pfnBench(pData, Ops);
+	return time_get()-Start;
+}
+
+static int CompareTimes(const void *pA, const void *pB)
+{
+	int64 A = *(const int64 *)pA;
+	int64 B = *(const int64 *)pB;
+	return A < B ? -1 : A > B;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	const char *pFilter = "";
+	const char *pOutput = 0;
+	if(argc < 2)
+	{
+		dbg_logger_stdout();
+		dbg_msg("bench_micro", "usage: %s <map> [-filter <text>] [-o <results file>]", argv[0]); // ignore_convention
+		return -1;
+	}
+	for(int i = 2; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-filter") == 0 && i+1 < argc) // ignore_convention
+			pFilter = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-o") == 0 && i+1 < argc) // ignore_convention
+			pOutput = argv[++i]; // ignore_convention
+	}
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv); // ignore_convention
+	IEngineMap *pEngineMap = CreateEngineMap();
+	IConsole *pConsole = CreateConsole(CFGFLAG_SERVER);
+
+	bool RegisterFail = !pKernel->RegisterInterface(pStorage);
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+	RegisterFail |= !pKernel->RegisterInterface(pConsole);
+	if(RegisterFail)
+		return -1;
+
+	// every ban is logged, set them up before there is a logger
+	CBenchData *pData = new CBenchData;
+	pData->m_pConsole = pConsole;
+	SetupNetBan(pData, pStorage);
+	dbg_logger_stdout();
+
+	if(!pEngineMap->Load(argv[1])) // ignore_convention
+	{
+		dbg_msg("bench_micro", "failed to load map '%s'", argv[1]); // ignore_convention
+		return -1;
+	}
+
+	CNetBase::Init();
+	CLayers Layers;
+	CCollision Collision;
+	Layers.Init(pKernel);
+	Collision.Init(&Layers);
+
+	pData->m_pCollision = &Collision;
+	SetupSnapshots(pData);
+	SetupCollision(pData);
+
+	int AvgSnap = 0, AvgDelta = 0, AvgCompressed = 0;
+	for(int i = 0; i < NUM_SNAPS; i++)
+	{
+		AvgSnap += pData->m_aSnapSizes[i];
+		AvgDelta += pData->m_aDeltaSizes[i];
+		AvgCompressed += pData->m_aCompressedSizes[i];
+	}
+	dbg_msg("bench_micro", "map '%s', %d snapshots of %d bytes, deltas of %d bytes, %d compressed", argv[1], NUM_SNAPS, // ignore_convention
+		AvgSnap/NUM_SNAPS, AvgDelta/NUM_SNAPS, AvgCompressed/NUM_SNAPS);
+
+	IOHANDLE OutputFile = 0;
+	if(pOutput)
+	{
+		OutputFile = io_open(pOutput, IOFLAG_WRITE);
+		if(!OutputFile)
+		{
+			dbg_msg("bench_micro", "failed to open '%s'", pOutput);
+			return -1;
+		}
+		const char *pHeader = "name\tops\tmedian_ns\tmin_ns";
+		io_write(OutputFile, pHeader, str_length(pHeader));
+		io_write_newline(OutputFile);
+	}
+
+	int64 Freq = time_freq();
+	for(unsigned b = 0; b < sizeof(s_aBenchmarks)/sizeof(s_aBenchmarks[0]); b++)
+	{
+		if(!str_find(s_aBenchmarks[b].m_pName, pFilter))
+			continue;
+
+		// grow the run until it is long enough to measure, this warms up as well
+		int Ops = 16;
+		while(Ops < (1<<28) && TimeRun(pData, s_aBenchmarks[b].m_pfnBench, Ops) < Freq*RUN_TIME_US/1000000)
+			Ops *= 2;
+
+		int64 aTimes[NUM_RUNS];
+		for(int r = 0; r < NUM_RUNS; r++)
+			aTimes[r] = TimeRun(pData, s_aBenchmarks[b].m_pfnBench, Ops);
+		qsort(aTimes, NUM_RUNS, sizeof(aTimes[0]), CompareTimes);
+
+		double Median = aTimes[NUM_RUNS/2]*1000000000.0/Freq/Ops;
+		double Min = aTimes[0]*1000000000.0/Freq/Ops;
+		dbg_msg("bench_micro", "%s ops=%d median_ns=%.1f min_ns=%.1f", s_aBenchmarks[b].m_pName, Ops, Median, Min);
+
+		if(OutputFile)
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "%s\t%d\t%.1f\t%.1f", s_aBenchmarks[b].m_pName, Ops, Median, Min);
+			io_write(OutputFile, aBuf, str_length(aBuf));
+			io_write_newline(OutputFile);
+		}
+	}
+
+	if(OutputFile)
+		io_close(OutputFile);
+	pEngineMap->Unload();
+	return 0;
+}
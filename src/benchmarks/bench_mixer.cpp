@@ -0,0 +1,140 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/mixer.h>
+
+/*
+	Sound mixer benchmark.
+
+	Mixes generated voices the way the client sound callback does, without
+	SDL. The samples keep their own rate and are resampled while mixing.
+	The vectorised and the portable code are checked against each other
+	before they are measured.
+
+	Usage: bench_mixer [voices] [buffers] [frames] [mixing rate]
+*/
+
+enum
+{
+	NUM_SAMPLES=8,
+	SAMPLE_FRAMES=22050,
+};
+
+static int NextRandom(unsigned *pSeed)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return (*pSeed>>16)&0x7fff;
+}
+
+class CBenchSample
+{
+public:
+	short *m_pData;
+	int m_NumFrames;
+	int m_Rate;
+	int m_Channels;
+};
+
+static void SetupVoices(CMixer *pMixer, const CBenchSample *pSamples, int NumVoices, int MixingRate)
+{
+	unsigned Seed = 1337;
+	pMixer->Clear();
+	for(int i = 0; i < NumVoices; i++)
+	{
+		const CBenchSample *pSample = &pSamples[i%NUM_SAMPLES];
+		pMixer->AddVoice(pSample->m_pData, pSample->m_NumFrames, pSample->m_Channels, NextRandom(&Seed)%pSample->m_NumFrames, 0,
+			CMixer::Step(pSample->m_Rate, MixingRate), true, NextRandom(&Seed)%256, NextRandom(&Seed)%256);
+	}
+}
+
+static void AdvanceVoices(CMixer *pMixer, unsigned Frames)
+{
+	for(int i = 0; i < pMixer->m_NumVoices; i++)
+		CMixer::Advance(&pMixer->m_aFrame[i], &pMixer->m_aFrac[i], pMixer->m_aStep[i], pMixer->m_aNumFrames[i], pMixer->m_aLoop[i] != 0, Frames);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumVoices = argc > 1 ? clamp(str_toint(argv[1]), 1, (int)CMixer::MAX_VOICES) : CMixer::MAX_VOICES;
+	int NumBuffers = argc > 2 ? max(str_toint(argv[2]), 1) : 20000;
+	int Frames = argc > 3 ? max(str_toint(argv[3]), 1) : 512;
+	int MixingRate = argc > 4 ? max(str_toint(argv[4]), 8000) : 48000;
+
+	// mono and stereo noise at the common sample rates
+	static const int s_aRates[] = {44100, 22050, 48000, 11025};
+	CBenchSample aSamples[NUM_SAMPLES];
+	unsigned Seed = 42;
+	for(int i = 0; i < NUM_SAMPLES; i++)
+	{
+		aSamples[i].m_NumFrames = SAMPLE_FRAMES;
+		aSamples[i].m_Rate = s_aRates[i%4];
+		aSamples[i].m_Channels = 1+i%2;
+		aSamples[i].m_pData = (short *)mem_alloc(SAMPLE_FRAMES*aSamples[i].m_Channels*sizeof(short), 1);
+		for(int j = 0; j < SAMPLE_FRAMES*aSamples[i].m_Channels; j++)
+			aSamples[i].m_pData[j] = (short)(NextRandom(&Seed)*2-0x7fff);
+	}
+
+	int *pMixBuffer = (int *)mem_alloc(Frames*2*sizeof(int), 1);
+	int *pCheckBuffer = (int *)mem_alloc(Frames*2*sizeof(int), 1);
+	short *pOut = (short *)mem_alloc(Frames*2*sizeof(short), 1);
+	short *pCheckOut = (short *)mem_alloc(Frames*2*sizeof(short), 1);
+
+	// verify that both paths give the same samples
+	{
+		CMixer Mixer;
+		SetupVoices(&Mixer, aSamples, NumVoices, MixingRate);
+		for(int b = 0; b < 64; b++)
+		{
+			mem_zero(pMixBuffer, Frames*2*sizeof(int));
+			mem_zero(pCheckBuffer, Frames*2*sizeof(int));
+			Mixer.Mix(pMixBuffer, Frames);
+			Mixer.Mix(pCheckBuffer, Frames, true);
+			CMixer::Finish(pOut, pMixBuffer, Frames, 100);
+			CMixer::FinishScalar(pCheckOut, pCheckBuffer, Frames, 100);
+			if(mem_comp(pMixBuffer, pCheckBuffer, Frames*2*sizeof(int)) != 0 || mem_comp(pOut, pCheckOut, Frames*2*sizeof(short)) != 0)
+			{
+				dbg_msg("bench_mixer", "mismatch in buffer %d", b);
+				return 1;
+			}
+			AdvanceVoices(&Mixer, Frames);
+		}
+		dbg_msg("bench_mixer", "verify: ok");
+	}
+
+	// measure
+	for(int Scalar = 1; Scalar >= 0; Scalar--)
+	{
+		CMixer Mixer;
+		SetupVoices(&Mixer, aSamples, NumVoices, MixingRate);
+
+		int64 Start = time_get();
+		for(int b = 0; b < NumBuffers; b++)
+		{
+			mem_zero(pMixBuffer, Frames*2*sizeof(int));
+			Mixer.Mix(pMixBuffer, Frames, Scalar != 0);
+			if(Scalar)
+				CMixer::FinishScalar(pOut, pMixBuffer, Frames, 100);
+			else
+				CMixer::Finish(pOut, pMixBuffer, Frames, 100);
+			AdvanceVoices(&Mixer, Frames);
+		}
+		int64 End = time_get();
+
+		double Seconds = (End-Start)/(double)time_freq();
+		double AudioSeconds = NumBuffers*(double)Frames/MixingRate;
+		dbg_msg("bench_mixer", "%s: %d voices, %d buffers of %d frames, %.3f ms, %.0fx realtime", Scalar ? "scalar" : "vector",
+			NumVoices, NumBuffers, Frames, Seconds*1000.0, AudioSeconds/Seconds);
+	}
+
+	for(int i = 0; i < NUM_SAMPLES; i++)
+		mem_free(aSamples[i].m_pData);
+	mem_free(pMixBuffer);
+	mem_free(pCheckBuffer);
+	mem_free(pOut);
+	mem_free(pCheckOut);
+	return 0;
+}
@@ -0,0 +1,323 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/kernel.h>
+#include <engine/map.h>
+#include <engine/storage.h>
+
+#include <game/collision.h>
+#include <game/gamecore.h>
+#include <game/gamecore_batch.h>
+#include <game/layers.h>
+
+/*
+	Physics throughput benchmark.
+
+	Runs a recorded input stream through CCharacterCore::Tick()/Move()
+	and through CWorldCoreBatch::Step() and checks that both produce the
+	same state every tick.
+
+	Usage: bench_physics <map> <input stream> [ticks] [players]
+
+	If the input stream can't be opened a random one is generated with
+	the given amount of ticks and players and saved under that name.
+*/
+
+static const char s_aStreamMagic[8] = {'T', 'W', 'P', 'H', 'Y', 'S', 'I', 'N'};
+
+enum
+{
+	STREAM_VERSION=1,
+};
+
+static int NextRandom(unsigned *pSeed)
+{
+	*pSeed = *pSeed*1103515245+12345;
+	return (*pSeed>>16)&0x7fff;
+}
+
+struct CSpawn
+{
+	int m_X;
+	int m_Y;
+	int m_Frozen;
+};
+
+class CInputStream
+{
+public:
+	int m_NumTicks;
+	int m_NumPlayers;
+	CSpawn m_aSpawns[MAX_CLIENTS];
+	CNetObj_PlayerInput *m_pInputs;
+
+	CInputStream() : m_NumTicks(0), m_NumPlayers(0), m_pInputs(0) {}
+	~CInputStream() { mem_free(m_pInputs); }
+
+	CNetObj_PlayerInput *Input(int Tick, int Player) { return &m_pInputs[Tick*m_NumPlayers+Player]; }
+
+	void Alloc(int NumTicks, int NumPlayers)
+	{
+		m_NumTicks = NumTicks;
+		m_NumPlayers = NumPlayers;
+		m_pInputs = (CNetObj_PlayerInput *)mem_alloc(NumTicks*NumPlayers*sizeof(CNetObj_PlayerInput), 1);
+		mem_zero(m_pInputs, NumTicks*NumPlayers*sizeof(CNetObj_PlayerInput));
+	}
+
+	bool Load(const char *pFilename)
+	{
+		IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+		if(!File)
+			return false;
+
+		char aMagic[sizeof(s_aStreamMagic)];
+		int aHeader[3];
+		bool Valid = io_read(File, aMagic, sizeof(aMagic)) == sizeof(aMagic) && mem_comp(aMagic, s_aStreamMagic, sizeof(aMagic)) == 0 &&
+			io_read(File, aHeader, sizeof(aHeader)) == sizeof(aHeader) && aHeader[0] == STREAM_VERSION &&
+			aHeader[1] > 0 && aHeader[2] > 0 && aHeader[2] <= MAX_CLIENTS;
+		if(Valid)
+		{
+			Alloc(aHeader[1], aHeader[2]);
+			unsigned InputSize = m_NumTicks*m_NumPlayers*sizeof(CNetObj_PlayerInput);
+			Valid = io_read(File, m_aSpawns, m_NumPlayers*sizeof(CSpawn)) == m_NumPlayers*sizeof(CSpawn) &&
+				io_read(File, m_pInputs, InputSize) == InputSize;
+		}
+		io_close(File);
+		return Valid;
+	}
+
+	bool Save(const char *pFilename)
+	{
+		IOHANDLE File = io_open(pFilename, IOFLAG_WRITE);
+		if(!File)
+			return false;
+
+		int aHeader[3] = {STREAM_VERSION, m_NumTicks, m_NumPlayers};
+		io_write(File, s_aStreamMagic, sizeof(s_aStreamMagic));
+		io_write(File, aHeader, sizeof(aHeader));
+		io_write(File, m_aSpawns, m_NumPlayers*sizeof(CSpawn));
+		io_write(File, m_pInputs, m_NumTicks*m_NumPlayers*sizeof(CNetObj_PlayerInput));
+		io_close(File);
+		return true;
+	}
+
+	// plays like a bunch of very nervous players that hook each other a lot
+	void Generate(CCollision *pCollision, int NumTicks, int NumPlayers)
+	{
+		unsigned Seed = 0x2f6b3a1d;
+
+		Alloc(NumTicks, NumPlayers);
+
+		int Width = pCollision->GetWidth();
+		int Height = pCollision->GetHeight();
+		for(int p = 0; p < NumPlayers; p++)
+		{
+			// spawn in the air, close to the center so players meet each other
+			vec2 Pos;
+			for(int Try = 0; Try < 10000; Try++)
+			{
+				int x = Width/4 + NextRandom(&Seed)%max(Width/2, 1);
+				int y = Height/4 + NextRandom(&Seed)%max(Height/2, 1);
+				Pos = vec2(x*32+16.0f, y*32+16.0f);
+				if(!pCollision->TestBox(Pos, vec2(28.0f, 28.0f)))
+					break;
+			}
+			m_aSpawns[p].m_X = round_to_int(Pos.x);
+			m_aSpawns[p].m_Y = round_to_int(Pos.y);
+			m_aSpawns[p].m_Frozen = 0;
+			if(NextRandom(&Seed)%4 == 0)
+				m_aSpawns[p].m_Frozen = NextRandom(&Seed)%150;
+		}
+
+		CNetObj_PlayerInput aCurrent[MAX_CLIENTS];
+		mem_zero(aCurrent, sizeof(aCurrent));
+		for(int t = 0; t < NumTicks; t++)
+		{
+			for(int p = 0; p < NumPlayers; p++)
+			{
+				CNetObj_PlayerInput *pInput = &aCurrent[p];
+				if(NextRandom(&Seed)%8 == 0)
+					pInput->m_Direction = NextRandom(&Seed)%3 - 1;
+				if(NextRandom(&Seed)%6 == 0)
+					pInput->m_Jump = NextRandom(&Seed)%3 == 0;
+				if(NextRandom(&Seed)%10 == 0)
+				{
+					pInput->m_Hook = NextRandom(&Seed)%2;
+					pInput->m_TargetX = NextRandom(&Seed)%512 - 256;
+					pInput->m_TargetY = NextRandom(&Seed)%512 - 256;
+				}
+				*Input(t, p) = *pInput;
+			}
+		}
+	}
+};
+
+class CPhysicsRun
+{
+public:
+	CWorldCore m_World;
+	CCharacterCore m_aCores[MAX_CLIENTS];
+	CWorldCoreBatch m_Batch;
+	bool m_aUseInput[MAX_CLIENTS];
+
+	void Init(CCollision *pCollision, CInputStream *pStream)
+	{
+		m_Batch.Init(&m_World, pCollision);
+		for(int p = 0; p < MAX_CLIENTS; p++)
+			m_aUseInput[p] = true;
+		for(int p = 0; p < pStream->m_NumPlayers; p++)
+		{
+			m_aCores[p].Init(&m_World, pCollision);
+			m_aCores[p].Reset();
+			m_aCores[p].m_Pos = vec2(pStream->m_aSpawns[p].m_X, pStream->m_aSpawns[p].m_Y);
+			m_aCores[p].m_Frozen = pStream->m_aSpawns[p].m_Frozen;
+			m_World.m_apCharacters[p] = &m_aCores[p];
+		}
+	}
+
+	void ApplyInput(CCollision *pCollision, CInputStream *pStream, int Tick)
+	{
+		for(int p = 0; p < pStream->m_NumPlayers; p++)
+		{
+			// players that left the map or hit a death tile respawn like in the game
+			vec2 Pos = m_aCores[p].m_Pos;
+			if(Pos.x < -32.0f || Pos.x >= pCollision->GetWidth()*32+32.0f || Pos.y < -32.0f || Pos.y >= pCollision->GetHeight()*32+32.0f ||
+				(pCollision->GetCollisionAt(Pos.x, Pos.y)&CCollision::COLFLAG_DEATH))
+			{
+				m_aCores[p].Reset();
+				m_aCores[p].m_Pos = vec2(pStream->m_aSpawns[p].m_X, pStream->m_aSpawns[p].m_Y);
+			}
+
+			m_aCores[p].m_Input = *pStream->Input(Tick, p);
+		}
+	}
+
+	void StepScalar(int NumPlayers)
+	{
+		for(int p = 0; p < NumPlayers; p++)
+			m_aCores[p].Tick(true);
+		for(int p = 0; p < NumPlayers; p++)
+		{
+			m_aCores[p].Move();
+			m_aCores[p].Quantize();
+		}
+	}
+
+	void StepBatch()
+	{
+		m_Batch.Step(m_aUseInput, true);
+	}
+};
+
+static bool CoreEqual(const CCharacterCore *pA, const CCharacterCore *pB)
+{
+	// compare the bits, not the values
+	return mem_comp(&pA->m_Pos, &pB->m_Pos, sizeof(vec2)) == 0 &&
+		mem_comp(&pA->m_Vel, &pB->m_Vel, sizeof(vec2)) == 0 &&
+		mem_comp(&pA->m_HookPos, &pB->m_HookPos, sizeof(vec2)) == 0 &&
+		mem_comp(&pA->m_HookDir, &pB->m_HookDir, sizeof(vec2)) == 0 &&
+		pA->m_HookTick == pB->m_HookTick && pA->m_HookState == pB->m_HookState &&
+		pA->m_HookedPlayer == pB->m_HookedPlayer && pA->m_Jumped == pB->m_Jumped &&
+		pA->m_Direction == pB->m_Direction && pA->m_Angle == pB->m_Angle &&
+		pA->m_Frozen == pB->m_Frozen && pA->m_TriggeredEvents == pB->m_TriggeredEvents;
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	if(argc < 3)
+	{
+		dbg_msg("bench_physics", "usage: %s <map> <input stream> [ticks] [players]", argv[0]);
+		return -1;
+	}
+
+	IKernel *pKernel = IKernel::Create();
+	IStorage *pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv);
+	IEngineMap *pEngineMap = CreateEngineMap();
+
+	bool RegisterFail = !pKernel->RegisterInterface(pStorage);
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IEngineMap*>(pEngineMap));
+	RegisterFail |= !pKernel->RegisterInterface(static_cast<IMap*>(pEngineMap));
+	if(RegisterFail)
+		return -1;
+
+	if(!pEngineMap->Load(argv[1]))
+	{
+		dbg_msg("bench_physics", "failed to load map '%s'", argv[1]);
+		return -1;
+	}
+
+	CLayers Layers;
+	CCollision Collision;
+	Layers.Init(pKernel);
+	Collision.Init(&Layers);
+
+	CInputStream Stream;
+	if(Stream.Load(argv[2]))
+		dbg_msg("bench_physics", "loaded input stream '%s', %d ticks, %d players", argv[2], Stream.m_NumTicks, Stream.m_NumPlayers);
+	else
+	{
+		int NumTicks = argc > 3 ? max(str_toint(argv[3]), 1) : 50*60*5;
+		int NumPlayers = argc > 4 ? clamp(str_toint(argv[4]), 1, (int)MAX_CLIENTS) : MAX_CLIENTS;
+		Stream.Generate(&Collision, NumTicks, NumPlayers);
+		if(Stream.Save(argv[2]))
+			dbg_msg("bench_physics", "recorded input stream '%s', %d ticks, %d players", argv[2], NumTicks, NumPlayers);
+	}
+
+	// verify that both paths stay in sync
+	{
+		CPhysicsRun *pScalar = new CPhysicsRun;
+		CPhysicsRun *pBatch = new CPhysicsRun;
+		pScalar->Init(&Collision, &Stream);
+		pBatch->Init(&Collision, &Stream);
+		for(int t = 0; t < Stream.m_NumTicks; t++)
+		{
+			pScalar->ApplyInput(&Collision, &Stream, t);
+			pBatch->ApplyInput(&Collision, &Stream, t);
+			pScalar->StepScalar(Stream.m_NumPlayers);
+			pBatch->StepBatch();
+
+			for(int p = 0; p < Stream.m_NumPlayers; p++)
+			{
+				if(!CoreEqual(&pScalar->m_aCores[p], &pBatch->m_aCores[p]))
+				{
+					dbg_msg("bench_physics", "desync at tick %d player %d: scalar (%f %f) batch (%f %f)", t, p,
+						pScalar->m_aCores[p].m_Pos.x, pScalar->m_aCores[p].m_Pos.y, pBatch->m_aCores[p].m_Pos.x, pBatch->m_aCores[p].m_Pos.y);
+					return 1;
+				}
+			}
+		}
+		delete pScalar;
+		delete pBatch;
+		dbg_msg("bench_physics", "verify: ok");
+	}
+
+	// measure
+	for(int Batch = 0; Batch < 2; Batch++)
+	{
+		CPhysicsRun *pRun = new CPhysicsRun;
+		pRun->Init(&Collision, &Stream);
+
+		int64 Start = time_get();
+		for(int t = 0; t < Stream.m_NumTicks; t++)
+		{
+			pRun->ApplyInput(&Collision, &Stream, t);
+			if(Batch)
+				pRun->StepBatch();
+			else
+				pRun->StepScalar(Stream.m_NumPlayers);
+		}
+		int64 End = time_get();
+
+		double Seconds = (End-Start)/(double)time_freq();
+		dbg_msg("bench_physics", "%s: %d ticks, %d players, %.3f ms, %.0f ticks/s", Batch ? "batch" : "scalar",
+			Stream.m_NumTicks, Stream.m_NumPlayers, Seconds*1000.0, Seconds > 0 ? Stream.m_NumTicks/Seconds : 0.0);
+		delete pRun;
+	}
+
+	pEngineMap->Unload();
+	return 0;
+}
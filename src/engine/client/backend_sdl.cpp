@@ -193,6 +193,29 @@ void CCommandProcessorFragment_OpenGL::SetState(const CCommandBuffer::SState &St
 	glOrtho(State.m_ScreenTL.x, State.m_ScreenBR.x, State.m_ScreenBR.y, State.m_ScreenTL.y, 1.0f, 10.f);
 }
 
+void CCommandProcessorFragment_OpenGL::CheckVbo()
+{
+	// the extension can only be queried once the context is current
+	if(m_VboChecked)
+		return;
+	m_VboChecked = true;
+
+	const char *pExtensions = (const char *)glGetString(GL_EXTENSIONS);
+	if(pExtensions && str_find(pExtensions, "GL_ARB_vertex_buffer_object"))
+	{
+		m_pfnGenBuffers = (PFNGLGENBUFFERSARBPROC)SDL_GL_GetProcAddress("glGenBuffersARB");
+		m_pfnDeleteBuffers = (PFNGLDELETEBUFFERSARBPROC)SDL_GL_GetProcAddress("glDeleteBuffersARB");
+		m_pfnBindBuffer = (PFNGLBINDBUFFERARBPROC)SDL_GL_GetProcAddress("glBindBufferARB");
+		m_pfnBufferData = (PFNGLBUFFERDATAARBPROC)SDL_GL_GetProcAddress("glBufferDataARB");
+	}
+
+	if(!m_pfnGenBuffers || !m_pfnDeleteBuffers || !m_pfnBindBuffer || !m_pfnBufferData)
+	{
+		dbg_msg("render", "vertex buffer objects not supported, using client memory for quad buffers");
+		m_pfnGenBuffers = 0;
+	}
+}
+
 void CCommandProcessorFragment_OpenGL::Cmd_Init(const SCommand_Init *pCommand)
 {
 	m_pTextureMemoryUsage = pCommand->m_pTextureMemoryUsage;
@@ -319,6 +342,71 @@ void CCommandProcessorFragment_OpenGL::Cmd_Render(const CCommandBuffer::SCommand
 	};
 }
 
+void CCommandProcessorFragment_OpenGL::Cmd_QuadBuffer_Create(const CCommandBuffer::SCommand_QuadBuffer_Create *pCommand)
+{
+	CheckVbo();
+
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	SBufferVertex *pVertices = (SBufferVertex *)mem_alloc(sizeof(SBufferVertex)*pCommand->m_NumVertices, sizeof(void*));
+	for(int i = 0; i < pCommand->m_NumVertices; i++)
+	{
+		pVertices[i].m_Pos.x = pCommand->m_pVertices[i].m_X;
+		pVertices[i].m_Pos.y = pCommand->m_pVertices[i].m_Y;
+		pVertices[i].m_Pos.z = -5.0f;
+		pVertices[i].m_Tex.u = pCommand->m_pVertices[i].m_U;
+		pVertices[i].m_Tex.v = pCommand->m_pVertices[i].m_V;
+	}
+	mem_free(pCommand->m_pVertices);
+
+	if(m_pfnGenBuffers)
+	{
+		m_pfnGenBuffers(1, &pBuffer->m_Vbo);
+		m_pfnBindBuffer(GL_ARRAY_BUFFER_ARB, pBuffer->m_Vbo);
+		m_pfnBufferData(GL_ARRAY_BUFFER_ARB, sizeof(SBufferVertex)*pCommand->m_NumVertices, pVertices, GL_STATIC_DRAW_ARB);
+		m_pfnBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+		mem_free(pVertices);
+		pBuffer->m_pVertices = 0;
+	}
+	else
+	{
+		pBuffer->m_Vbo = 0;
+		pBuffer->m_pVertices = pVertices;
+	}
+}
+
+void CCommandProcessorFragment_OpenGL::Cmd_QuadBuffer_Destroy(const CCommandBuffer::SCommand_QuadBuffer_Destroy *pCommand)
+{
+	CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	if(pBuffer->m_Vbo)
+		m_pfnDeleteBuffers(1, &pBuffer->m_Vbo);
+	if(pBuffer->m_pVertices)
+		mem_free(pBuffer->m_pVertices);
+	pBuffer->m_Vbo = 0;
+	pBuffer->m_pVertices = 0;
+}
+
+void CCommandProcessorFragment_OpenGL::Cmd_RenderQuadBuffer(const CCommandBuffer::SCommand_RenderQuadBuffer *pCommand)
+{
+	SetState(pCommand->m_State);
+
+	const CQuadBuffer *pBuffer = &m_aQuadBuffers[pCommand->m_Slot];
+	const char *pBase = (const char *)pBuffer->m_pVertices;
+	if(pBuffer->m_Vbo)
+		m_pfnBindBuffer(GL_ARRAY_BUFFER_ARB, pBuffer->m_Vbo);
+
+	glVertexPointer(3, GL_FLOAT, sizeof(SBufferVertex), pBase);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(SBufferVertex), pBase + sizeof(float)*3);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(pCommand->m_Color.r, pCommand->m_Color.g, pCommand->m_Color.b, pCommand->m_Color.a);
+
+	glDrawArrays(GL_QUADS, pCommand->m_FirstQuad*4, pCommand->m_NumQuads*4);
+
+	if(pBuffer->m_Vbo)
+		m_pfnBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+}
+
 void CCommandProcessorFragment_OpenGL::Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand)
 {
 	// fetch image data
@@ -357,7 +445,13 @@ void CCommandProcessorFragment_OpenGL::Cmd_Screenshot(const CCommandBuffer::SCom
 CCommandProcessorFragment_OpenGL::CCommandProcessorFragment_OpenGL()
 {
 	mem_zero(m_aTextures, sizeof(m_aTextures));
+	mem_zero(m_aQuadBuffers, sizeof(m_aQuadBuffers));
 	m_pTextureMemoryUsage = 0;
+	m_VboChecked = false;
+	m_pfnGenBuffers = 0;
+	m_pfnDeleteBuffers = 0;
+	m_pfnBindBuffer = 0;
+	m_pfnBufferData = 0;
 }
 
 bool CCommandProcessorFragment_OpenGL::RunCommand(const CCommandBuffer::SCommand * pBaseCommand)
@@ -369,7 +463,10 @@ bool CCommandProcessorFragment_OpenGL::RunCommand(const CCommandBuffer::SCommand
 	case CCommandBuffer::CMD_TEXTURE_DESTROY: Cmd_Texture_Destroy(static_cast<const CCommandBuffer::SCommand_Texture_Destroy *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_TEXTURE_UPDATE: Cmd_Texture_Update(static_cast<const CCommandBuffer::SCommand_Texture_Update *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_CLEAR: Cmd_Clear(static_cast<const CCommandBuffer::SCommand_Clear *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_QUADBUFFER_CREATE: Cmd_QuadBuffer_Create(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Create *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_QUADBUFFER_DESTROY: Cmd_QuadBuffer_Destroy(static_cast<const CCommandBuffer::SCommand_QuadBuffer_Destroy *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_RENDER: Cmd_Render(static_cast<const CCommandBuffer::SCommand_Render *>(pBaseCommand)); break;
+	case CCommandBuffer::CMD_RENDER_QUADBUFFER: Cmd_RenderQuadBuffer(static_cast<const CCommandBuffer::SCommand_RenderQuadBuffer *>(pBaseCommand)); break;
 	case CCommandBuffer::CMD_SCREENSHOT: Cmd_Screenshot(static_cast<const CCommandBuffer::SCommand_Screenshot *>(pBaseCommand)); break;
 	default: return false;
 	}
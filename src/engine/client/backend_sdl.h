@@ -175,6 +175,26 @@ class CCommandProcessorFragment_OpenGL
 	CTexture m_aTextures[CCommandBuffer::MAX_TEXTURES];
 	volatile int *m_pTextureMemoryUsage;
 
+	struct SBufferVertex
+	{
+		CCommandBuffer::SPoint m_Pos;
+		CCommandBuffer::STexCoord m_Tex;
+	};
+
+	// the vertices stay in client memory when vertex buffer objects are not supported
+	struct CQuadBuffer
+	{
+		GLuint m_Vbo;
+		SBufferVertex *m_pVertices;
+	};
+	CQuadBuffer m_aQuadBuffers[CCommandBuffer::MAX_QUADBUFFERS];
+
+	bool m_VboChecked;
+	PFNGLGENBUFFERSARBPROC m_pfnGenBuffers;
+	PFNGLDELETEBUFFERSARBPROC m_pfnDeleteBuffers;
+	PFNGLBINDBUFFERARBPROC m_pfnBindBuffer;
+	PFNGLBUFFERDATAARBPROC m_pfnBufferData;
+
 public:
 	enum
 	{
@@ -193,13 +213,17 @@ private:
 	static void *Rescale(int Width, int Height, int NewWidth, int NewHeight, int Format, const unsigned char *pData);
 
 	void SetState(const CCommandBuffer::SState &State);
+	void CheckVbo();
 
 	void Cmd_Init(const SCommand_Init *pCommand);
 	void Cmd_Texture_Update(const CCommandBuffer::SCommand_Texture_Update *pCommand);
 	void Cmd_Texture_Destroy(const CCommandBuffer::SCommand_Texture_Destroy *pCommand);
 	void Cmd_Texture_Create(const CCommandBuffer::SCommand_Texture_Create *pCommand);
 	void Cmd_Clear(const CCommandBuffer::SCommand_Clear *pCommand);
+	void Cmd_QuadBuffer_Create(const CCommandBuffer::SCommand_QuadBuffer_Create *pCommand);
+	void Cmd_QuadBuffer_Destroy(const CCommandBuffer::SCommand_QuadBuffer_Destroy *pCommand);
 	void Cmd_Render(const CCommandBuffer::SCommand_Render *pCommand);
+	void Cmd_RenderQuadBuffer(const CCommandBuffer::SCommand_RenderQuadBuffer *pCommand);
 	void Cmd_Screenshot(const CCommandBuffer::SCommand_Screenshot *pCommand);
 
 public:
@@ -636,19 +636,19 @@ void CClient::SnapInvalidateItem(int SnapID, int Index)
 
 void *CClient::SnapFindItem(int SnapID, int Type, int ID)
 {
-	// TODO: linear search. should be fixed.
-	int i;
-
 	if(!m_aSnapshots[SnapID])
 		return 0x0;
 
-	for(i = 0; i < m_aSnapshots[SnapID]->m_pSnap->NumItems(); i++)
-	{
-		CSnapshotItem *pItem = m_aSnapshots[SnapID]->m_pAltSnap->GetItem(i);
-		if(pItem->Type() == Type && pItem->ID() == ID)
-			return (void *)pItem->Data();
-	}
-	return 0x0;
+	int Key = (Type<<16)|ID;
+	int Index = m_aSnapshots[SnapID]->m_Index.Find(Key);
+	if(Index == -1)
+		return 0x0;
+
+	// invalidated items are not found
+	CSnapshotItem *pItem = m_aSnapshots[SnapID]->m_pAltSnap->GetItem(Index);
+	if(pItem->Key() != Key)
+		return 0x0;
+	return (void *)pItem->Data();
 }
 
 int CClient::SnapNumItems(int SnapID)
@@ -1460,6 +1460,7 @@ void CClient::OnDemoPlayerSnapshot(void *pData, int Size)
 
 	mem_copy(m_aSnapshots[SNAP_CURRENT]->m_pSnap, pData, Size);
 	mem_copy(m_aSnapshots[SNAP_CURRENT]->m_pAltSnap, pData, Size);
+	m_aSnapshots[SNAP_CURRENT]->m_Index.Build(m_aSnapshots[SNAP_CURRENT]->m_pSnap);
 
 	GameClient()->OnNewSnapshot();
 }
@@ -2116,11 +2117,15 @@ const char *CClient::DemoPlayer_Play(const char *pFilename, int StorageType)
 	m_aSnapshots[SNAP_CURRENT]->m_pAltSnap = (CSnapshot *)m_aDemorecSnapshotData[SNAP_CURRENT][1];
 	m_aSnapshots[SNAP_CURRENT]->m_SnapSize = 0;
 	m_aSnapshots[SNAP_CURRENT]->m_Tick = -1;
+	m_aSnapshots[SNAP_CURRENT]->m_Index.Init(m_aaDemorecSnapshotIndex[SNAP_CURRENT], CSnapshotIndex::MAX_SLOTS);
+	m_aSnapshots[SNAP_CURRENT]->m_Index.Build(m_aSnapshots[SNAP_CURRENT]->m_pSnap);
 
 	m_aSnapshots[SNAP_PREV]->m_pSnap = (CSnapshot *)m_aDemorecSnapshotData[SNAP_PREV][0];
 	m_aSnapshots[SNAP_PREV]->m_pAltSnap = (CSnapshot *)m_aDemorecSnapshotData[SNAP_PREV][1];
 	m_aSnapshots[SNAP_PREV]->m_SnapSize = 0;
 	m_aSnapshots[SNAP_PREV]->m_Tick = -1;
+	m_aSnapshots[SNAP_PREV]->m_Index.Init(m_aaDemorecSnapshotIndex[SNAP_PREV], CSnapshotIndex::MAX_SLOTS);
+	m_aSnapshots[SNAP_PREV]->m_Index.Build(m_aSnapshots[SNAP_PREV]->m_pSnap);
 
 	// enter demo playback state
 	SetState(IClient::STATE_DEMOPLAYBACK);
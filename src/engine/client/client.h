@@ -154,6 +154,7 @@ class CClient : public IClient, public CDemoPlayer::IListner
 
 	class CSnapshotStorage::CHolder m_aDemorecSnapshotHolders[NUM_SNAPSHOT_TYPES];
 	char *m_aDemorecSnapshotData[NUM_SNAPSHOT_TYPES][2][CSnapshot::MAX_SIZE];
+	int m_aaDemorecSnapshotIndex[NUM_SNAPSHOT_TYPES][CSnapshotIndex::MAX_SLOTS*2];
 
 	class CSnapshotDelta m_SnapshotDelta;
 
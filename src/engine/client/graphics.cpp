@@ -312,11 +312,6 @@ int CGraphics_OpenGL::LoadTextureRawSub(int TextureID, int x, int y, int Width,
 
 int CGraphics_OpenGL::LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
 {
-	int Mipmap = 1;
-	unsigned char *pTexData = (unsigned char *)pData;
-	unsigned char *pTmpData = 0;
-	int Oglformat = 0;
-	int StoreOglformat = 0;
 	int Tex = 0;
 
 	// don't waste memory on texture if we are stress testing
@@ -328,6 +323,29 @@ int CGraphics_OpenGL::LoadTextureRaw(int Width, int Height, int Format, const vo
 	m_FirstFreeTexture = m_aTextures[Tex].m_Next;
 	m_aTextures[Tex].m_Next = -1;
 
+	CreateTexture(Tex, Width, Height, Format, pData, StoreFormat, Flags);
+	return Tex;
+}
+
+int CGraphics_OpenGL::LoadTextureRawReplace(int TextureID, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
+	if(TextureID == m_InvalidTexture || TextureID < 0)
+		return -1;
+
+	glDeleteTextures(1, &m_aTextures[TextureID].m_Tex);
+	m_TextureMemoryUsage -= m_aTextures[TextureID].m_MemSize;
+	CreateTexture(TextureID, Width, Height, Format, pData, StoreFormat, Flags);
+	return TextureID;
+}
+
+void CGraphics_OpenGL::CreateTexture(int Tex, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
+	int Mipmap = 1;
+	unsigned char *pTexData = (unsigned char *)pData;
+	unsigned char *pTmpData = 0;
+	int Oglformat = 0;
+	int StoreOglformat = 0;
+
 	// resample if needed
 	if(!(Flags&TEXLOAD_NORESAMPLE) && (Format == CImageInfo::FORMAT_RGBA || Format == CImageInfo::FORMAT_RGB))
 	{
@@ -411,7 +429,6 @@ int CGraphics_OpenGL::LoadTextureRaw(int Width, int Height, int Format, const vo
 
 	m_TextureMemoryUsage += m_aTextures[Tex].m_MemSize;
 	mem_free(pTmpData);
-	return Tex;
 }
 
 // simple uncompressed RGBA loaders
@@ -441,40 +458,77 @@ int CGraphics_OpenGL::LoadTexture(const char *pFilename, int StorageType, int St
 int CGraphics_OpenGL::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
 {
 	char aCompleteFilename[512];
-	unsigned char *pBuffer;
-	png_t Png; // ignore_convention
-
-	// open file for reading
-	png_init(0,0); // ignore_convention
 
+	// read the whole file, the decoder works on memory
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-		io_close(File);
-	else
+	if(!File)
 	{
 		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
 		return 0;
 	}
 
-	int Error = png_open_file(&Png, aCompleteFilename); // ignore_convention
+	unsigned FileSize = (unsigned)io_length(File);
+	unsigned char *pFileData = (unsigned char *)mem_alloc(FileSize, 1);
+	unsigned ReadSize = io_read(File, pFileData, FileSize);
+	io_close(File);
+
+	int Result = 0;
+	if(ReadSize == FileSize)
+		Result = DecodePNG(pImg, pFileData, FileSize, aCompleteFilename);
+	else
+		dbg_msg("game/png", "failed to read file. filename='%s'", aCompleteFilename);
+	mem_free(pFileData);
+	return Result;
+}
+
+class CPngReader
+{
+public:
+	const unsigned char *m_pData;
+	unsigned m_Size;
+	unsigned m_Pos;
+
+	static unsigned Read(void *pOutput, unsigned long Size, unsigned long Numel, void *pUser)
+	{
+		CPngReader *pReader = (CPngReader *)pUser;
+		unsigned Bytes = min((unsigned)(Size*Numel), pReader->m_Size-pReader->m_Pos);
+		if(pOutput) // no output means skip
+			mem_copy(pOutput, pReader->m_pData+pReader->m_Pos, Bytes);
+		pReader->m_Pos += Bytes;
+		return Size ? Bytes/Size : 0;
+	}
+};
+
+int CGraphics_OpenGL::DecodePNG(CImageInfo *pImg, const void *pData, unsigned DataSize, const char *pContext)
+{
+	unsigned char *pBuffer;
+	png_t Png; // ignore_convention
+
+	CPngReader Reader;
+	Reader.m_pData = (const unsigned char *)pData;
+	Reader.m_Size = DataSize;
+	Reader.m_Pos = 0;
+
+	int Error = png_open_read(&Png, CPngReader::Read, &Reader); // ignore_convention
 	if(Error != PNG_NO_ERROR)
 	{
-		dbg_msg("game/png", "failed to open file. filename='%s'", aCompleteFilename);
-		if(Error != PNG_FILE_ERROR)
-			png_close_file(&Png); // ignore_convention
+		dbg_msg("game/png", "failed to open file. filename='%s'", pContext);
 		return 0;
 	}
 
 	if(Png.depth != 8 || (Png.color_type != PNG_TRUECOLOR && Png.color_type != PNG_TRUECOLOR_ALPHA)) // ignore_convention
 	{
-		dbg_msg("game/png", "invalid format. filename='%s'", aCompleteFilename);
-		png_close_file(&Png); // ignore_convention
+		dbg_msg("game/png", "invalid format. filename='%s'", pContext);
 		return 0;
 	}
 
 	pBuffer = (unsigned char *)mem_alloc(Png.width * Png.height * Png.bpp, 1); // ignore_convention
-	png_get_data(&Png, pBuffer); // ignore_convention
-	png_close_file(&Png); // ignore_convention
+	if(png_get_data(&Png, pBuffer) != PNG_NO_ERROR) // ignore_convention
+	{
+		dbg_msg("game/png", "failed to decode file. filename='%s'", pContext);
+		mem_free(pBuffer);
+		return 0;
+	}
 
 	pImg->m_Width = Png.width; // ignore_convention
 	pImg->m_Height = Png.height; // ignore_convention
@@ -700,6 +754,38 @@ void CGraphics_OpenGL::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
 	AddVertices(4*Num);
 }
 
+void CGraphics_OpenGL::QuadsDrawVertices(const CQuadVertex *pVertices, int NumQuads)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawVertices without begin");
+
+	while(NumQuads > 0)
+	{
+		// as many quads as fit before the next flush
+		int Num = min(NumQuads, (MAX_VERTICES-m_NumVertices)/4-1);
+		if(Num <= 0)
+		{
+			Flush();
+			continue;
+		}
+
+		for(int i = 0; i < Num*4; ++i)
+		{
+			m_aVertices[m_NumVertices + i].m_Pos.x = pVertices[i].m_X;
+			m_aVertices[m_NumVertices + i].m_Pos.y = pVertices[i].m_Y;
+			m_aVertices[m_NumVertices + i].m_Tex.u = pVertices[i].m_U;
+			m_aVertices[m_NumVertices + i].m_Tex.v = pVertices[i].m_V;
+			m_aVertices[m_NumVertices + i].m_Color.r = pVertices[i].m_R;
+			m_aVertices[m_NumVertices + i].m_Color.g = pVertices[i].m_G;
+			m_aVertices[m_NumVertices + i].m_Color.b = pVertices[i].m_B;
+			m_aVertices[m_NumVertices + i].m_Color.a = pVertices[i].m_A;
+		}
+
+		AddVertices(4*Num);
+		pVertices += 4*Num;
+		NumQuads -= Num;
+	}
+}
+
 void CGraphics_OpenGL::QuadsText(float x, float y, float Size, const char *pText)
 {
 	float StartX = x;
@@ -729,11 +815,67 @@ void CGraphics_OpenGL::QuadsText(float x, float y, float Size, const char *pText
 	}
 }
 
+int CGraphics_OpenGL::CreateQuadBuffer(const CBufferVertex *pVertices, int NumQuads)
+{
+	if(NumQuads <= 0 || m_FirstFreeQuadBuffer < 0)
+		return -1;
+
+	// grab buffer
+	int Buffer = m_FirstFreeQuadBuffer;
+	m_FirstFreeQuadBuffer = m_aQuadBuffers[Buffer].m_Next;
+	m_aQuadBuffers[Buffer].m_Next = -1;
+
+	// the vertices stay in client memory, they are in the layout glDrawArrays wants
+	int NumVertices = NumQuads*4;
+	CBufferedVertex *pBuffered = (CBufferedVertex *)mem_alloc(sizeof(CBufferedVertex)*NumVertices, sizeof(void*));
+	for(int i = 0; i < NumVertices; i++)
+	{
+		pBuffered[i].m_Pos.x = pVertices[i].m_X;
+		pBuffered[i].m_Pos.y = pVertices[i].m_Y;
+		pBuffered[i].m_Pos.z = -5.0f;
+		pBuffered[i].m_Tex.u = pVertices[i].m_U;
+		pBuffered[i].m_Tex.v = pVertices[i].m_V;
+	}
+	m_aQuadBuffers[Buffer].m_pVertices = pBuffered;
+	return Buffer;
+}
+
+void CGraphics_OpenGL::DeleteQuadBuffer(int BufferID)
+{
+	if(BufferID < 0)
+		return;
+
+	mem_free(m_aQuadBuffers[BufferID].m_pVertices);
+	m_aQuadBuffers[BufferID].m_pVertices = 0;
+	m_aQuadBuffers[BufferID].m_Next = m_FirstFreeQuadBuffer;
+	m_FirstFreeQuadBuffer = BufferID;
+}
+
+void CGraphics_OpenGL::RenderQuadBuffer(int BufferID, int FirstQuad, int NumQuads, float r, float g, float b, float a)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderQuadBuffer within begin");
+	if(BufferID < 0 || NumQuads <= 0 || !m_RenderEnable)
+		return;
+
+	const char *pBase = (const char *)m_aQuadBuffers[BufferID].m_pVertices;
+	glVertexPointer(3, GL_FLOAT, sizeof(CBufferedVertex), pBase);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(CBufferedVertex), pBase + sizeof(float)*3);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glColor4f(r, g, b, a);
+
+	glDrawArrays(GL_QUADS, FirstQuad*4, NumQuads*4);
+}
+
 int CGraphics_OpenGL::Init()
 {
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 
+	// sets global state, the images get decoded on other threads later
+	png_init(0,0); // ignore_convention
+
 	// Set all z to -5.0f
 	for(int i = 0; i < MAX_VERTICES; i++)
 		m_aVertices[i].m_Pos.z = -5.0f;
@@ -744,6 +886,15 @@ int CGraphics_OpenGL::Init()
 		m_aTextures[i].m_Next = i+1;
 	m_aTextures[MAX_TEXTURES-1].m_Next = -1;
 
+	// init quad buffers
+	m_FirstFreeQuadBuffer = 0;
+	for(int i = 0; i < MAX_QUADBUFFERS; i++)
+	{
+		m_aQuadBuffers[i].m_pVertices = 0;
+		m_aQuadBuffers[i].m_Next = i+1;
+	}
+	m_aQuadBuffers[MAX_QUADBUFFERS-1].m_Next = -1;
+
 	// set some default settings
 	glEnable(GL_BLEND);
 	glDisable(GL_CULL_FACE);
@@ -25,6 +25,7 @@ protected:
 	{
 		MAX_VERTICES = 32*1024,
 		MAX_TEXTURES = 1024*4,
+		MAX_QUADBUFFERS = 1024,
 
 		DRAWING_QUADS=1,
 		DRAWING_LINES=2
@@ -62,12 +63,28 @@ protected:
 	int m_FirstFreeTexture;
 	int m_TextureMemoryUsage;
 
+	typedef struct
+	{
+		CPoint m_Pos;
+		CTexCoord m_Tex;
+	} CBufferedVertex;
+
+	struct CQuadBuffer
+	{
+		CBufferedVertex *m_pVertices;
+		int m_Next;
+	};
+
+	CQuadBuffer m_aQuadBuffers[MAX_QUADBUFFERS];
+	int m_FirstFreeQuadBuffer;
+
 	void Flush();
 	void AddVertices(int Count);
 	void Rotate4(const CPoint &rCenter, CVertex *pPoints);
 
 	static unsigned char Sample(int w, int h, const unsigned char *pData, int u, int v, int Offset, int ScaleW, int ScaleH, int Bpp);
 	static unsigned char *Rescale(int Width, int Height, int NewWidth, int NewHeight, int Format, const unsigned char *pData);
+	void CreateTexture(int Tex, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags);
 public:
 	CGraphics_OpenGL();
 
@@ -92,11 +109,13 @@ public:
 
 	virtual int UnloadTexture(int Index);
 	virtual int LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags);
+	virtual int LoadTextureRawReplace(int TextureID, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags);
 	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData);
 
 	// simple uncompressed RGBA loaders
 	virtual int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags);
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType);
+	virtual int DecodePNG(CImageInfo *pImg, const void *pData, unsigned DataSize, const char *pContext);
 
 	void ScreenshotDirect(const char *pFilename);
 
@@ -119,8 +138,13 @@ public:
 	virtual void QuadsDraw(CQuadItem *pArray, int Num);
 	virtual void QuadsDrawTL(const CQuadItem *pArray, int Num);
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num);
+	virtual void QuadsDrawVertices(const CQuadVertex *pVertices, int NumQuads);
 	virtual void QuadsText(float x, float y, float Size, const char *pText);
 
+	virtual int CreateQuadBuffer(const CBufferVertex *pVertices, int NumQuads);
+	virtual void DeleteQuadBuffer(int BufferID);
+	virtual void RenderQuadBuffer(int BufferID, int FirstQuad, int NumQuads, float r, float g, float b, float a);
+
 	virtual int Init();
 };
 
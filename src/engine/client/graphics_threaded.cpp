@@ -335,6 +335,30 @@ int CGraphics_Threaded::LoadTextureRaw(int Width, int Height, int Format, const
 	m_FirstFreeTexture = m_aTextureIndices[Tex];
 	m_aTextureIndices[Tex] = -1;
 
+	CreateTexture(Tex, Width, Height, Format, pData, StoreFormat, Flags);
+	return Tex;
+}
+
+int CGraphics_Threaded::LoadTextureRawReplace(int TextureID, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
+	if(TextureID == m_InvalidTexture || TextureID < 0)
+		return -1;
+
+	// the backend recreates the texture in the same slot
+	CCommandBuffer::SCommand_Texture_Destroy Cmd;
+	Cmd.m_Slot = TextureID;
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		KickCommandBuffer();
+		m_pCommandBuffer->AddCommand(Cmd);
+	}
+
+	CreateTexture(TextureID, Width, Height, Format, pData, StoreFormat, Flags);
+	return TextureID;
+}
+
+void CGraphics_Threaded::CreateTexture(int Tex, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags)
+{
 	CCommandBuffer::SCommand_Texture_Create Cmd;
 	Cmd.m_Slot = Tex;
 	Cmd.m_Width = Width;
@@ -359,9 +383,12 @@ int CGraphics_Threaded::LoadTextureRaw(int Width, int Height, int Format, const
 	Cmd.m_pData = pTmpData;
 
 	//
-	m_pCommandBuffer->AddCommand(Cmd);
-
-	return Tex;
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+		m_pCommandBuffer->AddCommand(Cmd);
+	}
 }
 
 // simple uncompressed RGBA loaders
@@ -391,40 +418,77 @@ int CGraphics_Threaded::LoadTexture(const char *pFilename, int StorageType, int
 int CGraphics_Threaded::LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType)
 {
 	char aCompleteFilename[512];
-	unsigned char *pBuffer;
-	png_t Png; // ignore_convention
-
-	// open file for reading
-	png_init(0,0); // ignore_convention
 
+	// read the whole file, the decoder works on memory
 	IOHANDLE File = m_pStorage->OpenFile(pFilename, IOFLAG_READ, StorageType, aCompleteFilename, sizeof(aCompleteFilename));
-	if(File)
-		io_close(File);
-	else
+	if(!File)
 	{
 		dbg_msg("game/png", "failed to open file. filename='%s'", pFilename);
 		return 0;
 	}
 
-	int Error = png_open_file(&Png, aCompleteFilename); // ignore_convention
+	unsigned FileSize = (unsigned)io_length(File);
+	unsigned char *pFileData = (unsigned char *)mem_alloc(FileSize, 1);
+	unsigned ReadSize = io_read(File, pFileData, FileSize);
+	io_close(File);
+
+	int Result = 0;
+	if(ReadSize == FileSize)
+		Result = DecodePNG(pImg, pFileData, FileSize, aCompleteFilename);
+	else
+		dbg_msg("game/png", "failed to read file. filename='%s'", aCompleteFilename);
+	mem_free(pFileData);
+	return Result;
+}
+
+class CPngReader
+{
+public:
+	const unsigned char *m_pData;
+	unsigned m_Size;
+	unsigned m_Pos;
+
+	static unsigned Read(void *pOutput, unsigned long Size, unsigned long Numel, void *pUser)
+	{
+		CPngReader *pReader = (CPngReader *)pUser;
+		unsigned Bytes = min((unsigned)(Size*Numel), pReader->m_Size-pReader->m_Pos);
+		if(pOutput) // no output means skip
+			mem_copy(pOutput, pReader->m_pData+pReader->m_Pos, Bytes);
+		pReader->m_Pos += Bytes;
+		return Size ? Bytes/Size : 0;
+	}
+};
+
+int CGraphics_Threaded::DecodePNG(CImageInfo *pImg, const void *pData, unsigned DataSize, const char *pContext)
+{
+	unsigned char *pBuffer;
+	png_t Png; // ignore_convention
+
+	CPngReader Reader;
+	Reader.m_pData = (const unsigned char *)pData;
+	Reader.m_Size = DataSize;
+	Reader.m_Pos = 0;
+
+	int Error = png_open_read(&Png, CPngReader::Read, &Reader); // ignore_convention
 	if(Error != PNG_NO_ERROR)
 	{
-		dbg_msg("game/png", "failed to open file. filename='%s'", aCompleteFilename);
-		if(Error != PNG_FILE_ERROR)
-			png_close_file(&Png); // ignore_convention
+		dbg_msg("game/png", "failed to open file. filename='%s'", pContext);
 		return 0;
 	}
 
 	if(Png.depth != 8 || (Png.color_type != PNG_TRUECOLOR && Png.color_type != PNG_TRUECOLOR_ALPHA)) // ignore_convention
 	{
-		dbg_msg("game/png", "invalid format. filename='%s'", aCompleteFilename);
-		png_close_file(&Png); // ignore_convention
+		dbg_msg("game/png", "invalid format. filename='%s'", pContext);
 		return 0;
 	}
 
 	pBuffer = (unsigned char *)mem_alloc(Png.width * Png.height * Png.bpp, 1); // ignore_convention
-	png_get_data(&Png, pBuffer); // ignore_convention
-	png_close_file(&Png); // ignore_convention
+	if(png_get_data(&Png, pBuffer) != PNG_NO_ERROR) // ignore_convention
+	{
+		dbg_msg("game/png", "failed to decode file. filename='%s'", pContext);
+		mem_free(pBuffer);
+		return 0;
+	}
 
 	pImg->m_Width = Png.width; // ignore_convention
 	pImg->m_Height = Png.height; // ignore_convention
@@ -648,6 +712,38 @@ void CGraphics_Threaded::QuadsDrawFreeform(const CFreeformItem *pArray, int Num)
 	AddVertices(4*Num);
 }
 
+void CGraphics_Threaded::QuadsDrawVertices(const CQuadVertex *pVertices, int NumQuads)
+{
+	dbg_assert(m_Drawing == DRAWING_QUADS, "called Graphics()->QuadsDrawVertices without begin");
+
+	while(NumQuads > 0)
+	{
+		// as many quads as fit before the next flush
+		int Num = min(NumQuads, (MAX_VERTICES-m_NumVertices)/4-1);
+		if(Num <= 0)
+		{
+			FlushVertices();
+			continue;
+		}
+
+		for(int i = 0; i < Num*4; ++i)
+		{
+			m_aVertices[m_NumVertices + i].m_Pos.x = pVertices[i].m_X;
+			m_aVertices[m_NumVertices + i].m_Pos.y = pVertices[i].m_Y;
+			m_aVertices[m_NumVertices + i].m_Tex.u = pVertices[i].m_U;
+			m_aVertices[m_NumVertices + i].m_Tex.v = pVertices[i].m_V;
+			m_aVertices[m_NumVertices + i].m_Color.r = pVertices[i].m_R;
+			m_aVertices[m_NumVertices + i].m_Color.g = pVertices[i].m_G;
+			m_aVertices[m_NumVertices + i].m_Color.b = pVertices[i].m_B;
+			m_aVertices[m_NumVertices + i].m_Color.a = pVertices[i].m_A;
+		}
+
+		AddVertices(4*Num);
+		pVertices += 4*Num;
+		NumQuads -= Num;
+	}
+}
+
 void CGraphics_Threaded::QuadsText(float x, float y, float Size, const char *pText)
 {
 	float StartX = x;
@@ -677,6 +773,81 @@ void CGraphics_Threaded::QuadsText(float x, float y, float Size, const char *pTe
 	}
 }
 
+int CGraphics_Threaded::CreateQuadBuffer(const CBufferVertex *pVertices, int NumQuads)
+{
+	if(NumQuads <= 0 || m_FirstFreeQuadBuffer < 0)
+		return -1;
+
+	// grab buffer
+	int Buffer = m_FirstFreeQuadBuffer;
+	m_FirstFreeQuadBuffer = m_aQuadBufferIndices[Buffer];
+	m_aQuadBufferIndices[Buffer] = -1;
+
+	CCommandBuffer::SCommand_QuadBuffer_Create Cmd;
+	Cmd.m_Slot = Buffer;
+	Cmd.m_NumVertices = NumQuads*4;
+
+	// copy vertex data
+	Cmd.m_pVertices = (CBufferVertex *)mem_alloc(sizeof(CBufferVertex)*Cmd.m_NumVertices, sizeof(void*));
+	mem_copy(Cmd.m_pVertices, pVertices, sizeof(CBufferVertex)*Cmd.m_NumVertices);
+
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		// kick command buffer and try again
+		KickCommandBuffer();
+		if(!m_pCommandBuffer->AddCommand(Cmd))
+		{
+			// the backend never gets to free the copy
+			mem_free(Cmd.m_pVertices);
+			m_aQuadBufferIndices[Buffer] = m_FirstFreeQuadBuffer;
+			m_FirstFreeQuadBuffer = Buffer;
+			return -1;
+		}
+	}
+	return Buffer;
+}
+
+void CGraphics_Threaded::DeleteQuadBuffer(int BufferID)
+{
+	if(BufferID < 0)
+		return;
+
+	CCommandBuffer::SCommand_QuadBuffer_Destroy Cmd;
+	Cmd.m_Slot = BufferID;
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		KickCommandBuffer();
+		m_pCommandBuffer->AddCommand(Cmd);
+	}
+
+	m_aQuadBufferIndices[BufferID] = m_FirstFreeQuadBuffer;
+	m_FirstFreeQuadBuffer = BufferID;
+}
+
+void CGraphics_Threaded::RenderQuadBuffer(int BufferID, int FirstQuad, int NumQuads, float r, float g, float b, float a)
+{
+	dbg_assert(m_Drawing == 0, "called Graphics()->RenderQuadBuffer within begin");
+	if(BufferID < 0 || NumQuads <= 0 || !m_RenderEnable)
+		return;
+
+	CCommandBuffer::SCommand_RenderQuadBuffer Cmd;
+	Cmd.m_State = m_State;
+	Cmd.m_Slot = BufferID;
+	Cmd.m_FirstQuad = FirstQuad;
+	Cmd.m_NumQuads = NumQuads;
+	Cmd.m_Color.r = r;
+	Cmd.m_Color.g = g;
+	Cmd.m_Color.b = b;
+	Cmd.m_Color.a = a;
+
+	if(!m_pCommandBuffer->AddCommand(Cmd))
+	{
+		KickCommandBuffer();
+		if(!m_pCommandBuffer->AddCommand(Cmd))
+			dbg_msg("graphics", "failed to allocate memory for render command");
+	}
+}
+
 int CGraphics_Threaded::IssueInit()
 {
 	int Flags = 0;
@@ -735,6 +906,9 @@ int CGraphics_Threaded::Init()
 	m_pStorage = Kernel()->RequestInterface<IStorage>();
 	m_pConsole = Kernel()->RequestInterface<IConsole>();
 
+	// sets global state, the images get decoded on other threads later
+	png_init(0,0); // ignore_convention
+
 	// Set all z to -5.0f
 	for(int i = 0; i < MAX_VERTICES; i++)
 		m_aVertices[i].m_Pos.z = -5.0f;
@@ -745,6 +919,12 @@ int CGraphics_Threaded::Init()
 		m_aTextureIndices[i] = i+1;
 	m_aTextureIndices[MAX_TEXTURES-1] = -1;
 
+	// init quad buffers
+	m_FirstFreeQuadBuffer = 0;
+	for(int i = 0; i < MAX_QUADBUFFERS-1; i++)
+		m_aQuadBufferIndices[i] = i+1;
+	m_aQuadBufferIndices[MAX_QUADBUFFERS-1] = -1;
+
 	m_pBackend = CreateGraphicsBackend();
 	if(InitWindow() != 0)
 		return -1;
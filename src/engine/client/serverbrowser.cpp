@@ -1,6 +1,6 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
-#include <algorithm> // sort  TODO: remove this
+#include <algorithm> // sort, lower_bound  TODO: remove this
 
 #include <base/math.h>
 #include <base/system.h>
@@ -21,12 +21,17 @@
 
 class SortWrap
 {
-	typedef bool (CServerBrowser::*SortFunc)(int, int) const;
-	SortFunc m_pfnSort;
-	CServerBrowser *m_pThis;
+	CServerBrowser::FSortCompare m_pfnSort;
+	const CServerBrowser *m_pThis;
 public:
-	SortWrap(CServerBrowser *t, SortFunc f) : m_pfnSort(f), m_pThis(t) {}
-	bool operator()(int a, int b) { return (g_Config.m_BrSortOrder ? (m_pThis->*m_pfnSort)(b, a) : (m_pThis->*m_pfnSort)(a, b)); }
+	SortWrap(const CServerBrowser *t, CServerBrowser::FSortCompare f) : m_pfnSort(f), m_pThis(t) {}
+	bool operator()(int a, int b) const
+	{
+		int Result = (m_pThis->*m_pfnSort)(a, b);
+		if(Result == 0)
+			return a < b; // equal keys keep the server order, so inserting gives the same order as sorting
+		return g_Config.m_BrSortOrder ? Result > 0 : Result < 0;
+	}
 };
 
 CServerBrowser::CServerBrowser()
@@ -81,178 +86,224 @@ const CServerInfo *CServerBrowser::SortedGet(int Index) const
 }
 
 
-bool CServerBrowser::SortCompareName(int Index1, int Index2) const
+int CServerBrowser::SortCompareName(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
 	//	make sure empty entries are listed last
-	return (a->m_GotInfo && b->m_GotInfo) || (!a->m_GotInfo && !b->m_GotInfo) ? str_comp(a->m_Info.m_aName, b->m_Info.m_aName) < 0 :
-			a->m_GotInfo ? true : false;
+	if(a->m_GotInfo != b->m_GotInfo)
+		return a->m_GotInfo ? -1 : 1;
+	return str_comp(a->m_aSortName, b->m_aSortName);
 }
 
-bool CServerBrowser::SortCompareMap(int Index1, int Index2) const
+int CServerBrowser::SortCompareMap(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
-	return str_comp(a->m_Info.m_aMap, b->m_Info.m_aMap) < 0;
+	return str_comp(a->m_aSortMap, b->m_aSortMap);
 }
 
-bool CServerBrowser::SortComparePing(int Index1, int Index2) const
+int CServerBrowser::SortComparePing(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
-	return a->m_Info.m_Latency < b->m_Info.m_Latency;
+	return a->m_Info.m_Latency - b->m_Info.m_Latency;
 }
 
-bool CServerBrowser::SortCompareGametype(int Index1, int Index2) const
+int CServerBrowser::SortCompareGametype(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
-	return str_comp(a->m_Info.m_aGameType, b->m_Info.m_aGameType) < 0;
+	return str_comp(a->m_aSortGameType, b->m_aSortGameType);
 }
 
-bool CServerBrowser::SortCompareNumPlayers(int Index1, int Index2) const
+int CServerBrowser::SortCompareNumPlayers(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
-	return a->m_Info.m_NumPlayers < b->m_Info.m_NumPlayers;
+	return a->m_Info.m_NumPlayers - b->m_Info.m_NumPlayers;
 }
 
-bool CServerBrowser::SortCompareNumClients(int Index1, int Index2) const
+int CServerBrowser::SortCompareNumClients(int Index1, int Index2) const
 {
 	CServerEntry *a = m_ppServerlist[Index1];
 	CServerEntry *b = m_ppServerlist[Index2];
-	return a->m_Info.m_NumClients < b->m_Info.m_NumClients;
+	return a->m_Info.m_NumClients - b->m_Info.m_NumClients;
 }
 
-void CServerBrowser::Filter()
+CServerBrowser::FSortCompare CServerBrowser::SortCompare() const
 {
-	int i = 0, p = 0;
-	m_NumSortedServers = 0;
+	if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
+		return &CServerBrowser::SortComparePing;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
+		return &CServerBrowser::SortCompareMap;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
+		return g_Config.m_BrFilterSpectators ? &CServerBrowser::SortCompareNumPlayers : &CServerBrowser::SortCompareNumClients;
+	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
+		return &CServerBrowser::SortCompareGametype;
+	return &CServerBrowser::SortCompareName;
+}
 
-	// allocate the sorted list
-	if(m_NumSortedServersCapacity < m_NumServers)
+static void SortKey(char *pDst, const char *pSrc, int DstSize)
+{
+	int i = 0;
+	for(; i < DstSize-1 && pSrc[i]; i++)
+		pDst[i] = (pSrc[i] >= 'A' && pSrc[i] <= 'Z') ? pSrc[i]-'A'+'a' : pSrc[i];
+	pDst[i] = 0;
+}
+
+void CServerBrowser::UpdateSortKeys(CServerEntry *pEntry)
+{
+	static const char *s_apPureGameTypes[] = {"DM", "TDM", "CTF"};
+	static const char *s_apPureMaps[] = {"dm1", "dm2", "dm6", "dm7", "dm8", "dm9", "ctf1", "ctf2", "ctf3", "ctf4", "ctf5", "ctf6", "ctf7"};
+	const CServerInfo *pInfo = &pEntry->m_Info;
+
+	SortKey(pEntry->m_aSortName, pInfo->m_aName, sizeof(pEntry->m_aSortName));
+	SortKey(pEntry->m_aSortMap, pInfo->m_aMap, sizeof(pEntry->m_aSortMap));
+	SortKey(pEntry->m_aSortGameType, pInfo->m_aGameType, sizeof(pEntry->m_aSortGameType));
+
+	int Flags = 0;
+	if(pInfo->m_NumPlayers == 0)
+		Flags |= FILTERFLAG_NOPLAYERS;
+	if(pInfo->m_NumClients == 0)
+		Flags |= FILTERFLAG_NOCLIENTS;
+	if(pInfo->m_NumPlayers == pInfo->m_MaxPlayers)
+		Flags |= FILTERFLAG_FULLPLAYERS;
+	if(pInfo->m_NumClients == pInfo->m_MaxClients)
+		Flags |= FILTERFLAG_FULLCLIENTS;
+	if(pInfo->m_Flags&SERVER_FLAG_PASSWORD)
+		Flags |= FILTERFLAG_PASSWORD;
+
+	Flags |= FILTERFLAG_IMPURE;
+	for(unsigned i = 0; i < sizeof(s_apPureGameTypes)/sizeof(s_apPureGameTypes[0]); i++)
 	{
-		if(m_pSortedServerlist)
-			mem_free(m_pSortedServerlist);
-		m_NumSortedServersCapacity = m_NumServers;
-		m_pSortedServerlist = (int *)mem_alloc(m_NumSortedServersCapacity*sizeof(int), 1);
+		if(str_comp(pInfo->m_aGameType, s_apPureGameTypes[i]) == 0)
+		{
+			Flags &= ~FILTERFLAG_IMPURE;
+			break;
+		}
 	}
 
-	// filter the servers
-	for(i = 0; i < m_NumServers; i++)
+	Flags |= FILTERFLAG_IMPUREMAP;
+	for(unsigned i = 0; i < sizeof(s_apPureMaps)/sizeof(s_apPureMaps[0]); i++)
 	{
-		int Filtered = 0;
-
-		if(g_Config.m_BrFilterEmpty && ((g_Config.m_BrFilterSpectators && m_ppServerlist[i]->m_Info.m_NumPlayers == 0) || m_ppServerlist[i]->m_Info.m_NumClients == 0))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterFull && ((g_Config.m_BrFilterSpectators && m_ppServerlist[i]->m_Info.m_NumPlayers == m_ppServerlist[i]->m_Info.m_MaxPlayers) ||
-				m_ppServerlist[i]->m_Info.m_NumClients == m_ppServerlist[i]->m_Info.m_MaxClients))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterPw && m_ppServerlist[i]->m_Info.m_Flags&SERVER_FLAG_PASSWORD)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterPure &&
-			(str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "DM") != 0 &&
-			str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "TDM") != 0 &&
-			str_comp(m_ppServerlist[i]->m_Info.m_aGameType, "CTF") != 0))
+		if(str_comp(pInfo->m_aMap, s_apPureMaps[i]) == 0)
 		{
-			Filtered = 1;
+			Flags &= ~FILTERFLAG_IMPUREMAP;
+			break;
 		}
-		else if(g_Config.m_BrFilterPureMap &&
-			!(str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm1") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm2") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm6") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm7") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm8") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "dm9") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf1") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf2") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf3") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf4") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf5") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf6") == 0 ||
-			str_comp(m_ppServerlist[i]->m_Info.m_aMap, "ctf7") == 0)
-		)
+	}
+
+	if(str_comp_num(pInfo->m_aVersion, m_aNetVersion, 3) != 0)
+		Flags |= FILTERFLAG_INCOMPATIBLE;
+
+	pEntry->m_FilterFlags = Flags;
+}
+
+int CServerBrowser::FilterMask() const
+{
+	int Mask = 0;
+	if(g_Config.m_BrFilterEmpty)
+		Mask |= FILTERFLAG_NOCLIENTS | (g_Config.m_BrFilterSpectators ? FILTERFLAG_NOPLAYERS : 0);
+	if(g_Config.m_BrFilterFull)
+		Mask |= FILTERFLAG_FULLCLIENTS | (g_Config.m_BrFilterSpectators ? FILTERFLAG_FULLPLAYERS : 0);
+	if(g_Config.m_BrFilterPw)
+		Mask |= FILTERFLAG_PASSWORD;
+	if(g_Config.m_BrFilterPure)
+		Mask |= FILTERFLAG_IMPURE;
+	if(g_Config.m_BrFilterPureMap)
+		Mask |= FILTERFLAG_IMPUREMAP;
+	if(g_Config.m_BrFilterCompatversion)
+		Mask |= FILTERFLAG_INCOMPATIBLE;
+	return Mask;
+}
+
+bool CServerBrowser::Filtered(CServerEntry *pEntry, int FilterMask)
+{
+	CServerInfo *pInfo = &pEntry->m_Info;
+	int p = 0;
+
+	if(pEntry->m_FilterFlags&FilterMask)
+		return true;
+	else if(g_Config.m_BrFilterPing < pInfo->m_Latency)
+		return true;
+	else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(pInfo->m_aAddress, g_Config.m_BrFilterServerAddress))
+		return true;
+	else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(pInfo->m_aGameType, g_Config.m_BrFilterGametype))
+		return true;
+	else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_find_nocase(pInfo->m_aGameType, g_Config.m_BrFilterGametype))
+		return true;
+
+	if(g_Config.m_BrFilterCountry)
+	{
+		// match against player country
+		for(p = 0; p < pInfo->m_NumClients; p++)
 		{
-			Filtered = 1;
+			if(pInfo->m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
+				break;
 		}
-		else if(g_Config.m_BrFilterPing < m_ppServerlist[i]->m_Info.m_Latency)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterCompatversion && str_comp_num(m_ppServerlist[i]->m_Info.m_aVersion, m_aNetVersion, 3) != 0)
-			Filtered = 1;
-		else if(g_Config.m_BrFilterServerAddress[0] && !str_find_nocase(m_ppServerlist[i]->m_Info.m_aAddress, g_Config.m_BrFilterServerAddress))
-			Filtered = 1;
-		else if(g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && str_comp_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = 1;
-		else if(!g_Config.m_BrFilterGametypeStrict && g_Config.m_BrFilterGametype[0] && !str_find_nocase(m_ppServerlist[i]->m_Info.m_aGameType, g_Config.m_BrFilterGametype))
-			Filtered = 1;
-		else
-		{
-			if(g_Config.m_BrFilterCountry)
-			{
-				Filtered = 1;
-				// match against player country
-				for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
-				{
-					if(m_ppServerlist[i]->m_Info.m_aClients[p].m_Country == g_Config.m_BrFilterCountryIndex)
-					{
-						Filtered = 0;
-						break;
-					}
-				}
-			}
+		if(p == pInfo->m_NumClients)
+			return true;
+	}
 
-			if(!Filtered && g_Config.m_BrFilterString[0] != 0)
-			{
-				int MatchFound = 0;
-
-				m_ppServerlist[i]->m_Info.m_QuickSearchHit = 0;
-
-				// match against server name
-				if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aName, g_Config.m_BrFilterString))
-				{
-					MatchFound = 1;
-					m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
-				}
-
-				// match against players
-				for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
-				{
-					if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
-						str_find_nocase(m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan, g_Config.m_BrFilterString))
-					{
-						MatchFound = 1;
-						m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
-						break;
-					}
-				}
-
-				// match against map
-				if(str_find_nocase(m_ppServerlist[i]->m_Info.m_aMap, g_Config.m_BrFilterString))
-				{
-					MatchFound = 1;
-					m_ppServerlist[i]->m_Info.m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
-				}
-
-				if(!MatchFound)
-					Filtered = 1;
-			}
-		}
+	if(g_Config.m_BrFilterString[0] != 0)
+	{
+		pInfo->m_QuickSearchHit = 0;
 
-		if(Filtered == 0)
+		// match against server name
+		if(str_find_nocase(pInfo->m_aName, g_Config.m_BrFilterString))
+			pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_SERVERNAME;
+
+		// match against players
+		for(p = 0; p < pInfo->m_NumClients; p++)
 		{
-			// check for friend
-			m_ppServerlist[i]->m_Info.m_FriendState = IFriends::FRIEND_NO;
-			for(p = 0; p < m_ppServerlist[i]->m_Info.m_NumClients; p++)
+			if(str_find_nocase(pInfo->m_aClients[p].m_aName, g_Config.m_BrFilterString) ||
+				str_find_nocase(pInfo->m_aClients[p].m_aClan, g_Config.m_BrFilterString))
 			{
-				m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState = m_pFriends->GetFriendState(m_ppServerlist[i]->m_Info.m_aClients[p].m_aName,
-					m_ppServerlist[i]->m_Info.m_aClients[p].m_aClan);
-				m_ppServerlist[i]->m_Info.m_FriendState = max(m_ppServerlist[i]->m_Info.m_FriendState, m_ppServerlist[i]->m_Info.m_aClients[p].m_FriendState);
+				pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_PLAYER;
+				break;
 			}
-
-			if(!g_Config.m_BrFilterFriends || m_ppServerlist[i]->m_Info.m_FriendState != IFriends::FRIEND_NO)
-				m_pSortedServerlist[m_NumSortedServers++] = i;
 		}
+
+		// match against map
+		if(str_find_nocase(pInfo->m_aMap, g_Config.m_BrFilterString))
+			pInfo->m_QuickSearchHit |= IServerBrowser::QUICK_MAPNAME;
+
+		if(!pInfo->m_QuickSearchHit)
+			return true;
+	}
+
+	// check for friend
+	pInfo->m_FriendState = IFriends::FRIEND_NO;
+	for(p = 0; p < pInfo->m_NumClients; p++)
+	{
+		pInfo->m_aClients[p].m_FriendState = m_pFriends->GetFriendState(pInfo->m_aClients[p].m_aName, pInfo->m_aClients[p].m_aClan);
+		pInfo->m_FriendState = max(pInfo->m_FriendState, pInfo->m_aClients[p].m_FriendState);
+	}
+
+	return g_Config.m_BrFilterFriends && pInfo->m_FriendState == IFriends::FRIEND_NO;
+}
+
+void CServerBrowser::Filter()
+{
+	int FilterMask = this->FilterMask();
+	m_NumSortedServers = 0;
+
+	// allocate the sorted list
+	if(m_NumSortedServersCapacity < m_NumServers)
+	{
+		if(m_pSortedServerlist)
+			mem_free(m_pSortedServerlist);
+		m_NumSortedServersCapacity = m_NumServers;
+		m_pSortedServerlist = (int *)mem_alloc(m_NumSortedServersCapacity*sizeof(int), 1);
+	}
+
+	// filter the servers
+	for(int i = 0; i < m_NumServers; i++)
+	{
+		m_ppServerlist[i]->m_Info.m_SortedIndex = -1;
+		if(!Filtered(m_ppServerlist[i], FilterMask))
+			m_pSortedServerlist[m_NumSortedServers++] = i;
 	}
 }
 
@@ -274,6 +325,12 @@ int CServerBrowser::SortHash() const
 	return i;
 }
 
+bool CServerBrowser::NeedSort() const
+{
+	return m_Sorthash != SortHash() || str_comp(m_aFilterString, g_Config.m_BrFilterString) != 0 ||
+		str_comp(m_aFilterGametypeString, g_Config.m_BrFilterGametype) != 0;
+}
+
 void CServerBrowser::Sort()
 {
 	int i;
@@ -282,17 +339,7 @@ void CServerBrowser::Sort()
 	Filter();
 
 	// sort
-	if(g_Config.m_BrSort == IServerBrowser::SORT_NAME)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareName));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_PING)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortComparePing));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_MAP)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareMap));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_NUMPLAYERS)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this,
-					g_Config.m_BrFilterSpectators ? &CServerBrowser::SortCompareNumPlayers : &CServerBrowser::SortCompareNumClients));
-	else if(g_Config.m_BrSort == IServerBrowser::SORT_GAMETYPE)
-		std::stable_sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, &CServerBrowser::SortCompareGametype));
+	std::sort(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, SortWrap(this, SortCompare()));
 
 	// set indexes
 	for(i = 0; i < m_NumSortedServers; i++)
@@ -303,6 +350,49 @@ void CServerBrowser::Sort()
 	m_Sorthash = SortHash();
 }
 
+void CServerBrowser::Resort(CServerEntry *pEntry)
+{
+	// a changed filter or order needs the whole list
+	if(NeedSort())
+	{
+		Sort();
+		return;
+	}
+
+	// take the entry out of the sorted list
+	int Index = pEntry->m_Info.m_SortedIndex;
+	if(Index >= 0)
+	{
+		m_NumSortedServers--;
+		mem_move(&m_pSortedServerlist[Index], &m_pSortedServerlist[Index+1], (m_NumSortedServers-Index)*sizeof(int));
+		for(int i = Index; i < m_NumSortedServers; i++)
+			m_ppServerlist[m_pSortedServerlist[i]]->m_Info.m_SortedIndex = i;
+		pEntry->m_Info.m_SortedIndex = -1;
+	}
+
+	if(Filtered(pEntry, FilterMask()))
+		return;
+
+	if(m_NumSortedServersCapacity < m_NumServers)
+	{
+		int *pNewList = (int *)mem_alloc(m_NumServerCapacity*sizeof(int), 1);
+		mem_copy(pNewList, m_pSortedServerlist, m_NumSortedServers*sizeof(int));
+		if(m_pSortedServerlist)
+			mem_free(m_pSortedServerlist);
+		m_pSortedServerlist = pNewList;
+		m_NumSortedServersCapacity = m_NumServerCapacity;
+	}
+
+	// and put it back at its place
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
+	Index = std::lower_bound(m_pSortedServerlist, m_pSortedServerlist+m_NumSortedServers, ServerIndex, SortWrap(this, SortCompare()))-m_pSortedServerlist;
+	mem_move(&m_pSortedServerlist[Index+1], &m_pSortedServerlist[Index], (m_NumSortedServers-Index)*sizeof(int));
+	m_pSortedServerlist[Index] = ServerIndex;
+	m_NumSortedServers++;
+	for(int i = Index; i < m_NumSortedServers; i++)
+		m_ppServerlist[m_pSortedServerlist[i]]->m_Info.m_SortedIndex = i;
+}
+
 void CServerBrowser::RemoveRequest(CServerEntry *pEntry)
 {
 	if(pEntry->m_pPrevReq || pEntry->m_pNextReq || m_pFirstReqServer == pEntry)
@@ -351,8 +441,12 @@ void CServerBrowser::QueueRequest(CServerEntry *pEntry)
 void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 {
 	int Fav = pEntry->m_Info.m_Favorite;
+	int SortedIndex = pEntry->m_Info.m_SortedIndex;
+	int ServerIndex = pEntry->m_Info.m_ServerIndex;
 	pEntry->m_Info = Info;
 	pEntry->m_Info.m_Favorite = Fav;
+	pEntry->m_Info.m_SortedIndex = SortedIndex;
+	pEntry->m_Info.m_ServerIndex = ServerIndex;
 	pEntry->m_Info.m_NetAddr = pEntry->m_Addr;
 
 	// all these are just for nice compability
@@ -370,6 +464,7 @@ void CServerBrowser::SetInfo(CServerEntry *pEntry, const CServerInfo &Info)
 	}*/
 
 	pEntry->m_GotInfo = 1;
+	UpdateSortKeys(pEntry);
 }
 
 CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR &Addr)
@@ -414,8 +509,11 @@ CServerBrowser::CServerEntry *CServerBrowser::Add(const NETADDR &Addr)
 	// add to list
 	m_ppServerlist[m_NumServers] = pEntry;
 	pEntry->m_Info.m_ServerIndex = m_NumServers;
+	pEntry->m_Info.m_SortedIndex = -1;
 	m_NumServers++;
 
+	UpdateSortKeys(pEntry);
+
 	return pEntry;
 }
 
@@ -463,7 +561,9 @@ void CServerBrowser::Set(const NETADDR &Addr, int Type, int Token, const CServer
 		}
 	}
 
-	Sort();
+	// only the changed entry moves
+	if(pEntry)
+		Resort(pEntry);
 }
 
 void CServerBrowser::Refresh(int Type)
@@ -628,7 +728,7 @@ void CServerBrowser::Update(bool ForceResort)
 	}
 
 	// check if we need to resort
-	if(m_Sorthash != SortHash() || ForceResort)
+	if(NeedSort() || ForceResort)
 		Sort();
 }
 
@@ -16,6 +16,12 @@ public:
 		int m_GotInfo;
 		CServerInfo m_Info;
 
+		// precomputed on every info update
+		char m_aSortName[64]; // lowercased
+		char m_aSortMap[32];
+		char m_aSortGameType[16];
+		int m_FilterFlags;
+
 		CServerEntry *m_pNextIp; // ip hashed list
 
 		CServerEntry *m_pPrevReq; // request list
@@ -24,9 +30,21 @@ public:
 
 	enum
 	{
-		MAX_FAVORITES=256
+		MAX_FAVORITES=256,
+
+		// filter conditions that only depend on the server info
+		FILTERFLAG_NOPLAYERS=1,
+		FILTERFLAG_NOCLIENTS=2,
+		FILTERFLAG_FULLPLAYERS=4,
+		FILTERFLAG_FULLCLIENTS=8,
+		FILTERFLAG_PASSWORD=16,
+		FILTERFLAG_IMPURE=32,
+		FILTERFLAG_IMPUREMAP=64,
+		FILTERFLAG_INCOMPATIBLE=128,
 	};
 
+	typedef int (CServerBrowser::*FSortCompare)(int Index1, int Index2) const;
+
 	CServerBrowser();
 
 	// interface functions
@@ -89,17 +107,23 @@ private:
 	int64 m_BroadcastTime;
 
 	// sorting criterions
-	bool SortCompareName(int Index1, int Index2) const;
-	bool SortCompareMap(int Index1, int Index2) const;
-	bool SortComparePing(int Index1, int Index2) const;
-	bool SortCompareGametype(int Index1, int Index2) const;
-	bool SortCompareNumPlayers(int Index1, int Index2) const;
-	bool SortCompareNumClients(int Index1, int Index2) const;
+	int SortCompareName(int Index1, int Index2) const;
+	int SortCompareMap(int Index1, int Index2) const;
+	int SortComparePing(int Index1, int Index2) const;
+	int SortCompareGametype(int Index1, int Index2) const;
+	int SortCompareNumPlayers(int Index1, int Index2) const;
+	int SortCompareNumClients(int Index1, int Index2) const;
+	FSortCompare SortCompare() const;
 
 	//
+	int FilterMask() const;
+	bool Filtered(CServerEntry *pEntry, int FilterMask);
 	void Filter();
 	void Sort();
+	void Resort(CServerEntry *pEntry);
+	bool NeedSort() const;
 	int SortHash() const;
+	void UpdateSortKeys(CServerEntry *pEntry);
 
 	CServerEntry *Find(const NETADDR &Addr);
 	CServerEntry *Add(const NETADDR &Addr);
@@ -7,6 +7,7 @@
 #include <engine/storage.h>
 
 #include <engine/shared/config.h>
+#include <engine/shared/mixer.h>
 
 #include "SDL.h"
 
@@ -20,7 +21,7 @@ extern "C" { // wavpack
 enum
 {
 	NUM_SAMPLES = 512,
-	NUM_VOICES = 64,
+	NUM_VOICES = CMixer::MAX_VOICES,
 	NUM_CHANNELS = 16,
 };
 
@@ -45,7 +46,8 @@ struct CVoice
 {
 	CSample *m_pSample;
 	CChannel *m_pChannel;
-	int m_Tick;
+	int m_Frame; // position in the sample, it keeps its own rate
+	int m_Frac;
 	int m_Vol; // 0 - 255
 	int m_Flags;
 	int m_X, m_Y;
@@ -65,18 +67,9 @@ static volatile int m_SoundVolume = 100;
 
 static int m_NextVoice = 0;
 static int *m_pMixBuffer = 0;	// buffer only used by the thread callback function
+static CMixer m_Mixer;	// voice snapshot only used by the thread callback function
 static unsigned m_MaxFrames = 0;
 
-// TODO: there should be a faster way todo this
-static short Int2Short(int i)
-{
-	if(i > 0x7fff)
-		return 0x7fff;
-	else if(i < -0x7fff)
-		return -0x7fff;
-	return i;
-}
-
 static int IntAbs(int i)
 {
 	if(i<0)
@@ -90,36 +83,22 @@ static void Mix(short *pFinalOut, unsigned Frames)
 	mem_zero(m_pMixBuffer, m_MaxFrames*2*sizeof(int));
 	Frames = min(Frames, m_MaxFrames);
 
-	// aquire lock while we are mixing
+	// aquire lock only to take the voices and move them forward
 	lock_wait(m_SoundLock);
 
 	MasterVol = m_SoundVolume;
+	m_Mixer.Clear();
 
 	for(unsigned i = 0; i < NUM_VOICES; i++)
 	{
 		if(m_aVoices[i].m_pSample)
 		{
-			// mix voice
 			CVoice *v = &m_aVoices[i];
-			int *pOut = m_pMixBuffer;
-
-			int Step = v->m_pSample->m_Channels; // setup input sources
-			short *pInL = &v->m_pSample->m_pData[v->m_Tick*Step];
-			short *pInR = &v->m_pSample->m_pData[v->m_Tick*Step+1];
-
-			unsigned End = v->m_pSample->m_NumFrames-v->m_Tick;
+			CSample *pSample = v->m_pSample;
 
 			int Rvol = v->m_pChannel->m_Vol;
 			int Lvol = v->m_pChannel->m_Vol;
 
-			// make sure that we don't go outside the sound data
-			if(Frames < End)
-				End = Frames;
-
-			// check if we have a mono sound
-			if(v->m_pSample->m_Channels == 1)
-				pInR = pInL;
-
 			// volume calculation
 			if(v->m_Flags&ISound::FLAG_POS && v->m_pChannel->m_Pan)
 			{
@@ -148,44 +127,21 @@ static void Mix(short *pFinalOut, unsigned Frames)
 				}
 			}
 
-			// process all frames
-			for(unsigned s = 0; s < End; s++)
-			{
-				*pOut++ += (*pInL)*Lvol;
-				*pOut++ += (*pInR)*Rvol;
-				pInL += Step;
-				pInR += Step;
-				v->m_Tick++;
-			}
+			bool Loop = (v->m_Flags&ISound::FLAG_LOOP) != 0;
+			int Step = CMixer::Step(pSample->m_Rate, m_MixingRate);
+			m_Mixer.AddVoice(pSample->m_pData, pSample->m_NumFrames, pSample->m_Channels, v->m_Frame, v->m_Frac, Step, Loop, Lvol, Rvol);
 
 			// free voice if not used any more
-			if(v->m_Tick == v->m_pSample->m_NumFrames)
-			{
-				if(v->m_Flags&ISound::FLAG_LOOP)
-					v->m_Tick = 0;
-				else
-					v->m_pSample = 0;
-			}
+			if(!CMixer::Advance(&v->m_Frame, &v->m_Frac, Step, pSample->m_NumFrames, Loop, Frames))
+				v->m_pSample = 0;
 		}
 	}
 
-
 	// release the lock
 	lock_release(m_SoundLock);
 
-	{
-		// clamp accumulated values
-		// TODO: this seams slow
-		for(unsigned i = 0; i < Frames; i++)
-		{
-			int j = i<<1;
-			int vl = ((m_pMixBuffer[j]*MasterVol)/101)>>8;
-			int vr = ((m_pMixBuffer[j+1]*MasterVol)/101)>>8;
-
-			pFinalOut[j] = Int2Short(vl);
-			pFinalOut[j+1] = Int2Short(vr);
-		}
-	}
+	m_Mixer.Mix(m_pMixBuffer, Frames);
+	CMixer::Finish(pFinalOut, m_pMixBuffer, Frames, MasterVol);
 
 #if defined(CONF_ARCH_ENDIAN_BIG)
 	swap_endian(pFinalOut, sizeof(short), Frames * 2);
@@ -290,44 +246,6 @@ int CSound::AllocID()
 	return -1;
 }
 
-void CSound::RateConvert(int SampleID)
-{
-	CSample *pSample = &m_aSamples[SampleID];
-	int NumFrames = 0;
-	short *pNewData = 0;
-
-	// make sure that we need to convert this sound
-	if(!pSample->m_pData || pSample->m_Rate == m_MixingRate)
-		return;
-
-	// allocate new data
-	NumFrames = (int)((pSample->m_NumFrames/(float)pSample->m_Rate)*m_MixingRate);
-	pNewData = (short *)mem_alloc(NumFrames*pSample->m_Channels*sizeof(short), 1);
-
-	for(int i = 0; i < NumFrames; i++)
-	{
-		// resample TODO: this should be done better, like linear atleast
-		float a = i/(float)NumFrames;
-		int f = (int)(a*pSample->m_NumFrames);
-		if(f >= pSample->m_NumFrames)
-			f = pSample->m_NumFrames-1;
-
-		// set new data
-		if(pSample->m_Channels == 1)
-			pNewData[i] = pSample->m_pData[f];
-		else if(pSample->m_Channels == 2)
-		{
-			pNewData[i*2] = pSample->m_pData[f*2];
-			pNewData[i*2+1] = pSample->m_pData[f*2+1];
-		}
-	}
-
-	// free old data and apply new
-	mem_free(pSample->m_pData);
-	pSample->m_pData = pNewData;
-	pSample->m_NumFrames = NumFrames;
-}
-
 int CSound::ReadData(void *pBuffer, int Size)
 {
 	return io_read(ms_File, pBuffer, Size);
@@ -425,7 +343,6 @@ int CSound::LoadWV(const char *pFilename)
 	if(g_Config.m_Debug)
 		dbg_msg("sound/wv", "loaded %s", pFilename);
 
-	RateConvert(SampleID);
 	return SampleID;
 }
 
@@ -467,9 +384,10 @@ int CSound::Play(int ChannelID, int SampleID, int Flags, float x, float y)
 		m_aVoices[VoiceID].m_pSample = &m_aSamples[SampleID];
 		m_aVoices[VoiceID].m_pChannel = &m_aChannels[ChannelID];
 		if(Flags & FLAG_LOOP)
-			m_aVoices[VoiceID].m_Tick = m_aSamples[SampleID].m_PausedAt;
+			m_aVoices[VoiceID].m_Frame = m_aSamples[SampleID].m_PausedAt;
 		else
-			m_aVoices[VoiceID].m_Tick = 0;
+			m_aVoices[VoiceID].m_Frame = 0;
+		m_aVoices[VoiceID].m_Frac = 0;
 		m_aVoices[VoiceID].m_Vol = 255;
 		m_aVoices[VoiceID].m_Flags = Flags;
 		m_aVoices[VoiceID].m_X = (int)x;
@@ -500,7 +418,7 @@ void CSound::Stop(int SampleID)
 		if(m_aVoices[i].m_pSample == pSample)
 		{
 			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
+				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Frame;
 			else
 				m_aVoices[i].m_pSample->m_PausedAt = 0;
 			m_aVoices[i].m_pSample = 0;
@@ -518,7 +436,7 @@ void CSound::StopAll()
 		if(m_aVoices[i].m_pSample)
 		{
 			if(m_aVoices[i].m_Flags & FLAG_LOOP)
-				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Tick;
+				m_aVoices[i].m_pSample->m_PausedAt = m_aVoices[i].m_Frame;
 			else
 				m_aVoices[i].m_pSample->m_PausedAt = 0;
 		}
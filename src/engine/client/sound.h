@@ -19,8 +19,6 @@ public:
 	int Shutdown();
 	int AllocID();
 
-	static void RateConvert(int SampleID);
-
 	// TODO: Refactor: clean this mess up
 	static IOHANDLE ms_File;
 	static int ReadData(void *pBuffer, int Size);
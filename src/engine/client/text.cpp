@@ -2,8 +2,10 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
 #include <base/math.h>
+#include <base/tl/array.h>
 #include <engine/graphics.h>
 #include <engine/textrender.h>
+#include <engine/shared/config.h>
 
 #ifdef CONF_FAMILY_WINDOWS
 	#include <windows.h>
@@ -16,7 +18,14 @@
 // TODO: Refactor: clean this up
 enum
 {
-	MAX_CHARACTERS = 64,
+	MAX_GLYPHS = 1024,
+	GLYPH_HASH_SIZE = 256,
+
+	MIN_ATLAS_SIZE = 64,
+	MAX_ATLAS_SIZE = 2048,
+
+	LAYOUT_HASH_SIZE = 1024,
+	LAYOUT_RENDER_BATCH = 256,
 };
 
 
@@ -26,6 +35,7 @@ static int aFontSizes[] = {8,9,10,11,12,13,14,15,16,17,18,19,20,36,64};
 struct CFontChar
 {
 	int m_ID;
+	int m_Next; // in the hash chain
 
 	// these values are scaled to the pFont size
 	// width * font_size == real_size
@@ -36,27 +46,32 @@ struct CFontChar
 	float m_AdvanceX;
 
 	float m_aUvs[4];
-	int64 m_TouchTime;
+	float m_aOutlineUvs[4];
 };
 
+/*
+	One atlas texture holds the glyphs of a size and their outlines next
+	to them. They are packed in rows, when the atlas is full it grows up
+	to MAX_ATLAS_SIZE and is cleared otherwise. Every clear bumps the
+	generation, layouts of an older generation are laid out again.
+*/
 struct CFontSizeData
 {
 	int m_FontSize;
 	FT_Face *m_pFace;
 
-	int m_aTextures[2];
+	int m_Texture;
 	int m_TextureWidth;
 	int m_TextureHeight;
+	int m_Generation;
 
-	int m_NumXChars;
-	int m_NumYChars;
-
-	int m_CharMaxWidth;
-	int m_CharMaxHeight;
+	int m_PackX;
+	int m_PackY;
+	int m_PackRowHeight;
 
-	CFontChar m_aCharacters[MAX_CHARACTERS*MAX_CHARACTERS];
-
-	int m_CurrentCharacter;
+	CFontChar m_aCharacters[MAX_GLYPHS];
+	int m_aCharHash[GLYPH_HASH_SIZE];
+	int m_NumCharacters;
 };
 
 class CFont
@@ -67,6 +82,48 @@ public:
 	CFontSizeData m_aSizes[NUM_FONT_SIZES];
 };
 
+// a glyph placed relative to the start of the layout
+struct CGlyphQuad
+{
+	float m_X, m_Y, m_Width, m_Height;
+	float m_aUvs[4];
+	float m_aOutlineUvs[4];
+};
+
+class CTextLayout
+{
+public:
+	// key
+	unsigned m_Hash;
+	CFont *m_pFont;
+	int m_FontSize;
+	float m_FakeToScreenX;
+	float m_FakeToScreenY;
+	int m_Flags;
+	float m_LineWidth;
+	int m_MaxLines;
+	int m_LineCount;
+	float m_StartOffset;
+	char *m_pText;
+	int m_Length;
+
+	// the glyphs and where the cursor ends up
+	CFontSizeData *m_pSizeData;
+	int m_Generation;
+	CGlyphQuad *m_pQuads;
+	int m_NumQuads;
+	float m_AdvanceX;
+	float m_AdvanceY;
+	int m_NewLine;
+	int m_Lines;
+	int m_Chars;
+
+	int m_MemSize;
+	CTextLayout *m_pHashNext;
+	CTextLayout *m_pPrev; // more recently used
+	CTextLayout *m_pNext; // less recently used
+};
+
 
 class CTextRender : public IEngineTextRender
 {
@@ -103,6 +160,15 @@ class CTextRender : public IEngineTextRender
 
 	FT_Library m_FTLibrary;
 
+	// layout cache, most recently used first
+	CTextLayout *m_apLayoutHash[LAYOUT_HASH_SIZE];
+	CTextLayout *m_pFirstLayout;
+	CTextLayout *m_pLastLayout;
+	int m_LayoutMemory;
+	CTextLayout m_ScratchLayout;
+	array<CGlyphQuad> m_lLayoutQuads;
+	IGraphics::CQuadVertex m_aVertices[LAYOUT_RENDER_BATCH*4];
+
 	int GetFontSizeIndex(int Pixelsize)
 	{
 		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
@@ -140,33 +206,32 @@ class CTextRender : public IEngineTextRender
 			}
 	}
 
-	void InitTexture(CFontSizeData *pSizeData, int CharWidth, int CharHeight, int Xchars, int Ychars)
+	void InitTexture(CFontSizeData *pSizeData, int Width, int Height)
 	{
 		static int FontMemoryUsage = 0;
-		int Width = CharWidth*Xchars;
-		int Height = CharHeight*Ychars;
 		void *pMem = mem_alloc(Width*Height, 1);
 		mem_zero(pMem, Width*Height);
 
-		for(int i = 0; i < 2; i++)
+		if(pSizeData->m_Texture != 0)
 		{
-			if(pSizeData->m_aTextures[i] != 0)
-			{
-				Graphics()->UnloadTexture(pSizeData->m_aTextures[i]);
-				FontMemoryUsage -= pSizeData->m_TextureWidth*pSizeData->m_TextureHeight;
-				pSizeData->m_aTextures[i] = 0;
-			}
-
-			pSizeData->m_aTextures[i] = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pMem, CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
-			FontMemoryUsage += Width*Height;
+			Graphics()->UnloadTexture(pSizeData->m_Texture);
+			FontMemoryUsage -= pSizeData->m_TextureWidth*pSizeData->m_TextureHeight;
+			pSizeData->m_Texture = 0;
 		}
 
-		pSizeData->m_NumXChars = Xchars;
-		pSizeData->m_NumYChars = Ychars;
+		pSizeData->m_Texture = Graphics()->LoadTextureRaw(Width, Height, CImageInfo::FORMAT_ALPHA, pMem, CImageInfo::FORMAT_ALPHA, IGraphics::TEXLOAD_NOMIPMAPS);
+		FontMemoryUsage += Width*Height;
+
 		pSizeData->m_TextureWidth = Width;
 		pSizeData->m_TextureHeight = Height;
-		pSizeData->m_CurrentCharacter = 0;
-		
+		pSizeData->m_Generation++;
+		pSizeData->m_PackX = 0;
+		pSizeData->m_PackY = 0;
+		pSizeData->m_PackRowHeight = 0;
+		pSizeData->m_NumCharacters = 0;
+		for(int i = 0; i < GLYPH_HASH_SIZE; i++)
+			pSizeData->m_aCharHash[i] = -1;
+
 		dbg_msg("", "pFont memory usage: %d", FontMemoryUsage);
 
 		mem_free(pMem);
@@ -181,13 +246,18 @@ class CTextRender : public IEngineTextRender
 		return OutlineThickness;
 	}
 
+	// grows the atlas if it may, clears it otherwise
 	void IncreaseTextureSize(CFontSizeData *pSizeData)
 	{
-		if(pSizeData->m_TextureWidth < pSizeData->m_TextureHeight)
-			pSizeData->m_NumXChars <<= 1;
-		else
-			pSizeData->m_NumYChars <<= 1;
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, pSizeData->m_NumXChars, pSizeData->m_NumYChars);
+		int Width = pSizeData->m_TextureWidth;
+		int Height = pSizeData->m_TextureHeight;
+		if(Height < Width && Height < MAX_ATLAS_SIZE)
+			Height <<= 1;
+		else if(Width < MAX_ATLAS_SIZE)
+			Width <<= 1;
+		else if(Height < MAX_ATLAS_SIZE)
+			Height <<= 1;
+		InitTexture(pSizeData, Width, Height);
 	}
 
 
@@ -199,34 +269,14 @@ class CTextRender : public IEngineTextRender
 		pSizeData->m_FontSize = aFontSizes[Index];
 		FT_Set_Pixel_Sizes(pFont->m_FtFace, 0, pSizeData->m_FontSize);
 
-		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
-
-		{
-			unsigned GlyphIndex;
-			int MaxH = 0;
-			int MaxW = 0;
-
-			int Charcode = FT_Get_First_Char(pFont->m_FtFace, &GlyphIndex);
-			while(GlyphIndex != 0)
-			{
-				// do stuff
-				FT_Load_Glyph(pFont->m_FtFace, GlyphIndex, FT_LOAD_DEFAULT);
-
-				if(pFont->m_FtFace->glyph->metrics.width > MaxW) MaxW = pFont->m_FtFace->glyph->metrics.width; // ignore_convention
-				if(pFont->m_FtFace->glyph->metrics.height > MaxH) MaxH = pFont->m_FtFace->glyph->metrics.height; // ignore_convention
-				Charcode = FT_Get_Next_Char(pFont->m_FtFace, Charcode, &GlyphIndex);
-			}
-
-			MaxW = (MaxW>>6)+2+OutlineThickness*2;
-			MaxH = (MaxH>>6)+2+OutlineThickness*2;
-
-			for(pSizeData->m_CharMaxWidth = 1; pSizeData->m_CharMaxWidth < MaxW; pSizeData->m_CharMaxWidth <<= 1);
-			for(pSizeData->m_CharMaxHeight = 1; pSizeData->m_CharMaxHeight < MaxH; pSizeData->m_CharMaxHeight <<= 1);
-		}
+		// room for a few rows of glyphs with their outlines to begin with
+		int Width, Height;
+		for(Width = MIN_ATLAS_SIZE; Width < pSizeData->m_FontSize*16 && Width < MAX_ATLAS_SIZE; Width <<= 1);
+		for(Height = MIN_ATLAS_SIZE; Height < pSizeData->m_FontSize*8 && Height < MAX_ATLAS_SIZE; Height <<= 1);
 
 		//dbg_msg("pFont", "init size %d, texture size %d %d", pFont->sizes[index].font_size, w, h);
 		//FT_New_Face(m_FTLibrary, "data/fonts/vera.ttf", 0, &pFont->ft_face);
-		InitTexture(pSizeData, pSizeData->m_CharMaxWidth, pSizeData->m_CharMaxHeight, 8, 8);
+		InitTexture(pSizeData, Width, Height);
 	}
 
 	CFontSizeData *GetSize(CFont *pFont, int Pixelsize)
@@ -237,66 +287,36 @@ class CTextRender : public IEngineTextRender
 		return &pFont->m_aSizes[Index];
 	}
 
-
-	void UploadGlyph(CFontSizeData *pSizeData, int Texnum, int SlotID, int Chr, const void *pData)
+	// finds room for a glyph and its outline, returns false when the atlas is full
+	bool PackGlyph(CFontSizeData *pSizeData, int Width, int Height, int *pX, int *pY)
 	{
-		int x = (SlotID%pSizeData->m_NumXChars) * (pSizeData->m_TextureWidth/pSizeData->m_NumXChars);
-		int y = (SlotID/pSizeData->m_NumXChars) * (pSizeData->m_TextureHeight/pSizeData->m_NumYChars);
+		int PairWidth = Width*2+2;
+		if(pSizeData->m_PackX+PairWidth > pSizeData->m_TextureWidth)
+		{
+			// next row
+			pSizeData->m_PackX = 0;
+			pSizeData->m_PackY += pSizeData->m_PackRowHeight+1;
+			pSizeData->m_PackRowHeight = 0;
+		}
+
+		if(PairWidth > pSizeData->m_TextureWidth || pSizeData->m_PackY+Height > pSizeData->m_TextureHeight ||
+			pSizeData->m_NumCharacters == MAX_GLYPHS)
+			return false;
 
-		Graphics()->LoadTextureRawSub(pSizeData->m_aTextures[Texnum], x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			CImageInfo::FORMAT_ALPHA, pData);
-		/*
-		glBindTexture(GL_TEXTURE_2D, pSizeData->m_aTextures[Texnum]);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, x, y,
-			pSizeData->m_TextureWidth/pSizeData->m_NumXChars,
-			pSizeData->m_TextureHeight/pSizeData->m_NumYChars,
-			m_FontTextureFormat, GL_UNSIGNED_BYTE, pData);*/
+		*pX = pSizeData->m_PackX;
+		*pY = pSizeData->m_PackY;
+		pSizeData->m_PackX += PairWidth;
+		pSizeData->m_PackRowHeight = max(pSizeData->m_PackRowHeight, Height);
+		return true;
 	}
 
 	// 32k of data used for rendering glyphs
 	unsigned char ms_aGlyphData[(1024/8) * (1024/8)];
 	unsigned char ms_aGlyphDataOutlined[(1024/8) * (1024/8)];
 
-	int GetSlot(CFontSizeData *pSizeData)
-	{
-		int CharCount = pSizeData->m_NumXChars*pSizeData->m_NumYChars;
-		if(pSizeData->m_CurrentCharacter < CharCount)
-		{
-			int i = pSizeData->m_CurrentCharacter;
-			pSizeData->m_CurrentCharacter++;
-			return i;
-		}
-
-		// kick out the oldest
-		// TODO: remove this linear search
-		{
-			int Oldest = 0;
-			for(int i = 1; i < CharCount; i++)
-			{
-				if(pSizeData->m_aCharacters[i].m_TouchTime < pSizeData->m_aCharacters[Oldest].m_TouchTime)
-					Oldest = i;
-			}
-
-			if(time_get()-pSizeData->m_aCharacters[Oldest].m_TouchTime < time_freq() &&
-				(pSizeData->m_NumXChars < MAX_CHARACTERS || pSizeData->m_NumYChars < MAX_CHARACTERS))
-			{
-				IncreaseTextureSize(pSizeData);
-				return GetSlot(pSizeData);
-			}
-
-			return Oldest;
-		}
-	}
-
-	int RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, int Chr)
+	CFontChar *RenderGlyph(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
 		FT_Bitmap *pBitmap;
-		int SlotID = 0;
-		int SlotW = pSizeData->m_TextureWidth / pSizeData->m_NumXChars;
-		int SlotH = pSizeData->m_TextureHeight / pSizeData->m_NumYChars;
-		int SlotSize = SlotW*SlotH;
 		int x = 1;
 		int y = 1;
 		int px, py;
@@ -306,29 +326,40 @@ class CTextRender : public IEngineTextRender
 		if(FT_Load_Char(pFont->m_FtFace, Chr, FT_LOAD_RENDER|FT_LOAD_NO_BITMAP))
 		{
 			dbg_msg("pFont", "error loading glyph %d", Chr);
-			return -1;
+			return 0;
 		}
 
 		pBitmap = &pFont->m_FtFace->glyph->bitmap; // ignore_convention
 
-		// fetch slot
-		SlotID = GetSlot(pSizeData);
-		if(SlotID < 0)
-			return -1;
-
 		// adjust spacing
 		int OutlineThickness = AdjustOutlineThicknessToFontSize(1, pSizeData->m_FontSize);
 		x += OutlineThickness;
 		y += OutlineThickness;
+		int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
+		int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
+		if(Width*Height > (int)sizeof(ms_aGlyphData))
+		{
+			dbg_msg("pFont", "glyph %d is too large", Chr);
+			return 0;
+		}
+
+		// fetch room in the atlas
+		int AtlasX, AtlasY;
+		if(!PackGlyph(pSizeData, Width, Height, &AtlasX, &AtlasY))
+		{
+			IncreaseTextureSize(pSizeData);
+			if(!PackGlyph(pSizeData, Width, Height, &AtlasX, &AtlasY))
+				return 0;
+		}
 
 		// prepare glyph data
-		mem_zero(ms_aGlyphData, SlotSize);
+		mem_zero(ms_aGlyphData, Width*Height);
 
 		if(pBitmap->pixel_mode == FT_PIXEL_MODE_GRAY) // ignore_convention
 		{
 			for(py = 0; py < pBitmap->rows; py++) // ignore_convention
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
-					ms_aGlyphData[(py+y)*SlotW+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
+					ms_aGlyphData[(py+y)*Width+px+x] = pBitmap->buffer[py*pBitmap->pitch+px]; // ignore_convention
 		}
 		else if(pBitmap->pixel_mode == FT_PIXEL_MODE_MONO) // ignore_convention
 		{
@@ -336,40 +367,36 @@ class CTextRender : public IEngineTextRender
 				for(px = 0; px < pBitmap->width; px++) // ignore_convention
 				{
 					if(pBitmap->buffer[py*pBitmap->pitch+px/8]&(1<<(7-(px%8)))) // ignore_convention
-						ms_aGlyphData[(py+y)*SlotW+px+x] = 255;
+						ms_aGlyphData[(py+y)*Width+px+x] = 255;
 				}
 		}
 
-		if(0) for(py = 0; py < SlotW; py++)
-			for(px = 0; px < SlotH; px++)
-				ms_aGlyphData[py*SlotW+px] = 255;
-
-		// upload the glyph
-		UploadGlyph(pSizeData, 0, SlotID, Chr, ms_aGlyphData);
+		// upload the glyph and its outline next to it
+		Graphics()->LoadTextureRawSub(pSizeData->m_Texture, AtlasX, AtlasY, Width, Height, CImageInfo::FORMAT_ALPHA, ms_aGlyphData);
 
+		int OutlineX = AtlasX+Width+1;
 		if(OutlineThickness == 1)
 		{
-			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphDataOutlined);
+			Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+			Graphics()->LoadTextureRawSub(pSizeData->m_Texture, OutlineX, AtlasY, Width, Height, CImageInfo::FORMAT_ALPHA, ms_aGlyphDataOutlined);
 		}
 		else
 		{
 			for(int i = OutlineThickness; i > 0; i-=2)
 			{
-				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, SlotW, SlotH);
-				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, SlotW, SlotH);
+				Grow(ms_aGlyphData, ms_aGlyphDataOutlined, Width, Height);
+				Grow(ms_aGlyphDataOutlined, ms_aGlyphData, Width, Height);
 			}
-			UploadGlyph(pSizeData, 1, SlotID, Chr, ms_aGlyphData);
+			Graphics()->LoadTextureRawSub(pSizeData->m_Texture, OutlineX, AtlasY, Width, Height, CImageInfo::FORMAT_ALPHA, ms_aGlyphData);
 		}
 
 		// set char info
+		int Index = pSizeData->m_NumCharacters++;
+		CFontChar *pFontchr = &pSizeData->m_aCharacters[Index];
 		{
-			CFontChar *pFontchr = &pSizeData->m_aCharacters[SlotID];
 			float Scale = 1.0f/pSizeData->m_FontSize;
 			float Uscale = 1.0f/pSizeData->m_TextureWidth;
 			float Vscale = 1.0f/pSizeData->m_TextureHeight;
-			int Height = pBitmap->rows + OutlineThickness*2 + 2; // ignore_convention
-			int Width = pBitmap->width + OutlineThickness*2 + 2; // ignore_convention
 
 			pFontchr->m_ID = Chr;
 			pFontchr->m_Height = Height * Scale;
@@ -378,45 +405,33 @@ class CTextRender : public IEngineTextRender
 			pFontchr->m_OffsetY = (pSizeData->m_FontSize - pFont->m_FtFace->glyph->bitmap_top) * Scale; // ignore_convention
 			pFontchr->m_AdvanceX = (pFont->m_FtFace->glyph->advance.x>>6) * Scale; // ignore_convention
 
-			pFontchr->m_aUvs[0] = (SlotID%pSizeData->m_NumXChars) / (float)(pSizeData->m_NumXChars);
-			pFontchr->m_aUvs[1] = (SlotID/pSizeData->m_NumXChars) / (float)(pSizeData->m_NumYChars);
-			pFontchr->m_aUvs[2] = pFontchr->m_aUvs[0] + Width*Uscale;
-			pFontchr->m_aUvs[3] = pFontchr->m_aUvs[1] + Height*Vscale;
+			pFontchr->m_aUvs[0] = AtlasX*Uscale;
+			pFontchr->m_aUvs[1] = AtlasY*Vscale;
+			pFontchr->m_aUvs[2] = (AtlasX+Width)*Uscale;
+			pFontchr->m_aUvs[3] = (AtlasY+Height)*Vscale;
+			pFontchr->m_aOutlineUvs[0] = OutlineX*Uscale;
+			pFontchr->m_aOutlineUvs[1] = pFontchr->m_aUvs[1];
+			pFontchr->m_aOutlineUvs[2] = (OutlineX+Width)*Uscale;
+			pFontchr->m_aOutlineUvs[3] = pFontchr->m_aUvs[3];
 		}
 
-		return SlotID;
+		int Hash = (unsigned)Chr%GLYPH_HASH_SIZE;
+		pFontchr->m_Next = pSizeData->m_aCharHash[Hash];
+		pSizeData->m_aCharHash[Hash] = Index;
+		return pFontchr;
 	}
 
 	CFontChar *GetChar(CFont *pFont, CFontSizeData *pSizeData, int Chr)
 	{
-		CFontChar *pFontchr = NULL;
-
 		// search for the character
-		// TODO: remove this linear search
-		int i;
-		for(i = 0; i < pSizeData->m_CurrentCharacter; i++)
+		for(int i = pSizeData->m_aCharHash[(unsigned)Chr%GLYPH_HASH_SIZE]; i != -1; i = pSizeData->m_aCharacters[i].m_Next)
 		{
 			if(pSizeData->m_aCharacters[i].m_ID == Chr)
-			{
-				pFontchr = &pSizeData->m_aCharacters[i];
-				break;
-			}
+				return &pSizeData->m_aCharacters[i];
 		}
 
-		// check if we need to render the character
-		if(!pFontchr)
-		{
-			int Index = RenderGlyph(pFont, pSizeData, Chr);
-			if(Index >= 0)
-				pFontchr = &pSizeData->m_aCharacters[Index];
-		}
-
-		// touch the character
-		// TODO: don't call time_get here
-		if(pFontchr)
-			pFontchr->m_TouchTime = time_get();
-
-		return pFontchr;
+		// render the character
+		return RenderGlyph(pFont, pSizeData, Chr);
 	}
 
 	// must only be called from the rendering function as the pFont must be set to the correct size
@@ -432,6 +447,377 @@ class CTextRender : public IEngineTextRender
 		return (Kerning.x>>6);
 	}
 
+	// where the cursor really starts, text is aligned to screen pixels
+	struct CLayoutStart
+	{
+		float m_FakeToScreenX;
+		float m_FakeToScreenY;
+		int m_ActualSize;
+		float m_Size;
+		float m_CursorX;
+		float m_CursorY;
+	};
+
+	void GetLayoutStart(const CTextCursor *pCursor, CLayoutStart *pStart)
+	{
+		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+
+		// to correct coords, convert to screen coords, round, and convert back
+		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+		pStart->m_FakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
+		pStart->m_FakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
+		int ActualX = (int)(pCursor->m_X * pStart->m_FakeToScreenX);
+		int ActualY = (int)(pCursor->m_Y * pStart->m_FakeToScreenY);
+
+		pStart->m_CursorX = ActualX / pStart->m_FakeToScreenX;
+		pStart->m_CursorY = ActualY / pStart->m_FakeToScreenY;
+
+		// same with size
+		pStart->m_ActualSize = (int)(pCursor->m_FontSize * pStart->m_FakeToScreenY);
+		pStart->m_Size = pStart->m_ActualSize / pStart->m_FakeToScreenY;
+	}
+
+	// lays the text out from the cursor on and moves the cursor. the glyphs are
+	// added to pQuads relative to the start of the cursor when it is given.
+	// returns whether the text went on to a new line
+	int LayoutText(CTextCursor *pCursor, CFont *pFont, const char *pText, int Length, array<CGlyphQuad> *pQuads)
+	{
+		CLayoutStart Start;
+		GetLayoutStart(pCursor, &Start);
+		float FakeToScreenX = Start.m_FakeToScreenX;
+		float FakeToScreenY = Start.m_FakeToScreenY;
+		float Size = Start.m_Size;
+
+		int GotNewLine = 0;
+		CFontSizeData *pSizeData = GetSize(pFont, Start.m_ActualSize);
+		RenderSetup(pFont, Start.m_ActualSize);
+
+		float Scale = 1/pSizeData->m_FontSize;
+
+		const char *pCurrent = (char *)pText;
+		const char *pEnd = pCurrent+Length;
+		float DrawX = Start.m_CursorX;
+		float DrawY = Start.m_CursorY;
+		int LineCount = pCursor->m_LineCount;
+
+		while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
+		{
+			int NewLine = 0;
+			const char *pBatchEnd = pEnd;
+			if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
+			{
+				int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
+				CTextCursor Compare = *pCursor;
+				Compare.m_X = DrawX;
+				Compare.m_Y = DrawY;
+				Compare.m_Flags &= ~TEXTFLAG_RENDER;
+				Compare.m_LineWidth = -1;
+				LayoutText(&Compare, pFont, pCurrent, Wlen, 0);
+
+				if(Compare.m_X-DrawX > pCursor->m_LineWidth)
+				{
+					// word can't be fitted in one line, cut it
+					CTextCursor Cutter = *pCursor;
+					Cutter.m_CharCount = 0;
+					Cutter.m_X = DrawX;
+					Cutter.m_Y = DrawY;
+					Cutter.m_Flags &= ~TEXTFLAG_RENDER;
+					Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
+
+					LayoutText(&Cutter, pFont, (const char *)pCurrent, Wlen, 0);
+					Wlen = Cutter.m_CharCount;
+					NewLine = 1;
+
+					if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
+						Wlen = 0;
+				}
+				else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
+				{
+					NewLine = 1;
+					Wlen = 0;
+				}
+
+				pBatchEnd = pCurrent + Wlen;
+			}
+
+			const char *pTmp = pCurrent;
+			int NextCharacter = str_utf8_decode(&pTmp);
+			while(pCurrent < pBatchEnd)
+			{
+				int Character = NextCharacter;
+				pCurrent = pTmp;
+				NextCharacter = str_utf8_decode(&pTmp);
+
+				if(Character == '\n')
+				{
+					DrawX = pCursor->m_StartX;
+					DrawY += Size;
+					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+					++LineCount;
+					if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
+						break;
+					continue;
+				}
+
+				CFontChar *pChr = GetChar(pFont, pSizeData, Character);
+				if(pChr)
+				{
+					float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
+					if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
+					{
+						// we hit the end of the line, no more to render or count
+						pCurrent = pEnd;
+						break;
+					}
+
+					if(pQuads)
+					{
+						CGlyphQuad Quad;
+						Quad.m_X = DrawX+pChr->m_OffsetX*Size-Start.m_CursorX;
+						Quad.m_Y = DrawY+pChr->m_OffsetY*Size-Start.m_CursorY;
+						Quad.m_Width = pChr->m_Width*Size;
+						Quad.m_Height = pChr->m_Height*Size;
+						mem_copy(Quad.m_aUvs, pChr->m_aUvs, sizeof(Quad.m_aUvs));
+						mem_copy(Quad.m_aOutlineUvs, pChr->m_aOutlineUvs, sizeof(Quad.m_aOutlineUvs));
+						pQuads->add(Quad);
+					}
+
+					DrawX += Advance*Size;
+					pCursor->m_CharCount++;
+				}
+			}
+
+			if(NewLine)
+			{
+				DrawX = pCursor->m_StartX;
+				DrawY += Size;
+				GotNewLine = 1;
+				DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
+				DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
+				++LineCount;
+			}
+		}
+
+		pCursor->m_X = DrawX;
+		pCursor->m_LineCount = LineCount;
+
+		if(GotNewLine)
+			pCursor->m_Y = DrawY;
+		return GotNewLine;
+	}
+
+	static unsigned LayoutHash(const char *pText, int Length, const int *pKey, int KeySize)
+	{
+		// fnv-1a
+		unsigned Hash = 2166136261u;
+		for(int i = 0; i < Length; i++)
+			Hash = (Hash^(unsigned char)pText[i])*16777619u;
+		for(int i = 0; i < KeySize; i++)
+			Hash = (Hash^(unsigned)pKey[i])*16777619u;
+		return Hash;
+	}
+
+	void UnlinkLayout(CTextLayout *pLayout)
+	{
+		if(pLayout->m_pPrev)
+			pLayout->m_pPrev->m_pNext = pLayout->m_pNext;
+		else
+			m_pFirstLayout = pLayout->m_pNext;
+		if(pLayout->m_pNext)
+			pLayout->m_pNext->m_pPrev = pLayout->m_pPrev;
+		else
+			m_pLastLayout = pLayout->m_pPrev;
+		pLayout->m_pPrev = 0;
+		pLayout->m_pNext = 0;
+	}
+
+	void LinkLayout(CTextLayout *pLayout)
+	{
+		pLayout->m_pPrev = 0;
+		pLayout->m_pNext = m_pFirstLayout;
+		if(m_pFirstLayout)
+			m_pFirstLayout->m_pPrev = pLayout;
+		else
+			m_pLastLayout = pLayout;
+		m_pFirstLayout = pLayout;
+	}
+
+	void FreeLayout(CTextLayout *pLayout)
+	{
+		UnlinkLayout(pLayout);
+		CTextLayout **ppLayout = &m_apLayoutHash[pLayout->m_Hash%LAYOUT_HASH_SIZE];
+		while(*ppLayout != pLayout)
+			ppLayout = &(*ppLayout)->m_pHashNext;
+		*ppLayout = pLayout->m_pHashNext;
+
+		m_LayoutMemory -= pLayout->m_MemSize;
+		mem_free(pLayout->m_pQuads);
+		mem_free(pLayout->m_pText);
+		mem_free(pLayout);
+	}
+
+	// lays the text out again into the layout, also when the atlas got cleared on the way
+	void BuildLayout(CTextLayout *pLayout, const CTextCursor *pCursor, CFont *pFont, const CLayoutStart *pStart, const char *pText, int Length)
+	{
+		CFontSizeData *pSizeData = GetSize(pFont, pStart->m_ActualSize);
+		CTextCursor Cursor;
+		int NewLine = 0;
+		for(int Try = 0; Try < 2; Try++)
+		{
+			int Generation = pSizeData->m_Generation;
+			Cursor = *pCursor;
+			Cursor.m_CharCount = 0;
+			m_lLayoutQuads.clear();
+			NewLine = LayoutText(&Cursor, pFont, pText, Length, &m_lLayoutQuads);
+			if(pSizeData->m_Generation == Generation)
+				break;
+		}
+
+		pLayout->m_pSizeData = pSizeData;
+		pLayout->m_Generation = pSizeData->m_Generation;
+		pLayout->m_AdvanceX = Cursor.m_X-pStart->m_CursorX;
+		pLayout->m_AdvanceY = Cursor.m_Y-pStart->m_CursorY;
+		pLayout->m_NewLine = NewLine;
+		pLayout->m_Lines = Cursor.m_LineCount-pCursor->m_LineCount;
+		pLayout->m_Chars = Cursor.m_CharCount;
+
+		mem_free(pLayout->m_pQuads);
+		pLayout->m_NumQuads = m_lLayoutQuads.size();
+		pLayout->m_pQuads = (CGlyphQuad *)mem_alloc(max(pLayout->m_NumQuads, 1)*sizeof(CGlyphQuad), 1);
+		for(int i = 0; i < pLayout->m_NumQuads; i++)
+			pLayout->m_pQuads[i] = m_lLayoutQuads[i];
+	}
+
+	// fetches the layout from the cache, lays it out if it is not there
+	CTextLayout *FindLayout(const CTextCursor *pCursor, CFont *pFont, const CLayoutStart *pStart, const char *pText, int Length)
+	{
+		// the start of the lines only matters when the text can break
+		float StartOffset = pCursor->m_StartX-pStart->m_CursorX;
+		if(pCursor->m_LineWidth <= 0)
+		{
+			int i = 0;
+			while(i < Length && pText[i] != '\n')
+				i++;
+			if(i == Length)
+				StartOffset = 0;
+		}
+		int Flags = pCursor->m_Flags&TEXTFLAG_STOP_AT_END;
+		int LineCount = pCursor->m_MaxLines > 0 ? pCursor->m_LineCount : 0;
+
+		int Budget = g_Config.m_GfxTextLayoutCache*1024;
+		if(!Budget)
+		{
+			BuildLayout(&m_ScratchLayout, pCursor, pFont, pStart, pText, Length);
+			return &m_ScratchLayout;
+		}
+
+		int aKey[] = {pStart->m_ActualSize, (int)(pStart->m_FakeToScreenX*1024), (int)(pStart->m_FakeToScreenY*1024), Flags,
+			(int)pCursor->m_LineWidth, pCursor->m_MaxLines, LineCount, (int)StartOffset};
+		unsigned Hash = LayoutHash(pText, Length, aKey, sizeof(aKey)/sizeof(aKey[0]));
+
+		for(CTextLayout *pLayout = m_apLayoutHash[Hash%LAYOUT_HASH_SIZE]; pLayout; pLayout = pLayout->m_pHashNext)
+		{
+			if(pLayout->m_Hash != Hash || pLayout->m_pFont != pFont || pLayout->m_FontSize != pStart->m_ActualSize ||
+				pLayout->m_FakeToScreenX != pStart->m_FakeToScreenX || pLayout->m_FakeToScreenY != pStart->m_FakeToScreenY ||
+				pLayout->m_Flags != Flags || pLayout->m_LineWidth != pCursor->m_LineWidth || pLayout->m_MaxLines != pCursor->m_MaxLines ||
+				pLayout->m_LineCount != LineCount || pLayout->m_StartOffset != StartOffset ||
+				pLayout->m_Length != Length || mem_comp(pLayout->m_pText, pText, Length) != 0)
+				continue;
+
+			if(pLayout->m_Generation != pLayout->m_pSizeData->m_Generation)
+			{
+				m_LayoutMemory -= pLayout->m_MemSize;
+				BuildLayout(pLayout, pCursor, pFont, pStart, pText, Length);
+				pLayout->m_MemSize = sizeof(CTextLayout)+Length+1+pLayout->m_NumQuads*sizeof(CGlyphQuad);
+				m_LayoutMemory += pLayout->m_MemSize;
+			}
+
+			// move it to the front
+			UnlinkLayout(pLayout);
+			LinkLayout(pLayout);
+			return pLayout;
+		}
+
+		CTextLayout *pLayout = (CTextLayout *)mem_alloc(sizeof(CTextLayout), 1);
+		mem_zero(pLayout, sizeof(CTextLayout));
+		pLayout->m_Hash = Hash;
+		pLayout->m_pFont = pFont;
+		pLayout->m_FontSize = pStart->m_ActualSize;
+		pLayout->m_FakeToScreenX = pStart->m_FakeToScreenX;
+		pLayout->m_FakeToScreenY = pStart->m_FakeToScreenY;
+		pLayout->m_Flags = Flags;
+		pLayout->m_LineWidth = pCursor->m_LineWidth;
+		pLayout->m_MaxLines = pCursor->m_MaxLines;
+		pLayout->m_LineCount = LineCount;
+		pLayout->m_StartOffset = StartOffset;
+		pLayout->m_pText = (char *)mem_alloc(Length+1, 1);
+		mem_copy(pLayout->m_pText, pText, Length);
+		pLayout->m_pText[Length] = 0;
+		pLayout->m_Length = Length;
+		BuildLayout(pLayout, pCursor, pFont, pStart, pText, Length);
+		pLayout->m_MemSize = sizeof(CTextLayout)+Length+1+pLayout->m_NumQuads*sizeof(CGlyphQuad);
+
+		pLayout->m_pHashNext = m_apLayoutHash[Hash%LAYOUT_HASH_SIZE];
+		m_apLayoutHash[Hash%LAYOUT_HASH_SIZE] = pLayout;
+		LinkLayout(pLayout);
+		m_LayoutMemory += pLayout->m_MemSize;
+
+		// keep to the budget, the least recently used go first
+		while(m_LayoutMemory > Budget && m_pLastLayout != pLayout)
+			FreeLayout(m_pLastLayout);
+
+		return pLayout;
+	}
+
+	void DrawLayout(const CTextLayout *pLayout, float x, float y, float r, float g, float b, float a)
+	{
+		if(!pLayout->m_NumQuads)
+			return;
+
+		Graphics()->TextureSet(pLayout->m_pSizeData->m_Texture);
+		Graphics()->QuadsBegin();
+
+		// the outlines go first, then the glyphs on top
+		for(int Pass = 0; Pass < 2; Pass++)
+		{
+			float R = Pass ? r : m_TextOutlineR;
+			float G = Pass ? g : m_TextOutlineG;
+			float B = Pass ? b : m_TextOutlineB;
+			float A = Pass ? a : m_TextOutlineA*a;
+
+			for(int Start = 0; Start < pLayout->m_NumQuads; Start += LAYOUT_RENDER_BATCH)
+			{
+				int Num = min(pLayout->m_NumQuads-Start, (int)LAYOUT_RENDER_BATCH);
+				for(int i = 0; i < Num; i++)
+				{
+					const CGlyphQuad *pQuad = &pLayout->m_pQuads[Start+i];
+					const float *pUvs = Pass ? pQuad->m_aUvs : pQuad->m_aOutlineUvs;
+					float X0 = x+pQuad->m_X;
+					float Y0 = y+pQuad->m_Y;
+					float X1 = X0+pQuad->m_Width;
+					float Y1 = Y0+pQuad->m_Height;
+
+					IGraphics::CQuadVertex *pVertex = &m_aVertices[i*4];
+					pVertex[0].m_X = X0; pVertex[0].m_Y = Y0; pVertex[0].m_U = pUvs[0]; pVertex[0].m_V = pUvs[1];
+					pVertex[1].m_X = X1; pVertex[1].m_Y = Y0; pVertex[1].m_U = pUvs[2]; pVertex[1].m_V = pUvs[1];
+					pVertex[2].m_X = X1; pVertex[2].m_Y = Y1; pVertex[2].m_U = pUvs[2]; pVertex[2].m_V = pUvs[3];
+					pVertex[3].m_X = X0; pVertex[3].m_Y = Y1; pVertex[3].m_U = pUvs[0]; pVertex[3].m_V = pUvs[3];
+					for(int k = 0; k < 4; k++)
+					{
+						pVertex[k].m_R = R;
+						pVertex[k].m_G = G;
+						pVertex[k].m_B = B;
+						pVertex[k].m_A = A;
+					}
+				}
+				Graphics()->QuadsDrawVertices(m_aVertices, Num);
+			}
+		}
+
+		Graphics()->QuadsEnd();
+	}
 
 public:
 	CTextRender()
@@ -449,6 +835,12 @@ public:
 
 		m_pDefaultFont = 0;
 
+		mem_zero(m_apLayoutHash, sizeof(m_apLayoutHash));
+		m_pFirstLayout = 0;
+		m_pLastLayout = 0;
+		m_LayoutMemory = 0;
+		mem_zero(&m_ScratchLayout, sizeof(m_ScratchLayout));
+
 		// GL_LUMINANCE can be good for debugging
 		//m_FontTextureFormat = GL_ALPHA;
 	}
@@ -482,6 +874,22 @@ public:
 
 	virtual void DestroyFont(CFont *pFont)
 	{
+		// drop the layouts and atlases of the font
+		for(CTextLayout *pLayout = m_pFirstLayout; pLayout;)
+		{
+			CTextLayout *pNext = pLayout->m_pNext;
+			if(pLayout->m_pFont == pFont)
+				FreeLayout(pLayout);
+			pLayout = pNext;
+		}
+		if(m_ScratchLayout.m_pFont == pFont)
+			m_ScratchLayout.m_NumQuads = 0;
+
+		for(unsigned i = 0; i < NUM_FONT_SIZES; i++)
+		{
+			if(pFont->m_aSizes[i].m_Texture != 0)
+				Graphics()->UnloadTexture(pFont->m_aSizes[i].m_Texture);
+		}
 		mem_free(pFont);
 	}
 
@@ -551,38 +959,9 @@ public:
 	virtual void TextEx(CTextCursor *pCursor, const char *pText, int Length)
 	{
 		CFont *pFont = pCursor->m_pFont;
-		CFontSizeData *pSizeData = NULL;
 
 		//dbg_msg("textrender", "rendering text '%s'", text);
 
-		float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
-		float FakeToScreenX, FakeToScreenY;
-		int ActualX, ActualY;
-
-		int ActualSize;
-		int i;
-		int GotNewLine = 0;
-		float DrawX = 0.0f, DrawY = 0.0f;
-		int LineCount = 0;
-		float CursorX, CursorY;
-
-		float Size = pCursor->m_FontSize;
-
-		// to correct coords, convert to screen coords, round, and convert back
-		Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
-
-		FakeToScreenX = (Graphics()->ScreenWidth()/(ScreenX1-ScreenX0));
-		FakeToScreenY = (Graphics()->ScreenHeight()/(ScreenY1-ScreenY0));
-		ActualX = (int)(pCursor->m_X * FakeToScreenX);
-		ActualY = (int)(pCursor->m_Y * FakeToScreenY);
-
-		CursorX = ActualX / FakeToScreenX;
-		CursorY = ActualY / FakeToScreenY;
-
-		// same with size
-		ActualSize = (int)(Size * FakeToScreenY);
-		Size = ActualSize / FakeToScreenY;
-
 		// fetch pFont data
 		if(!pFont)
 			pFont = m_pDefaultFont;
@@ -590,146 +969,55 @@ public:
 		if(!pFont)
 			return;
 
-		pSizeData = GetSize(pFont, ActualSize);
-		RenderSetup(pFont, ActualSize);
-
-		float Scale = 1/pSizeData->m_FontSize;
-
 		// set length
 		if(Length < 0)
 			Length = str_length(pText);
 
-		// if we don't want to render, we can just skip the first outline pass
-		i = 1;
-		if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			i = 0;
-
-		for(;i < 2; i++)
-		{
-			const char *pCurrent = (char *)pText;
-			const char *pEnd = pCurrent+Length;
-			DrawX = CursorX;
-			DrawY = CursorY;
-			LineCount = pCursor->m_LineCount;
-
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-			{
-				// TODO: Make this better
-				if (i == 0)
-					Graphics()->TextureSet(pSizeData->m_aTextures[1]);
-				else
-					Graphics()->TextureSet(pSizeData->m_aTextures[0]);
-
-				Graphics()->QuadsBegin();
-				if (i == 0)
-					Graphics()->SetColor(m_TextOutlineR, m_TextOutlineG, m_TextOutlineB, m_TextOutlineA*m_TextA);
-				else
-					Graphics()->SetColor(m_TextR, m_TextG, m_TextB, m_TextA);
-			}
-
-			while(pCurrent < pEnd && (pCursor->m_MaxLines < 1 || LineCount <= pCursor->m_MaxLines))
-			{
-				int NewLine = 0;
-				const char *pBatchEnd = pEnd;
-				if(pCursor->m_LineWidth > 0 && !(pCursor->m_Flags&TEXTFLAG_STOP_AT_END))
-				{
-					int Wlen = min(WordLength((char *)pCurrent), (int)(pEnd-pCurrent));
-					CTextCursor Compare = *pCursor;
-					Compare.m_X = DrawX;
-					Compare.m_Y = DrawY;
-					Compare.m_Flags &= ~TEXTFLAG_RENDER;
-					Compare.m_LineWidth = -1;
-					TextEx(&Compare, pCurrent, Wlen);
-
-					if(Compare.m_X-DrawX > pCursor->m_LineWidth)
-					{
-						// word can't be fitted in one line, cut it
-						CTextCursor Cutter = *pCursor;
-						Cutter.m_CharCount = 0;
-						Cutter.m_X = DrawX;
-						Cutter.m_Y = DrawY;
-						Cutter.m_Flags &= ~TEXTFLAG_RENDER;
-						Cutter.m_Flags |= TEXTFLAG_STOP_AT_END;
-
-						TextEx(&Cutter, (const char *)pCurrent, Wlen);
-						Wlen = Cutter.m_CharCount;
-						NewLine = 1;
-
-						if(Wlen <= 3) // if we can't place 3 chars of the word on this line, take the next
-							Wlen = 0;
-					}
-					else if(Compare.m_X-pCursor->m_StartX > pCursor->m_LineWidth)
-					{
-						NewLine = 1;
-						Wlen = 0;
-					}
-
-					pBatchEnd = pCurrent + Wlen;
-				}
-
-				const char *pTmp = pCurrent;
-				int NextCharacter = str_utf8_decode(&pTmp);
-				while(pCurrent < pBatchEnd)
-				{
-					int Character = NextCharacter;
-					pCurrent = pTmp;
-					NextCharacter = str_utf8_decode(&pTmp);
-
-					if(Character == '\n')
-					{
-						DrawX = pCursor->m_StartX;
-						DrawY += Size;
-						DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-						DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-						++LineCount;
-						if(pCursor->m_MaxLines > 0 && LineCount > pCursor->m_MaxLines)
-							break;
-						continue;
-					}
+		CLayoutStart Start;
+		GetLayoutStart(pCursor, &Start);
+		const CTextLayout *pLayout = FindLayout(pCursor, pFont, &Start, pText, Length);
 
-					CFontChar *pChr = GetChar(pFont, pSizeData, Character);
-					if(pChr)
-					{
-						float Advance = pChr->m_AdvanceX + Kerning(pFont, Character, NextCharacter)*Scale;
-						if(pCursor->m_Flags&TEXTFLAG_STOP_AT_END && DrawX+Advance*Size-pCursor->m_StartX > pCursor->m_LineWidth)
-						{
-							// we hit the end of the line, no more to render or count
-							pCurrent = pEnd;
-							break;
-						}
+		if(pCursor->m_Flags&TEXTFLAG_RENDER)
+			DrawLayout(pLayout, Start.m_CursorX, Start.m_CursorY, m_TextR, m_TextG, m_TextB, m_TextA);
+
+		// move the cursor the way the layout did
+		pCursor->m_X = Start.m_CursorX+pLayout->m_AdvanceX;
+		pCursor->m_LineCount += pLayout->m_Lines;
+		pCursor->m_CharCount += pLayout->m_Chars;
+		if(pLayout->m_NewLine)
+			pCursor->m_Y = Start.m_CursorY+pLayout->m_AdvanceY;
+	}
 
-						if(pCursor->m_Flags&TEXTFLAG_RENDER)
-						{
-							Graphics()->QuadsSetSubset(pChr->m_aUvs[0], pChr->m_aUvs[1], pChr->m_aUvs[2], pChr->m_aUvs[3]);
-							IGraphics::CQuadItem QuadItem(DrawX+pChr->m_OffsetX*Size, DrawY+pChr->m_OffsetY*Size, pChr->m_Width*Size, pChr->m_Height*Size);
-							Graphics()->QuadsDrawTL(&QuadItem, 1);
-						}
+	virtual CTextLayout *TextLayout(float Size, const char *pText, int Length, float LineWidth)
+	{
+		if(!m_pDefaultFont)
+			return 0;
 
-						DrawX += Advance*Size;
-						pCursor->m_CharCount++;
-					}
-				}
+		if(Length < 0)
+			Length = str_length(pText);
 
-				if(NewLine)
-				{
-					DrawX = pCursor->m_StartX;
-					DrawY += Size;
-					GotNewLine = 1;
-					DrawX = (int)(DrawX * FakeToScreenX) / FakeToScreenX; // realign
-					DrawY = (int)(DrawY * FakeToScreenY) / FakeToScreenY;
-					++LineCount;
-				}
-			}
+		CTextCursor Cursor;
+		SetCursor(&Cursor, 0, 0, Size, 0);
+		Cursor.m_LineWidth = LineWidth;
+		CLayoutStart Start;
+		GetLayoutStart(&Cursor, &Start);
+		return FindLayout(&Cursor, m_pDefaultFont, &Start, pText, Length);
+	}
 
-			if(pCursor->m_Flags&TEXTFLAG_RENDER)
-				Graphics()->QuadsEnd();
-		}
+	virtual float TextLayoutWidth(const CTextLayout *pLayout)
+	{
+		return pLayout ? pLayout->m_AdvanceX : 0.0f;
+	}
 
-		pCursor->m_X = DrawX;
-		pCursor->m_LineCount = LineCount;
+	virtual void TextLayoutDraw(const CTextLayout *pLayout, float x, float y, float r, float g, float b, float a)
+	{
+		if(!pLayout)
+			return;
 
-		if(GotNewLine)
-			pCursor->m_Y = DrawY;
+		// aligned to screen pixels like TextEx does
+		float X = (int)(x * pLayout->m_FakeToScreenX) / pLayout->m_FakeToScreenX;
+		float Y = (int)(y * pLayout->m_FakeToScreenY) / pLayout->m_FakeToScreenY;
+		DrawLayout(pLayout, X, Y, r, g, b, a);
 	}
 
 };
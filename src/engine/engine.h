@@ -24,9 +24,14 @@ protected:
 
 public:
 	virtual void Init() = 0;
+	// registers the engine commands in a console without going through the kernel
+	virtual void RegisterCommands(class IConsole *pConsole, class IStorage *pStorage) = 0;
 	virtual void InitLogfile() = 0;
 	virtual void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype) = 0;
 	virtual void AddJob(CJob *pJob, JOBFUNC pfnFunc, void *pData) = 0;
+	virtual void InitJobThreads(int NumThreads) = 0;
+	int NumJobThreads() const { return m_JobPool.NumThreads(); }
+	CJobPool *JobPool() { return &m_JobPool; }
 };
 
 extern IEngine *CreateEngine(const char *pAppname);
@@ -80,9 +80,13 @@ public:
 	virtual void WrapClamp() = 0;
 	virtual int MemoryUsage() const = 0;
 
+	// LoadPNG and DecodePNG don't touch the graphics state and can be used from job threads
 	virtual int LoadPNG(CImageInfo *pImg, const char *pFilename, int StorageType) = 0;
+	virtual int DecodePNG(CImageInfo *pImg, const void *pData, unsigned DataSize, const char *pContext) = 0;
 	virtual int UnloadTexture(int Index) = 0;
 	virtual int LoadTextureRaw(int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags) = 0;
+	// gives an existing texture new contents, the id stays valid
+	virtual int LoadTextureRawReplace(int TextureID, int Width, int Height, int Format, const void *pData, int StoreFormat, int Flags) = 0;
 	virtual int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags) = 0;
 	virtual int LoadTextureRawSub(int TextureID, int x, int y, int Width, int Height, int Format, const void *pData) = 0;
 	virtual void TextureSet(int TextureID) = 0;
@@ -120,6 +124,18 @@ public:
 			: m_X0(x0), m_Y0(y0), m_X1(x1), m_Y1(y1), m_X2(x2), m_Y2(y2), m_X3(x3), m_Y3(y3) {}
 	};
 	virtual void QuadsDrawFreeform(const CFreeformItem *pArray, int Num) = 0;
+
+	/* Vertex quads
+		Quads that bring their own texture coordinates and colors, four
+		vertices per quad going around it. The subset, rotation and color
+		set for the other quads are not used.
+	*/
+	struct CQuadVertex
+	{
+		float m_X, m_Y, m_U, m_V;
+		float m_R, m_G, m_B, m_A;
+	};
+	virtual void QuadsDrawVertices(const CQuadVertex *pVertices, int NumQuads) = 0;
 	virtual void QuadsText(float x, float y, float Size, const char *pText) = 0;
 
 	struct CColorVertex
@@ -132,6 +148,23 @@ public:
 	virtual void SetColorVertex(const CColorVertex *pArray, int Num) = 0;
 	virtual void SetColor(float r, float g, float b, float a) = 0;
 
+	/* Quad buffers
+		Static quads that are uploaded once and drawn many times. Every quad
+		takes four vertices, the position is in the current screen mapping.
+		RenderQuadBuffer uses the current texture, blend, wrap and clip state
+		and draws all quads with one color. It must not be called between
+		QuadsBegin and QuadsEnd.
+	*/
+	struct CBufferVertex
+	{
+		float m_X, m_Y, m_U, m_V;
+		CBufferVertex() {}
+		CBufferVertex(float x, float y, float u, float v) : m_X(x), m_Y(y), m_U(u), m_V(v) {}
+	};
+	virtual int CreateQuadBuffer(const CBufferVertex *pVertices, int NumQuads) = 0;
+	virtual void DeleteQuadBuffer(int BufferID) = 0;
+	virtual void RenderQuadBuffer(int BufferID, int FirstQuad, int NumQuads, float r, float g, float b, float a) = 0;
+
 	virtual void TakeScreenshot(const char *pFilename) = 0;
 	virtual int GetVideoModes(CVideoMode *pModes, int MaxModes) = 0;
 
@@ -16,6 +16,16 @@ public:
 	virtual void GetType(int Type, int *pStart, int *pNum) = 0;
 	virtual void *FindItem(int Type, int ID) = 0;
 	virtual int NumItems() = 0;
+
+	/*
+		Function: PrepareData
+			Returns a data block after letting pfnPrepare modify it in
+			place. pfnPrepare only gets called the first time a block is
+			prepared, the map data might be shared with other users in the
+			same process that already did it.
+	*/
+	typedef void (*FPrepareData)(void *pData, void *pUser);
+	virtual void *PrepareData(int Index, FPrepareData pfnPrepare, void *pUser) = 0;
 };
 
 
@@ -27,8 +37,20 @@ public:
 	virtual bool IsLoaded() = 0;
 	virtual void Unload() = 0;
 	virtual unsigned Crc() = 0;
+
+	// contents of the map file, only kept by shared maps
+	virtual const unsigned char *FileData(int *pSize) = 0;
 };
 
 extern IEngineMap *CreateEngineMap();
 
+/*
+	Function: CreateSharedEngineMap
+		Creates a map that shares its data with the other shared maps of
+		the process that have the same file loaded. The data is read-only
+		apart from PrepareData and UnloadData does nothing. Must be called
+		from the main thread before other threads use shared maps.
+*/
+extern IEngineMap *CreateSharedEngineMap();
+
 #endif
@@ -31,6 +31,7 @@ public:
 	virtual const char *ClientClan(int ClientID) = 0;
 	virtual int ClientCountry(int ClientID) = 0;
 	virtual bool ClientIngame(int ClientID) = 0;
+	virtual int ClientLastAckedSnapshot(int ClientID) = 0;
 	virtual int GetClientInfo(int ClientID, CClientInfo *pInfo) = 0;
 	virtual void GetClientAddr(int ClientID, char *pAddrStr, int Size) = 0;
 
@@ -50,6 +51,9 @@ public:
 	virtual void SetClientCountry(int ClientID, int Country) = 0;
 	virtual void SetClientScore(int ClientID, int Score) = 0;
 
+	// has to be called when anything the server info shows changes
+	virtual void ExpireServerInfo() = 0;
+
 	virtual int SnapNewID() = 0;
 	virtual void SnapFreeID(int ID) = 0;
 	virtual void *SnapNewItem(int Type, int ID, int Size) = 0;
@@ -102,6 +106,11 @@ public:
 	virtual const char *NetVersionCust() = 0;
 	
 	virtual void OnSetAuthed(int ClientID, int Level) = 0;
+
+	// counts the entities of every type for the metrics, returns the number of types
+	virtual int CountEntities(int *pCounts, const char **ppNames, int MaxTypes) = 0;
+	virtual const char *NetObjName(int Type) = 0;
+	virtual const char *NetMsgName(int MsgID) = 0;
 };
 
 extern IGameServer *CreateGameServer();
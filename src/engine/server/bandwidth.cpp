@@ -0,0 +1,94 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "bandwidth.h"
+
+static const char *s_apSystemMsgNames[] = {
+	"null", "info", "map_change", "map_data", "con_ready", "snap", "snapempty", "snapsingle", "snapsmall",
+	"inputtiming", "rcon_auth_status", "rcon_line", "auth_challange", "auth_result", "ready", "entergame",
+	"input", "rcon_cmd", "rcon_auth", "request_map_data", "auth_start", "auth_response", "ping", "ping_reply",
+	"error", "rcon_cmd_add", "rcon_cmd_rem",
+};
+
+CBandwidthStats::CBandwidthStats()
+{
+	Reset();
+}
+
+void CBandwidthStats::Reset()
+{
+	mem_zero(m_aSlots, sizeof(m_aSlots));
+	m_CurrentSlot = 0;
+	m_SlotStart = time_get();
+	m_ResetTime = m_SlotStart;
+}
+
+void CBandwidthStats::Update()
+{
+	int64 Now = time_get();
+	int64 SlotLength = time_freq()*SLOT_SECONDS;
+	for(int i = 0; Now-m_SlotStart >= SlotLength; i++)
+	{
+		m_SlotStart += SlotLength;
+		if(i >= NUM_SLOTS)
+		{
+			// away for longer than the window
+			m_SlotStart = Now;
+			break;
+		}
+		m_CurrentSlot = (m_CurrentSlot+1)%NUM_SLOTS;
+		mem_zero(&m_aSlots[m_CurrentSlot], sizeof(CSlot));
+	}
+}
+
+void CBandwidthStats::AddMessage(int ClientID, int MsgID, bool System, int Bytes)
+{
+	CSlot *pSlot = &m_aSlots[m_CurrentSlot];
+	pSlot->m_aaMsgBytes[System ? 1 : 0][clamp(MsgID, 0, (int)MAX_MSG_TYPES-1)] += Bytes;
+	pSlot->m_aaClientBytes[ClientID][KIND_MESSAGE] += Bytes;
+}
+
+int64 CBandwidthStats::WindowTime() const
+{
+	int64 Now = time_get();
+	int64 Time = (NUM_SLOTS-1)*SLOT_SECONDS*time_freq() + (Now-m_SlotStart);
+	return max(min(Time, Now-m_ResetTime), (int64)1);
+}
+
+int CBandwidthStats::WindowSeconds() const
+{
+	return max((int)(WindowTime()/time_freq()), 1);
+}
+
+int CBandwidthStats::ItemRate(int Type) const
+{
+	int64 Bytes = 0;
+	for(int s = 0; s < NUM_SLOTS; s++)
+		Bytes += m_aSlots[s].m_aItemBytes[Type];
+	return (int)(Bytes*(double)time_freq()/WindowTime());
+}
+
+int CBandwidthStats::MsgRate(int MsgID, bool System) const
+{
+	int64 Bytes = 0;
+	for(int s = 0; s < NUM_SLOTS; s++)
+		Bytes += m_aSlots[s].m_aaMsgBytes[System ? 1 : 0][MsgID];
+	return (int)(Bytes*(double)time_freq()/WindowTime());
+}
+
+int CBandwidthStats::ClientRate(int ClientID, int Kind) const
+{
+	int64 Bytes = 0;
+	for(int s = 0; s < NUM_SLOTS; s++)
+		Bytes += m_aSlots[s].m_aaClientBytes[ClientID][Kind];
+	return (int)(Bytes*(double)time_freq()/WindowTime());
+}
+
+const char *CBandwidthStats::SystemMsgName(int MsgID)
+{
+	if(MsgID < 0 || MsgID >= (int)(sizeof(s_apSystemMsgNames)/sizeof(s_apSystemMsgNames[0])))
+		return "unknown";
+	return s_apSystemMsgNames[MsgID];
+}
@@ -0,0 +1,75 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_BANDWIDTH_H
+#define ENGINE_SERVER_BANDWIDTH_H
+
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+
+/*
+	Class: CBandwidthStats
+		Tells where the outgoing bytes of a server go: snapshot deltas by
+		item type, vital messages by message type, and both by client.
+
+		Snapshot bytes are counted as variable ints, the way the deltas
+		are packed before they go out, the packet compression on top is
+		left out. The bytes are summed up in slots of SLOT_SECONDS, the
+		last NUM_SLOTS slots make up the window the rates are given for.
+*/
+class CBandwidthStats
+{
+public:
+	enum
+	{
+		MAX_ITEM_TYPES=64,
+		MAX_MSG_TYPES=64,
+		NUM_SLOTS=6,
+		SLOT_SECONDS=10,
+
+		KIND_SNAPSHOT=0,
+		KIND_MESSAGE,
+		NUM_KINDS,
+	};
+
+private:
+	struct CSlot
+	{
+		int m_aItemBytes[MAX_ITEM_TYPES];
+		int m_aaMsgBytes[2][MAX_MSG_TYPES];
+		int m_aaClientBytes[MAX_CLIENTS][NUM_KINDS];
+	};
+
+	CSlot m_aSlots[NUM_SLOTS];
+	int m_CurrentSlot;
+	int64 m_SlotStart;
+	int64 m_ResetTime;
+
+	// time the slots hold data for, the current slot is only partly filled
+	int64 WindowTime() const;
+
+public:
+	CBandwidthStats();
+
+	void Reset();
+
+	// moves on to the next slot when the current one is full
+	void Update();
+
+	// for CSnapshotDelta::CreateDelta to add the bytes of every item type to
+	int *ItemBytes() { return m_aSlots[m_CurrentSlot].m_aItemBytes; }
+
+	void AddSnapshot(int ClientID, int Bytes) { m_aSlots[m_CurrentSlot].m_aaClientBytes[ClientID][KIND_SNAPSHOT] += Bytes; }
+	void AddMessage(int ClientID, int MsgID, bool System, int Bytes);
+
+	// seconds the rates are taken over, shorter right after a reset
+	int WindowSeconds() const;
+
+	// bytes per second over the window
+	int ItemRate(int Type) const;
+	int MsgRate(int MsgID, bool System) const;
+	int ClientRate(int ClientID, int Kind) const;
+
+	static const char *SystemMsgName(int MsgID);
+};
+
+#endif
@@ -0,0 +1,212 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/config.h>
+#include <engine/console.h>
+#include <engine/engine.h>
+#include <engine/map.h>
+#include <engine/masterserver.h>
+#include <engine/server.h>
+#include <engine/storage.h>
+
+#include "host.h"
+#include "server.h"
+
+CServerInstance::CServerInstance()
+{
+	mem_zero(&m_Config, sizeof(m_Config));
+	m_pKernel = 0;
+	m_pServer = 0;
+	m_pEngineMap = 0;
+	m_pGameServer = 0;
+	m_pConsole = 0;
+	m_pEngineMasterServer = 0;
+	m_pStorage = 0;
+	m_pConfig = 0;
+	m_Started = false;
+}
+
+CServerInstance::~CServerInstance()
+{
+	Select();
+
+	delete m_pServer;
+	delete m_pKernel;
+	delete m_pEngineMap;
+	delete m_pGameServer;
+	delete m_pConsole;
+	delete m_pEngineMasterServer;
+	delete m_pStorage;
+	delete m_pConfig;
+}
+
+bool CServerInstance::Create(IEngine *pEngine, bool SharedMap, const char *pConfigFile, int argc, const char **argv)
+{
+	// the console binds the config variables of the current configuration
+	Select();
+
+	m_pKernel = IKernel::Create();
+	m_pServer = new CServer();
+	m_pEngineMap = SharedMap ? CreateSharedEngineMap() : CreateEngineMap();
+	m_pGameServer = CreateGameServer();
+	m_pConsole = CreateConsole(CFGFLAG_SERVER|CFGFLAG_ECON);
+	m_pEngineMasterServer = CreateEngineMasterServer();
+	m_pStorage = CreateStorage("OpenFNG", IStorage::STORAGETYPE_SERVER, argc, argv); // ignore_convention
+	m_pConfig = CreateConfig();
+
+	m_pServer->InitRegister(&m_pServer->m_NetServer, m_pEngineMasterServer, m_pConsole);
+
+	{
+		bool RegisterFail = false;
+
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(m_pServer); // register as both
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(pEngine);
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(static_cast<IEngineMap*>(m_pEngineMap)); // register as both
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(static_cast<IMap*>(m_pEngineMap));
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(m_pGameServer);
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(m_pConsole);
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(m_pStorage);
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(m_pConfig);
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(static_cast<IEngineMasterServer*>(m_pEngineMasterServer)); // register as both
+		RegisterFail = RegisterFail || !m_pKernel->RegisterInterface(static_cast<IMasterServer*>(m_pEngineMasterServer));
+
+		if(RegisterFail)
+			return false;
+	}
+
+	// the engine is shared, so it must not rely on its kernel, which is the
+	// one of the last instance registering it
+	pEngine->RegisterCommands(m_pConsole, m_pStorage);
+	m_pConfig->Init();
+	m_pEngineMasterServer->Init();
+	m_pEngineMasterServer->Load();
+
+	// register all console commands
+	m_pServer->RegisterCommands();
+
+	// execute default openfng config
+	m_pConsole->ExecuteFile("openfng.cfg");
+
+	// parse the command line arguments, they are shared by all instances
+	if(argc > 1) // ignore_convention
+		m_pConsole->ParseArguments(argc-1, &argv[1]); // ignore_convention
+
+	// execute the config of this instance
+	if(pConfigFile)
+		m_pConsole->ExecuteFile(pConfigFile);
+
+	// restore empty config strings to their defaults
+	m_pConfig->RestoreStrings();
+	return true;
+}
+
+CServerHost::~CServerHost()
+{
+	for(int i = 0; i < m_lpWorkers.size(); i++)
+		delete m_lpWorkers[i];
+	for(int i = 0; i < m_lpInstances.size(); i++)
+		delete m_lpInstances[i];
+}
+
+bool CServerHost::AddInstance(IEngine *pEngine, const char *pConfigFile, int argc, const char **argv)
+{
+	CServerInstance *pInstance = new CServerInstance();
+	m_lpInstances.add(pInstance);
+	if(!pInstance->Create(pEngine, true, pConfigFile, argc, argv))
+	{
+		dbg_msg("host", "failed to create server. config='%s'", pConfigFile);
+		return false;
+	}
+	return true;
+}
+
+void CServerHost::WorkerThread(void *pUser)
+{
+	CWorker *pWorker = static_cast<CWorker *>(pUser);
+	pWorker->m_pHost->RunWorker(pWorker);
+}
+
+void CServerHost::RunWorker(CWorker *pWorker)
+{
+	NETSOCKET *pSockets = (NETSOCKET *)mem_alloc(sizeof(NETSOCKET)*pWorker->m_lpInstances.size(), 1);
+
+	while(1)
+	{
+		int NumSockets = 0;
+		int64 NextTick = 0;
+
+		for(int i = 0; i < pWorker->m_lpInstances.size(); i++)
+		{
+			CServerInstance *pInstance = pWorker->m_lpInstances[i];
+			if(!pInstance->m_Started || !pInstance->m_pServer->m_RunServer)
+				continue;
+
+			pInstance->Select();
+			pInstance->m_pServer->Update();
+
+			int64 Tick = pInstance->m_pServer->NextTickTime();
+			if(!NumSockets || Tick < NextTick)
+				NextTick = Tick;
+			pSockets[NumSockets++] = pInstance->m_pServer->m_NetServer.Socket();
+		}
+
+		if(!NumSockets)
+			break;
+
+		// wait for incomming data or the next tick that is due
+		int64 Wait = NextTick - time_get();
+		if(Wait > 0)
+			net_socket_read_wait_multi(pSockets, NumSockets, Wait*1000000/time_freq());
+	}
+
+	mem_free(pSockets);
+}
+
+int CServerHost::Run(int NumThreads)
+{
+	if(!m_lpInstances.size())
+		return -1;
+
+	// all servers tick at the same times, a worker wakes up once for all of them
+	int64 Epoch = time_get();
+	for(int i = 0; i < m_lpInstances.size(); i++)
+	{
+		CServerInstance *pInstance = m_lpInstances[i];
+		pInstance->Select();
+		pInstance->m_pServer->SetTickEpoch(Epoch);
+
+		dbg_msg("server", "starting...");
+		pInstance->m_Started = pInstance->m_pServer->Start() == 0;
+	}
+
+	NumThreads = clamp(NumThreads, 1, m_lpInstances.size());
+	for(int i = 0; i < NumThreads; i++)
+	{
+		CWorker *pWorker = new CWorker;
+		pWorker->m_pHost = this;
+		for(int j = i; j < m_lpInstances.size(); j += NumThreads)
+			pWorker->m_lpInstances.add(m_lpInstances[j]);
+		m_lpWorkers.add(pWorker);
+	}
+
+	dbg_msg("host", "running %d servers on %d threads", m_lpInstances.size(), NumThreads);
+
+	for(int i = 0; i < m_lpWorkers.size(); i++)
+		m_lpWorkers[i]->m_pThread = thread_create(WorkerThread, m_lpWorkers[i]);
+	for(int i = 0; i < m_lpWorkers.size(); i++)
+		thread_wait(m_lpWorkers[i]->m_pThread);
+
+	for(int i = 0; i < m_lpInstances.size(); i++)
+	{
+		CServerInstance *pInstance = m_lpInstances[i];
+		if(!pInstance->m_Started)
+			continue;
+
+		pInstance->Select();
+		pInstance->m_pServer->Shutdown();
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_HOST_H
+#define ENGINE_SERVER_HOST_H
+
+#include <base/tl/array.h>
+#include <engine/shared/config.h>
+
+/*
+	Class: CServerInstance
+		One game server with its own kernel, console and configuration.
+		The engine is shared by all instances of the process.
+*/
+class CServerInstance
+{
+public:
+	CConfiguration m_Config;
+
+	class IKernel *m_pKernel;
+	class CServer *m_pServer;
+	class IEngineMap *m_pEngineMap;
+	class IGameServer *m_pGameServer;
+	class IConsole *m_pConsole;
+	class IEngineMasterServer *m_pEngineMasterServer;
+	class IStorage *m_pStorage;
+	class IConfig *m_pConfig;
+
+	bool m_Started;
+
+	CServerInstance();
+	~CServerInstance();
+
+	// makes this instance's configuration the one of the calling thread
+	void Select() { g_pConfig = &m_Config; }
+
+	// creates and registers the components and executes the configs.
+	// pConfigFile is executed after the command line, it can be 0
+	bool Create(class IEngine *pEngine, bool SharedMap, const char *pConfigFile, int argc, const char **argv);
+};
+
+/*
+	Class: CServerHost
+		Runs several servers in one process. The servers share the map
+		data of maps they have in common and are spread over a few worker
+		threads, each server stays on the same thread all the time.
+		Every worker ticks its servers and sleeps on their sockets until
+		the next tick of one of them is due. Logging belongs to the
+		process: the log file of the first instance is used and the log
+		level is the one an instance set last.
+*/
+class CServerHost
+{
+	class CWorker
+	{
+	public:
+		CServerHost *m_pHost;
+		array<CServerInstance *> m_lpInstances;
+		void *m_pThread;
+	};
+
+	array<CWorker *> m_lpWorkers;
+
+	static void WorkerThread(void *pUser);
+	void RunWorker(CWorker *pWorker);
+
+public:
+	array<CServerInstance *> m_lpInstances;
+
+	~CServerHost();
+
+	bool AddInstance(class IEngine *pEngine, const char *pConfigFile, int argc, const char **argv);
+	int Run(int NumThreads);
+};
+
+#endif
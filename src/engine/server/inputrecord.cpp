@@ -0,0 +1,412 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/storage.h>
+
+#include "inputrecord.h"
+
+const unsigned char CInputRecord::ms_aHeaderMarker[8] = {'T', 'W', 'I', 'N', 'P', 'U', 'T', 0};
+
+CInputRecorder::CInputRecorder()
+{
+	m_File = 0;
+	m_NumTickInputs = 0;
+	m_NumTicks = 0;
+}
+
+void CInputRecorder::Write(const CPacker *pPacker)
+{
+	if(m_File)
+		io_write(m_File, pPacker->Data(), pPacker->Size());
+}
+
+void CInputRecorder::PackInput(CPacker *pPacker, int *pLast, const int *pData)
+{
+	int NumChanged = 0;
+	for(int i = 0; i < MAX_INPUT_SIZE; i++)
+	{
+		if(pData[i] != pLast[i])
+			NumChanged++;
+	}
+
+	pPacker->AddInt(NumChanged);
+	for(int i = 0; i < MAX_INPUT_SIZE; i++)
+	{
+		if(pData[i] != pLast[i])
+		{
+			pPacker->AddInt(i);
+			pPacker->AddInt(pData[i]);
+			pLast[i] = pData[i];
+		}
+	}
+}
+
+bool CInputRecorder::Start(IStorage *pStorage, const char *pFilename, const char *pMap, unsigned MapCrc, unsigned Seed, int MaxClients)
+{
+	Stop();
+
+	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!m_File)
+	{
+		dbg_msg("inputrecord", "could not open '%s'", pFilename);
+		return false;
+	}
+
+	mem_zero(m_aaLastInput, sizeof(m_aaLastInput));
+	mem_zero(m_aaLastDirectInput, sizeof(m_aaLastDirectInput));
+	m_NumTickInputs = 0;
+	m_NumTicks = 0;
+
+	io_write(m_File, CInputRecord::ms_aHeaderMarker, sizeof(CInputRecord::ms_aHeaderMarker));
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::VERSION);
+	Packer.AddString(pMap, 0);
+	Packer.AddInt(MapCrc);
+	Packer.AddInt(Seed);
+	Packer.AddInt(MaxClients);
+	Write(&Packer);
+
+	dbg_msg("inputrecord", "recording to '%s'", pFilename);
+	return true;
+}
+
+void CInputRecorder::Stop()
+{
+	if(!m_File)
+		return;
+
+	io_close(m_File);
+	m_File = 0;
+	dbg_msg("inputrecord", "record stopped after %d ticks", m_NumTicks);
+}
+
+void CInputRecorder::AddTickInput(int ClientID, const int *pData)
+{
+	if(!m_File)
+		return;
+
+	mem_copy(m_aaTickInput[m_NumTickInputs], pData, sizeof(m_aaTickInput[0]));
+	m_aTickInputClients[m_NumTickInputs++] = ClientID;
+}
+
+void CInputRecorder::RecordTick()
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_TICK);
+	Packer.AddInt(m_NumTickInputs);
+	Write(&Packer);
+
+	for(int i = 0; i < m_NumTickInputs; i++)
+	{
+		int ClientID = m_aTickInputClients[i];
+		Packer.Reset();
+		Packer.AddInt(ClientID);
+		PackInput(&Packer, m_aaLastInput[ClientID], m_aaTickInput[i]);
+		Write(&Packer);
+	}
+
+	m_NumTickInputs = 0;
+	m_NumTicks++;
+}
+
+void CInputRecorder::RecordSnap()
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_SNAP);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordChecksum(int Tick, unsigned Checksum)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_CHECKSUM);
+	Packer.AddInt(Tick);
+	Packer.AddInt(Checksum);
+	Write(&Packer);
+
+	// a record cut off by a crash stays usable up to its last checksum
+	io_flush(m_File);
+}
+
+void CInputRecorder::RecordConnect(int ClientID, bool CustClt)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_CONNECT);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(CustClt);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordEnter(int ClientID)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_ENTER);
+	Packer.AddInt(ClientID);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordDrop(int ClientID, const char *pReason)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_DROP);
+	Packer.AddInt(ClientID);
+	Packer.AddString(pReason ? pReason : "", 128);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordInput(int ClientID, int Latency, const int *pData)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_INPUT);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Latency);
+	PackInput(&Packer, m_aaLastDirectInput[ClientID], pData);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordMessage(int ClientID, const void *pData, int Size)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_MESSAGE);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Size);
+	Packer.AddRaw(pData, Size);
+	if(Packer.Error())
+	{
+		dbg_msg("inputrecord", "message of %d bytes too large to record", Size);
+		return;
+	}
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordAuth(int ClientID, int Level)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_AUTH);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Level);
+	Write(&Packer);
+}
+
+void CInputRecorder::RecordCommand(int ClientID, int Level, const char *pLine)
+{
+	if(!m_File)
+		return;
+
+	CPacker Packer;
+	Packer.Reset();
+	Packer.AddInt(CInputRecord::EVENT_COMMAND);
+	Packer.AddInt(ClientID);
+	Packer.AddInt(Level);
+	Packer.AddString(pLine, 1024);
+	Write(&Packer);
+}
+
+
+CInputRecordReader::CInputRecordReader()
+{
+	m_pFileData = 0;
+	m_FileSize = 0;
+	m_Error = false;
+	m_aMap[0] = 0;
+	m_MapCrc = 0;
+	m_Seed = 0;
+	m_MaxClients = 0;
+}
+
+CInputRecordReader::~CInputRecordReader()
+{
+	mem_free(m_pFileData);
+}
+
+bool CInputRecordReader::Load(IStorage *pStorage, const char *pFilename)
+{
+	IOHANDLE File = pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_ALL);
+	if(!File)
+	{
+		dbg_msg("inputrecord", "could not open '%s'", pFilename);
+		return false;
+	}
+
+	mem_free(m_pFileData);
+	m_FileSize = (int)io_length(File);
+	m_pFileData = (unsigned char *)mem_alloc(max(m_FileSize, 1), 1);
+	int ReadSize = (int)io_read(File, m_pFileData, m_FileSize);
+	io_close(File);
+
+	const int MarkerSize = sizeof(CInputRecord::ms_aHeaderMarker);
+	if(ReadSize != m_FileSize || m_FileSize < MarkerSize || mem_comp(m_pFileData, CInputRecord::ms_aHeaderMarker, MarkerSize) != 0)
+	{
+		dbg_msg("inputrecord", "'%s' is not an input record", pFilename);
+		return false;
+	}
+
+	m_Unpacker.Reset(m_pFileData+MarkerSize, m_FileSize-MarkerSize);
+	int Version = m_Unpacker.GetInt();
+	if(Version != CInputRecord::VERSION)
+	{
+		dbg_msg("inputrecord", "'%s' has version %d, only version %d is supported", pFilename, Version, (int)CInputRecord::VERSION);
+		return false;
+	}
+	str_copy(m_aMap, m_Unpacker.GetString(CUnpacker::SANITIZE_CC), sizeof(m_aMap));
+	m_MapCrc = (unsigned)m_Unpacker.GetInt();
+	m_Seed = (unsigned)m_Unpacker.GetInt();
+	m_MaxClients = m_Unpacker.GetInt();
+	if(m_Unpacker.Error() || m_MaxClients < 1 || m_MaxClients > MAX_CLIENTS)
+	{
+		dbg_msg("inputrecord", "'%s' has a broken header", pFilename);
+		return false;
+	}
+
+	mem_zero(m_aaInput, sizeof(m_aaInput));
+	mem_zero(m_aaDirectInput, sizeof(m_aaDirectInput));
+	m_Error = false;
+	return true;
+}
+
+bool CInputRecordReader::UnpackInput(int *pInput)
+{
+	int NumChanged = m_Unpacker.GetInt();
+	if(NumChanged < 0 || NumChanged > MAX_INPUT_SIZE)
+		return false;
+
+	for(int i = 0; i < NumChanged; i++)
+	{
+		int Index = m_Unpacker.GetInt();
+		int Value = m_Unpacker.GetInt();
+		if(Index < 0 || Index >= MAX_INPUT_SIZE)
+			return false;
+		pInput[Index] = Value;
+	}
+	return !m_Unpacker.Error();
+}
+
+int CInputRecordReader::GetClientID()
+{
+	int ClientID = m_Unpacker.GetInt();
+	if(ClientID < 0 || ClientID >= MAX_CLIENTS)
+	{
+		m_Error = true;
+		return 0;
+	}
+	return ClientID;
+}
+
+bool CInputRecordReader::NextEvent(CEvent *pEvent)
+{
+	if(m_Error || !m_pFileData)
+		return false;
+
+	mem_zero(pEvent, sizeof(*pEvent));
+	pEvent->m_Type = m_Unpacker.GetInt();
+	if(m_Unpacker.Error())
+		return false; // end of the record
+
+	switch(pEvent->m_Type)
+	{
+	case CInputRecord::EVENT_TICK:
+		pEvent->m_NumInputs = m_Unpacker.GetInt();
+		if(pEvent->m_NumInputs < 0 || pEvent->m_NumInputs > MAX_CLIENTS)
+		{
+			m_Error = true;
+			break;
+		}
+		for(int i = 0; i < pEvent->m_NumInputs && !m_Error; i++)
+		{
+			int ClientID = GetClientID();
+			m_aInputClients[i] = ClientID;
+			if(!m_Error && !UnpackInput(m_aaInput[ClientID]))
+				m_Error = true;
+		}
+		pEvent->m_pInputClients = m_aInputClients;
+		break;
+	case CInputRecord::EVENT_SNAP:
+		break;
+	case CInputRecord::EVENT_CHECKSUM:
+		pEvent->m_Tick = m_Unpacker.GetInt();
+		pEvent->m_Checksum = (unsigned)m_Unpacker.GetInt();
+		break;
+	case CInputRecord::EVENT_CONNECT:
+		pEvent->m_ClientID = GetClientID();
+		pEvent->m_CustClt = m_Unpacker.GetInt() != 0;
+		break;
+	case CInputRecord::EVENT_ENTER:
+		pEvent->m_ClientID = GetClientID();
+		break;
+	case CInputRecord::EVENT_DROP:
+		pEvent->m_ClientID = GetClientID();
+		pEvent->m_pString = m_Unpacker.GetString(0);
+		break;
+	case CInputRecord::EVENT_INPUT:
+		pEvent->m_ClientID = GetClientID();
+		pEvent->m_Latency = m_Unpacker.GetInt();
+		if(!m_Error && !UnpackInput(m_aaDirectInput[pEvent->m_ClientID]))
+			m_Error = true;
+		break;
+	case CInputRecord::EVENT_MESSAGE:
+		pEvent->m_ClientID = GetClientID();
+		pEvent->m_DataSize = m_Unpacker.GetInt();
+		if(pEvent->m_DataSize < 0)
+			m_Error = true;
+		else
+			pEvent->m_pData = m_Unpacker.GetRaw(pEvent->m_DataSize);
+		break;
+	case CInputRecord::EVENT_AUTH:
+		pEvent->m_ClientID = GetClientID();
+		pEvent->m_Level = m_Unpacker.GetInt();
+		break;
+	case CInputRecord::EVENT_COMMAND:
+		// commands from the econ have no client
+		pEvent->m_ClientID = m_Unpacker.GetInt();
+		pEvent->m_Level = m_Unpacker.GetInt();
+		pEvent->m_pString = m_Unpacker.GetString(0);
+		if(pEvent->m_ClientID < -1 || pEvent->m_ClientID >= MAX_CLIENTS)
+			m_Error = true;
+		break;
+	default:
+		m_Error = true;
+	}
+
+	if(m_Unpacker.Error())
+		m_Error = true;
+	return !m_Error;
+}
@@ -0,0 +1,146 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_INPUTRECORD_H
+#define ENGINE_SERVER_INPUTRECORD_H
+
+#include <base/system.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+
+/*
+	Input records hold everything from the outside that reaches the game
+	while a map runs: clients joining and leaving, their inputs and game
+	messages, rcon logins and console commands. Played back through the
+	same game on the same map they give the same game again, without any
+	network or clock, which makes the game tick measurable and testable.
+
+	The file is a header followed by events, all packed as variable ints.
+	A tick event advances the game by one tick and holds the predicted
+	inputs for it, everything else happened in between the ticks. Inputs
+	are stored as the fields that changed since the last one.
+
+	Every CHECKSUM_INTERVAL ticks the state of the game is hashed, a
+	replay that ends up with a different hash has diverged.
+*/
+class CInputRecord
+{
+public:
+	enum
+	{
+		EVENT_TICK=0,
+		EVENT_SNAP,
+		EVENT_CHECKSUM,
+		EVENT_CONNECT,
+		EVENT_ENTER,
+		EVENT_DROP,
+		EVENT_INPUT,
+		EVENT_MESSAGE,
+		EVENT_AUTH,
+		EVENT_COMMAND,
+		NUM_EVENTS,
+
+		VERSION=1,
+		CHECKSUM_INTERVAL=50,
+	};
+
+	static const unsigned char ms_aHeaderMarker[8];
+};
+
+class CInputRecorder
+{
+	IOHANDLE m_File;
+	int m_aaLastInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	int m_aaLastDirectInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+
+	// predicted inputs of the tick that is being run
+	int m_aaTickInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	int m_aTickInputClients[MAX_CLIENTS];
+	int m_NumTickInputs;
+
+	int m_NumTicks;
+
+	void Write(const CPacker *pPacker);
+	static void PackInput(CPacker *pPacker, int *pLast, const int *pData);
+
+public:
+	CInputRecorder();
+
+	bool Start(class IStorage *pStorage, const char *pFilename, const char *pMap, unsigned MapCrc, unsigned Seed, int MaxClients);
+	void Stop();
+	bool IsRecording() const { return m_File != 0; }
+
+	void AddTickInput(int ClientID, const int *pData);
+	void RecordTick();
+	void RecordSnap();
+	void RecordChecksum(int Tick, unsigned Checksum);
+
+	void RecordConnect(int ClientID, bool CustClt);
+	void RecordEnter(int ClientID);
+	void RecordDrop(int ClientID, const char *pReason);
+	void RecordInput(int ClientID, int Latency, const int *pData);
+	void RecordMessage(int ClientID, const void *pData, int Size);
+	void RecordAuth(int ClientID, int Level);
+	void RecordCommand(int ClientID, int Level, const char *pLine);
+};
+
+class CInputRecordReader
+{
+public:
+	class CEvent
+	{
+	public:
+		int m_Type;
+		int m_ClientID;
+
+		// tick: the clients with inputs, the inputs are in the reader
+		int m_NumInputs;
+		const int *m_pInputClients;
+
+		int m_Tick;
+		unsigned m_Checksum;
+		int m_Latency;
+		int m_Level;
+		bool m_CustClt;
+		const char *m_pString;
+		const unsigned char *m_pData;
+		int m_DataSize;
+	};
+
+private:
+	unsigned char *m_pFileData;
+	int m_FileSize;
+	CUnpacker m_Unpacker;
+	bool m_Error;
+
+	char m_aMap[64];
+	unsigned m_MapCrc;
+	unsigned m_Seed;
+	int m_MaxClients;
+
+	int m_aaInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	int m_aaDirectInput[MAX_CLIENTS][MAX_INPUT_SIZE];
+	int m_aInputClients[MAX_CLIENTS];
+
+	bool UnpackInput(int *pInput);
+	int GetClientID();
+
+public:
+	CInputRecordReader();
+	~CInputRecordReader();
+
+	bool Load(class IStorage *pStorage, const char *pFilename);
+
+	const char *MapName() const { return m_aMap; }
+	unsigned MapCrc() const { return m_MapCrc; }
+	unsigned Seed() const { return m_Seed; }
+	int MaxClients() const { return m_MaxClients; }
+
+	int *Input(int ClientID) { return m_aaInput[ClientID]; }
+	int *DirectInput(int ClientID) { return m_aaDirectInput[ClientID]; }
+
+	// false at the end of the record or when it is broken, see Error()
+	bool NextEvent(CEvent *pEvent);
+	bool Error() const { return m_Error; }
+};
+
+#endif
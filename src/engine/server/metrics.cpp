@@ -0,0 +1,346 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+#include <base/tl/threading.h>
+
+#include <engine/shared/config.h>
+
+#if defined(CONF_FAMILY_UNIX)
+	#include <signal.h>
+#endif
+
+#include "metrics.h"
+
+static const struct
+{
+	const char *m_pName;
+	const char *m_pType;
+	const char *m_pHelp;
+} s_aMetrics[CMetrics::NUM_METRICS] = {
+	{"openfng_packets_received_total", "counter", "Packets received by the process"},
+	{"openfng_packets_sent_total", "counter", "Packets sent by the process"},
+	{"openfng_bytes_received_total", "counter", "Bytes received by the process"},
+	{"openfng_bytes_sent_total", "counter", "Bytes sent by the process"},
+	{"openfng_resends_total", "counter", "Chunks sent again because they were not acknowledged"},
+	{"openfng_ban_hits_total", "counter", "Packets dropped because the sender is banned"},
+	{"openfng_connless_requests_total", "counter", "Packets received outside of a connection"},
+	{"openfng_clients", "gauge", "Connected clients"},
+	{"openfng_players", "gauge", "Clients in the game"},
+	{"openfng_memory_allocated_bytes", "gauge", "Memory allocated through mem_alloc"},
+	{"openfng_memory_allocations", "gauge", "Active allocations"},
+	{"openfng_memory_allocations_total", "counter", "Allocations made"},
+};
+
+static const char *s_apQuantiles[CMetrics::NUM_QUANTILES] = {"0.5", "0.9", "0.99", "1"};
+
+CMetrics::CMetrics()
+{
+	m_Socket.type = NETTYPE_INVALID;
+	m_Socket.ipv4sock = -1;
+	m_Socket.ipv6sock = -1;
+	m_pThread = 0;
+	m_Serving = false;
+	m_pText = 0;
+	m_pConfig = 0;
+	Reset();
+}
+
+CMetrics::~CMetrics()
+{
+	Close();
+}
+
+void CMetrics::Reset()
+{
+	mem_zero(&m_Values, sizeof(m_Values));
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_Values.m_aSnapshotBytes[i] = -1;
+
+	m_aPublished[0] = m_Values;
+	m_aPublished[1] = m_Values;
+	m_aSequence[0] = 0;
+	m_aSequence[1] = 0;
+	m_Latest = 0;
+}
+
+void CMetrics::Publish()
+{
+	// write the copy that readers are not sent to
+	int Next = m_Latest^1;
+	m_aSequence[Next]++;
+	sync_barrier();
+	m_aPublished[Next] = m_Values;
+	sync_barrier();
+	m_aSequence[Next]++;
+	sync_barrier();
+	m_Latest = Next;
+}
+
+void CMetrics::Read(CValues *pValues) const
+{
+	while(1)
+	{
+		int Latest = m_Latest;
+		unsigned Sequence = m_aSequence[Latest];
+		if(Sequence&1)
+			continue;
+		sync_barrier();
+		*pValues = m_aPublished[Latest];
+		sync_barrier();
+		if(m_aSequence[Latest] == Sequence)
+			return;
+	}
+}
+
+int CMetrics::FormatText(const CValues *pValues, char *pBuffer, int BufferSize)
+{
+	int Length = 0;
+	pBuffer[0] = 0;
+
+	for(int m = 0; m < NUM_METRICS; m++)
+	{
+		str_format(pBuffer+Length, BufferSize-Length, "# HELP %s %s\n# TYPE %s %s\n%s %.0f\n",
+			s_aMetrics[m].m_pName, s_aMetrics[m].m_pHelp, s_aMetrics[m].m_pName, s_aMetrics[m].m_pType,
+			s_aMetrics[m].m_pName, (double)pValues->m_aValues[m]);
+		Length += str_length(pBuffer+Length);
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_phase_seconds Time of the server update phases over the last minute\n# TYPE openfng_phase_seconds gauge\n");
+	Length += str_length(pBuffer+Length);
+	for(int p = 0; p < CTickProfiler::NUM_PHASES; p++)
+	{
+		for(int q = 0; q < NUM_QUANTILES; q++)
+		{
+			str_format(pBuffer+Length, BufferSize-Length, "openfng_phase_seconds{phase=\"%s\",quantile=\"%s\"} %.6f\n",
+				CTickProfiler::PhaseName(p), s_apQuantiles[q], pValues->m_aaPhaseTimes[p][q]/1000000.0);
+			Length += str_length(pBuffer+Length);
+		}
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_snapshot_bytes_total Snapshot bytes sent to a client since it connected\n# TYPE openfng_snapshot_bytes_total counter\n");
+	Length += str_length(pBuffer+Length);
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(pValues->m_aSnapshotBytes[c] < 0)
+			continue;
+		str_format(pBuffer+Length, BufferSize-Length, "openfng_snapshot_bytes_total{client=\"%d\"} %.0f\n", c, (double)pValues->m_aSnapshotBytes[c]);
+		Length += str_length(pBuffer+Length);
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_entities Entities in the game world\n# TYPE openfng_entities gauge\n");
+	Length += str_length(pBuffer+Length);
+	for(int i = 0; i < pValues->m_NumEntityTypes; i++)
+	{
+		str_format(pBuffer+Length, BufferSize-Length, "openfng_entities{type=\"%s\"} %d\n", pValues->m_apEntityNames[i], pValues->m_aEntities[i]);
+		Length += str_length(pBuffer+Length);
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_snapshot_item_bytes_per_second Snapshot delta bytes of an item type\n# TYPE openfng_snapshot_item_bytes_per_second gauge\n");
+	Length += str_length(pBuffer+Length);
+	for(int t = 0; t < CBandwidthStats::MAX_ITEM_TYPES; t++)
+	{
+		if(!pValues->m_aItemRates[t])
+			continue;
+		str_format(pBuffer+Length, BufferSize-Length, "openfng_snapshot_item_bytes_per_second{type=\"%s\"} %d\n", pValues->m_apItemNames[t], pValues->m_aItemRates[t]);
+		Length += str_length(pBuffer+Length);
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_message_bytes_per_second Bytes of vital messages of a type\n# TYPE openfng_message_bytes_per_second gauge\n");
+	Length += str_length(pBuffer+Length);
+	for(int s = 0; s < 2; s++)
+	{
+		for(int m = 0; m < CBandwidthStats::MAX_MSG_TYPES; m++)
+		{
+			if(!pValues->m_aaMsgRates[s][m])
+				continue;
+			str_format(pBuffer+Length, BufferSize-Length, "openfng_message_bytes_per_second{type=\"%s\",system=\"%d\"} %d\n", pValues->m_aapMsgNames[s][m], s, pValues->m_aaMsgRates[s][m]);
+			Length += str_length(pBuffer+Length);
+		}
+	}
+
+	str_format(pBuffer+Length, BufferSize-Length, "# HELP openfng_client_bytes_per_second Bytes sent to a client\n# TYPE openfng_client_bytes_per_second gauge\n");
+	Length += str_length(pBuffer+Length);
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(pValues->m_aSnapshotBytes[c] < 0)
+			continue;
+		str_format(pBuffer+Length, BufferSize-Length, "openfng_client_bytes_per_second{client=\"%d\",kind=\"snapshot\"} %d\nopenfng_client_bytes_per_second{client=\"%d\",kind=\"message\"} %d\n",
+			c, pValues->m_aaClientRates[c][CBandwidthStats::KIND_SNAPSHOT], c, pValues->m_aaClientRates[c][CBandwidthStats::KIND_MESSAGE]);
+		Length += str_length(pBuffer+Length);
+	}
+
+	return Length;
+}
+
+static void PackInt64(CPacker *pPacker, int64 Value)
+{
+	pPacker->AddInt((int)(Value&0x7fffffff));
+	pPacker->AddInt((int)(Value>>31));
+}
+
+static void PackRates(CPacker *pPacker, const int *pRates, int Num)
+{
+	int NumRates = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		if(pRates[i])
+			NumRates++;
+	}
+	pPacker->AddInt(NumRates);
+	for(int i = 0; i < Num; i++)
+	{
+		if(!pRates[i])
+			continue;
+		pPacker->AddInt(i);
+		pPacker->AddInt(pRates[i]);
+	}
+}
+
+void CMetrics::Pack(const CValues *pValues, CPacker *pPacker)
+{
+	pPacker->AddInt(VERSION);
+	for(int m = 0; m < NUM_METRICS; m++)
+		PackInt64(pPacker, pValues->m_aValues[m]);
+
+	for(int p = 0; p < CTickProfiler::NUM_PHASES; p++)
+	{
+		for(int q = 0; q < NUM_QUANTILES; q++)
+			pPacker->AddInt(pValues->m_aaPhaseTimes[p][q]);
+	}
+
+	int NumClients = 0;
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(pValues->m_aSnapshotBytes[c] >= 0)
+			NumClients++;
+	}
+	pPacker->AddInt(NumClients);
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(pValues->m_aSnapshotBytes[c] < 0)
+			continue;
+		pPacker->AddInt(c);
+		PackInt64(pPacker, pValues->m_aSnapshotBytes[c]);
+	}
+
+	pPacker->AddInt(pValues->m_NumEntityTypes);
+	for(int i = 0; i < pValues->m_NumEntityTypes; i++)
+		pPacker->AddInt(pValues->m_aEntities[i]);
+
+	PackRates(pPacker, pValues->m_aItemRates, CBandwidthStats::MAX_ITEM_TYPES);
+	PackRates(pPacker, pValues->m_aaMsgRates[0], CBandwidthStats::MAX_MSG_TYPES);
+	PackRates(pPacker, pValues->m_aaMsgRates[1], CBandwidthStats::MAX_MSG_TYPES);
+
+	int NumRates = 0;
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(pValues->m_aaClientRates[c][0] || pValues->m_aaClientRates[c][1])
+			NumRates++;
+	}
+	pPacker->AddInt(NumRates);
+	for(int c = 0; c < MAX_CLIENTS; c++)
+	{
+		if(!pValues->m_aaClientRates[c][0] && !pValues->m_aaClientRates[c][1])
+			continue;
+		pPacker->AddInt(c);
+		pPacker->AddInt(pValues->m_aaClientRates[c][CBandwidthStats::KIND_SNAPSHOT]);
+		pPacker->AddInt(pValues->m_aaClientRates[c][CBandwidthStats::KIND_MESSAGE]);
+	}
+}
+
+bool CMetrics::Listen(NETADDR BindAddr)
+{
+	Close();
+
+	m_Socket = net_tcp_create(BindAddr);
+	if(!m_Socket.type)
+		return false;
+	if(net_tcp_listen(m_Socket, 4))
+	{
+		net_tcp_close(m_Socket);
+		m_Socket.type = NETTYPE_INVALID;
+		return false;
+	}
+	net_set_non_blocking(m_Socket);
+
+#if defined(CONF_FAMILY_UNIX)
+	// a scraper that hangs up early must not take the server down
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	m_pText = (char *)mem_alloc(TEXT_SIZE, 1);
+	m_Serving = true;
+	m_pConfig = g_pConfig;
+	m_pThread = thread_create(ServeThread, this);
+	return true;
+}
+
+void CMetrics::Close()
+{
+	if(m_pThread)
+	{
+		m_Serving = false;
+		thread_wait(m_pThread);
+		m_pThread = 0;
+	}
+	if(m_Socket.type != NETTYPE_INVALID)
+	{
+		net_tcp_close(m_Socket);
+		m_Socket.type = NETTYPE_INVALID;
+	}
+	if(m_pText)
+	{
+		mem_free(m_pText);
+		m_pText = 0;
+	}
+}
+
+void CMetrics::ServeThread(void *pUser)
+{
+	CMetrics *pThis = (CMetrics *)pUser;
+	g_pConfig = pThis->m_pConfig;
+	while(pThis->m_Serving)
+	{
+		if(!net_socket_read_wait(pThis->m_Socket, 100))
+			continue;
+
+		NETSOCKET Client;
+		NETADDR Addr;
+		if(net_tcp_accept(pThis->m_Socket, &Client, &Addr) < 0)
+			continue;
+		pThis->Serve(Client);
+		net_tcp_close(Client);
+	}
+}
+
+void CMetrics::Serve(NETSOCKET Client)
+{
+	// the request does not matter, every path gets the metrics
+	char aRequest[1024];
+	int Received = 0;
+	for(int Wait = 0; Wait < 10 && net_socket_read_wait(Client, 100); Wait++)
+	{
+		int Bytes = net_tcp_recv(Client, aRequest+Received, sizeof(aRequest)-1-Received);
+		if(Bytes <= 0)
+			break;
+		Received += Bytes;
+		aRequest[Received] = 0;
+		if(str_find(aRequest, "\r\n\r\n") || str_find(aRequest, "\n\n") || Received == (int)sizeof(aRequest)-1)
+			break;
+	}
+
+	CValues Values;
+	Read(&Values);
+	int Length = FormatText(&Values, m_pText, TEXT_SIZE);
+
+	char aHeader[256];
+	str_format(aHeader, sizeof(aHeader), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", Length);
+	net_tcp_send(Client, aHeader, str_length(aHeader));
+	for(int Sent = 0; Sent < Length; )
+	{
+		int Bytes = net_tcp_send(Client, m_pText+Sent, Length-Sent);
+		if(Bytes <= 0)
+			break;
+		Sent += Bytes;
+	}
+}
@@ -0,0 +1,124 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_METRICS_H
+#define ENGINE_SERVER_METRICS_H
+
+#include <base/system.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/profiler.h>
+#include <engine/shared/protocol.h>
+#include <engine/server/bandwidth.h>
+
+/*
+	Class: CMetrics
+		Counters and gauges of a server for monitoring.
+
+		The server counts into m_Values on its own thread and publishes a
+		copy of them about once a second. There are two published copies,
+		each with a sequence number that is odd while it is written, so
+		readers on any thread get a consistent copy without the server
+		ever waiting on them or allocating.
+
+		The copies are served in the Prometheus text format on an optional
+		TCP port by a thread of their own, and packed into a compact binary
+		form for the metrics command. The binary form is a list of variable
+		ints: VERSION, then NUM_METRICS values, then NUM_QUANTILES times for
+		every profiler phase, then the number of clients in the game
+		followed by client id and snapshot bytes for each, then the number
+		of entity types followed by their counts. From VERSION 2 on the
+		bandwidth rates follow as lists of a count and then index and
+		bytes per second pairs: snapshot items by type, game messages,
+		system messages, and client snapshot and message rates as triples
+		of client id and the two rates. Only nonzero rates are in the
+		lists. Values that can grow past 31 bits are packed as two ints,
+		the lower 31 bits first.
+*/
+class CMetrics
+{
+public:
+	enum
+	{
+		PACKETS_RECEIVED=0,
+		PACKETS_SENT,
+		BYTES_RECEIVED,
+		BYTES_SENT,
+		RESENDS,
+		BAN_HITS,
+		CONNLESS_REQUESTS,
+		CLIENTS,
+		PLAYERS,
+		MEMORY_ALLOCATED,
+		MEMORY_ALLOCATIONS,
+		MEMORY_ALLOCATIONS_TOTAL,
+		NUM_METRICS,
+
+		QUANTILE_P50=0,
+		QUANTILE_P90,
+		QUANTILE_P99,
+		QUANTILE_MAX,
+		NUM_QUANTILES,
+
+		MAX_ENTITY_TYPES=8,
+		TEXT_SIZE=1<<15,
+
+		VERSION=2,
+	};
+
+	class CValues
+	{
+	public:
+		int64 m_aValues[NUM_METRICS];
+
+		// profiler times of the last minute in microseconds
+		int m_aaPhaseTimes[CTickProfiler::NUM_PHASES][NUM_QUANTILES];
+
+		// snapshot bytes sent to each client since it connected, -1 for empty slots
+		int64 m_aSnapshotBytes[MAX_CLIENTS];
+
+		int m_NumEntityTypes;
+		int m_aEntities[MAX_ENTITY_TYPES];
+		const char *m_apEntityNames[MAX_ENTITY_TYPES];
+
+		// bytes per second over the window of CBandwidthStats, index 1 of the messages for system ones
+		int m_aItemRates[CBandwidthStats::MAX_ITEM_TYPES];
+		const char *m_apItemNames[CBandwidthStats::MAX_ITEM_TYPES];
+		int m_aaMsgRates[2][CBandwidthStats::MAX_MSG_TYPES];
+		const char *m_aapMsgNames[2][CBandwidthStats::MAX_MSG_TYPES];
+		int m_aaClientRates[MAX_CLIENTS][CBandwidthStats::NUM_KINDS];
+	};
+
+	CValues m_Values;
+
+private:
+	CValues m_aPublished[2];
+	volatile unsigned m_aSequence[2];
+	volatile int m_Latest;
+
+	NETSOCKET m_Socket;
+	void *m_pThread;
+	volatile bool m_Serving;
+	char *m_pText;
+	struct CConfiguration *m_pConfig;
+
+	static void ServeThread(void *pUser);
+	void Serve(NETSOCKET Client);
+
+public:
+	CMetrics();
+	~CMetrics();
+
+	void Reset();
+
+	// copies m_Values for the readers, only call from the thread counting
+	void Publish();
+	void Read(CValues *pValues) const;
+
+	// serves the text format on a port until Close()
+	bool Listen(NETADDR BindAddr);
+	void Close();
+
+	static int FormatText(const CValues *pValues, char *pBuffer, int BufferSize);
+	static void Pack(const CValues *pValues, CPacker *pPacker);
+};
+
+#endif
@@ -44,7 +44,7 @@ void CRegister::RegisterSendFwcheckresponse(NETADDR *pAddr)
 
 void CRegister::RegisterSendHeartbeat(NETADDR Addr)
 {
-	static unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
+	unsigned char aData[sizeof(SERVERBROWSE_HEARTBEAT) + 2];
 	unsigned short Port = g_Config.m_SvPort;
 	CNetChunk Packet;
 
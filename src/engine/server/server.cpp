@@ -26,7 +26,9 @@
 #include <engine/shared/snapshot.h>
 
 #include <mastersrv/mastersrv.h>
+#include <zlib.h>
 
+#include "host.h"
 #include "register.h"
 #include "server.h"
 
@@ -265,6 +267,7 @@ void CServer::CClient::Reset()
 	m_LastAckedSnapshot = -1;
 	m_LastInputTick = -1;
 	m_SnapRate = CClient::SNAPRATE_INIT;
+	m_SnapControl.Reset();
 	m_Score = 0;
 }
 
@@ -279,11 +282,21 @@ CServer::CServer() : m_DemoRecorder(&m_SnapshotDelta)
 
 	m_pCurrentMapData = 0;
 	m_CurrentMapSize = 0;
+	m_OwnCurrentMapData = false;
 
 	m_MapReload = 0;
 
+	m_ServerInfoCacheSize = 0;
+	m_ServerInfoCacheValid = false;
+
 	m_RconClientID = IServer::RCON_CID_SERV;
 	m_RconAuthLevel = AUTHED_ADMIN;
+	m_RconLineReentryGuard = 0;
+	m_TickEpoch = 0;
+
+	m_Replaying = false;
+	m_ReplayMaxClients = 0;
+	m_MetricsTime = 0;
 
 	Init();
 }
@@ -320,6 +333,7 @@ int CServer::TrySetClientName(int ClientID, const char *pName)
 
 	// set the client name
 	str_copy(m_aClients[ClientID].m_aName, pName, MAX_NAME_LENGTH);
+	ExpireServerInfo();
 	return 0;
 }
 
@@ -362,7 +376,11 @@ void CServer::SetClientClan(int ClientID, const char *pClan)
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY || !pClan)
 		return;
 
+	if(str_comp(m_aClients[ClientID].m_aClan, pClan) == 0)
+		return;
+
 	str_copy(m_aClients[ClientID].m_aClan, pClan, MAX_CLAN_LENGTH);
+	ExpireServerInfo();
 }
 
 void CServer::SetClientCountry(int ClientID, int Country)
@@ -370,14 +388,22 @@ void CServer::SetClientCountry(int ClientID, int Country)
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
 
+	if(m_aClients[ClientID].m_Country == Country)
+		return;
+
 	m_aClients[ClientID].m_Country = Country;
+	ExpireServerInfo();
 }
 
 void CServer::SetClientScore(int ClientID, int Score)
 {
 	if(ClientID < 0 || ClientID >= MAX_CLIENTS || m_aClients[ClientID].m_State < CClient::STATE_READY)
 		return;
+	if(m_aClients[ClientID].m_Score == Score)
+		return;
+
 	m_aClients[ClientID].m_Score = Score;
+	ExpireServerInfo();
 }
 
 void CServer::Kick(int ClientID, const char *pReason)
@@ -506,8 +532,17 @@ bool CServer::ClientIngame(int ClientID)
 	return ClientID >= 0 && ClientID < MAX_CLIENTS && m_aClients[ClientID].m_State == CServer::CClient::STATE_INGAME;
 }
 
+int CServer::ClientLastAckedSnapshot(int ClientID)
+{
+	if(!ClientIngame(ClientID))
+		return -1;
+	return m_aClients[ClientID].m_LastAckedSnapshot;
+}
+
 int CServer::MaxClients() const
 {
+	if(m_Replaying)
+		return m_ReplayMaxClients;
 	return m_NetServer.MaxClients();
 }
 
@@ -522,12 +557,20 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 	if(!pMsg)
 		return -1;
 
+	// nobody to send to in a replay
+	if(m_Replaying)
+		return 0;
+
 	mem_zero(&Packet, sizeof(CNetChunk));
 
 	Packet.m_ClientID = ClientID;
 	Packet.m_pData = pMsg->Data();
 	Packet.m_DataSize = pMsg->Size();
 
+	int MsgID = 0;
+	if(Flags&MSGFLAG_VITAL)
+		CVariableInt::Unpack(pMsg->Data(), &MsgID);
+
 	// HACK: modify the message id in the packet and store the system flag
 	*((unsigned char*)Packet.m_pData) <<= 1;
 	if(System)
@@ -553,17 +596,71 @@ int CServer::SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System)
 				{
 					Packet.m_ClientID = i;
 					m_NetServer.Send(&Packet);
+					if(Flags&MSGFLAG_VITAL)
+						m_Bandwidth.AddMessage(i, MsgID, System, Packet.m_DataSize);
 				}
 		}
 		else
+		{
 			m_NetServer.Send(&Packet);
+			if(Flags&MSGFLAG_VITAL)
+				m_Bandwidth.AddMessage(ClientID, MsgID, System, Packet.m_DataSize);
+		}
 	}
 	return 0;
 }
 
+bool CServer::BeginMsg(CPacker *pPacker, int MsgID, int ClientID, int Flags, int MaxSize)
+{
+	dbg_assert(!(Flags&MSGFLAG_NOSEND), "packing in place needs a client to send to");
+	if(m_Replaying)
+		return false;
+
+	// room for the variable ints the packer always wants to have
+	MaxSize += 6;
+	unsigned char *pData = m_NetServer.ReserveChunk(ClientID, (Flags&MSGFLAG_VITAL) ? NETSENDFLAG_VITAL : 0, MaxSize);
+	if(!pData)
+		return false;
+	pPacker->Reset(pData, MaxSize);
+	pPacker->AddInt(MsgID);
+	return true;
+}
+
+int CServer::EndMsg(CPacker *pPacker, int ClientID, int Flags, bool System)
+{
+	// the reserved room is simply taken by the next chunk
+	if(pPacker->Error())
+		return -1;
+
+	unsigned char *pData = (unsigned char *)pPacker->Data();
+	int MsgID = 0;
+	if(Flags&MSGFLAG_VITAL)
+		CVariableInt::Unpack(pData, &MsgID);
+
+	// HACK: modify the message id in the packet and store the system flag, as in SendMsgEx
+	*pData <<= 1;
+	if(System)
+		*pData |= 1;
+
+	if(!(Flags&MSGFLAG_NORECORD))
+		m_DemoRecorder.RecordMessage(pData, pPacker->Size());
+
+	int SendFlags = 0;
+	if(Flags&MSGFLAG_VITAL)
+	{
+		SendFlags |= NETSENDFLAG_VITAL;
+		m_Bandwidth.AddMessage(ClientID, MsgID, System, pPacker->Size());
+	}
+	if(Flags&MSGFLAG_FLUSH)
+		SendFlags |= NETSENDFLAG_FLUSH;
+	return m_NetServer.CommitChunk(ClientID, SendFlags, pPacker->Size());
+}
+
 void CServer::DoSnapshot()
 {
+	m_Profiler.Begin(CTickProfiler::PHASE_SNAP_BUILD);
 	GameServer()->OnPreSnap();
+	m_Profiler.End(CTickProfiler::PHASE_SNAP_BUILD);
 
 	// create snapshot for demo recording
 	if(m_DemoRecorder.IsRecording())
@@ -572,9 +669,11 @@ void CServer::DoSnapshot()
 		int SnapshotSize;
 
 		// build snap and possibly add some messages
+		m_Profiler.Begin(CTickProfiler::PHASE_SNAP_BUILD);
 		m_SnapshotBuilder.Init();
 		GameServer()->OnSnap(-1);
 		SnapshotSize = m_SnapshotBuilder.Finish(aData);
+		m_Profiler.End(CTickProfiler::PHASE_SNAP_BUILD);
 
 		// write snapshot
 		m_DemoRecorder.RecordSnapshot(Tick(), aData, SnapshotSize);
@@ -587,13 +686,23 @@ void CServer::DoSnapshot()
 		if(m_aClients[i].m_State != CClient::STATE_INGAME)
 			continue;
 
-		// this client is trying to recover, don't spam snapshots
-		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick()%50) != 0)
-			continue;
+		if(g_Config.m_SvSnapAdaptive && m_aClients[i].m_SnapRate != CClient::SNAPRATE_INIT)
+		{
+			// let the connection decide how often it gets one
+			m_aClients[i].m_SnapControl.Update(Tick(), m_NetServer.NumResends(i));
+			if(!m_aClients[i].m_SnapControl.ShouldSend(Tick(), g_Config.m_SvSnapBudget))
+				continue;
+		}
+		else
+		{
+			// this client is trying to recover, don't spam snapshots
+			if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER && (Tick()%50) != 0)
+				continue;
 
-		// this client is trying to recover, don't spam snapshots
-		if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_INIT && (Tick()%10) != 0)
-			continue;
+			// this client is trying to recover, don't spam snapshots
+			if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_INIT && (Tick()%10) != 0)
+				continue;
+		}
 
 		{
 			char aData[CSnapshot::MAX_SIZE];
@@ -608,6 +717,7 @@ void CServer::DoSnapshot()
 			int DeltaTick = -1;
 			int DeltaSize;
 
+			m_Profiler.Begin(CTickProfiler::PHASE_SNAP_BUILD);
 			m_SnapshotBuilder.Init();
 
 			GameServer()->OnSnap(i);
@@ -615,6 +725,9 @@ void CServer::DoSnapshot()
 			// finish snapshot
 			SnapshotSize = m_SnapshotBuilder.Finish(pData);
 			Crc = pData->Crc();
+			m_Profiler.End(CTickProfiler::PHASE_SNAP_BUILD);
+
+			m_Profiler.Begin(CTickProfiler::PHASE_SNAP_DELTA);
 
 			// remove old snapshos
 			// keep 3 seconds worth of snapshots
@@ -635,11 +748,14 @@ void CServer::DoSnapshot()
 					// no acked package found, force client to recover rate
 					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_FULL)
 						m_aClients[i].m_SnapRate = CClient::SNAPRATE_RECOVER;
+					if(m_aClients[i].m_SnapRate == CClient::SNAPRATE_RECOVER)
+						m_aClients[i].m_SnapControl.OnLost(Tick());
 				}
 			}
 
 			// create delta
-			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData);
+			DeltaSize = m_SnapshotDelta.CreateDelta(pDeltashot, pData, aDeltaData, g_Config.m_SvBandwidthStats ? m_Bandwidth.ItemBytes() : 0);
+			m_Profiler.End(CTickProfiler::PHASE_SNAP_DELTA);
 
 			if(DeltaSize)
 			{
@@ -648,49 +764,72 @@ void CServer::DoSnapshot()
 				const int MaxSize = MAX_SNAPSHOT_PACKSIZE;
 				int NumPackets;
 
+				m_Profiler.Begin(CTickProfiler::PHASE_SNAP_COMPRESS);
 				SnapshotSize = CVariableInt::Compress(aDeltaData, DeltaSize, aCompData);
 				NumPackets = (SnapshotSize+MaxSize-1)/MaxSize;
+				m_Profiler.End(CTickProfiler::PHASE_SNAP_COMPRESS);
+				m_Metrics.m_Values.m_aSnapshotBytes[i] += SnapshotSize;
+				m_Bandwidth.AddSnapshot(i, SnapshotSize);
 
+				m_Profiler.Begin(CTickProfiler::PHASE_SNAP_SEND);
+
+				// only what got out counts against the budget
+				int Bytes = 0;
 				for(int n = 0, Left = SnapshotSize; Left; n++)
 				{
 					int Chunk = Left < MaxSize ? Left : MaxSize;
 					Left -= Chunk;
 
+					// the header ints take 5 bytes at most each
+					CPacker Packer;
 					if(NumPackets == 1)
 					{
-						CMsgPacker Msg(NETMSG_SNAPSINGLE);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
+						if(!BeginMsg(&Packer, NETMSG_SNAPSINGLE, i, MSGFLAG_FLUSH, Chunk+4*5))
+							continue;
+						Packer.AddInt(m_CurrentGameTick);
+						Packer.AddInt(m_CurrentGameTick-DeltaTick);
+						Packer.AddInt(Crc);
+						Packer.AddInt(Chunk);
 					}
 					else
 					{
-						CMsgPacker Msg(NETMSG_SNAP);
-						Msg.AddInt(m_CurrentGameTick);
-						Msg.AddInt(m_CurrentGameTick-DeltaTick);
-						Msg.AddInt(NumPackets);
-						Msg.AddInt(n);
-						Msg.AddInt(Crc);
-						Msg.AddInt(Chunk);
-						Msg.AddRaw(&aCompData[n*MaxSize], Chunk);
-						SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
+						if(!BeginMsg(&Packer, NETMSG_SNAP, i, MSGFLAG_FLUSH, Chunk+6*5))
+							continue;
+						Packer.AddInt(m_CurrentGameTick);
+						Packer.AddInt(m_CurrentGameTick-DeltaTick);
+						Packer.AddInt(NumPackets);
+						Packer.AddInt(n);
+						Packer.AddInt(Crc);
+						Packer.AddInt(Chunk);
 					}
+					Packer.AddRaw(&aCompData[n*MaxSize], Chunk);
+					if(EndMsg(&Packer, i, MSGFLAG_FLUSH, true) == 0)
+						Bytes += Packer.Size();
 				}
+				m_Profiler.End(CTickProfiler::PHASE_SNAP_SEND);
+				m_aClients[i].m_SnapControl.OnSent(Tick(), Bytes, g_Config.m_SvSnapBudget);
 			}
 			else
 			{
-				CMsgPacker Msg(NETMSG_SNAPEMPTY);
-				Msg.AddInt(m_CurrentGameTick);
-				Msg.AddInt(m_CurrentGameTick-DeltaTick);
-				SendMsgEx(&Msg, MSGFLAG_FLUSH, i, true);
+				m_Profiler.Begin(CTickProfiler::PHASE_SNAP_SEND);
+				CPacker Packer;
+				int Bytes = 0;
+				if(BeginMsg(&Packer, NETMSG_SNAPEMPTY, i, MSGFLAG_FLUSH, 2*5))
+				{
+					Packer.AddInt(m_CurrentGameTick);
+					Packer.AddInt(m_CurrentGameTick-DeltaTick);
+					if(EndMsg(&Packer, i, MSGFLAG_FLUSH, true) == 0)
+						Bytes = Packer.Size();
+				}
+				m_Profiler.End(CTickProfiler::PHASE_SNAP_SEND);
+				m_aClients[i].m_SnapControl.OnSent(Tick(), Bytes, g_Config.m_SvSnapBudget);
 			}
 		}
 	}
 
+	m_Profiler.Begin(CTickProfiler::PHASE_SNAP_BUILD);
 	GameServer()->OnPostSnap();
+	m_Profiler.End(CTickProfiler::PHASE_SNAP_BUILD);
 }
 
 
@@ -698,6 +837,7 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_AUTH;
+	pThis->ExpireServerInfo();
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
@@ -705,6 +845,8 @@ int CServer::NewClientCallback(int ClientID, void *pUser)
 	pThis->m_aClients[ClientID].m_AuthTries = 0;
 	pThis->m_aClients[ClientID].m_pRconCmdToSend = 0;
 	pThis->m_aClients[ClientID].Reset();
+	pThis->m_aClients[ClientID].m_SnapControl.m_Limit = 0;
+	pThis->m_Metrics.m_Values.m_aSnapshotBytes[ClientID] = 0;
 	return 0;
 }
 
@@ -720,9 +862,13 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 
 	// notify the mod about the drop
 	if(pThis->m_aClients[ClientID].m_State >= CClient::STATE_READY)
+	{
+		pThis->m_InputRecorder.RecordDrop(ClientID, pReason);
 		pThis->GameServer()->OnClientDrop(ClientID, pReason);
+	}
 
 	pThis->m_aClients[ClientID].m_State = CClient::STATE_EMPTY;
+	pThis->ExpireServerInfo();
 	pThis->m_aClients[ClientID].m_aName[0] = 0;
 	pThis->m_aClients[ClientID].m_aClan[0] = 0;
 	pThis->m_aClients[ClientID].m_Country = -1;
@@ -730,6 +876,7 @@ int CServer::DelClientCallback(int ClientID, const char *pReason, void *pUser)
 	pThis->m_aClients[ClientID].m_AuthTries = 0;
 	pThis->m_aClients[ClientID].m_pRconCmdToSend = 0;
 	pThis->m_aClients[ClientID].m_Snapshots.PurgeAll();
+	pThis->m_Metrics.m_Values.m_aSnapshotBytes[ClientID] = -1;
 	return 0;
 }
 
@@ -758,11 +905,10 @@ void CServer::SendRconLine(int ClientID, const char *pLine)
 void CServer::SendRconLineAuthed(const char *pLine, void *pUser)
 {
 	CServer *pThis = (CServer *)pUser;
-	static volatile int ReentryGuard = 0;
 	int i;
 
-	if(ReentryGuard) return;
-	ReentryGuard++;
+	if(pThis->m_RconLineReentryGuard) return;
+	pThis->m_RconLineReentryGuard++;
 
 	for(i = 0; i < MAX_CLIENTS; i++)
 	{
@@ -770,7 +916,7 @@ void CServer::SendRconLineAuthed(const char *pLine, void *pUser)
 			pThis->SendRconLine(i, pLine);
 	}
 
-	ReentryGuard--;
+	pThis->m_RconLineReentryGuard--;
 }
 
 void CServer::SendRconCmdAdd(const IConsole::CCommandInfo *pCommandInfo, int ClientID)
@@ -899,7 +1045,9 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player is ready. ClientID=%x addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_READY;
+				m_InputRecorder.RecordConnect(ClientID, m_aClients[ClientID].m_CustClt);
 				GameServer()->OnClientConnected(ClientID);
+				ExpireServerInfo();
 				SendConnectionReady(ClientID);
 			}
 		}
@@ -914,6 +1062,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				str_format(aBuf, sizeof(aBuf), "player has entered the game. ClientID=%x addr=%s", ClientID, aAddrStr);
 				Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 				m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+				m_InputRecorder.RecordEnter(ClientID);
 				GameServer()->OnClientEnter(ClientID);
 			}
 		}
@@ -931,7 +1080,10 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				return;
 
 			if(m_aClients[ClientID].m_LastAckedSnapshot > 0)
+			{
 				m_aClients[ClientID].m_SnapRate = CClient::SNAPRATE_FULL;
+				m_aClients[ClientID].m_SnapControl.OnAck(Tick(), m_aClients[ClientID].m_LastAckedSnapshot);
+			}
 
 			if(m_aClients[ClientID].m_Snapshots.Get(m_aClients[ClientID].m_LastAckedSnapshot, &TagTime, 0, 0) >= 0)
 				m_aClients[ClientID].m_Latency = (int)(((time_get()-TagTime)*1000)/time_freq());
@@ -964,6 +1116,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 
 			m_aClients[ClientID].m_CurrentInput++;
 			m_aClients[ClientID].m_CurrentInput %= 200;
+			m_InputRecorder.RecordInput(ClientID, m_aClients[ClientID].m_Latency, m_aClients[ClientID].m_LatestInput.m_aData);
 
 			// call the mod with the fresh input data
 			if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
@@ -978,6 +1131,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 				char aBuf[256];
 				str_format(aBuf, sizeof(aBuf), "ClientID=%d rcon='%s'", ClientID, pCmd);
 				Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aBuf);
+				m_InputRecorder.RecordCommand(ClientID, m_aClients[ClientID].m_Authed, pCmd);
 				m_RconClientID = ClientID;
 				m_RconAuthLevel = m_aClients[ClientID].m_Authed;
 				Console()->SetAccessLevel(m_aClients[ClientID].m_Authed == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : m_aClients[ClientID].m_Authed == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD : IConsole::ACCESS_LEVEL_USER);
@@ -1019,6 +1173,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 		            if (GServer->m_apPlayers[ClientID])
 					    GServer->CreateText(GServer->GetPlayerChar(ClientID), true, vec2(0, -85), vec2(0, 0), 600, "welcome");*/
 					
+					m_InputRecorder.RecordAuth(ClientID, AUTHED_ADMIN);
 					GameServer()->OnSetAuthed(ClientID, AUTHED_ADMIN);
 				}
 				else if(g_Config.m_SvRconModPassword[0] && str_comp(pPw, g_Config.m_SvRconModPassword) == 0)
@@ -1037,6 +1192,7 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 					str_format(aBuf, sizeof(aBuf), "ClientID=%d authed (moderator)", ClientID);
 					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 					
+					m_InputRecorder.RecordAuth(ClientID, AUTHED_MOD);
 					GameServer()->OnSetAuthed(ClientID, AUTHED_MOD);
 				}
 				else if(g_Config.m_SvRconMaxTries)
@@ -1090,13 +1246,15 @@ void CServer::ProcessClientPacket(CNetChunk *pPacket)
 	{
 		// game message
 		if(m_aClients[ClientID].m_State >= CClient::STATE_READY)
+		{
+			m_InputRecorder.RecordMessage(ClientID, pPacket->m_pData, pPacket->m_DataSize);
 			GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
 	}
 }
 
-void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
+void CServer::BuildServerInfo()
 {
-	CNetChunk Packet;
 	CPacker p;
 	char aBuf[128];
 
@@ -1115,10 +1273,6 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
 
 	p.Reset();
 
-	p.AddRaw(SERVERBROWSE_INFO, sizeof(SERVERBROWSE_INFO));
-	str_format(aBuf, sizeof(aBuf), "%d", Token);
-	p.AddString(aBuf, 6);
-
 	p.AddString(GameServer()->Version(), 32);
 	p.AddString(g_Config.m_SvName, 64);
 	p.AddString(GetMapName(), 32);
@@ -1150,16 +1304,44 @@ void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
 		}
 	}
 
+	m_ServerInfoCacheSize = min(p.Size(), (int)sizeof(m_aServerInfoCache));
+	mem_copy(m_aServerInfoCache, p.Data(), m_ServerInfoCacheSize);
+	m_ServerInfoCacheValid = true;
+}
+
+void CServer::ExpireServerInfo()
+{
+	m_ServerInfoCacheValid = false;
+}
+
+void CServer::SendServerInfo(const NETADDR *pAddr, int Token)
+{
+	if(!m_ServerInfoCacheValid)
+		BuildServerInfo();
+
+	// header and token are the only parts that differ between requests
+	unsigned char aData[NET_MAX_PAYLOAD];
+	int Size = sizeof(SERVERBROWSE_INFO);
+	mem_copy(aData, SERVERBROWSE_INFO, Size);
+	str_format((char *)aData+Size, 6, "%d", Token);
+	Size += str_length((char *)aData+Size)+1;
+
+	int BodySize = min(m_ServerInfoCacheSize, (int)sizeof(aData)-Size);
+	mem_copy(aData+Size, m_aServerInfoCache, BodySize);
+	Size += BodySize;
+
+	CNetChunk Packet;
 	Packet.m_ClientID = -1;
 	Packet.m_Address = *pAddr;
 	Packet.m_Flags = NETSENDFLAG_CONNLESS;
-	Packet.m_DataSize = p.Size();
-	Packet.m_pData = p.Data();
+	Packet.m_DataSize = Size;
+	Packet.m_pData = aData;
 	m_NetServer.Send(&Packet);
 }
 
 void CServer::UpdateServerInfo()
 {
+	ExpireServerInfo();
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
 		if(m_aClients[i].m_State != CClient::STATE_EMPTY)
@@ -1231,6 +1413,7 @@ int CServer::LoadMap(const char *pMapName)
 
 	// stop recording when we change map
 	m_DemoRecorder.Stop();
+	m_InputRecorder.Stop();
 
 	// reinit snapshot ids
 	m_IDPool.TimeoutIDs();
@@ -1244,15 +1427,19 @@ int CServer::LoadMap(const char *pMapName)
 	str_copy(m_aCurrentMap, pMapName, sizeof(m_aCurrentMap));
 	//map_set(df);
 
-	// load complete map into memory for download
+	// load complete map into memory for download, shared maps already have it
+	if(m_pCurrentMapData && m_OwnCurrentMapData)
+		mem_free((void *)m_pCurrentMapData);
+	m_pCurrentMapData = m_pMap->FileData(&m_CurrentMapSize);
+	m_OwnCurrentMapData = !m_pCurrentMapData;
+	if(m_OwnCurrentMapData)
 	{
 		IOHANDLE File = Storage()->OpenFile(aBuf, IOFLAG_READ, IStorage::TYPE_ALL);
 		m_CurrentMapSize = (int)io_length(File);
-		if(m_pCurrentMapData)
-			mem_free(m_pCurrentMapData);
-		m_pCurrentMapData = (unsigned char *)mem_alloc(m_CurrentMapSize, 1);
-		io_read(File, m_pCurrentMapData, m_CurrentMapSize);
+		unsigned char *pData = (unsigned char *)mem_alloc(m_CurrentMapSize, 1);
+		io_read(File, pData, m_CurrentMapSize);
 		io_close(File);
+		m_pCurrentMapData = pData;
 	}
 	return 1;
 }
@@ -1262,7 +1449,23 @@ void CServer::InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterS
 	m_Register.Init(pNetServer, pMasterServer, pConsole);
 }
 
-int CServer::Run()
+int64 CServer::AlignedStartTime()
+{
+	int64 Now = time_get();
+	if(!m_TickEpoch)
+		return Now;
+
+	// start on the common tick grid, so servers sharing a thread tick together
+	int64 Ticks = (Now-m_TickEpoch)*SERVER_TICK_SPEED/time_freq();
+	return m_TickEpoch + Ticks*time_freq()/SERVER_TICK_SPEED;
+}
+
+int64 CServer::NextTickTime()
+{
+	return TickStartTime(m_CurrentGameTick+1);
+}
+
+int CServer::Start()
 {
 	//
 	m_PrintCBIndex = Console()->RegisterPrintCallback(g_Config.m_ConsoleOutputLevel, SendRconLineAuthed, this);
@@ -1298,11 +1501,31 @@ int CServer::Run()
 	m_NetServer.SetCallbacks(NewClientCallback, DelClientCallback, this);
 
 	m_Econ.Init(Console(), &m_ServerBan);
+	m_Econ.SetExecuteCallback(EconExecuteCallback, this);
 
 	char aBuf[256];
+	if(g_Config.m_SvMetricsPort)
+	{
+		if(g_Config.m_SvMetricsBindaddr[0] && net_host_lookup(g_Config.m_SvMetricsBindaddr, &BindAddr, NETTYPE_ALL) == 0)
+			BindAddr.type = NETTYPE_ALL;
+		else
+		{
+			mem_zero(&BindAddr, sizeof(BindAddr));
+			BindAddr.type = NETTYPE_ALL;
+		}
+		BindAddr.port = g_Config.m_SvMetricsPort;
+
+		if(m_Metrics.Listen(BindAddr))
+			str_format(aBuf, sizeof(aBuf), "serving metrics on %s:%d", g_Config.m_SvMetricsBindaddr, g_Config.m_SvMetricsPort);
+		else
+			str_format(aBuf, sizeof(aBuf), "couldn't open the metrics port %d", g_Config.m_SvMetricsPort);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+
 	str_format(aBuf, sizeof(aBuf), "server name is '%s'", g_Config.m_SvName);
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
 
+	StartInputRecord();
 	GameServer()->OnInit();
 	str_format(aBuf, sizeof(aBuf), "version %s", GameServer()->NetVersion());
 	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
@@ -1311,126 +1534,245 @@ int CServer::Run()
 	m_pConsole->StoreCommands(false);
 
 	// start game
+	m_ReportTime = time_get();
+	m_Lastheartbeat = 0;
+	m_GameStartTime = AlignedStartTime();
+
+	if(g_Config.m_Debug)
 	{
-		int64 ReportTime = time_get();
-		int ReportInterval = 3;
+		str_format(aBuf, sizeof(aBuf), "baseline memory usage %dk", mem_stats()->allocated/1024);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
+	}
 
-		m_Lastheartbeat = 0;
-		m_GameStartTime = time_get();
+	return 0;
+}
 
-		if(g_Config.m_Debug)
-		{
-			str_format(aBuf, sizeof(aBuf), "baseline memory usage %dk", mem_stats()->allocated/1024);
-			Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "server", aBuf);
-		}
+void CServer::Update()
+{
+	int64 t = time_get();
+	int NewTicks = 0;
+
+	m_Profiler.BeginUpdate(g_Config.m_SvPerf != 0);
+
+	// load new map TODO: don't poll this
+	if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload)
+	{
+		m_MapReload = 0;
 
-		while(m_RunServer)
+		// load map
+		if(LoadMap(g_Config.m_SvMap))
 		{
-			int64 t = time_get();
-			int NewTicks = 0;
+			// new map loaded
+			GameServer()->OnShutdown();
 
-			// load new map TODO: don't poll this
-			if(str_comp(g_Config.m_SvMap, m_aCurrentMap) != 0 || m_MapReload)
+			for(int c = 0; c < MAX_CLIENTS; c++)
 			{
-				m_MapReload = 0;
-
-				// load map
-				if(LoadMap(g_Config.m_SvMap))
-				{
-					// new map loaded
-					GameServer()->OnShutdown();
+				if(m_aClients[c].m_State <= CClient::STATE_AUTH)
+					continue;
 
-					for(int c = 0; c < MAX_CLIENTS; c++)
-					{
-						if(m_aClients[c].m_State <= CClient::STATE_AUTH)
-							continue;
+				SendMap(c);
+				m_aClients[c].Reset();
+				m_aClients[c].m_State = CClient::STATE_CONNECTING;
+			}
 
-						SendMap(c);
-						m_aClients[c].Reset();
-						m_aClients[c].m_State = CClient::STATE_CONNECTING;
-					}
+			m_GameStartTime = AlignedStartTime();
+			m_CurrentGameTick = 0;
+			Kernel()->ReregisterInterface(GameServer());
+			StartInputRecord();
+			GameServer()->OnInit();
+			UpdateServerInfo();
+		}
+		else
+		{
+			char aBuf[256];
+			str_format(aBuf, sizeof(aBuf), "failed to load map. mapname='%s'", g_Config.m_SvMap);
+			Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+			str_copy(g_Config.m_SvMap, m_aCurrentMap, sizeof(g_Config.m_SvMap));
+		}
+	}
 
-					m_GameStartTime = time_get();
-					m_CurrentGameTick = 0;
-					Kernel()->ReregisterInterface(GameServer());
-					GameServer()->OnInit();
-					UpdateServerInfo();
-				}
-				else
-				{
-					str_format(aBuf, sizeof(aBuf), "failed to load map. mapname='%s'", g_Config.m_SvMap);
-					Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
-					str_copy(g_Config.m_SvMap, m_aCurrentMap, sizeof(g_Config.m_SvMap));
-				}
-			}
+	while(t > TickStartTime(m_CurrentGameTick+1))
+	{
+		m_CurrentGameTick++;
+		NewTicks++;
 
-			while(t > TickStartTime(m_CurrentGameTick+1))
+		// apply new input
+		m_Profiler.Begin(CTickProfiler::PHASE_INPUT);
+		for(int c = 0; c < MAX_CLIENTS; c++)
+		{
+			if(m_aClients[c].m_State == CClient::STATE_EMPTY)
+				continue;
+			for(int i = 0; i < 200; i++)
 			{
-				m_CurrentGameTick++;
-				NewTicks++;
-
-				// apply new input
-				for(int c = 0; c < MAX_CLIENTS; c++)
+				if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
 				{
-					if(m_aClients[c].m_State == CClient::STATE_EMPTY)
-						continue;
-					for(int i = 0; i < 200; i++)
+					if(m_aClients[c].m_State == CClient::STATE_INGAME)
 					{
-						if(m_aClients[c].m_aInputs[i].m_GameTick == Tick())
-						{
-							if(m_aClients[c].m_State == CClient::STATE_INGAME)
-								GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
-							break;
-						}
+						m_InputRecorder.AddTickInput(c, m_aClients[c].m_aInputs[i].m_aData);
+						GameServer()->OnClientPredictedInput(c, m_aClients[c].m_aInputs[i].m_aData);
 					}
+					break;
 				}
-
-				GameServer()->OnTick();
 			}
+		}
 
-			// snap game
-			if(NewTicks)
-			{
-				if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
-					DoSnapshot();
+		m_Profiler.End(CTickProfiler::PHASE_INPUT);
+		m_InputRecorder.RecordTick();
 
-				UpdateClientRconCommands();
-			}
+		m_Profiler.Begin(CTickProfiler::PHASE_TICK);
+		GameServer()->OnTick();
+		m_Profiler.End(CTickProfiler::PHASE_TICK);
 
-			// master server stuff
-			m_Register.RegisterUpdate(m_NetServer.NetType());
+		if(m_InputRecorder.IsRecording() && Tick()%CInputRecord::CHECKSUM_INTERVAL == 0)
+			m_InputRecorder.RecordChecksum(Tick(), SnapChecksum());
+	}
 
-			PumpNetwork();
+	// snap game
+	if(NewTicks)
+	{
+		if(g_Config.m_SvHighBandwidth || (m_CurrentGameTick%2) == 0)
+		{
+			m_InputRecorder.RecordSnap();
+			m_Profiler.Begin(CTickProfiler::PHASE_SNAP);
+			DoSnapshot();
+			m_Profiler.End(CTickProfiler::PHASE_SNAP);
+		}
 
-			if(ReportTime < time_get())
-			{
-				if(g_Config.m_Debug)
-				{
-					/*
-					static NETSTATS prev_stats;
-					NETSTATS stats;
-					netserver_stats(net, &stats);
+		UpdateClientRconCommands();
+	}
 
-					perf_next();
+	// master server stuff
+	m_Profiler.Begin(CTickProfiler::PHASE_REGISTER);
+	m_Register.RegisterUpdate(m_NetServer.NetType());
+	m_Profiler.End(CTickProfiler::PHASE_REGISTER);
 
-					if(config.dbg_pref)
-						perf_dump(&rootscope);
+	m_Profiler.Begin(CTickProfiler::PHASE_NETWORK);
+	PumpNetwork();
+	m_Profiler.End(CTickProfiler::PHASE_NETWORK);
 
-					dbg_msg("server", "send=%8d recv=%8d",
-						(stats.send_bytes - prev_stats.send_bytes)/reportinterval,
-						(stats.recv_bytes - prev_stats.recv_bytes)/reportinterval);
+	m_Profiler.EndUpdate(NewTicks);
+	m_Bandwidth.Update();
 
-					prev_stats = stats;
-					*/
-				}
+	if(m_MetricsTime < time_get())
+	{
+		PublishMetrics();
+		m_MetricsTime = time_get()+time_freq();
+	}
 
-				ReportTime += time_freq()*ReportInterval;
-			}
+	if(m_ReportTime < time_get())
+	{
+		if(g_Config.m_SvPerf && g_Config.m_SvPerfReport)
+			PrintPerfSummary();
+		m_ReportTime = time_get()+time_freq()*max(g_Config.m_SvPerfReport, 1);
+	}
+}
 
-			// wait for incomming data
-			net_socket_read_wait(m_NetServer.Socket(), 5);
-		}
+void CServer::PrintPerfSummary()
+{
+	CTickProfiler::CPhaseStats Update, Tick, Snap, Network;
+	m_Profiler.GetStats(CTickProfiler::PHASE_UPDATE, &Update);
+	m_Profiler.GetStats(CTickProfiler::PHASE_TICK, &Tick);
+	m_Profiler.GetStats(CTickProfiler::PHASE_SNAP, &Snap);
+	m_Profiler.GetStats(CTickProfiler::PHASE_NETWORK, &Network);
+	int Updates, Overruns, OverrunTicks;
+	m_Profiler.GetOverruns(&Updates, &Overruns, &OverrunTicks);
+	if(!Updates)
+		return;
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "update p50=%.2fms p99=%.2fms max=%.2fms, tick p99=%.2fms, snap p99=%.2fms, network p99=%.2fms, overruns=%d/%d (%d ticks)",
+		Update.m_P50, Update.m_P99, Update.m_Max, Tick.m_P99, Snap.m_P99, Network.m_P99, Overruns, Updates, OverrunTicks);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+}
+
+void CServer::PrintPerfTable()
+{
+	char aBuf[256];
+	int Updates, Overruns, OverrunTicks;
+	m_Profiler.GetOverruns(&Updates, &Overruns, &OverrunTicks);
+	str_format(aBuf, sizeof(aBuf), "last %ds: %d updates with ticks, %d overruns running %d extra ticks",
+		m_Profiler.WindowSeconds(), Updates, Overruns, OverrunTicks);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "phase          count     avg     p50     p90     p99     max (ms)");
+
+	for(int p = 0; p < CTickProfiler::NUM_PHASES; p++)
+	{
+		CTickProfiler::CPhaseStats Stats;
+		m_Profiler.GetStats(p, &Stats);
+
+		char aName[32];
+		str_format(aName, sizeof(aName), "%*s%s", CTickProfiler::PhaseDepth(p)*2, "", CTickProfiler::PhaseName(p));
+		str_format(aBuf, sizeof(aBuf), "%-12s %7d %7.3f %7.3f %7.3f %7.3f %7.3f", aName, Stats.m_Count,
+			Stats.m_Avg, Stats.m_P50, Stats.m_P90, Stats.m_P99, Stats.m_Max);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", aBuf);
 	}
+}
+
+void CServer::PublishMetrics()
+{
+	CMetrics::CValues *pValues = &m_Metrics.m_Values;
+
+	NETSTATS NetStats;
+	net_stats(&NetStats);
+	pValues->m_aValues[CMetrics::PACKETS_RECEIVED] = (unsigned)NetStats.recv_packets;
+	pValues->m_aValues[CMetrics::PACKETS_SENT] = (unsigned)NetStats.sent_packets;
+	pValues->m_aValues[CMetrics::BYTES_RECEIVED] = (unsigned)NetStats.recv_bytes;
+	pValues->m_aValues[CMetrics::BYTES_SENT] = (unsigned)NetStats.sent_bytes;
+	pValues->m_aValues[CMetrics::RESENDS] = m_NetServer.NumResends();
+	pValues->m_aValues[CMetrics::BAN_HITS] = m_NetServer.NumBanHits();
+	pValues->m_aValues[CMetrics::CONNLESS_REQUESTS] = m_NetServer.NumConnless();
+
+	int Clients = 0, Players = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(m_aClients[i].m_State != CClient::STATE_EMPTY)
+			Clients++;
+		if(m_aClients[i].m_State == CClient::STATE_INGAME)
+			Players++;
+	}
+	pValues->m_aValues[CMetrics::CLIENTS] = Clients;
+	pValues->m_aValues[CMetrics::PLAYERS] = Players;
+
+	const MEMSTATS *pMemStats = mem_stats();
+	pValues->m_aValues[CMetrics::MEMORY_ALLOCATED] = pMemStats->allocated;
+	pValues->m_aValues[CMetrics::MEMORY_ALLOCATIONS] = pMemStats->active_allocations;
+	pValues->m_aValues[CMetrics::MEMORY_ALLOCATIONS_TOTAL] = pMemStats->total_allocations;
+
+	for(int p = 0; p < CTickProfiler::NUM_PHASES; p++)
+	{
+		CTickProfiler::CPhaseStats Stats;
+		m_Profiler.GetStats(p, &Stats);
+		pValues->m_aaPhaseTimes[p][CMetrics::QUANTILE_P50] = (int)(Stats.m_P50*1000.0f);
+		pValues->m_aaPhaseTimes[p][CMetrics::QUANTILE_P90] = (int)(Stats.m_P90*1000.0f);
+		pValues->m_aaPhaseTimes[p][CMetrics::QUANTILE_P99] = (int)(Stats.m_P99*1000.0f);
+		pValues->m_aaPhaseTimes[p][CMetrics::QUANTILE_MAX] = (int)(Stats.m_Max*1000.0f);
+	}
+
+	pValues->m_NumEntityTypes = GameServer()->CountEntities(pValues->m_aEntities, pValues->m_apEntityNames, CMetrics::MAX_ENTITY_TYPES);
+
+	for(int t = 0; t < CBandwidthStats::MAX_ITEM_TYPES; t++)
+	{
+		pValues->m_aItemRates[t] = m_Bandwidth.ItemRate(t);
+		pValues->m_apItemNames[t] = GameServer()->NetObjName(t);
+	}
+	for(int m = 0; m < CBandwidthStats::MAX_MSG_TYPES; m++)
+	{
+		pValues->m_aaMsgRates[0][m] = m_Bandwidth.MsgRate(m, false);
+		pValues->m_aapMsgNames[0][m] = GameServer()->NetMsgName(m);
+		pValues->m_aaMsgRates[1][m] = m_Bandwidth.MsgRate(m, true);
+		pValues->m_aapMsgNames[1][m] = CBandwidthStats::SystemMsgName(m);
+	}
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		for(int k = 0; k < CBandwidthStats::NUM_KINDS; k++)
+			pValues->m_aaClientRates[i][k] = m_Bandwidth.ClientRate(i, k);
+	}
+
+	m_Metrics.Publish();
+}
+
+void CServer::Shutdown()
+{
 	// disconnect all clients on shutdown
 	for(int i = 0; i < MAX_CLIENTS; ++i)
 	{
@@ -1440,14 +1782,250 @@ int CServer::Run()
 		m_Econ.Shutdown();
 	}
 
+	m_InputRecorder.Stop();
+	m_Metrics.Close();
 	GameServer()->OnShutdown();
 	m_pMap->Unload();
 
-	if(m_pCurrentMapData)
-		mem_free(m_pCurrentMapData);
+	if(m_pCurrentMapData && m_OwnCurrentMapData)
+		mem_free((void *)m_pCurrentMapData);
+	m_pCurrentMapData = 0;
+}
+
+int CServer::Run()
+{
+	if(Start() != 0)
+		return -1;
+
+	while(m_RunServer)
+	{
+		Update();
+
+		// wait for incomming data
+		net_socket_read_wait(m_NetServer.Socket(), 5);
+	}
+
+	Shutdown();
 	return 0;
 }
 
+void CServer::StartInputRecord()
+{
+	if(!g_Config.m_SvInputRecord)
+		return;
+
+	// the game draws from rand(), a replay has to start from the same seed
+	unsigned Seed = (unsigned)time_timestamp();
+	srand(Seed);
+
+	char aFilename[128];
+	char aDate[20];
+	str_timestamp(aDate, sizeof(aDate));
+	str_format(aFilename, sizeof(aFilename), "replays/%s_%s.rec", m_aCurrentMap, aDate);
+	Storage()->CreateFolder("replays", IStorage::TYPE_SAVE);
+	m_InputRecorder.Start(Storage(), aFilename, m_aCurrentMap, m_CurrentMapCrc, Seed, m_NetServer.MaxClients());
+}
+
+unsigned CServer::SnapChecksum()
+{
+	char aData[CSnapshot::MAX_SIZE];
+	CSnapshot *pSnap = (CSnapshot *)aData;
+	m_SnapshotBuilder.Init();
+	GameServer()->OnSnap(-1);
+	m_SnapshotBuilder.Finish(pSnap);
+
+	// the item ids are left out, they are given out again after a timeout
+	unsigned Crc = crc32(0L, 0x0, 0); // ignore_convention
+	for(int i = 0; i < pSnap->NumItems(); i++)
+	{
+		CSnapshotItem *pItem = pSnap->GetItem(i);
+		int Type = pItem->Type();
+		Crc = crc32(Crc, (const Bytef *)&Type, sizeof(Type)); // ignore_convention
+		Crc = crc32(Crc, (const Bytef *)pItem->Data(), pSnap->GetItemSize(i)); // ignore_convention
+	}
+	return Crc;
+}
+
+void CServer::ReplayEvent(const CInputRecordReader::CEvent *pEvent, CInputRecordReader *pReader)
+{
+	int ClientID = pEvent->m_ClientID;
+	switch(pEvent->m_Type)
+	{
+	case CInputRecord::EVENT_CONNECT:
+		NewClientCallback(ClientID, this);
+		m_aClients[ClientID].m_State = CClient::STATE_READY;
+		m_aClients[ClientID].m_CustClt = pEvent->m_CustClt;
+		GameServer()->OnClientConnected(ClientID);
+		break;
+	case CInputRecord::EVENT_ENTER:
+		if(m_aClients[ClientID].m_State == CClient::STATE_READY && GameServer()->IsClientReady(ClientID))
+		{
+			m_aClients[ClientID].m_State = CClient::STATE_INGAME;
+			GameServer()->OnClientEnter(ClientID);
+		}
+		break;
+	case CInputRecord::EVENT_DROP:
+		// clients kicked by the game are gone already
+		if(m_aClients[ClientID].m_State != CClient::STATE_EMPTY)
+			DelClientCallback(ClientID, pEvent->m_pString, this);
+		break;
+	case CInputRecord::EVENT_INPUT:
+		m_aClients[ClientID].m_Latency = pEvent->m_Latency;
+		mem_copy(m_aClients[ClientID].m_LatestInput.m_aData, pReader->DirectInput(ClientID), MAX_INPUT_SIZE*sizeof(int));
+		if(m_aClients[ClientID].m_State == CClient::STATE_INGAME)
+			GameServer()->OnClientDirectInput(ClientID, m_aClients[ClientID].m_LatestInput.m_aData);
+		break;
+	case CInputRecord::EVENT_MESSAGE:
+		{
+			CUnpacker Unpacker;
+			Unpacker.Reset(pEvent->m_pData, pEvent->m_DataSize);
+			int Msg = Unpacker.GetInt()>>1;
+			if(!Unpacker.Error() && m_aClients[ClientID].m_State >= CClient::STATE_READY)
+				GameServer()->OnMessage(Msg, &Unpacker, ClientID);
+		}
+		break;
+	case CInputRecord::EVENT_AUTH:
+		m_aClients[ClientID].m_Authed = pEvent->m_Level;
+		GameServer()->OnSetAuthed(ClientID, pEvent->m_Level);
+		break;
+	case CInputRecord::EVENT_COMMAND:
+		if(ClientID < 0)
+		{
+			Console()->ExecuteLine(pEvent->m_pString);
+			break;
+		}
+		m_RconClientID = ClientID;
+		m_RconAuthLevel = pEvent->m_Level;
+		Console()->SetAccessLevel(pEvent->m_Level == AUTHED_ADMIN ? IConsole::ACCESS_LEVEL_ADMIN : pEvent->m_Level == AUTHED_MOD ? IConsole::ACCESS_LEVEL_MOD : IConsole::ACCESS_LEVEL_USER);
+		Console()->ExecuteLineFlag(pEvent->m_pString, CFGFLAG_SERVER, ClientID);
+		Console()->SetAccessLevel(IConsole::ACCESS_LEVEL_ADMIN);
+		m_RconClientID = IServer::RCON_CID_SERV;
+		m_RconAuthLevel = AUTHED_ADMIN;
+		break;
+	}
+}
+
+int CServer::RunReplay(const char *pFilename)
+{
+	CInputRecordReader Reader;
+	if(!Reader.Load(Storage(), pFilename))
+		return -1;
+
+	m_Replaying = true;
+	m_ReplayMaxClients = Reader.MaxClients();
+	str_copy(g_Config.m_SvMap, Reader.MapName(), sizeof(g_Config.m_SvMap));
+	if(!LoadMap(Reader.MapName()))
+	{
+		dbg_msg("replay", "failed to load map. mapname='%s'", Reader.MapName());
+		return -1;
+	}
+	if(m_CurrentMapCrc != Reader.MapCrc())
+	{
+		dbg_msg("replay", "map crc is %08x but the record was made on %08x", m_CurrentMapCrc, Reader.MapCrc());
+		return -1;
+	}
+
+	srand(Reader.Seed());
+	GameServer()->OnInit();
+	m_pConsole->StoreCommands(false);
+	m_Profiler.Reset();
+
+	int Ticks = 0;
+	int Checksums = 0;
+	int Mismatches = 0;
+	unsigned LastChecksum = 0;
+	int64 StartTime = time_get();
+
+	CInputRecordReader::CEvent Event;
+	while(Reader.NextEvent(&Event))
+	{
+		if(Event.m_Type == CInputRecord::EVENT_TICK)
+		{
+			// a tick and the events up to the next one count as an update
+			if(Ticks)
+				m_Profiler.EndUpdate(1);
+			m_Profiler.BeginUpdate(true);
+			Ticks++;
+			m_CurrentGameTick++;
+
+			m_Profiler.Begin(CTickProfiler::PHASE_INPUT);
+			for(int i = 0; i < Event.m_NumInputs; i++)
+				GameServer()->OnClientPredictedInput(Event.m_pInputClients[i], Reader.Input(Event.m_pInputClients[i]));
+			m_Profiler.End(CTickProfiler::PHASE_INPUT);
+
+			m_Profiler.Begin(CTickProfiler::PHASE_TICK);
+			GameServer()->OnTick();
+			m_Profiler.End(CTickProfiler::PHASE_TICK);
+		}
+		else if(Event.m_Type == CInputRecord::EVENT_SNAP)
+		{
+			m_Profiler.Begin(CTickProfiler::PHASE_SNAP);
+			DoSnapshot();
+			m_Profiler.End(CTickProfiler::PHASE_SNAP);
+
+			// the clients ack every snapshot they got right away, the snapshot
+			// rate control may have skipped some of them this tick
+			for(int i = 0; i < MAX_CLIENTS; i++)
+			{
+				if(m_aClients[i].m_State != CClient::STATE_INGAME ||
+					m_aClients[i].m_Snapshots.Get(m_CurrentGameTick, 0, 0, 0) < 0)
+					continue;
+				m_aClients[i].m_LastAckedSnapshot = m_CurrentGameTick;
+				m_aClients[i].m_SnapRate = CClient::SNAPRATE_FULL;
+				m_aClients[i].m_SnapControl.OnAck(Tick(), m_CurrentGameTick);
+			}
+		}
+		else if(Event.m_Type == CInputRecord::EVENT_CHECKSUM)
+		{
+			LastChecksum = SnapChecksum();
+			Checksums++;
+			if(LastChecksum != Event.m_Checksum || m_CurrentGameTick != Event.m_Tick)
+			{
+				if(!Mismatches)
+					dbg_msg("replay", "diverged at tick %d: checksum %08x, recorded %08x at tick %d",
+						m_CurrentGameTick, LastChecksum, Event.m_Checksum, Event.m_Tick);
+				Mismatches++;
+			}
+		}
+		else
+		{
+			m_Profiler.Begin(CTickProfiler::PHASE_NETWORK);
+			ReplayEvent(&Event, &Reader);
+			m_Profiler.End(CTickProfiler::PHASE_NETWORK);
+		}
+	}
+	if(Ticks)
+		m_Profiler.EndUpdate(1);
+
+	float Seconds = max((time_get()-StartTime)/(float)time_freq(), 0.001f);
+	char aBuf[256];
+	if(Reader.Error())
+	{
+		str_format(aBuf, sizeof(aBuf), "record is broken after tick %d", m_CurrentGameTick);
+		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	}
+	str_format(aBuf, sizeof(aBuf), "%d ticks in %.2fs, %.0f ticks/s (%.1fx real time)",
+		Ticks, Seconds, Ticks/Seconds, Ticks/(Seconds*SERVER_TICK_SPEED));
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	str_format(aBuf, sizeof(aBuf), "%d checksums, %d mismatches, end state %08x", Checksums, Mismatches, LastChecksum);
+	Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "replay", aBuf);
+	PrintPerfTable();
+
+	GameServer()->OnShutdown();
+	m_pMap->Unload();
+	if(m_pCurrentMapData && m_OwnCurrentMapData)
+		mem_free((void *)m_pCurrentMapData);
+	m_pCurrentMapData = 0;
+
+	return (Mismatches || Reader.Error()) ? 1 : 0;
+}
+
+void CServer::EconExecuteCallback(const char *pLine, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	pThis->m_InputRecorder.RecordCommand(-1, AUTHED_ADMIN, pLine);
+}
+
 void CServer::ConKick(IConsole::IResult *pResult, void *pUser)
 {
 	if(pResult->NumArguments() > 1)
@@ -1485,6 +2063,162 @@ void CServer::ConStatus(IConsole::IResult *pResult, void *pUser)
 	}
 }
 
+void CServer::ConPerf(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	if(pResult->NumArguments() && str_comp(pResult->GetString(0), "reset") == 0)
+	{
+		pThis->m_Profiler.Reset();
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "statistics reset");
+		return;
+	}
+
+	if(!g_Config.m_SvPerf)
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "perf", "sv_perf is off, the statistics are not updated");
+
+	pThis->PrintPerfTable();
+}
+
+void CServer::ConMetrics(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+
+	CMetrics::CValues Values;
+	pThis->m_Metrics.Read(&Values);
+	CPacker Packer;
+	Packer.Reset();
+	CMetrics::Pack(&Values, &Packer);
+
+	// hex in lines short enough for the econ, numbered to put them together again
+	enum { LINE_BYTES=256 };
+	const unsigned char *pData = Packer.Data();
+	int NumLines = (Packer.Size()+LINE_BYTES-1)/LINE_BYTES;
+	for(int l = 0; l < NumLines; l++)
+	{
+		static const char s_aHex[] = "0123456789abcdef";
+		char aBuf[32+LINE_BYTES*2];
+		str_format(aBuf, sizeof(aBuf), "%d/%d ", l+1, NumLines);
+		int Length = str_length(aBuf);
+		for(int b = l*LINE_BYTES; b < min((l+1)*LINE_BYTES, Packer.Size()); b++)
+		{
+			aBuf[Length++] = s_aHex[pData[b]>>4];
+			aBuf[Length++] = s_aHex[pData[b]&0xf];
+		}
+		aBuf[Length] = 0;
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "metrics", aBuf);
+	}
+}
+
+void CServer::ConBandwidth(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	CBandwidthStats *pStats = &pThis->m_Bandwidth;
+
+	if(pResult->NumArguments() && str_comp(pResult->GetString(0), "reset") == 0)
+	{
+		pStats->Reset();
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", "statistics reset");
+		return;
+	}
+
+	int SnapshotRate = 0, MessageRate = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		SnapshotRate += pStats->ClientRate(i, CBandwidthStats::KIND_SNAPSHOT);
+		MessageRate += pStats->ClientRate(i, CBandwidthStats::KIND_MESSAGE);
+	}
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "last %ds: snapshots %d B/s, vital messages %d B/s%s", pStats->WindowSeconds(),
+		SnapshotRate, MessageRate, g_Config.m_SvBandwidthStats ? "" : " (sv_bandwidth_stats is off, no item types)");
+	pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+
+	// item types, the biggest first
+	int aOrder[CBandwidthStats::MAX_ITEM_TYPES];
+	int aRates[CBandwidthStats::MAX_ITEM_TYPES];
+	int NumItems = 0, ItemTotal = 0;
+	for(int t = 0; t < CBandwidthStats::MAX_ITEM_TYPES; t++)
+	{
+		int Rate = pStats->ItemRate(t);
+		if(!Rate)
+			continue;
+		int j = NumItems++;
+		for(; j > 0 && aRates[j-1] < Rate; j--)
+		{
+			aOrder[j] = aOrder[j-1];
+			aRates[j] = aRates[j-1];
+		}
+		aOrder[j] = t;
+		aRates[j] = Rate;
+		ItemTotal += Rate;
+	}
+	for(int i = 0; i < NumItems; i++)
+	{
+		str_format(aBuf, sizeof(aBuf), "item   %-20s %7d B/s %5.1f%%", pThis->GameServer()->NetObjName(aOrder[i]), aRates[i], aRates[i]*100.0f/ItemTotal);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+	}
+
+	for(int s = 0; s < 2; s++)
+	{
+		for(int m = 0; m < CBandwidthStats::MAX_MSG_TYPES; m++)
+		{
+			int Rate = pStats->MsgRate(m, s == 1);
+			if(!Rate)
+				continue;
+			str_format(aBuf, sizeof(aBuf), "%-6s %-20s %7d B/s", s ? "sysmsg" : "msg",
+				s ? CBandwidthStats::SystemMsgName(m) : pThis->GameServer()->NetMsgName(m), Rate);
+			pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+		}
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		int Snapshot = pStats->ClientRate(i, CBandwidthStats::KIND_SNAPSHOT);
+		int Message = pStats->ClientRate(i, CBandwidthStats::KIND_MESSAGE);
+		if(!Snapshot && !Message)
+			continue;
+		str_format(aBuf, sizeof(aBuf), "client %2d '%s' snapshots %d B/s, messages %d B/s", i, pThis->ClientName(i), Snapshot, Message);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "bandwidth", aBuf);
+	}
+}
+
+void CServer::ConSnapRate(IConsole::IResult *pResult, void *pUser)
+{
+	CServer *pThis = static_cast<CServer *>(pUser);
+	char aBuf[256];
+
+	int ClientID = -1;
+	if(pResult->NumArguments())
+	{
+		ClientID = pResult->GetInteger(0);
+		if(ClientID < 0 || ClientID >= MAX_CLIENTS || pThis->m_aClients[ClientID].m_State == CClient::STATE_EMPTY)
+		{
+			pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", "Invalid client id");
+			return;
+		}
+	}
+
+	if(pResult->NumArguments() > 1)
+	{
+		pThis->m_aClients[ClientID].m_SnapControl.m_Limit = clamp(pResult->GetInteger(1), 0, (int)CSnapRateControl::MAX_LIMIT);
+		str_format(aBuf, sizeof(aBuf), "limited client %d to one snapshot every %d ticks", ClientID, pThis->m_aClients[ClientID].m_SnapControl.m_Limit);
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+		return;
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(pThis->m_aClients[i].m_State != CClient::STATE_INGAME || (ClientID >= 0 && i != ClientID))
+			continue;
+		const CSnapRateControl *pControl = &pThis->m_aClients[i].m_SnapControl;
+		float Interval = g_Config.m_SvSnapAdaptive ? pControl->Interval(g_Config.m_SvSnapBudget) : (g_Config.m_SvHighBandwidth ? 1.0f : 2.0f);
+		str_format(aBuf, sizeof(aBuf), "id=%d name='%s' interval=%.2f snaps/s=%.1f limit=%d rtt=%dms backoffs=%d", i, pThis->ClientName(i),
+			Interval, SERVER_TICK_SPEED/max(Interval, g_Config.m_SvHighBandwidth ? 1.0f : 2.0f), pControl->m_Limit,
+			pControl->MinRtt()*1000/SERVER_TICK_SPEED, pControl->NumBackoffs());
+		pThis->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "server", aBuf);
+	}
+}
+
 void CServer::ConShutdown(IConsole::IResult *pResult, void *pUser)
 {
 	((CServer *)pUser)->m_RunServer = 0;
@@ -1632,9 +2366,14 @@ void CServer::RegisterCommands()
 	Console()->Register("stoprecord", "", CFGFLAG_SERVER, ConStopRecord, this, "Stop recording");
 
 	Console()->Register("reload", "", CFGFLAG_SERVER, ConMapReload, this, "Reload the map");
+	Console()->Register("perf", "?s", CFGFLAG_SERVER, ConPerf, this, "Show where the tick time goes ('reset' clears it)");
+	Console()->Register("metrics", "", CFGFLAG_SERVER, ConMetrics, this, "Dump the metrics packed as hex");
+	Console()->Register("bandwidth", "?s", CFGFLAG_SERVER, ConBandwidth, this, "Show where the outgoing bytes go ('reset' clears it)");
+	Console()->Register("snap_rate", "?ii", CFGFLAG_SERVER, ConSnapRate, this, "Show the snapshot rates or limit a client to one snapshot every n ticks (0 for no limit)");
 
 	Console()->Chain("sv_name", ConchainSpecialInfoupdate, this);
 	Console()->Chain("password", ConchainSpecialInfoupdate, this);
+	Console()->Chain("sv_spectator_slots", ConchainSpecialInfoupdate, this);
 
 	Console()->Chain("sv_max_clients_per_ip", ConchainMaxclientsperipUpdate, this);
 	Console()->Chain("mod_command", ConchainModCommandUpdate, this);
@@ -1671,6 +2410,52 @@ void CServer::SnapSetStaticsize(int ItemType, int Size)
 
 static CServer *CreateServer() { return new CServer(); }
 
+// runs a server for every --instance <config> given, see CServerHost
+static int RunHost(int argc, const char **argv) // ignore_convention
+{
+	int NumThreads = 2;
+	array<const char *> lpConfigs;
+	array<const char *> lpArgs;
+	lpArgs.add(argv[0]); // ignore_convention
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp("--instance", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			lpConfigs.add(argv[++i]); // ignore_convention
+		else if(str_comp("--host-threads", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			NumThreads = str_toint(argv[++i]); // ignore_convention
+		else
+			lpArgs.add(argv[i]); // ignore_convention
+	}
+
+	IEngine *pEngine = CreateEngine("Teeworlds");
+	CServerHost Host;
+	int Result = 0;
+	if(lpConfigs.size() == 0)
+	{
+		dbg_msg("host", "no server given. use --instance <config>");
+		Result = -1;
+	}
+
+	for(int i = 0; i < lpConfigs.size() && Result == 0; i++)
+	{
+		if(!Host.AddInstance(pEngine, lpConfigs[i], lpArgs.size(), lpArgs.base_ptr()))
+			Result = -1;
+	}
+
+	if(Result == 0)
+	{
+		// the logfile of the first server is used for all of them
+		Host.m_lpInstances[0]->Select();
+		pEngine->InitLogfile();
+		Result = Host.Run(NumThreads);
+	}
+
+	// the engine goes first, so no job still works on a server's data
+	delete pEngine;
+	return Result;
+}
+
 int main(int argc, const char **argv) // ignore_convention
 {
 #if defined(CONF_FAMILY_WINDOWS)
@@ -1684,6 +2469,23 @@ int main(int argc, const char **argv) // ignore_convention
 	}
 #endif
 
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp("--instance", argv[i]) == 0) // ignore_convention
+			return RunHost(argc, argv); // ignore_convention
+	}
+
+	// --replay <file> plays an input record back instead of running the server
+	const char *pReplayFile = 0;
+	array<const char *> lpArgs;
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp("--replay", argv[i]) == 0 && i+1 < argc) // ignore_convention
+			pReplayFile = argv[++i]; // ignore_convention
+		else
+			lpArgs.add(argv[i]); // ignore_convention
+	}
+
 	CServer *pServer = CreateServer();
 	IKernel *pKernel = IKernel::Create();
 
@@ -1731,8 +2533,8 @@ int main(int argc, const char **argv) // ignore_convention
 	pConsole->ExecuteFile("openfng.cfg");
 
 	// parse the command line arguments
-	if(argc > 1) // ignore_convention
-		pConsole->ParseArguments(argc-1, &argv[1]); // ignore_convention
+	if(lpArgs.size())
+		pConsole->ParseArguments(lpArgs.size(), lpArgs.base_ptr());
 
 	// restore empty config strings to their defaults
 	pConfig->RestoreStrings();
@@ -1740,10 +2542,17 @@ int main(int argc, const char **argv) // ignore_convention
 	pEngine->InitLogfile();
 
 	// run the server
-	dbg_msg("server", "starting...");
-	pServer->Run();
+	int Result = 0;
+	if(pReplayFile)
+		Result = pServer->RunReplay(pReplayFile);
+	else
+	{
+		dbg_msg("server", "starting...");
+		pServer->Run();
+	}
 
 	// free
+	delete pEngine;
 	delete pServer;
 	delete pKernel;
 	delete pEngineMap;
@@ -1752,6 +2561,6 @@ int main(int argc, const char **argv) // ignore_convention
 	delete pEngineMasterServer;
 	delete pStorage;
 	delete pConfig;
-	return 0;
+	return Result;
 }
 
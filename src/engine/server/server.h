@@ -10,12 +10,17 @@
 #include <engine/shared/protocol.h>
 #include <engine/shared/snapshot.h>
 #include <engine/shared/network.h>
+#include <engine/server/bandwidth.h>
+#include <engine/server/inputrecord.h>
+#include <engine/server/snaprate.h>
+#include <engine/server/metrics.h>
 #include <engine/server/register.h>
 
 #include <base/math.h>
 #include <engine/shared/mapchecker.h>
 #include <engine/shared/econ.h>
 #include <engine/shared/netban.h>
+#include <engine/shared/profiler.h>
 
 class CSnapIDPool
 {
@@ -117,6 +122,7 @@ public:
 		int m_State;
 		int m_Latency;
 		int m_SnapRate;
+		CSnapRateControl m_SnapControl;
 
 		int m_LastAckedSnapshot;
 		int m_LastInputTick;
@@ -155,20 +161,39 @@ public:
 	int m_RunServer;
 	int m_MapReload;
 	int m_RconClientID;
+
+	// the part of the server info that follows the token, built on demand
+	// and kept until ExpireServerInfo() gets called
+	unsigned char m_aServerInfoCache[NET_MAX_PAYLOAD];
+	int m_ServerInfoCacheSize;
+	bool m_ServerInfoCacheValid;
 	int m_RconAuthLevel;
 	int m_PrintCBIndex;
 
 	int64 m_Lastheartbeat;
+	int64 m_ReportTime;
+	int64 m_TickEpoch;
+	volatile int m_RconLineReentryGuard;
 	//static NETADDR4 master_server;
 
 	char m_aCurrentMap[64];
 	unsigned m_CurrentMapCrc;
-	unsigned char *m_pCurrentMapData;
+	const unsigned char *m_pCurrentMapData;
 	int m_CurrentMapSize;
+	bool m_OwnCurrentMapData;
 
 	CDemoRecorder m_DemoRecorder;
 	CRegister m_Register;
 	CMapChecker m_MapChecker;
+	CTickProfiler m_Profiler;
+	CInputRecorder m_InputRecorder;
+	CMetrics m_Metrics;
+	CBandwidthStats m_Bandwidth;
+	int64 m_MetricsTime;
+
+	// set while a record is played back, there is no network then
+	bool m_Replaying;
+	int m_ReplayMaxClients;
 
 	CServer();
 
@@ -198,11 +223,17 @@ public:
 	const char *ClientClan(int ClientID);
 	int ClientCountry(int ClientID);
 	bool ClientIngame(int ClientID);
+	int ClientLastAckedSnapshot(int ClientID);
 	int MaxClients() const;
 
 	virtual int SendMsg(CMsgPacker *pMsg, int Flags, int ClientID);
 	int SendMsgEx(CMsgPacker *pMsg, int Flags, int ClientID, bool System);
 
+	// packs a message straight into the packet of one client instead of copying
+	// it there, EndMsg sends what was packed between them
+	bool BeginMsg(CPacker *pPacker, int MsgID, int ClientID, int Flags, int MaxSize);
+	int EndMsg(CPacker *pPacker, int ClientID, int Flags, bool System);
+
 	void DoSnapshot();
 
 	static int NewClientCallback(int ClientID, void *pUser);
@@ -219,6 +250,8 @@ public:
 
 	void ProcessClientPacket(CNetChunk *pPacket);
 
+	void BuildServerInfo();
+	virtual void ExpireServerInfo();
 	void SendServerInfo(const NETADDR *pAddr, int Token);
 	void UpdateServerInfo();
 
@@ -228,11 +261,36 @@ public:
 	int LoadMap(const char *pMapName);
 
 	void InitRegister(CNetServer *pNetServer, IEngineMasterServer *pMasterServer, IConsole *pConsole);
+
+	// Run() is Start(), Update() until shutdown and Shutdown(). a host
+	// running several servers calls them itself and waits on the sockets
+	int Start();
+	void Update();
+	void Shutdown();
 	int Run();
 
+	// sets a time the game start gets aligned to, 0 to disable
+	void SetTickEpoch(int64 Epoch) { m_TickEpoch = Epoch; }
+	int64 AlignedStartTime();
+	int64 NextTickTime();
+
+	void PrintPerfSummary();
+	void PrintPerfTable();
+	void PublishMetrics();
+
+	void StartInputRecord();
+	unsigned SnapChecksum();
+	void ReplayEvent(const CInputRecordReader::CEvent *pEvent, CInputRecordReader *pReader);
+	int RunReplay(const char *pFilename);
+	static void EconExecuteCallback(const char *pLine, void *pUser);
+
 	static void ConKick(IConsole::IResult *pResult, void *pUser);
 	static void ConStatus(IConsole::IResult *pResult, void *pUser);
 	static void ConShutdown(IConsole::IResult *pResult, void *pUser);
+	static void ConPerf(IConsole::IResult *pResult, void *pUser);
+	static void ConMetrics(IConsole::IResult *pResult, void *pUser);
+	static void ConBandwidth(IConsole::IResult *pResult, void *pUser);
+	static void ConSnapRate(IConsole::IResult *pResult, void *pUser);
 	static void ConRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConStopRecord(IConsole::IResult *pResult, void *pUser);
 	static void ConMapReload(IConsole::IResult *pResult, void *pUser);
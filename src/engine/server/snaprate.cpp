@@ -0,0 +1,147 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <engine/shared/protocol.h>
+
+#include "snaprate.h"
+
+CSnapRateControl::CSnapRateControl()
+{
+	m_Limit = 0;
+	Reset();
+}
+
+void CSnapRateControl::Reset()
+{
+	m_Interval = 1.0f;
+	m_NextTick = 0.0f;
+	m_AvgBytes = 0.0f;
+	m_Tokens = 0;
+	m_TokenTick = -1;
+	for(int i = 0; i < SENT_HISTORY; i++)
+		m_aSentTicks[i] = -1;
+	m_SentIndex = 0;
+	m_LastAcked = -1;
+	m_MinRtt = -1;
+	m_NextMinRtt = -1;
+	m_RttWindowTick = 0;
+	m_CongestedInterval = 1.0f;
+	m_BackoffTick = -1;
+	m_HoldTick = 0;
+	m_DecayTick = 0;
+	m_LastResends = -1;
+	m_NumBackoffs = 0;
+}
+
+void CSnapRateControl::Backoff(int Tick, float Interval)
+{
+	if(Tick < m_HoldTick)
+		return;
+
+	m_CongestedInterval = m_Interval;
+	m_Interval = min(Interval, (float)MAX_INTERVAL);
+	// what is queued up already is late as well, only count what is sent after it got through
+	m_BackoffTick = Tick+clamp(Tick-m_LastAcked, 0, (int)SERVER_TICK_SPEED);
+	m_HoldTick = Tick+max(m_MinRtt, 0)+HOLD_TICKS;
+	m_DecayTick = m_HoldTick;
+	m_NumBackoffs++;
+}
+
+void CSnapRateControl::Update(int Tick, int NumResends)
+{
+	// resent vital chunks got lost on the way. the count belongs to the
+	// connection slot, so what a former client left there does not count
+	if(m_LastResends >= 0 && NumResends > m_LastResends)
+		Backoff(Tick, m_Interval*1.5f);
+	m_LastResends = NumResends;
+
+	if(Tick >= m_DecayTick)
+	{
+		// quick while far off the rate that was too much the last time, careful close to it
+		if(m_Interval > m_CongestedInterval*1.5f)
+			m_Interval = max(m_Interval*0.95f, 1.0f);
+		else
+			m_Interval = max(m_Interval-0.1f, 1.0f);
+		m_DecayTick = Tick+DECAY_TICKS;
+	}
+}
+
+float CSnapRateControl::Interval(int Budget) const
+{
+	float Interval = m_Interval;
+	if(Budget > 0)
+		Interval = max(Interval, min(m_AvgBytes*SERVER_TICK_SPEED/Budget, (float)MAX_INTERVAL));
+	return max(Interval, (float)m_Limit);
+}
+
+bool CSnapRateControl::ShouldSend(int Tick, int Budget)
+{
+	if(Budget > 0)
+	{
+		// the tokens are bytes times SERVER_TICK_SPEED, so no fraction of a byte gets lost.
+		// the bucket holds half a second, a longer pause can not give more
+		if(m_TokenTick >= 0)
+			m_Tokens = min(m_Tokens+Budget*clamp(Tick-m_TokenTick, 0, (int)SERVER_TICK_SPEED), Budget/2*SERVER_TICK_SPEED);
+		m_TokenTick = Tick;
+		if(m_Tokens < 0)
+			return false;
+	}
+	else
+		m_TokenTick = -1;
+
+	return Tick >= m_NextTick;
+}
+
+void CSnapRateControl::OnSent(int Tick, int Bytes, int Budget)
+{
+	if(Budget > 0)
+		m_Tokens -= Bytes*SERVER_TICK_SPEED;
+	m_AvgBytes = m_AvgBytes > 0.0f ? m_AvgBytes*0.9f+Bytes*0.1f : (float)Bytes;
+
+	m_SentIndex = (m_SentIndex+1)%SENT_HISTORY;
+	m_aSentTicks[m_SentIndex] = Tick;
+
+	// keep the phase for fractional intervals, but do not catch up on missed snapshots
+	float Next = Interval(Budget);
+	m_NextTick = max(m_NextTick, Tick-Next)+Next;
+}
+
+void CSnapRateControl::OnAck(int Tick, int AckedTick)
+{
+	if(AckedTick > m_LastAcked)
+	{
+		m_LastAcked = AckedTick;
+
+		// the smallest round trip of the last seconds is the one without queueing
+		int Rtt = max(Tick-AckedTick, 0);
+		if(m_NextMinRtt < 0 || Rtt < m_NextMinRtt)
+			m_NextMinRtt = Rtt;
+		if(m_MinRtt < 0 || Rtt < m_MinRtt)
+			m_MinRtt = Rtt;
+		if(Tick >= m_RttWindowTick)
+		{
+			m_MinRtt = m_NextMinRtt;
+			m_NextMinRtt = Rtt;
+			m_RttWindowTick = Tick+RTT_WINDOW_TICKS;
+		}
+	}
+	if(m_MinRtt < 0)
+		return;
+
+	// the newest snapshot that should have made it by now
+	int Due = Tick-m_MinRtt-QUEUE_TICKS;
+	int Late = -1;
+	for(int i = 0; i < SENT_HISTORY; i++)
+	{
+		if(m_aSentTicks[i] <= Due && m_aSentTicks[i] > Late)
+			Late = m_aSentTicks[i];
+	}
+	if(Late > m_LastAcked && Late > m_BackoffTick)
+		Backoff(Tick, m_Interval*1.5f);
+}
+
+void CSnapRateControl::OnLost(int Tick)
+{
+	Backoff(Tick, max(m_Interval*2.0f, (float)LOSS_INTERVAL));
+}
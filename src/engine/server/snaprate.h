@@ -0,0 +1,89 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SERVER_SNAPRATE_H
+#define ENGINE_SERVER_SNAPRATE_H
+
+/*
+	Class: CSnapRateControl
+		Picks how many ticks pass between the snapshots of one client.
+
+		The server remembers when it sent the last snapshots. A snapshot
+		that is older than the round trip plus a bit of queueing and still
+		not acked means the connection is congested, as do resent vital
+		chunks, and the interval grows by half. A lost delta base doubles
+		it. While nothing goes wrong the interval shrinks slowly back
+		towards a snapshot every tick, so a weak connection settles at a
+		rate it can take instead of jumping between full and recover rate.
+
+		A byte budget per second keeps the interval at least as long as
+		the average snapshot needs, with a token bucket as hard limit, and
+		the admin can set a limit of their own.
+*/
+class CSnapRateControl
+{
+public:
+	enum
+	{
+		MAX_INTERVAL=25,
+		LOSS_INTERVAL=10,
+		MAX_LIMIT=50,
+
+		// ticks a snapshot may wait in queues before it counts as late
+		QUEUE_TICKS=5,
+		// ticks to wait after backing off before doing it again
+		HOLD_TICKS=12,
+		// ticks between two steps back towards the full rate
+		DECAY_TICKS=12,
+		// ticks the round trip minimum is taken over
+		RTT_WINDOW_TICKS=250,
+
+		SENT_HISTORY=64,
+	};
+
+private:
+	float m_Interval;
+	float m_CongestedInterval;
+	float m_NextTick;
+	float m_AvgBytes;
+
+	int m_Tokens;
+	int m_TokenTick;
+
+	int m_aSentTicks[SENT_HISTORY];
+	int m_SentIndex;
+	int m_LastAcked;
+
+	int m_MinRtt;
+	int m_NextMinRtt;
+	int m_RttWindowTick;
+
+	int m_BackoffTick;
+	int m_HoldTick;
+	int m_DecayTick;
+	int m_LastResends;
+	int m_NumBackoffs;
+
+	void Backoff(int Tick, float Interval);
+
+public:
+	// least ticks between two snapshots set by the admin, 0 for none
+	int m_Limit;
+
+	CSnapRateControl();
+
+	// starts over with a new connection or map, the limit stays
+	void Reset();
+
+	// Budget is in bytes per second, 0 for none
+	void Update(int Tick, int NumResends);
+	bool ShouldSend(int Tick, int Budget);
+	void OnSent(int Tick, int Bytes, int Budget);
+	void OnAck(int Tick, int AckedTick);
+	void OnLost(int Tick);
+
+	float Interval(int Budget) const;
+	int MinRtt() const { return m_MinRtt; }
+	int NumBackoffs() const { return m_NumBackoffs; }
+};
+
+#endif
@@ -4,7 +4,8 @@
 #include <engine/storage.h>
 #include <engine/shared/config.h>
 
-CConfiguration g_Config;
+static CConfiguration s_DefaultConfig;
+CONFIG_THREAD_LOCAL CConfiguration *g_pConfig = &s_DefaultConfig;
 
 class CConfig : public IConfig
 {
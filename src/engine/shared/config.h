@@ -3,6 +3,8 @@
 #ifndef ENGINE_SHARED_CONFIG_H
 #define ENGINE_SHARED_CONFIG_H
 
+#include <base/detect.h>
+
 struct CConfiguration
 {
 	#define MACRO_CONFIG_INT(Name,ScriptName,Def,Min,Max,Save,Desc) int m_##Name;
@@ -12,7 +14,19 @@ struct CConfiguration
 	#undef MACRO_CONFIG_STR
 };
 
-extern CConfiguration g_Config;
+/*
+	The configuration values are accessed through g_Config. Each thread
+	works on the configuration g_pConfig points to, which is the default
+	one unless the thread runs one of several servers in the same process.
+*/
+#if defined(CONF_FAMILY_WINDOWS) && defined(_MSC_VER)
+	#define CONFIG_THREAD_LOCAL __declspec(thread)
+#else
+	#define CONFIG_THREAD_LOCAL __thread
+#endif
+
+extern CONFIG_THREAD_LOCAL CConfiguration *g_pConfig;
+#define g_Config (*g_pConfig)
 
 enum
 {
@@ -13,6 +13,7 @@ MACRO_CONFIG_STR(PlayerClan, player_clan, 12, "", CFGFLAG_SAVE|CFGFLAG_CLIENT, "
 MACRO_CONFIG_INT(PlayerCountry, player_country, -1, -1, 1000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Country of the player")
 MACRO_CONFIG_STR(Password, password, 32, "", CFGFLAG_CLIENT|CFGFLAG_SERVER, "Password to the server")
 MACRO_CONFIG_STR(Logfile, logfile, 128, "", CFGFLAG_SAVE|CFGFLAG_CLIENT|CFGFLAG_SERVER, "Filename to log all output to")
+MACRO_CONFIG_INT(LogLevel, log_level, 2, 0, 2, CFGFLAG_SAVE|CFGFLAG_CLIENT|CFGFLAG_SERVER, "Adjusts the amount of information in the log (0 = standard, 1 = more info, 2 = debug)")
 MACRO_CONFIG_INT(ConsoleOutputLevel, console_output_level, 0, 0, 2, CFGFLAG_CLIENT|CFGFLAG_SERVER, "Adjusts the amount of information in the console")
 
 MACRO_CONFIG_INT(ClCpuThrottle, cl_cpu_throttle, 0, 0, 100, CFGFLAG_SAVE|CFGFLAG_CLIENT, "")
@@ -75,6 +76,7 @@ MACRO_CONFIG_INT(GfxFinish, gfx_finish, 1, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, ""
 MACRO_CONFIG_INT(GfxAsyncRender, gfx_asyncrender, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Do rendering async from the the update")
 
 MACRO_CONFIG_INT(GfxThreaded, gfx_threaded, 0, 0, 1, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Use the threaded graphics backend")
+MACRO_CONFIG_INT(GfxTextLayoutCache, gfx_text_layout_cache, 256, 0, 16384, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Memory for laid out text in KB (0 = no cache)")
 
 MACRO_CONFIG_INT(InpMousesens, inp_mousesens, 100, 5, 100000, CFGFLAG_SAVE|CFGFLAG_CLIENT, "Mouse sensitivity")
 
@@ -93,6 +95,14 @@ MACRO_CONFIG_INT(SvRconMaxTries, sv_rcon_max_tries, 3, 0, 100, CFGFLAG_SERVER, "
 MACRO_CONFIG_INT(SvRconBantime, sv_rcon_bantime, 5, 0, 1440, CFGFLAG_SERVER, "The time a client gets banned if remote console authentication fails. 0 makes it just use kick")
 MACRO_CONFIG_INT(SvAutoDemoRecord, sv_auto_demo_record, 0, 0, 1, CFGFLAG_SERVER, "Automatically record demos")
 MACRO_CONFIG_INT(SvAutoDemoMax, sv_auto_demo_max, 10, 0, 1000, CFGFLAG_SERVER, "Maximum number of automatically recorded demos (0 = no limit)")
+MACRO_CONFIG_INT(SvPerf, sv_perf, 1, 0, 1, CFGFLAG_SERVER, "Measure where the tick time goes, see the perf command")
+MACRO_CONFIG_INT(SvPerfReport, sv_perf_report, 60, 0, 3600, CFGFLAG_SERVER, "Seconds between the tick time lines in the log (0 = off)")
+MACRO_CONFIG_INT(SvInputRecord, sv_input_record, 0, 0, 1, CFGFLAG_SERVER, "Record the inputs of every map started to replays/, play them back with --replay")
+MACRO_CONFIG_INT(SvSnapAdaptive, sv_snap_adaptive, 0, 0, 1, CFGFLAG_SERVER, "Adapt the snapshot rate of every client to what its connection takes")
+MACRO_CONFIG_INT(SvSnapBudget, sv_snap_budget, 0, 0, 1000000, CFGFLAG_SERVER, "Snapshot bytes per second a client may get at most with sv_snap_adaptive (0 for no limit)")
+MACRO_CONFIG_INT(SvBandwidthStats, sv_bandwidth_stats, 1, 0, 1, CFGFLAG_SERVER, "Count the snapshot bytes of every item type, see the bandwidth command")
+MACRO_CONFIG_INT(SvMetricsPort, sv_metrics_port, 0, 0, 0, CFGFLAG_SERVER, "Port to serve the metrics on in the Prometheus text format (0 = off)")
+MACRO_CONFIG_STR(SvMetricsBindaddr, sv_metrics_bindaddr, 128, "localhost", CFGFLAG_SERVER, "Address to bind the metrics port to")
 MACRO_CONFIG_INT(SvAllowUTF8Names, sv_allow_utf8_names, 0, 0, 1, CFGFLAG_SERVER, "Allow UTF-8 in client names")
 
 MACRO_CONFIG_STR(EcBindaddr, ec_bindaddr, 128, "localhost", CFGFLAG_ECON, "Address to bind the external console to. Anything but 'localhost' is dangerous")
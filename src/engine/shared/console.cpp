@@ -219,7 +219,7 @@ void CConsole::SetPrintOutputLevel(int Index, int OutputLevel)
 
 void CConsole::Print(int Level, const char *pFrom, const char *pStr)
 {
-	dbg_msg(pFrom ,"%s", pStr);
+	dbg_msg_level(Level, pFrom, "%s", pStr);
 	for(int i = 0; i < m_NumPrintCB; ++i)
 	{
 		if(Level <= m_aPrintCB[i].m_OutputLevel && m_aPrintCB[i].m_pfnPrintCallback)
@@ -723,16 +723,24 @@ CConsole::CConsole(int FlagMask)
 
 
 	// TODO: this should disappear
+	// the variables of the configuration the calling thread works on
 	#define MACRO_CONFIG_INT(Name,ScriptName,Def,Min,Max,Flags,Desc) \
 	{ \
-		static CIntVariableData Data = { this, &g_Config.m_##Name, Min, Max }; \
-		Register(#ScriptName, "?i", Flags, IntVariableCommand, &Data, Desc); \
+		CIntVariableData *pData = (CIntVariableData *)mem_alloc(sizeof(CIntVariableData), sizeof(void*)); \
+		pData->m_pConsole = this; \
+		pData->m_pVariable = &g_Config.m_##Name; \
+		pData->m_Min = Min; \
+		pData->m_Max = Max; \
+		Register(#ScriptName, "?i", Flags, IntVariableCommand, pData, Desc); \
 	}
 
 	#define MACRO_CONFIG_STR(Name,ScriptName,Len,Def,Flags,Desc) \
 	{ \
-		static CStrVariableData Data = { this, g_Config.m_##Name, Len }; \
-		Register(#ScriptName, "?r", Flags, StrVariableCommand, &Data, Desc); \
+		CStrVariableData *pData = (CStrVariableData *)mem_alloc(sizeof(CStrVariableData), sizeof(void*)); \
+		pData->m_pConsole = this; \
+		pData->m_pStr = g_Config.m_##Name; \
+		pData->m_MaxSize = Len; \
+		Register(#ScriptName, "?r", Flags, StrVariableCommand, pData, Desc); \
 	}
 
 	#include "config_variables.h"
@@ -741,6 +749,36 @@ CConsole::CConsole(int FlagMask)
 	#undef MACRO_CONFIG_STR
 }
 
+CConsole::~CConsole()
+{
+	CCommand *pCommand = m_pFirstCommand;
+	while(pCommand)
+	{
+		CCommand *pNext = pCommand->m_pNext;
+
+		// chains wrap the callback and data they were put in front of
+		FCommandCallback pfnCallback = pCommand->m_pfnCallback;
+		void *pUserData = pCommand->m_pUserData;
+		while(pfnCallback == Con_Chain)
+		{
+			CChain *pChainInfo = static_cast<CChain *>(pUserData);
+			pfnCallback = pChainInfo->m_pfnCallback;
+			pUserData = pChainInfo->m_pCallbackUserData;
+			mem_free(pChainInfo);
+		}
+		if(pfnCallback == IntVariableCommand || pfnCallback == StrVariableCommand)
+			mem_free(pUserData);
+
+		// temporary commands live in m_TempCommands
+		if(!pCommand->m_Temp)
+		{
+			pCommand->~CCommand();
+			mem_free(pCommand);
+		}
+		pCommand = pNext;
+	}
+}
+
 void CConsole::ParseArguments(int NumArgs, const char **ppArguments)
 {
 	for(int i = 0; i < NumArgs; i++)
@@ -264,6 +264,15 @@ int CDataFileReader::GetDataSize(int Index)
 	return m_pDataFile->m_Info.m_pDataOffsets[Index+1]-m_pDataFile->m_Info.m_pDataOffsets[Index];
 }
 
+int CDataFileReader::GetUncompressedDataSize(int Index)
+{
+	if(!m_pDataFile) { return 0; }
+
+	if(m_pDataFile->m_Header.m_Version == 4)
+		return m_pDataFile->m_Info.m_pDataSizes[Index];
+	return GetDataSize(Index);
+}
+
 void *CDataFileReader::GetDataImpl(int Index, int Swap)
 {
 	if(!m_pDataFile) { return 0; }
@@ -426,6 +435,12 @@ unsigned CDataFileReader::Crc()
 CDataFileWriter::CDataFileWriter()
 {
 	m_File = 0;
+	m_NumDatas = 0;
+	m_pStorage = 0;
+	m_pJobPool = 0;
+	m_TempFile = 0;
+	m_aTempFilename[0] = 0;
+	m_NumStreamedDatas = 0;
 	m_pItemTypes = static_cast<CItemTypeInfo *>(mem_alloc(sizeof(CItemTypeInfo) * MAX_ITEM_TYPES, 1));
 	m_pItems = static_cast<CItemInfo *>(mem_alloc(sizeof(CItemInfo) * MAX_ITEMS, 1));
 	m_pDatas = static_cast<CDataInfo *>(mem_alloc(sizeof(CDataInfo) * MAX_DATAS, 1));
@@ -433,6 +448,18 @@ CDataFileWriter::CDataFileWriter()
 
 CDataFileWriter::~CDataFileWriter()
 {
+	// the jobs still point into the data infos
+	if(m_File)
+	{
+		for(int i = 0; i < m_NumDatas; i++)
+			WaitData(i);
+	}
+	if(m_TempFile)
+	{
+		io_close(m_TempFile);
+		m_pStorage->RemoveFile(m_aTempFilename, IStorage::TYPE_SAVE);
+	}
+
 	mem_free(m_pItemTypes);
 	m_pItemTypes = 0;
 	mem_free(m_pItems);
@@ -441,13 +468,25 @@ CDataFileWriter::~CDataFileWriter()
 	m_pDatas = 0;
 }
 
-bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename)
+bool CDataFileWriter::Open(class IStorage *pStorage, const char *pFilename, CJobPool *pJobPool, bool Stream)
 {
 	dbg_assert(!m_File, "a file already exists");
 	m_File = pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
 	if(!m_File)
 		return false;
 
+	m_pStorage = pStorage;
+	m_pJobPool = pJobPool;
+	m_TempFile = 0;
+	m_NumStreamedDatas = 0;
+	if(Stream)
+	{
+		str_format(m_aTempFilename, sizeof(m_aTempFilename), "%s.tmp", pFilename);
+		m_TempFile = pStorage->OpenFile(m_aTempFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+		if(!m_TempFile)
+			dbg_msg("datafile", "failed to open temporary file, keeping the data in memory. filename='%s'", m_aTempFilename);
+	}
+
 	m_NumItems = 0;
 	m_NumDatas = 0;
 	m_NumItemTypes = 0;
@@ -498,30 +537,87 @@ int CDataFileWriter::AddItem(int Type, int ID, int Size, void *pData)
 	return m_NumItems-1;
 }
 
-int CDataFileWriter::AddData(int Size, void *pData)
+void CDataFileWriter::Compress(CDataInfo *pInfo, const void *pData)
 {
-	if(!m_File) return 0;
-
-	dbg_assert(m_NumDatas < 1024, "too much data");
-
-	CDataInfo *pInfo = &m_pDatas[m_NumDatas];
-	unsigned long s = compressBound(Size);
+	unsigned long s = compressBound(pInfo->m_UncompressedSize);
 	void *pCompData = mem_alloc(s, 1); // temporary buffer that we use during compression
 
-	int Result = compress((Bytef*)pCompData, &s, (Bytef*)pData, Size); // ignore_convention
+	int Result = compress((Bytef*)pCompData, &s, (Bytef*)pData, pInfo->m_UncompressedSize); // ignore_convention
 	if(Result != Z_OK)
 	{
 		dbg_msg("datafile", "compression error %d", Result);
 		dbg_assert(0, "zlib error");
 	}
 
-	pInfo->m_UncompressedSize = Size;
 	pInfo->m_CompressedSize = (int)s;
 	pInfo->m_pCompressedData = mem_alloc(pInfo->m_CompressedSize, 1);
 	mem_copy(pInfo->m_pCompressedData, pCompData, pInfo->m_CompressedSize);
 	mem_free(pCompData);
+}
+
+int CDataFileWriter::CompressThread(void *pUser)
+{
+	CDataInfo *pInfo = static_cast<CDataInfo *>(pUser);
+	Compress(pInfo, pInfo->m_pUncompressedData);
+	mem_free(pInfo->m_pUncompressedData);
+	pInfo->m_pUncompressedData = 0;
+	return 0;
+}
+
+void CDataFileWriter::WaitData(int Index)
+{
+	if(!m_pJobPool)
+		return;
+	while(m_pDatas[Index].m_Job.Status() != CJob::STATE_DONE)
+		thread_sleep(1);
+}
+
+void CDataFileWriter::StreamDatas(bool Wait)
+{
+	// move the compressed data to the temporary file in the order it was added
+	while(m_NumStreamedDatas < m_NumDatas)
+	{
+		CDataInfo *pInfo = &m_pDatas[m_NumStreamedDatas];
+		if(m_pJobPool && pInfo->m_Job.Status() != CJob::STATE_DONE)
+		{
+			if(!Wait && m_NumDatas-m_NumStreamedDatas < MAX_PENDING_DATAS)
+				break;
+			WaitData(m_NumStreamedDatas);
+		}
+
+		io_write(m_TempFile, pInfo->m_pCompressedData, pInfo->m_CompressedSize);
+		mem_free(pInfo->m_pCompressedData);
+		pInfo->m_pCompressedData = 0;
+		m_NumStreamedDatas++;
+	}
+}
+
+int CDataFileWriter::AddData(int Size, void *pData)
+{
+	if(!m_File) return 0;
+
+	dbg_assert(m_NumDatas < 1024, "too much data");
+
+	CDataInfo *pInfo = &m_pDatas[m_NumDatas];
+	pInfo->m_UncompressedSize = Size;
+	pInfo->m_CompressedSize = 0;
+	pInfo->m_pCompressedData = 0;
+	pInfo->m_pUncompressedData = 0;
+
+	if(m_pJobPool)
+	{
+		// the caller may free its data right away
+		pInfo->m_pUncompressedData = mem_alloc(max(Size, 1), 1);
+		mem_copy(pInfo->m_pUncompressedData, pData, Size);
+		m_pJobPool->Add(&pInfo->m_Job, CompressThread, pInfo);
+	}
+	else
+		Compress(pInfo, pData);
 
 	m_NumDatas++;
+
+	if(m_TempFile)
+		StreamDatas(false);
 	return m_NumDatas-1;
 }
 
@@ -551,6 +647,15 @@ int CDataFileWriter::Finish()
 	int DataSize = 0;
 	CDatafileHeader Header;
 
+	// all sizes are needed for the offsets
+	if(m_TempFile)
+		StreamDatas(true);
+	else
+	{
+		for(int i = 0; i < m_NumDatas; i++)
+			WaitData(i);
+	}
+
 	// we should now write this file!
 	if(DEBUG)
 		dbg_msg("datafile", "writing");
@@ -701,11 +806,40 @@ int CDataFileWriter::Finish()
 	}
 
 	// write data
-	for(int i = 0; i < m_NumDatas; i++)
+	if(m_TempFile)
 	{
-		if(DEBUG)
-			dbg_msg("datafile", "writing data id=%d size=%d", i, m_pDatas[i].m_CompressedSize);
-		io_write(m_File, m_pDatas[i].m_pCompressedData, m_pDatas[i].m_CompressedSize);
+		// copy it over from the temporary file
+		io_close(m_TempFile);
+		m_TempFile = m_pStorage->OpenFile(m_aTempFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+		if(m_TempFile)
+		{
+			char aBuffer[64*1024];
+			int Copied = 0;
+			while(Copied < DataSize)
+			{
+				unsigned Read = io_read(m_TempFile, aBuffer, min((int)sizeof(aBuffer), DataSize-Copied));
+				if(!Read)
+					break;
+				io_write(m_File, aBuffer, Read);
+				Copied += Read;
+			}
+			io_close(m_TempFile);
+			if(Copied != DataSize)
+				dbg_msg("datafile", "failed to read temporary file. filename='%s'", m_aTempFilename);
+		}
+		else
+			dbg_msg("datafile", "failed to reopen temporary file. filename='%s'", m_aTempFilename);
+		m_TempFile = 0;
+		m_pStorage->RemoveFile(m_aTempFilename, IStorage::TYPE_SAVE);
+	}
+	else
+	{
+		for(int i = 0; i < m_NumDatas; i++)
+		{
+			if(DEBUG)
+				dbg_msg("datafile", "writing data id=%d size=%d", i, m_pDatas[i].m_CompressedSize);
+			io_write(m_File, m_pDatas[i].m_pCompressedData, m_pDatas[i].m_CompressedSize);
+		}
 	}
 
 	// free data
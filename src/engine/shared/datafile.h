@@ -3,6 +3,8 @@
 #ifndef ENGINE_SHARED_DATAFILE_H
 #define ENGINE_SHARED_DATAFILE_H
 
+#include <engine/shared/jobs.h>
+
 // raw datafile access
 class CDataFileReader
 {
@@ -22,6 +24,7 @@ public:
 	void *GetData(int Index);
 	void *GetDataSwapped(int Index); // makes sure that the data is 32bit LE ints when saved
 	int GetDataSize(int Index);
+	int GetUncompressedDataSize(int Index);
 	void UnloadData(int Index);
 	void *GetItem(int Index, int *pType, int *pID);
 	int GetItemSize(int Index);
@@ -35,13 +38,25 @@ public:
 };
 
 // write access
+/*
+	Class: CDataFileWriter
+		With a job pool the data gets compressed on the pool while the
+		caller goes on adding. The file is assembled in the order the data
+		was added, so it does not differ from one that was written serially.
+
+		In stream mode the compressed data is moved to a temporary file next
+		to the target as soon as it is ready instead of being kept until
+		Finish. At most MAX_PENDING_DATAS are in flight then.
+*/
 class CDataFileWriter
 {
 	struct CDataInfo
 	{
 		int m_UncompressedSize;
 		int m_CompressedSize;
+		void *m_pUncompressedData; // copy that is owned by the compression job
 		void *m_pCompressedData;
+		CJob m_Job;
 	};
 
 	struct CItemInfo
@@ -66,6 +81,7 @@ class CDataFileWriter
 		MAX_ITEM_TYPES=0xffff,
 		MAX_ITEMS=1024,
 		MAX_DATAS=1024,
+		MAX_PENDING_DATAS=32,
 	};
 
 	IOHANDLE m_File;
@@ -76,10 +92,22 @@ class CDataFileWriter
 	CItemInfo *m_pItems;
 	CDataInfo *m_pDatas;
 
+	class IStorage *m_pStorage;
+	CJobPool *m_pJobPool;
+	IOHANDLE m_TempFile;
+	char m_aTempFilename[512];
+	int m_NumStreamedDatas;
+
+	static int CompressThread(void *pUser);
+	static void Compress(CDataInfo *pInfo, const void *pData);
+	void WaitData(int Index);
+	void StreamDatas(bool Wait);
+
 public:
 	CDataFileWriter();
 	~CDataFileWriter();
-	bool Open(class IStorage *pStorage, const char *Filename);
+	// pJobPool is optional, Stream keeps the compressed data out of memory
+	bool Open(class IStorage *pStorage, const char *Filename, CJobPool *pJobPool = 0, bool Stream = false);
 	int AddData(int Size, void *pData);
 	int AddDataSwapped(int Size, void *pData);
 	int AddItem(int Type, int ID, int Size, void *pData);
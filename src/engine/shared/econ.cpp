@@ -69,6 +69,8 @@ void CEcon::Init(IConsole *pConsole, CNetBan *pNetBan)
 
 	m_Ready = false;
 	m_UserClientID = -1;
+	m_pfnExecute = 0;
+	m_pExecuteUser = 0;
 
 	if(g_Config.m_EcPort == 0 || g_Config.m_EcPassword[0] == 0)
 		return;
@@ -148,6 +150,8 @@ void CEcon::Update()
 			str_format(aFormatted, sizeof(aFormatted), "cid=%d cmd='%s'", ClientID, aBuf);
 			Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "server", aFormatted);
 			m_UserClientID = ClientID;
+			if(m_pfnExecute)
+				m_pfnExecute(aBuf, m_pExecuteUser);
 			Console()->ExecuteLine(aBuf);
 			m_UserClientID = -1;
 		}
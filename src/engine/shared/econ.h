@@ -6,6 +6,10 @@
 
 class CEcon
 {
+public:
+	typedef void (*FExecuteCallback)(const char *pLine, void *pUser);
+
+private:
 	enum
 	{
 		MAX_AUTH_TRIES=3,
@@ -34,6 +38,9 @@ class CEcon
 	int m_PrintCBIndex;
 	int m_UserClientID;
 
+	FExecuteCallback m_pfnExecute;
+	void *m_pExecuteUser;
+
 	static void SendLineCB(const char *pLine, void *pUserData);
 	static void ConchainEconOutputLevelUpdate(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData);
 	static void ConLogout(IConsole::IResult *pResult, void *pUserData);
@@ -45,6 +52,8 @@ public:
 	IConsole *Console() { return m_pConsole; }
 
 	void Init(IConsole *pConsole, class CNetBan *pNetBan);
+	// gets called with every line an econ client executes
+	void SetExecuteCallback(FExecuteCallback pfnCallback, void *pUser) { m_pfnExecute = pfnCallback; m_pExecuteUser = pUser; }
 	void Update();
 	void Send(int ClientID, const char *pLine);
 	void Shutdown();
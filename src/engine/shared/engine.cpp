@@ -19,28 +19,29 @@ static int HostLookupThread(void *pUser)
 class CEngine : public IEngine
 {
 public:
-	IConsole *m_pConsole;
-	IStorage *m_pStorage;
-	bool m_Logging;
+	// the network log is the same for the whole process
+	static bool ms_Logging;
 
+	// the commands get the storage of their console, so the engine
+	// can serve several kernels at once
 	static void Con_DbgDumpmem(IConsole::IResult *pResult, void *pUserData)
 	{
-		CEngine *pEngine = static_cast<CEngine *>(pUserData);
+		IStorage *pStorage = static_cast<IStorage *>(pUserData);
 		char aBuf[32];
 		str_timestamp(aBuf, sizeof(aBuf));
 		char aFilename[128];
 		str_format(aFilename, sizeof(aFilename), "dumps/memory_%s.txt", aBuf);
-		mem_debug_dump(pEngine->m_pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE));
+		mem_debug_dump(pStorage->OpenFile(aFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE));
 	}
 
 	static void Con_DbgLognetwork(IConsole::IResult *pResult, void *pUserData)
 	{
-		CEngine *pEngine = static_cast<CEngine *>(pUserData);
+		IStorage *pStorage = static_cast<IStorage *>(pUserData);
 
-		if(pEngine->m_Logging)
+		if(ms_Logging)
 		{
 			CNetBase::CloseLog();
-			pEngine->m_Logging = false;
+			ms_Logging = false;
 		}
 		else
 		{
@@ -49,16 +50,26 @@ public:
 			char aFilenameSent[128], aFilenameRecv[128];
 			str_format(aFilenameSent, sizeof(aFilenameSent), "dumps/network_sent_%s.txt", aBuf);
 			str_format(aFilenameRecv, sizeof(aFilenameRecv), "dumps/network_recv_%s.txt", aBuf);
-			CNetBase::OpenLog(pEngine->m_pStorage->OpenFile(aFilenameSent, IOFLAG_WRITE, IStorage::TYPE_SAVE),
-								pEngine->m_pStorage->OpenFile(aFilenameRecv, IOFLAG_WRITE, IStorage::TYPE_SAVE));
-			pEngine->m_Logging = true;
+			CNetBase::OpenLog(pStorage->OpenFile(aFilenameSent, IOFLAG_WRITE, IStorage::TYPE_SAVE),
+								pStorage->OpenFile(aFilenameRecv, IOFLAG_WRITE, IStorage::TYPE_SAVE));
+			ms_Logging = true;
 		}
 	}
 
+	static void ConchainLogLevel(IConsole::IResult *pResult, void *pUserData, IConsole::FCommandCallback pfnCallback, void *pCallbackUserData)
+	{
+		// the log level belongs to the process, with several servers in one
+		// process the one that sets it last decides for all of them
+		pfnCallback(pResult, pCallbackUserData);
+		if(pResult->NumArguments() == 1)
+			dbg_log_level(g_Config.m_LogLevel);
+	}
+
 	CEngine(const char *pAppname)
 	{
 		dbg_logger_stdout();
 		dbg_logger_debugger();
+		dbg_logger_async();
 
 		//
 		dbg_msg("engine", "running on %s-%s-%s", CONF_FAMILY_STRING, CONF_PLATFORM_STRING, CONF_ARCH_STRING);
@@ -75,20 +86,21 @@ public:
 		CNetBase::Init();
 
 		m_JobPool.Init(1);
-
-		m_Logging = false;
 	}
 
 	void Init()
 	{
-		m_pConsole = Kernel()->RequestInterface<IConsole>();
-		m_pStorage = Kernel()->RequestInterface<IStorage>();
+		RegisterCommands(Kernel()->RequestInterface<IConsole>(), Kernel()->RequestInterface<IStorage>());
+	}
 
-		if(!m_pConsole || !m_pStorage)
+	void RegisterCommands(IConsole *pConsole, IStorage *pStorage)
+	{
+		if(!pConsole || !pStorage)
 			return;
 
-		m_pConsole->Register("dbg_dumpmem", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgDumpmem, this, "Dump the memory");
-		m_pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgLognetwork, this, "Log the network");
+		pConsole->Register("dbg_dumpmem", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgDumpmem, pStorage, "Dump the memory");
+		pConsole->Register("dbg_lognetwork", "", CFGFLAG_SERVER|CFGFLAG_CLIENT, Con_DbgLognetwork, pStorage, "Log the network");
+		pConsole->Chain("log_level", ConchainLogLevel, this);
 	}
 
 	void InitLogfile()
@@ -96,6 +108,7 @@ public:
 		// open logfile if needed
 		if(g_Config.m_Logfile[0])
 			dbg_logger_file(g_Config.m_Logfile);
+		dbg_log_level(g_Config.m_LogLevel);
 	}
 
 	void HostLookup(CHostLookup *pLookup, const char *pHostname, int Nettype)
@@ -111,6 +124,13 @@ public:
 			dbg_msg("engine", "job added");
 		m_JobPool.Add(pJob, pfnFunc, pData);
 	}
+
+	void InitJobThreads(int NumThreads)
+	{
+		m_JobPool.Init(NumThreads);
+	}
 };
 
+bool CEngine::ms_Logging = false;
+
 IEngine *CreateEngine(const char *pAppname) { return new CEngine(pAppname); }
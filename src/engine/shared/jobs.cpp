@@ -1,6 +1,7 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
+#include "config.h"
 #include "jobs.h"
 
 CJobPool::CJobPool()
@@ -9,13 +10,23 @@ CJobPool::CJobPool()
 	m_Lock = lock_create();
 	m_pFirstJob = 0;
 	m_pLastJob = 0;
+	m_NumThreads = 0;
+	m_Shutdown = false;
+}
+
+CJobPool::~CJobPool()
+{
+	m_Shutdown = true;
+	for(int i = 0; i < m_lpThreads.size(); i++)
+		thread_wait(m_lpThreads[i]);
+	lock_destroy(m_Lock);
 }
 
 void CJobPool::WorkerThread(void *pUser)
 {
 	CJobPool *pPool = (CJobPool *)pUser;
 
-	while(1)
+	while(!pPool->m_Shutdown)
 	{
 		CJob *pJob = 0;
 
@@ -36,6 +47,7 @@ void CJobPool::WorkerThread(void *pUser)
 		if(pJob)
 		{
 			pJob->m_Status = CJob::STATE_RUNNING;
+			g_pConfig = pJob->m_pConfig;
 			pJob->m_Result = pJob->m_pfnFunc(pJob->m_pFuncData);
 			pJob->m_Status = CJob::STATE_DONE;
 		}
@@ -48,8 +60,8 @@ void CJobPool::WorkerThread(void *pUser)
 int CJobPool::Init(int NumThreads)
 {
 	// start threads
-	for(int i = 0; i < NumThreads; i++)
-		thread_create(WorkerThread, this);
+	for(; m_NumThreads < NumThreads; m_NumThreads++)
+		m_lpThreads.add(thread_create(WorkerThread, this));
 	return 0;
 }
 
@@ -58,6 +70,8 @@ int CJobPool::Add(CJob *pJob, JOBFUNC pfnFunc, void *pData)
 	mem_zero(pJob, sizeof(CJob));
 	pJob->m_pfnFunc = pfnFunc;
 	pJob->m_pFuncData = pData;
+	// the job runs with the configuration of the server that added it
+	pJob->m_pConfig = g_pConfig;
 
 	lock_wait(m_Lock);
 
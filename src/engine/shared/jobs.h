@@ -2,9 +2,12 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #ifndef ENGINE_SHARED_JOBS_H
 #define ENGINE_SHARED_JOBS_H
+#include <base/tl/array.h>
+
 typedef int (*JOBFUNC)(void *pData);
 
 class CJobPool;
+struct CConfiguration;
 
 class CJob
 {
@@ -19,6 +22,7 @@ class CJob
 
 	JOBFUNC m_pfnFunc;
 	void *m_pFuncData;
+	CConfiguration *m_pConfig;
 public:
 	CJob()
 	{
@@ -42,13 +46,20 @@ class CJobPool
 	LOCK m_Lock;
 	CJob *m_pFirstJob;
 	CJob *m_pLastJob;
+	int m_NumThreads;
+	array<void *> m_lpThreads;
+	volatile bool m_Shutdown;
 
 	static void WorkerThread(void *pUser);
 
 public:
 	CJobPool();
+	// lets the running jobs finish, the ones still queued are dropped
+	~CJobPool();
 
+	// starts worker threads until there are NumThreads, can be called again to grow the pool
 	int Init(int NumThreads);
+	int NumThreads() const { return m_NumThreads; }
 	int Add(CJob *pJob, JOBFUNC pfnFunc, void *pData);
 };
 #endif
@@ -1,27 +1,193 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <base/system.h>
+#include <base/tl/array.h>
 #include <engine/map.h>
 #include <engine/storage.h>
 #include "datafile.h"
 
+// map data used by shared maps, kept as long as one of them has it loaded
+class CSharedMapData
+{
+public:
+	char m_aName[512];
+	unsigned m_Crc;
+	unsigned m_Size;
+	int m_RefCount;
+	CDataFileReader m_DataFile;
+	unsigned char *m_pFileData;
+	array<int> m_aPreparedData;
+	CSharedMapData *m_pNext;
+};
+
+static LOCK s_SharedMapLock = 0;
+static CSharedMapData *s_pFirstSharedMap = 0;
+
+static bool IsPrepared(const array<int> &rPrepared, int Index)
+{
+	for(int i = 0; i < rPrepared.size(); i++)
+		if(rPrepared[i] == Index)
+			return true;
+	return false;
+}
+
 class CMap : public IEngineMap
 {
 	CDataFileReader m_DataFile;
+	array<int> m_aPreparedData;
+
+	bool m_Shared;
+	CSharedMapData *m_pSharedData;
+
+	CDataFileReader *DataFile() { return m_pSharedData ? &m_pSharedData->m_DataFile : &m_DataFile; }
+
+	void ReleaseShared()
+	{
+		if(!m_pSharedData)
+			return;
+
+		lock_wait(s_SharedMapLock);
+		if(--m_pSharedData->m_RefCount == 0)
+		{
+			for(CSharedMapData **ppData = &s_pFirstSharedMap; *ppData; ppData = &(*ppData)->m_pNext)
+			{
+				if(*ppData == m_pSharedData)
+				{
+					*ppData = m_pSharedData->m_pNext;
+					break;
+				}
+			}
+			mem_free(m_pSharedData->m_pFileData);
+			delete m_pSharedData;
+		}
+		lock_release(s_SharedMapLock);
+		m_pSharedData = 0;
+	}
+
+	bool LoadShared(IStorage *pStorage, const char *pMapName)
+	{
+		unsigned Crc, Size;
+		if(!CDataFileReader::GetCrcSize(pStorage, pMapName, IStorage::TYPE_ALL, &Crc, &Size))
+			return false;
+
+		lock_wait(s_SharedMapLock);
+		CSharedMapData *pData = s_pFirstSharedMap;
+		for(; pData; pData = pData->m_pNext)
+			if(pData->m_Crc == Crc && pData->m_Size == Size && str_comp(pData->m_aName, pMapName) == 0)
+				break;
+
+		if(!pData)
+		{
+			IOHANDLE File = pStorage->OpenFile(pMapName, IOFLAG_READ, IStorage::TYPE_ALL);
+			if(!File)
+			{
+				lock_release(s_SharedMapLock);
+				return false;
+			}
+
+			pData = new CSharedMapData;
+			if(!pData->m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL))
+			{
+				io_close(File);
+				delete pData;
+				lock_release(s_SharedMapLock);
+				return false;
+			}
+
+			str_copy(pData->m_aName, pMapName, sizeof(pData->m_aName));
+			pData->m_Crc = Crc;
+			pData->m_Size = (unsigned)io_length(File);
+			pData->m_pFileData = (unsigned char *)mem_alloc(pData->m_Size, 1);
+			io_read(File, pData->m_pFileData, pData->m_Size);
+			io_close(File);
+			pData->m_RefCount = 0;
+			pData->m_pNext = s_pFirstSharedMap;
+			s_pFirstSharedMap = pData;
+		}
+		else
+			dbg_msg("map", "sharing loaded map data. filename='%s'", pMapName);
+
+		pData->m_RefCount++;
+		lock_release(s_SharedMapLock);
+
+		// keep the old data until the new one is there, it could be the same
+		ReleaseShared();
+		m_pSharedData = pData;
+		return true;
+	}
+
 public:
-	CMap() {}
+	CMap(bool Shared) : m_Shared(Shared), m_pSharedData(0) {}
+	~CMap() { ReleaseShared(); }
+
+	virtual void *GetData(int Index)
+	{
+		if(!m_pSharedData)
+			return m_DataFile.GetData(Index);
+
+		// data blocks get decompressed on first use
+		lock_wait(s_SharedMapLock);
+		void *pData = m_pSharedData->m_DataFile.GetData(Index);
+		lock_release(s_SharedMapLock);
+		return pData;
+	}
+
+	virtual void *GetDataSwapped(int Index)
+	{
+		if(!m_pSharedData)
+			return m_DataFile.GetDataSwapped(Index);
+
+		lock_wait(s_SharedMapLock);
+		void *pData = m_pSharedData->m_DataFile.GetDataSwapped(Index);
+		lock_release(s_SharedMapLock);
+		return pData;
+	}
+
+	virtual void UnloadData(int Index)
+	{
+		if(m_pSharedData)
+			return;
+
+		m_DataFile.UnloadData(Index);
+		for(int i = 0; i < m_aPreparedData.size(); i++)
+			if(m_aPreparedData[i] == Index)
+				m_aPreparedData.remove_index_fast(i--);
+	}
 
-	virtual void *GetData(int Index) { return m_DataFile.GetData(Index); }
-	virtual void *GetDataSwapped(int Index) { return m_DataFile.GetDataSwapped(Index); }
-	virtual void UnloadData(int Index) { m_DataFile.UnloadData(Index); }
-	virtual void *GetItem(int Index, int *pType, int *pID) { return m_DataFile.GetItem(Index, pType, pID); }
-	virtual void GetType(int Type, int *pStart, int *pNum) { m_DataFile.GetType(Type, pStart, pNum); }
-	virtual void *FindItem(int Type, int ID) { return m_DataFile.FindItem(Type, ID); }
-	virtual int NumItems() { return m_DataFile.NumItems(); }
+	virtual void *PrepareData(int Index, FPrepareData pfnPrepare, void *pUser)
+	{
+		if(!m_pSharedData)
+		{
+			void *pData = m_DataFile.GetData(Index);
+			if(pData && !IsPrepared(m_aPreparedData, Index))
+			{
+				pfnPrepare(pData, pUser);
+				m_aPreparedData.add(Index);
+			}
+			return pData;
+		}
+
+		lock_wait(s_SharedMapLock);
+		void *pData = m_pSharedData->m_DataFile.GetData(Index);
+		if(pData && !IsPrepared(m_pSharedData->m_aPreparedData, Index))
+		{
+			pfnPrepare(pData, pUser);
+			m_pSharedData->m_aPreparedData.add(Index);
+		}
+		lock_release(s_SharedMapLock);
+		return pData;
+	}
+
+	virtual void *GetItem(int Index, int *pType, int *pID) { return DataFile()->GetItem(Index, pType, pID); }
+	virtual void GetType(int Type, int *pStart, int *pNum) { DataFile()->GetType(Type, pStart, pNum); }
+	virtual void *FindItem(int Type, int ID) { return DataFile()->FindItem(Type, ID); }
+	virtual int NumItems() { return DataFile()->NumItems(); }
 
 	virtual void Unload()
 	{
+		ReleaseShared();
 		m_DataFile.Close();
+		m_aPreparedData.clear();
 	}
 
 	virtual bool Load(const char *pMapName)
@@ -29,18 +195,36 @@ public:
 		IStorage *pStorage = Kernel()->RequestInterface<IStorage>();
 		if(!pStorage)
 			return false;
+		if(m_Shared)
+			return LoadShared(pStorage, pMapName);
+		m_aPreparedData.clear();
 		return m_DataFile.Open(pStorage, pMapName, IStorage::TYPE_ALL);
 	}
 
 	virtual bool IsLoaded()
 	{
-		return m_DataFile.IsOpen();
+		return m_pSharedData != 0 || m_DataFile.IsOpen();
 	}
 
 	virtual unsigned Crc()
 	{
-		return m_DataFile.Crc();
+		return DataFile()->Crc();
+	}
+
+	virtual const unsigned char *FileData(int *pSize)
+	{
+		if(!m_pSharedData)
+			return 0;
+		*pSize = m_pSharedData->m_Size;
+		return m_pSharedData->m_pFileData;
 	}
 };
 
-extern IEngineMap *CreateEngineMap() { return new CMap; }
+extern IEngineMap *CreateEngineMap() { return new CMap(false); }
+extern IEngineMap *CreateSharedEngineMap()
+{
+	// the shared maps are all created before the servers start running
+	if(!s_SharedMapLock)
+		s_SharedMapLock = lock_create();
+	return new CMap(true);
+}
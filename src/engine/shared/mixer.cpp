@@ -0,0 +1,171 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include "mixer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MIXER_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+int CMixer::Step(int SampleRate, int MixingRate)
+{
+	return (int)(((int64)SampleRate<<FRAC_BITS)/MixingRate);
+}
+
+bool CMixer::Advance(int *pFrame, int *pFrac, int Step, int NumFrames, bool Loop, unsigned Frames)
+{
+	int64 Pos = ((int64)*pFrame<<FRAC_BITS) + *pFrac + (int64)Step*Frames;
+	int64 End = (int64)NumFrames<<FRAC_BITS;
+	if(Pos >= End)
+	{
+		if(!Loop || End == 0)
+			return false;
+		Pos %= End;
+	}
+	*pFrame = (int)(Pos>>FRAC_BITS);
+	*pFrac = (int)(Pos&FRAC_MASK);
+	return true;
+}
+
+int CMixer::AddVoice(const short *pData, int NumFrames, int Channels, int Frame, int Frac, int Step, bool Loop, int LVol, int RVol)
+{
+	if(m_NumVoices == MAX_VOICES)
+		return -1;
+
+	int i = m_NumVoices++;
+	m_apData[i] = pData;
+	m_aNumFrames[i] = NumFrames;
+	m_aChannels[i] = Channels;
+	m_aFrame[i] = Frame;
+	m_aFrac[i] = Frac;
+	m_aStep[i] = Step;
+	m_aLoop[i] = Loop;
+	m_aLVol[i] = LVol;
+	m_aRVol[i] = RVol;
+	return i;
+}
+
+// resamples one voice into interleaved stereo, returns the number of frames written
+static unsigned Resample(short *pOut, unsigned Frames, const short *pData, int NumFrames, int Channels,
+	int *pFrame, int *pFrac, int Step, bool Loop)
+{
+	int Frame = *pFrame;
+	int Frac = *pFrac;
+	int Right = Channels == 2 ? 1 : 0;
+	unsigned i = 0;
+
+	for(; i < Frames; i++)
+	{
+		int Next = Frame+1;
+		if(Next >= NumFrames)
+			Next = Loop ? 0 : Frame;
+
+		const short *pA = &pData[Frame*Channels];
+		const short *pB = &pData[Next*Channels];
+		// one bit less of the fraction keeps the product in 32 bit
+		int Weight = Frac>>1;
+		pOut[i*2] = (short)(pA[0] + (((pB[0]-pA[0])*Weight)>>(CMixer::FRAC_BITS-1)));
+		pOut[i*2+1] = (short)(pA[Right] + (((pB[Right]-pA[Right])*Weight)>>(CMixer::FRAC_BITS-1)));
+
+		Frac += Step;
+		Frame += Frac>>CMixer::FRAC_BITS;
+		Frac &= CMixer::FRAC_MASK;
+		if(Frame >= NumFrames)
+		{
+			if(!Loop)
+			{
+				i++;
+				break;
+			}
+			Frame %= NumFrames;
+		}
+	}
+
+	*pFrame = Frame;
+	*pFrac = Frac;
+	return i;
+}
+
+static void AccumulateScalar(int *pMixBuffer, const short *pIn, unsigned Frames, int LVol, int RVol)
+{
+	for(unsigned i = 0; i < Frames; i++)
+	{
+		pMixBuffer[i*2] += pIn[i*2]*LVol;
+		pMixBuffer[i*2+1] += pIn[i*2+1]*RVol;
+	}
+}
+
+static void Accumulate(int *pMixBuffer, const short *pIn, unsigned Frames, int LVol, int RVol)
+{
+	unsigned i = 0;
+#if defined(MIXER_SSE2)
+	// four frames at once, the 16 bit products get widened to 32 bit
+	__m128i Vol = _mm_set_epi16(RVol, LVol, RVol, LVol, RVol, LVol, RVol, LVol);
+	for(; i+4 <= Frames; i += 4)
+	{
+		__m128i In = _mm_loadu_si128((const __m128i *)&pIn[i*2]);
+		__m128i Lo = _mm_mullo_epi16(In, Vol);
+		__m128i Hi = _mm_mulhi_epi16(In, Vol);
+		__m128i *pOut = (__m128i *)&pMixBuffer[i*2];
+		_mm_storeu_si128(pOut, _mm_add_epi32(_mm_loadu_si128(pOut), _mm_unpacklo_epi16(Lo, Hi)));
+		_mm_storeu_si128(pOut+1, _mm_add_epi32(_mm_loadu_si128(pOut+1), _mm_unpackhi_epi16(Lo, Hi)));
+	}
+#endif
+	AccumulateScalar(pMixBuffer+i*2, pIn+i*2, Frames-i, LVol, RVol);
+}
+
+void CMixer::Mix(int *pMixBuffer, unsigned Frames, bool Scalar) const
+{
+	short aBlock[BLOCK_FRAMES*2];
+
+	for(int v = 0; v < m_NumVoices; v++)
+	{
+		if(!m_apData[v] || m_aNumFrames[v] <= 0 || (!m_aLVol[v] && !m_aRVol[v]))
+			continue;
+
+		int Frame = m_aFrame[v];
+		int Frac = m_aFrac[v];
+		for(unsigned Done = 0; Done < Frames;)
+		{
+			unsigned Wanted = min(Frames-Done, (unsigned)BLOCK_FRAMES);
+			unsigned Num = Resample(aBlock, Wanted, m_apData[v], m_aNumFrames[v], m_aChannels[v], &Frame, &Frac, m_aStep[v], m_aLoop[v] != 0);
+			if(Scalar)
+				AccumulateScalar(pMixBuffer+Done*2, aBlock, Num, m_aLVol[v], m_aRVol[v]);
+			else
+				Accumulate(pMixBuffer+Done*2, aBlock, Num, m_aLVol[v], m_aRVol[v]);
+			Done += Num;
+			if(Num < Wanted)
+				break;
+		}
+	}
+}
+
+void CMixer::FinishScalar(short *pOut, const int *pMixBuffer, unsigned Frames, int MasterVol)
+{
+	float Scale = MasterVol/(101.0f*256.0f);
+	for(unsigned i = 0; i < Frames*2; i++)
+	{
+		int Value = (int)(pMixBuffer[i]*Scale);
+		pOut[i] = (short)clamp(Value, -0x7fff, 0x7fff);
+	}
+}
+
+void CMixer::Finish(short *pOut, const int *pMixBuffer, unsigned Frames, int MasterVol)
+{
+	unsigned i = 0;
+#if defined(MIXER_SSE2)
+	// four frames at once, the saturating pack does the upper clamp
+	__m128 Scale = _mm_set1_ps(MasterVol/(101.0f*256.0f));
+	__m128i Min = _mm_set1_epi16(-0x7fff);
+	for(; i+4 <= Frames; i += 4)
+	{
+		__m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&pMixBuffer[i*2])), Scale));
+		__m128i b = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&pMixBuffer[i*2+4])), Scale));
+		_mm_storeu_si128((__m128i *)&pOut[i*2], _mm_max_epi16(_mm_packs_epi32(a, b), Min));
+	}
+#endif
+	FinishScalar(pOut+i*2, pMixBuffer+i*2, Frames-i, MasterVol);
+}
@@ -0,0 +1,63 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_MIXER_H
+#define ENGINE_SHARED_MIXER_H
+
+/*
+	Class: CMixer
+		Mixes 16 bit voices into a stereo buffer. The voice parameters are
+		kept as structure of arrays, the sound engine copies them in while
+		it holds its lock and the mixing runs without it.
+
+		Samples are resampled on the fly with linear interpolation. A voice
+		position is a frame index plus a fraction of FRAC_BITS bits, the
+		step is the sample rate divided by the mixing rate in the same
+		format.
+*/
+class CMixer
+{
+public:
+	enum
+	{
+		MAX_VOICES=64,
+		FRAC_BITS=16,
+		FRAC_ONE=1<<FRAC_BITS,
+		FRAC_MASK=FRAC_ONE-1,
+
+		// frames resampled at once, the block lives on the stack
+		BLOCK_FRAMES=256,
+	};
+
+	const short *m_apData[MAX_VOICES];
+	int m_aNumFrames[MAX_VOICES];
+	int m_aChannels[MAX_VOICES];
+	int m_aFrame[MAX_VOICES];
+	int m_aFrac[MAX_VOICES];
+	int m_aStep[MAX_VOICES];
+	int m_aLoop[MAX_VOICES];
+	int m_aLVol[MAX_VOICES]; // 0 - 255
+	int m_aRVol[MAX_VOICES]; // 0 - 255
+	int m_NumVoices;
+
+	CMixer() : m_NumVoices(0) {}
+
+	static int Step(int SampleRate, int MixingRate);
+
+	// moves a position forward by the given amount of mixed frames.
+	// returns false when a voice that does not loop has ended
+	static bool Advance(int *pFrame, int *pFrac, int Step, int NumFrames, bool Loop, unsigned Frames);
+
+	// adds a voice that starts at the given position, returns its index or -1 if full
+	int AddVoice(const short *pData, int NumFrames, int Channels, int Frame, int Frac, int Step, bool Loop, int LVol, int RVol);
+	void Clear() { m_NumVoices = 0; }
+
+	// adds all voices to the interleaved stereo buffer. the buffer is not cleared.
+	// Scalar forces the portable code, it gives the same result
+	void Mix(int *pMixBuffer, unsigned Frames, bool Scalar=false) const;
+
+	// applies the master volume (0 - 100) and clamps the mixed values to 16 bit
+	static void Finish(short *pOut, const int *pMixBuffer, unsigned Frames, int MasterVol);
+	static void FinishScalar(short *pOut, const int *pMixBuffer, unsigned Frames, int MasterVol);
+};
+
+#endif
@@ -155,6 +155,7 @@ private:
 	NETADDR m_PeerAddr;
 	NETSOCKET m_Socket;
 	NETSTATS m_Stats;
+	int m_NumResends;
 
 	//
 	void Reset();
@@ -163,6 +164,7 @@ private:
 	void AckChunks(int Ack);
 
 	int QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence);
+	int CommitChunkEx(int Flags, int DataSize, int Sequence);
 	void SendControl(int ControlMsg, const void *pExtra, int ExtraSize);
 	void ResendChunk(CNetChunkResend *pResend);
 	void Resend();
@@ -178,6 +180,12 @@ public:
 	int Feed(CNetPacketConstruct *pPacket, NETADDR *pAddr);
 	int QueueChunk(int Flags, int DataSize, const void *pData);
 
+	// packs a chunk in place: ReserveChunk gives room for MaxSize bytes in
+	// the packet being built, CommitChunk queues the DataSize bytes written
+	// there. Nothing else may be queued in between.
+	unsigned char *ReserveChunk(int Flags, int MaxSize);
+	int CommitChunk(int Flags, int DataSize);
+
 	const char *ErrorString();
 	void SignalResend();
 	int State() const { return m_State; }
@@ -191,6 +199,9 @@ public:
 	int64 ConnectTime() const { return m_LastUpdateTime; }
 
 	int AckSequence() const { return m_Ack; }
+
+	// chunks sent again since Init(), for the server metrics
+	int NumResends() const { return m_NumResends; }
 };
 
 class CConsoleNetConnection
@@ -256,6 +267,10 @@ class CNetServer
 	int m_MaxClients;
 	int m_MaxClientsPerIP;
 
+	// packets counted since Open() for the server metrics
+	int64 m_NumBanHits;
+	int64 m_NumConnless;
+
 	NETFUNC_NEWCLIENT m_pfnNewClient;
 	NETFUNC_DELCLIENT m_pfnDelClient;
 	void *m_UserPtr;
@@ -283,6 +298,14 @@ public:
 	class CNetBan *NetBan() const { return m_pNetBan; }
 	int NetType() const { return m_Socket.type; }
 	int MaxClients() const { return m_MaxClients; }
+	int64 NumBanHits() const { return m_NumBanHits; }
+	int64 NumConnless() const { return m_NumConnless; }
+	int64 NumResends() const;
+
+	// sends a chunk packed in place, see CNetConnection::ReserveChunk, Flags are NETSENDFLAG_*
+	unsigned char *ReserveChunk(int ClientID, int Flags, int MaxSize);
+	int CommitChunk(int ClientID, int Flags, int DataSize);
+	int NumResends(int ClientID) const { return m_aSlots[ClientID].m_Connection.NumResends(); }
 
 	//
 	void SetMaxClientsPerIP(int Max);
@@ -356,6 +379,7 @@ public:
 
 	// error and state
 	int NetType() const { return m_Socket.type; }
+	NETSOCKET Socket() const { return m_Socket; }
 	int State();
 	int GotProblems();
 	const char *ErrorString();
@@ -7,6 +7,7 @@
 void CNetConnection::ResetStats()
 {
 	mem_zero(&m_Stats, sizeof(m_Stats));
+	m_NumResends = 0;
 }
 
 void CNetConnection::Reset()
@@ -80,27 +81,50 @@ int CNetConnection::Flush()
 	// update send times
 	m_LastSendTime = time_get();
 
-	// clear construct so we can start building a new package
-	mem_zero(&m_Construct, sizeof(m_Construct));
+	// clear construct so we can start building a new package, the chunk data
+	// past m_DataSize is never read
+	m_Construct.m_Flags = 0;
+	m_Construct.m_Ack = 0;
+	m_Construct.m_NumChunks = 0;
+	m_Construct.m_DataSize = 0;
 	return NumChunks;
 }
 
-int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence)
+unsigned char *CNetConnection::ReserveChunk(int Flags, int MaxSize)
 {
-	unsigned char *pChunkData;
-
 	// check if we have space for it, if not, flush the connection
-	if(m_Construct.m_DataSize + DataSize + NET_MAX_CHUNKHEADERSIZE > (int)sizeof(m_Construct.m_aChunkData))
+	if(m_Construct.m_DataSize + MaxSize + NET_MAX_CHUNKHEADERSIZE > (int)sizeof(m_Construct.m_aChunkData))
 		Flush();
 
-	// pack all the data
+	// leave room for the header in front
+	return &m_Construct.m_aChunkData[m_Construct.m_DataSize + ((Flags&NET_CHUNKFLAG_VITAL) ? 3 : 2)];
+}
+
+int CNetConnection::CommitChunk(int Flags, int DataSize)
+{
+	if(Flags&NET_CHUNKFLAG_VITAL)
+		m_Sequence = (m_Sequence+1)%NET_MAX_SEQUENCE;
+	return CommitChunkEx(Flags, DataSize, m_Sequence);
+}
+
+int CNetConnection::QueueChunkEx(int Flags, int DataSize, const void *pData, int Sequence)
+{
+	mem_copy(ReserveChunk(Flags, DataSize), pData, DataSize);
+	return CommitChunkEx(Flags, DataSize, Sequence);
+}
+
+int CNetConnection::CommitChunkEx(int Flags, int DataSize, int Sequence)
+{
+	unsigned char *pChunkData;
+
+	// the data is in place already, only the header goes in front
 	CNetChunkHeader Header;
 	Header.m_Flags = Flags;
 	Header.m_Size = DataSize;
 	Header.m_Sequence = Sequence;
 	pChunkData = &m_Construct.m_aChunkData[m_Construct.m_DataSize];
 	pChunkData = Header.Pack(pChunkData);
-	mem_copy(pChunkData, pData, DataSize);
+	const unsigned char *pData = pChunkData;
 	pChunkData += DataSize;
 
 	//
@@ -152,6 +176,7 @@ void CNetConnection::ResendChunk(CNetChunkResend *pResend)
 {
 	QueueChunkEx(pResend->m_Flags|NET_CHUNKFLAG_RESEND, pResend->m_DataSize, pResend->m_pData, pResend->m_Sequence);
 	pResend->m_LastSendTime = time_get();
+	m_NumResends++;
 }
 
 void CNetConnection::Resend()
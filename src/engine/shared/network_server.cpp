@@ -112,12 +112,14 @@ int CNetServer::Recv(CNetChunk *pChunk)
 			if(NetBan() && NetBan()->IsBanned(&Addr, aBuf, sizeof(aBuf)))
 			{
 				// banned, reply with a message
+				m_NumBanHits++;
 				CNetBase::SendControlMsg(m_Socket, &Addr, 0, NET_CTRLMSG_CLOSE, aBuf, str_length(aBuf)+1);
 				continue;
 			}
 
 			if(m_RecvUnpacker.m_Data.m_Flags&NET_PACKETFLAG_CONNLESS)
 			{
+				m_NumConnless++;
 				pChunk->m_Flags = NETSENDFLAG_CONNLESS;
 				pChunk->m_ClientID = -1;
 				pChunk->m_Address = Addr;
@@ -244,6 +246,29 @@ int CNetServer::Send(CNetChunk *pChunk)
 	return 0;
 }
 
+unsigned char *CNetServer::ReserveChunk(int ClientID, int Flags, int MaxSize)
+{
+	dbg_assert(ClientID >= 0 && ClientID < MaxClients(), "errornous client id");
+	if(MaxSize >= NET_MAX_PAYLOAD-NET_MAX_CHUNKHEADERSIZE)
+		return 0;
+	return m_aSlots[ClientID].m_Connection.ReserveChunk((Flags&NETSENDFLAG_VITAL) ? NET_CHUNKFLAG_VITAL : 0, MaxSize);
+}
+
+int CNetServer::CommitChunk(int ClientID, int Flags, int DataSize)
+{
+	if(m_aSlots[ClientID].m_Connection.CommitChunk((Flags&NETSENDFLAG_VITAL) ? NET_CHUNKFLAG_VITAL : 0, DataSize) == 0)
+	{
+		if(Flags&NETSENDFLAG_FLUSH)
+			m_aSlots[ClientID].m_Connection.Flush();
+	}
+	else
+	{
+		Drop(ClientID, "Error sending data");
+		return -1;
+	}
+	return 0;
+}
+
 void CNetServer::SetMaxClientsPerIP(int Max)
 {
 	// clamp
@@ -254,3 +279,11 @@ void CNetServer::SetMaxClientsPerIP(int Max)
 
 	m_MaxClientsPerIP = Max;
 }
+
+int64 CNetServer::NumResends() const
+{
+	int64 Resends = 0;
+	for(int i = 0; i < NET_MAX_CLIENTS; i++)
+		Resends += m_aSlots[i].m_Connection.NumResends();
+	return Resends;
+}
@@ -7,10 +7,16 @@
 #include "config.h"
 
 void CPacker::Reset()
+{
+	Reset(m_aBuffer, PACKER_BUFFER_SIZE);
+}
+
+void CPacker::Reset(unsigned char *pBuffer, int Size)
 {
 	m_Error = 0;
-	m_pCurrent = m_aBuffer;
-	m_pEnd = m_pCurrent + PACKER_BUFFER_SIZE;
+	m_pBuffer = pBuffer;
+	m_pCurrent = pBuffer;
+	m_pEnd = m_pCurrent + Size;
 }
 
 void CPacker::AddInt(int i)
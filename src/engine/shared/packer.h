@@ -13,17 +13,20 @@ class CPacker
 	};
 
 	unsigned char m_aBuffer[PACKER_BUFFER_SIZE];
+	unsigned char *m_pBuffer;
 	unsigned char *m_pCurrent;
 	unsigned char *m_pEnd;
 	int m_Error;
 public:
 	void Reset();
+	// packs into the given memory instead of the own buffer
+	void Reset(unsigned char *pBuffer, int Size);
 	void AddInt(int i);
 	void AddString(const char *pStr, int Limit);
 	void AddRaw(const void *pData, int Size);
 
-	int Size() const { return (int)(m_pCurrent-m_aBuffer); }
-	const unsigned char *Data() const { return m_aBuffer; }
+	int Size() const { return (int)(m_pCurrent-m_pBuffer); }
+	const unsigned char *Data() const { return m_pBuffer; }
 	bool Error() const { return m_Error; }
 };
 
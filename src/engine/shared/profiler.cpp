@@ -0,0 +1,186 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+
+#include "profiler.h"
+
+static const struct
+{
+	const char *m_pName;
+	int m_Depth;
+} s_aPhases[CTickProfiler::NUM_PHASES] = {
+	{"update", 0},
+	{"input", 1},
+	{"tick", 1},
+	{"snap", 1},
+	{"onsnap", 2},
+	{"delta", 2},
+	{"compress", 2},
+	{"send", 2},
+	{"register", 1},
+	{"network", 1},
+};
+
+CTickProfiler::CTickProfiler()
+{
+	m_Enabled = false;
+	Reset();
+}
+
+void CTickProfiler::Reset()
+{
+	mem_zero(m_aSlots, sizeof(m_aSlots));
+	m_CurrentSlot = 0;
+	m_SlotStart = time_get();
+	mem_zero(m_aTime, sizeof(m_aTime));
+	m_RanPhases = 0;
+}
+
+int CTickProfiler::Bucket(int64 Micros)
+{
+	// exact below 16us, then four buckets per power of two
+	if(Micros < 16)
+		return (int)max(Micros, (int64)0);
+
+	int Exp = 4;
+	while(Exp < 62 && (Micros>>(Exp+1)))
+		Exp++;
+	int Sub = (int)(Micros>>(Exp-2))&3;
+	return min(16+(Exp-4)*4+Sub, (int)NUM_BUCKETS-1);
+}
+
+float CTickProfiler::BucketTime(int Bucket)
+{
+	// upper end of the bucket in milliseconds
+	if(Bucket < 16)
+		return (Bucket+1)/1000.0f;
+	int Exp = 4+(Bucket-16)/4;
+	int Sub = (Bucket-16)%4;
+	return ((int64)(5+Sub)<<(Exp-2))/1000.0f;
+}
+
+void CTickProfiler::BeginUpdate(bool Enabled)
+{
+	m_Enabled = Enabled;
+	if(!m_Enabled)
+		return;
+
+	mem_zero(m_aTime, sizeof(m_aTime));
+	m_RanPhases = 0;
+	Begin(PHASE_UPDATE);
+}
+
+void CTickProfiler::EndUpdate(int Ticks)
+{
+	if(!m_Enabled)
+		return;
+
+	End(PHASE_UPDATE);
+	int64 Now = time_get();
+	int64 Freq = time_freq();
+
+	// move on to the next slots, clearing what they held
+	int64 SlotLength = Freq*SLOT_SECONDS;
+	for(int i = 0; Now-m_SlotStart >= SlotLength; i++)
+	{
+		m_SlotStart += SlotLength;
+		if(i >= NUM_SLOTS)
+		{
+			// away for longer than the window
+			m_SlotStart = Now;
+			break;
+		}
+		m_CurrentSlot = (m_CurrentSlot+1)%NUM_SLOTS;
+		mem_zero(&m_aSlots[m_CurrentSlot], sizeof(CSlot));
+	}
+
+	CSlot *pSlot = &m_aSlots[m_CurrentSlot];
+
+	// updates without a tick only pump the network, keep them out of the update times
+	unsigned Phases = m_RanPhases;
+	if(!Ticks)
+		Phases &= ~(1<<PHASE_UPDATE);
+	else
+	{
+		pSlot->m_Updates++;
+		if(Ticks > 1)
+		{
+			pSlot->m_Overruns++;
+			pSlot->m_OverrunTicks += Ticks-1;
+		}
+	}
+
+	for(int p = 0; p < NUM_PHASES; p++)
+	{
+		if(!(Phases&(1<<p)))
+			continue;
+		int64 Micros = m_aTime[p]*1000000/Freq;
+		pSlot->m_aaHistogram[p][Bucket(Micros)]++;
+		pSlot->m_aTotal[p] += Micros;
+		pSlot->m_aMax[p] = max(pSlot->m_aMax[p], Micros);
+	}
+}
+
+void CTickProfiler::GetStats(int Phase, CPhaseStats *pStats) const
+{
+	int aHistogram[NUM_BUCKETS] = {0};
+	int64 Total = 0;
+	int64 Max = 0;
+	int Count = 0;
+	for(int s = 0; s < NUM_SLOTS; s++)
+	{
+		for(int b = 0; b < NUM_BUCKETS; b++)
+		{
+			aHistogram[b] += m_aSlots[s].m_aaHistogram[Phase][b];
+			Count += m_aSlots[s].m_aaHistogram[Phase][b];
+		}
+		Total += m_aSlots[s].m_aTotal[Phase];
+		Max = max(Max, m_aSlots[s].m_aMax[Phase]);
+	}
+
+	mem_zero(pStats, sizeof(*pStats));
+	pStats->m_Count = Count;
+	if(!Count)
+		return;
+
+	pStats->m_Avg = Total/1000.0f/Count;
+	pStats->m_Max = Max/1000.0f;
+
+	float *apPercentiles[] = {&pStats->m_P50, &pStats->m_P90, &pStats->m_P99};
+	const int aPercents[] = {50, 90, 99};
+	for(int i = 0, b = 0, Seen = 0; i < 3; i++)
+	{
+		int Wanted = (int)(((int64)Count*aPercents[i]+99)/100);
+		while(b < NUM_BUCKETS-1 && Seen+aHistogram[b] < Wanted)
+			Seen += aHistogram[b++];
+		*apPercentiles[i] = min(BucketTime(b), pStats->m_Max);
+	}
+}
+
+void CTickProfiler::GetOverruns(int *pUpdates, int *pOverruns, int *pOverrunTicks) const
+{
+	*pUpdates = 0;
+	*pOverruns = 0;
+	*pOverrunTicks = 0;
+	for(int s = 0; s < NUM_SLOTS; s++)
+	{
+		*pUpdates += m_aSlots[s].m_Updates;
+		*pOverruns += m_aSlots[s].m_Overruns;
+		*pOverrunTicks += m_aSlots[s].m_OverrunTicks;
+	}
+}
+
+int CTickProfiler::WindowSeconds() const
+{
+	return NUM_SLOTS*SLOT_SECONDS;
+}
+
+const char *CTickProfiler::PhaseName(int Phase)
+{
+	return s_aPhases[Phase].m_pName;
+}
+
+int CTickProfiler::PhaseDepth(int Phase)
+{
+	return s_aPhases[Phase].m_Depth;
+}
@@ -0,0 +1,109 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef ENGINE_SHARED_PROFILER_H
+#define ENGINE_SHARED_PROFILER_H
+
+#include <base/system.h>
+
+/*
+	Class: CTickProfiler
+		Measures the phases of a server update. The time of every phase is
+		summed up over the update and then sorted into a histogram with
+		four buckets per power of two microseconds. The histograms of the
+		last NUM_SLOTS*SLOT_SECONDS seconds are kept to give percentiles.
+
+		An update that has to run more than one tick to catch up is an
+		overrun, those are counted with the ticks they ran.
+
+		It costs two time_get() calls per phase and update, phases that
+		are nested are simply measured twice.
+*/
+class CTickProfiler
+{
+public:
+	enum
+	{
+		PHASE_UPDATE=0,
+		PHASE_INPUT,
+		PHASE_TICK,
+		PHASE_SNAP,
+		PHASE_SNAP_BUILD,
+		PHASE_SNAP_DELTA,
+		PHASE_SNAP_COMPRESS,
+		PHASE_SNAP_SEND,
+		PHASE_REGISTER,
+		PHASE_NETWORK,
+		NUM_PHASES,
+
+		NUM_BUCKETS=96,
+		NUM_SLOTS=6,
+		SLOT_SECONDS=10,
+	};
+
+	struct CPhaseStats
+	{
+		int m_Count;
+		float m_Avg;
+		float m_P50;
+		float m_P90;
+		float m_P99;
+		float m_Max;
+	};
+
+private:
+	struct CSlot
+	{
+		int m_aaHistogram[NUM_PHASES][NUM_BUCKETS];
+		int64 m_aTotal[NUM_PHASES];
+		int64 m_aMax[NUM_PHASES];
+		int m_Updates;
+		int m_Overruns;
+		int m_OverrunTicks;
+	};
+
+	CSlot m_aSlots[NUM_SLOTS];
+	int m_CurrentSlot;
+	int64 m_SlotStart;
+
+	bool m_Enabled;
+	int64 m_aStart[NUM_PHASES];
+	int64 m_aTime[NUM_PHASES];
+	unsigned m_RanPhases;
+
+	static int Bucket(int64 Micros);
+	static float BucketTime(int Bucket);
+
+public:
+	CTickProfiler();
+
+	void Reset();
+
+	// starts measuring an update, nothing is measured when disabled
+	void BeginUpdate(bool Enabled);
+	void EndUpdate(int Ticks);
+
+	void Begin(int Phase)
+	{
+		if(m_Enabled)
+			m_aStart[Phase] = time_get();
+	}
+
+	void End(int Phase)
+	{
+		if(m_Enabled)
+		{
+			m_aTime[Phase] += time_get()-m_aStart[Phase];
+			m_RanPhases |= 1<<Phase;
+		}
+	}
+
+	// times are in milliseconds, over the whole window
+	void GetStats(int Phase, CPhaseStats *pStats) const;
+	void GetOverruns(int *pUpdates, int *pOverruns, int *pOverrunTicks) const;
+	int WindowSeconds() const;
+
+	static const char *PhaseName(int Phase);
+	static int PhaseDepth(int Phase);
+};
+
+#endif
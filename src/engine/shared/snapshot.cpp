@@ -19,7 +19,7 @@ int CSnapshot::GetItemSize(int Index)
 
 int CSnapshot::GetItemIndex(int Key)
 {
-	// TODO: OPT: this should not be a linear search. very bad
+	// linear, use a CSnapshotIndex for repeated lookups
 	for(int i = 0; i < m_NumItems; i++)
 	{
 		if(GetItem(i)->Key() == Key)
@@ -57,6 +57,84 @@ void CSnapshot::DebugDump()
 }
 
 
+// CSnapshotIndex
+
+int CSnapshotIndex::NumSlots(int NumItems)
+{
+	// keep the load below one half
+	int Num = 16;
+	while(Num < NumItems*2)
+		Num <<= 1;
+	return Num;
+}
+
+void CSnapshotIndex::Init(int *pSlots, int MaxSlots)
+{
+	m_pSlots = pSlots;
+	m_MaxSlots = MaxSlots;
+	m_Mask = -1;
+	m_pSnap = 0;
+}
+
+void CSnapshotIndex::Clear(int NumItems)
+{
+	int Num = NumSlots(NumItems);
+	if(Num > m_MaxSlots)
+	{
+		m_Mask = -1;
+		return;
+	}
+
+	m_Mask = Num-1;
+	for(int i = 0; i < Num; i++)
+		m_pSlots[i*2+1] = -1;
+}
+
+void CSnapshotIndex::Insert(int Key, int Index)
+{
+	if(m_Mask < 0)
+		return;
+
+	unsigned Slot = Hash(Key)&m_Mask;
+	while(m_pSlots[Slot*2+1] != -1)
+	{
+		// the first item with a key wins, like with a linear search
+		if(m_pSlots[Slot*2] == Key)
+			return;
+		Slot = (Slot+1)&m_Mask;
+	}
+
+	m_pSlots[Slot*2] = Key;
+	m_pSlots[Slot*2+1] = Index;
+}
+
+void CSnapshotIndex::Build(CSnapshot *pSnap)
+{
+	m_pSnap = pSnap;
+	Clear(pSnap->NumItems());
+	if(m_Mask < 0)
+		return;
+
+	for(int i = 0; i < pSnap->NumItems(); i++)
+		Insert(pSnap->GetItem(i)->Key(), i);
+}
+
+int CSnapshotIndex::Find(int Key) const
+{
+	if(m_Mask < 0)
+		return m_pSnap ? m_pSnap->GetItemIndex(Key) : -1;
+
+	unsigned Slot = Hash(Key)&m_Mask;
+	while(m_pSlots[Slot*2+1] != -1)
+	{
+		if(m_pSlots[Slot*2] == Key)
+			return m_pSlots[Slot*2+1];
+		Slot = (Slot+1)&m_Mask;
+	}
+	return -1;
+}
+
+
 // CSnapshotDelta
 
 struct CItemList
@@ -158,8 +236,22 @@ CSnapshotDelta::CData *CSnapshotDelta::EmptyDelta()
 	return &m_Empty;
 }
 
+// bytes the ints take once packed by CVariableInt
+static int PackedSize(const int *pData, int Num)
+{
+	int Size = 0;
+	for(int i = 0; i < Num; i++)
+	{
+		unsigned Value = pData[i] < 0 ? ~pData[i] : pData[i];
+		Size++;
+		for(Value >>= 6; Value; Value >>= 7)
+			Size++;
+	}
+	return Size;
+}
+
 // TODO: OPT: this should be made much faster
-int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData)
+int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData, int *pItemBytes)
 {
 	CData *pDelta = (CData *)pDstData;
 	int *pData = (int *)pDelta->m_pData;
@@ -186,6 +278,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			// deleted
 			pDelta->m_NumDeletedItems++;
 			*pData = pFromItem->Key();
+			if(pItemBytes)
+				pItemBytes[pFromItem->Type()&63] += PackedSize(pData, 1);
 			pData++;
 		}
 	}
@@ -220,17 +314,20 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 
 			if(DiffItem((int*)pPastItem->Data(), (int*)pCurItem->Data(), pItemDataDst, ItemSize/4))
 			{
-
+				int *pItemStart = pData;
 				*pData++ = pCurItem->Type();
 				*pData++ = pCurItem->ID();
 				if(!m_aItemSizes[pCurItem->Type()])
 					*pData++ = ItemSize/4;
 				pData += ItemSize/4;
 				pDelta->m_NumUpdateItems++;
+				if(pItemBytes)
+					pItemBytes[pCurItem->Type()&63] += PackedSize(pItemStart, (int)(pData-pItemStart));
 			}
 		}
 		else
 		{
+			int *pItemStart = pData;
 			*pData++ = pCurItem->Type();
 			*pData++ = pCurItem->ID();
 			if(!m_aItemSizes[pCurItem->Type()])
@@ -241,6 +338,8 @@ int CSnapshotDelta::CreateDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pDstData
 			pData += ItemSize/4;
 			pDelta->m_NumUpdateItems++;
 			Count++;
+			if(pItemBytes)
+				pItemBytes[pCurItem->Type()&63] += PackedSize(pItemStart, (int)(pData-pItemStart));
 		}
 	}
 
@@ -287,11 +386,16 @@ int CSnapshotDelta::UnpackDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pSrcData
 	int Keep, ItemSize;
 	int *pDeleted;
 	int ID, Type, Key;
-	int FromIndex;
+	int FromItem;
 	int *pNewData;
 
 	Builder.Init();
 
+	int aFromSlots[CSnapshotIndex::MAX_SLOTS*2];
+	CSnapshotIndex FromIndex;
+	FromIndex.Init(aFromSlots, CSnapshotIndex::MAX_SLOTS);
+	FromIndex.Build(pFrom);
+
 	// unpack deleted stuff
 	pDeleted = pData;
 	pData += pDelta->m_NumDeletedItems;
@@ -352,11 +456,11 @@ int CSnapshotDelta::UnpackDelta(CSnapshot *pFrom, CSnapshot *pTo, void *pSrcData
 
 		//if(range_check(pEnd, pNewData, ItemSize)) return -4;
 
-		FromIndex = pFrom->GetItemIndex(Key);
-		if(FromIndex != -1)
+		FromItem = FromIndex.Find(Key);
+		if(FromItem != -1)
 		{
 			// we got an update so we need pTo apply the diff
-			UndiffItem((int *)pFrom->GetItem(FromIndex)->Data(), pData, pNewData, ItemSize/4);
+			UndiffItem((int *)pFrom->GetItem(FromItem)->Data(), pData, pNewData, ItemSize/4);
 			m_aSnapshotDataUpdates[m_SnapshotCurrent]++;
 		}
 		else // no previous, just copy the pData
@@ -434,6 +538,14 @@ void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, i
 	if(CreateAlt)
 		TotalSize += DataSize;
 
+	// the index of the snapshot follows the alternative one
+	int NumSlots = 0;
+	if(CreateAlt)
+	{
+		NumSlots = CSnapshotIndex::NumSlots(((CSnapshot *)pData)->NumItems());
+		TotalSize += NumSlots*2*sizeof(int);
+	}
+
 	CHolder *pHolder = (CHolder *)mem_alloc(TotalSize, 1);
 
 	// set data
@@ -447,9 +559,14 @@ void CSnapshotStorage::Add(int Tick, int64 Tagtime, int DataSize, void *pData, i
 	{
 		pHolder->m_pAltSnap = (CSnapshot*)(((char *)pHolder->m_pSnap) + DataSize);
 		mem_copy(pHolder->m_pAltSnap, pData, DataSize);
+		pHolder->m_Index.Init((int *)(((char *)pHolder->m_pAltSnap) + DataSize), NumSlots);
+		pHolder->m_Index.Build(pHolder->m_pSnap);
 	}
 	else
+	{
 		pHolder->m_pAltSnap = 0;
+		pHolder->m_Index.Init(0, 0);
+	}
 
 
 	// link
@@ -491,6 +608,8 @@ void CSnapshotBuilder::Init()
 {
 	m_DataSize = 0;
 	m_NumItems = 0;
+	m_Index.Init(m_aIndexSlots, CSnapshotIndex::MAX_SLOTS);
+	m_NumIndexed = -1;
 }
 
 CSnapshotItem *CSnapshotBuilder::GetItem(int Index)
@@ -500,13 +619,19 @@ CSnapshotItem *CSnapshotBuilder::GetItem(int Index)
 
 int *CSnapshotBuilder::GetItemData(int Key)
 {
-	int i;
-	for(i = 0; i < m_NumItems; i++)
+	// index what got added since the last lookup
+	if(m_NumIndexed < 0)
 	{
-		if(GetItem(i)->Key() == Key)
-			return (int *)GetItem(i)->Data();
+		m_Index.Clear(MAX_ITEMS);
+		m_NumIndexed = 0;
 	}
-	return 0;
+	for(; m_NumIndexed < m_NumItems; m_NumIndexed++)
+		m_Index.Insert(GetItem(m_NumIndexed)->Key(), m_NumIndexed);
+
+	int Index = m_Index.Find(Key);
+	if(Index == -1)
+		return 0;
+	return (int *)GetItem(Index)->Data();
 }
 
 int CSnapshotBuilder::Finish(void *SpnapData)
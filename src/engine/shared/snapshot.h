@@ -45,6 +45,36 @@ public:
 };
 
 
+// CSnapshotIndex
+
+// open addressing table from item keys to item indices. the table memory
+// is owned by the user, a snapshot that doesn't fit is searched linearly
+class CSnapshotIndex
+{
+	int *m_pSlots; // key and item index pairs, the index is -1 for empty slots
+	int m_MaxSlots;
+	int m_Mask;
+	CSnapshot *m_pSnap;
+
+	static unsigned Hash(int Key) { return ((unsigned)Key*0x9E3779B1u)>>16; }
+
+public:
+	enum
+	{
+		MAX_ITEMS=1024,
+		MAX_SLOTS=MAX_ITEMS*2,
+	};
+
+	static int NumSlots(int NumItems);
+
+	void Init(int *pSlots, int MaxSlots);
+	void Clear(int NumItems);
+	void Insert(int Key, int Index);
+	void Build(CSnapshot *pSnap);
+	int Find(int Key) const;
+};
+
+
 // CSnapshotDelta
 
 class CSnapshotDelta
@@ -75,7 +105,8 @@ public:
 	int GetDataUpdates(int Index) { return m_aSnapshotDataUpdates[Index]; }
 	void SetStaticsize(int ItemType, int Size);
 	CData *EmptyDelta();
-	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData);
+	// pItemBytes, if given, gets the packed bytes of every item type added, it needs 64 entries
+	int CreateDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int *pItemBytes = 0);
 	int UnpackDelta(class CSnapshot *pFrom, class CSnapshot *pTo, void *pData, int DataSize);
 };
 
@@ -97,6 +128,9 @@ public:
 		int m_SnapSize;
 		CSnapshot *m_pSnap;
 		CSnapshot *m_pAltSnap;
+
+		// only built for holders with an alternative snapshot
+		CSnapshotIndex m_Index;
 	};
 
 
@@ -114,7 +148,7 @@ class CSnapshotBuilder
 {
 	enum
 	{
-		MAX_ITEMS = 1024
+		MAX_ITEMS = CSnapshotIndex::MAX_ITEMS
 	};
 
 	char m_aData[CSnapshot::MAX_SIZE];
@@ -123,6 +157,11 @@ class CSnapshotBuilder
 	int m_aOffsets[MAX_ITEMS];
 	int m_NumItems;
 
+	// built on the first lookup, the server only adds items
+	int m_aIndexSlots[CSnapshotIndex::MAX_SLOTS*2];
+	CSnapshotIndex m_Index;
+	int m_NumIndexed;
+
 public:
 	void Init();
 
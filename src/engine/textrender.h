@@ -12,6 +12,7 @@ enum
 };
 
 class CFont;
+class CTextLayout;
 
 class CTextCursor
 {
@@ -44,6 +45,12 @@ public:
 	//
 	virtual void TextEx(CTextCursor *pCursor, const char *pText, int Length) = 0;
 
+	// laid out text for strings that get drawn over and over, like names.
+	// the layout is cached, it is only valid until the next text call
+	virtual CTextLayout *TextLayout(float Size, const char *pText, int Length, float LineWidth) = 0;
+	virtual float TextLayoutWidth(const CTextLayout *pLayout) = 0;
+	virtual void TextLayoutDraw(const CTextLayout *pLayout, float x, float y, float r, float g, float b, float a) = 0;
+
 	// old foolish interface
 	virtual void TextColor(float r, float g, float b, float a) = 0;
 	virtual void TextOutlineColor(float r, float g, float b, float a) = 0;
@@ -38,6 +38,7 @@ public:
 	virtual void OnReset() {};
 	virtual void OnRender() {};
 	virtual void OnRelease() {};
+	virtual void OnShutdown() {};
 	virtual void OnMapLoad() {};
 	virtual void OnMessage(int Msg, void *pRawMsg) {}
 	virtual bool OnMouseMove(float x, float y) { return false; }
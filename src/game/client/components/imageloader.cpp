@@ -0,0 +1,236 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/system.h>
+
+#include <engine/engine.h>
+#include <engine/graphics.h>
+#include <engine/storage.h>
+#include <engine/shared/config.h>
+
+#include "imageloader.h"
+
+CImageLoader::CImageLoader()
+{
+	m_pFirstRequest = 0;
+	m_pLastRequest = 0;
+
+	m_BatchStart = 0;
+	m_BatchImages = 0;
+	m_BatchFailed = 0;
+	m_BatchIoTime = 0;
+	m_BatchDecodeTime = 0;
+	m_BatchUploadTime = 0;
+}
+
+void CImageLoader::OnInit()
+{
+	if(g_Config.m_ClThreadimageloading)
+		m_pClient->Engine()->InitJobThreads(g_Config.m_ClImageThreads);
+}
+
+void CImageLoader::Decode(CRequest *pRequest)
+{
+	int64 Start = time_get();
+
+	// read the whole file first to tell the io and decode time apart
+	char aCompleteFilename[512];
+	IOHANDLE File = pRequest->m_pStorage->OpenFile(pRequest->m_aFilename, IOFLAG_READ, pRequest->m_StorageType, aCompleteFilename, sizeof(aCompleteFilename));
+	if(!File)
+	{
+		dbg_msg("game/png", "failed to open file. filename='%s'", pRequest->m_aFilename);
+		pRequest->m_IoTime = time_get()-Start;
+		return;
+	}
+
+	unsigned FileSize = (unsigned)io_length(File);
+	unsigned char *pFileData = (unsigned char *)mem_alloc(FileSize, 1);
+	unsigned ReadSize = io_read(File, pFileData, FileSize);
+	io_close(File);
+
+	int64 Read = time_get();
+	pRequest->m_IoTime = Read-Start;
+
+	if(ReadSize == FileSize)
+		pRequest->m_Loaded = pRequest->m_pGraphics->DecodePNG(&pRequest->m_Image, pFileData, FileSize, aCompleteFilename) != 0;
+	mem_free(pFileData);
+
+	pRequest->m_DecodeTime = time_get()-Read;
+}
+
+int CImageLoader::LoadThread(void *pUser)
+{
+	Decode(static_cast<CRequest *>(pUser));
+	return 0;
+}
+
+int CImageLoader::CreateTexture()
+{
+	static const unsigned char s_aEmpty[4] = {0};
+	return Graphics()->LoadTextureRaw(1, 1, CImageInfo::FORMAT_RGBA, s_aEmpty, CImageInfo::FORMAT_RGBA, IGraphics::TEXLOAD_NORESAMPLE|IGraphics::TEXLOAD_NOMIPMAPS);
+}
+
+void CImageLoader::Queue(CRequest *pRequest)
+{
+	pRequest->m_pGraphics = Graphics();
+	pRequest->m_pStorage = Storage();
+	pRequest->m_Cancelled = false;
+	pRequest->m_Loaded = false;
+	mem_zero(&pRequest->m_Image, sizeof(pRequest->m_Image));
+	pRequest->m_IoTime = 0;
+	pRequest->m_DecodeTime = 0;
+	pRequest->m_pNext = 0;
+
+	if(!m_pFirstRequest && !m_BatchImages)
+	{
+		m_BatchStart = time_get();
+		m_BatchImages = 0;
+		m_BatchFailed = 0;
+		m_BatchIoTime = 0;
+		m_BatchDecodeTime = 0;
+		m_BatchUploadTime = 0;
+	}
+
+	if(!g_Config.m_ClThreadimageloading)
+	{
+		// load it right away
+		Decode(pRequest);
+		Upload(pRequest);
+		delete pRequest;
+		return;
+	}
+
+	if(m_pLastRequest)
+		m_pLastRequest->m_pNext = pRequest;
+	else
+		m_pFirstRequest = pRequest;
+	m_pLastRequest = pRequest;
+
+	m_pClient->Engine()->AddJob(&pRequest->m_Job, LoadThread, pRequest);
+}
+
+int CImageLoader::LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags)
+{
+	CRequest *pRequest = new CRequest;
+	str_copy(pRequest->m_aFilename, pFilename, sizeof(pRequest->m_aFilename));
+	pRequest->m_StorageType = StorageType;
+	pRequest->m_Texture = CreateTexture();
+	pRequest->m_StoreFormat = StoreFormat;
+	pRequest->m_Flags = Flags;
+	pRequest->m_pfnLoaded = 0;
+	pRequest->m_pUser = 0;
+
+	int Texture = pRequest->m_Texture;
+	Queue(pRequest);
+	return Texture;
+}
+
+void CImageLoader::Load(const char *pFilename, int StorageType, FImageLoaded pfnLoaded, void *pUser)
+{
+	CRequest *pRequest = new CRequest;
+	str_copy(pRequest->m_aFilename, pFilename, sizeof(pRequest->m_aFilename));
+	pRequest->m_StorageType = StorageType;
+	pRequest->m_Texture = -1;
+	pRequest->m_StoreFormat = CImageInfo::FORMAT_AUTO;
+	pRequest->m_Flags = 0;
+	pRequest->m_pfnLoaded = pfnLoaded;
+	pRequest->m_pUser = pUser;
+	Queue(pRequest);
+}
+
+void CImageLoader::Cancel(int TextureID)
+{
+	for(CRequest *pRequest = m_pFirstRequest; pRequest; pRequest = pRequest->m_pNext)
+	{
+		if(pRequest->m_Texture == TextureID)
+			pRequest->m_Cancelled = true;
+	}
+}
+
+int CImageLoader::Upload(CRequest *pRequest)
+{
+	int Size = 0;
+	if(!pRequest->m_Cancelled)
+	{
+		int64 Start = time_get();
+		CImageInfo *pImg = pRequest->m_Loaded ? &pRequest->m_Image : 0;
+		if(pImg)
+		{
+			Size = pImg->m_Width*pImg->m_Height*(pImg->m_Format == CImageInfo::FORMAT_RGB ? 3 : 4);
+			if(g_Config.m_Debug)
+				dbg_msg("graphics/texture", "loaded %s", pRequest->m_aFilename);
+		}
+
+		if(pRequest->m_pfnLoaded)
+			pRequest->m_pfnLoaded(pRequest->m_aFilename, pImg, pRequest->m_pUser);
+		else if(pImg)
+		{
+			int StoreFormat = pRequest->m_StoreFormat == CImageInfo::FORMAT_AUTO ? pImg->m_Format : pRequest->m_StoreFormat;
+			Graphics()->LoadTextureRawReplace(pRequest->m_Texture, pImg->m_Width, pImg->m_Height, pImg->m_Format, pImg->m_pData, StoreFormat, pRequest->m_Flags);
+		}
+
+		m_BatchUploadTime += time_get()-Start;
+		m_BatchIoTime += pRequest->m_IoTime;
+		m_BatchDecodeTime += pRequest->m_DecodeTime;
+		m_BatchImages++;
+		if(!pImg)
+			m_BatchFailed++;
+	}
+
+	mem_free(pRequest->m_Image.m_pData);
+	pRequest->m_Image.m_pData = 0;
+	return Size;
+}
+
+void CImageLoader::OnRender()
+{
+	// hand over the decoded images, in any order, until the budget is used up
+	int Budget = g_Config.m_ClImageUploadBudget*1024;
+	int Uploaded = 0;
+	CRequest **ppRequest = &m_pFirstRequest;
+	CRequest *pPrev = 0;
+	while(*ppRequest && (!Budget || Uploaded < Budget))
+	{
+		CRequest *pRequest = *ppRequest;
+		if(pRequest->m_Job.Status() != CJob::STATE_DONE)
+		{
+			pPrev = pRequest;
+			ppRequest = &pRequest->m_pNext;
+			continue;
+		}
+
+		Uploaded += Upload(pRequest);
+
+		*ppRequest = pRequest->m_pNext;
+		if(m_pLastRequest == pRequest)
+			m_pLastRequest = pPrev;
+		delete pRequest;
+	}
+
+	if(!m_pFirstRequest && m_BatchImages)
+	{
+		// the queue ran empty, report where the time went
+		int64 Freq = time_freq();
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "loaded %d images (%d failed) in %.2fms: io %.2fms, decode %.2fms on %d threads, upload %.2fms",
+			m_BatchImages, m_BatchFailed, (time_get()-m_BatchStart)*1000.0f/Freq, m_BatchIoTime*1000.0f/Freq,
+			m_BatchDecodeTime*1000.0f/Freq, g_Config.m_ClThreadimageloading ? m_pClient->Engine()->NumJobThreads() : 1, m_BatchUploadTime*1000.0f/Freq);
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "images", aBuf);
+		m_BatchImages = 0;
+	}
+}
+
+void CImageLoader::OnShutdown()
+{
+	// the job pool can't drop queued jobs, so wait for them to finish
+	while(m_pFirstRequest)
+	{
+		CRequest *pRequest = m_pFirstRequest;
+		while(pRequest->m_Job.Status() != CJob::STATE_DONE)
+			thread_sleep(1);
+
+		m_pFirstRequest = pRequest->m_pNext;
+		mem_free(pRequest->m_Image.m_pData);
+		delete pRequest;
+	}
+	m_pLastRequest = 0;
+}
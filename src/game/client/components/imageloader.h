@@ -0,0 +1,89 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_CLIENT_COMPONENTS_IMAGELOADER_H
+#define GAME_CLIENT_COMPONENTS_IMAGELOADER_H
+#include <engine/graphics.h>
+#include <engine/shared/jobs.h>
+#include <game/client/component.h>
+
+/*
+	Class: CImageLoader
+		Reads and decodes png files on the engine job pool. The decoded
+		images are handed back on the render thread, a few per frame
+		within the upload budget (cl_image_upload_budget).
+
+		Textures are reserved right away and stay empty until their image
+		is uploaded, so the ids can be stored before the loading is done.
+*/
+class CImageLoader : public CComponent
+{
+public:
+	// called on the render thread, pImg is 0 when the image could not be loaded.
+	// the image data gets freed afterwards
+	typedef void (*FImageLoaded)(const char *pFilename, CImageInfo *pImg, void *pUser);
+
+private:
+	class CRequest
+	{
+	public:
+		CJob m_Job;
+		class IGraphics *m_pGraphics;
+		class IStorage *m_pStorage;
+
+		char m_aFilename[128];
+		int m_StorageType;
+
+		// either a texture to fill or a callback
+		int m_Texture;
+		int m_StoreFormat;
+		int m_Flags;
+		FImageLoaded m_pfnLoaded;
+		void *m_pUser;
+
+		bool m_Cancelled;
+		bool m_Loaded;
+		CImageInfo m_Image;
+		int64 m_IoTime;
+		int64 m_DecodeTime;
+
+		CRequest *m_pNext;
+	};
+
+	CRequest *m_pFirstRequest;
+	CRequest *m_pLastRequest;
+
+	// statistics of the images loaded since the queue was last empty
+	int64 m_BatchStart;
+	int m_BatchImages;
+	int m_BatchFailed;
+	int64 m_BatchIoTime;
+	int64 m_BatchDecodeTime;
+	int64 m_BatchUploadTime;
+
+	static int LoadThread(void *pUser);
+	static void Decode(CRequest *pRequest);
+
+	void Queue(CRequest *pRequest);
+	int Upload(CRequest *pRequest);
+
+public:
+	CImageLoader();
+
+	// a texture that is empty until it gets replaced
+	int CreateTexture();
+
+	// loads the image into a new texture and returns its id right away
+	int LoadTexture(const char *pFilename, int StorageType, int StoreFormat, int Flags);
+	void Load(const char *pFilename, int StorageType, FImageLoaded pfnLoaded, void *pUser);
+
+	// drops a pending load into the texture, call it before unloading the texture
+	void Cancel(int TextureID);
+
+	bool IsLoading() const { return m_pFirstRequest != 0; }
+
+	virtual void OnInit();
+	virtual void OnRender();
+	virtual void OnShutdown();
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <engine/storage.h>
 #include <game/client/component.h>
 #include <game/mapitems.h>
+#include <game/client/components/imageloader.h>
 
 #include "mapimages.h"
 
@@ -20,6 +21,7 @@ void CMapImages::OnMapLoad()
 	// unload all textures
 	for(int i = 0; i < m_Count; i++)
 	{
+		m_pClient->m_pImageLoader->Cancel(m_aTextures[i]);
 		Graphics()->UnloadTexture(m_aTextures[i]);
 		m_aTextures[i] = -1;
 	}
@@ -39,7 +41,7 @@ void CMapImages::OnMapLoad()
 			char Buf[256];
 			char *pName = (char *)pMap->GetData(pImg->m_ImageName);
 			str_format(Buf, sizeof(Buf), "mapres/%s.png", pName);
-			m_aTextures[i] = Graphics()->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+			m_aTextures[i] = m_pClient->m_pImageLoader->LoadTexture(Buf, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
 		}
 		else
 		{
@@ -25,6 +25,8 @@ CMapLayers::CMapLayers(int t)
 	m_CurrentLocalTick = 0;
 	m_LastLocalTick = 0;
 	m_EnvelopeUpdate = false;
+	m_pTileBuffers = 0;
+	m_NumTileBuffers = 0;
 }
 
 void CMapLayers::OnInit()
@@ -32,6 +34,29 @@ void CMapLayers::OnInit()
 	m_pLayers = Layers();
 }
 
+void CMapLayers::FreeTileBuffers()
+{
+	for(int i = 0; i < m_NumTileBuffers; i++)
+		RenderTools()->RenderTilemapFree(&m_pTileBuffers[i]);
+	delete [] m_pTileBuffers;
+	m_pTileBuffers = 0;
+	m_NumTileBuffers = 0;
+}
+
+void CMapLayers::OnMapLoad()
+{
+	// the buffers get filled when a layer is rendered the first time
+	FreeTileBuffers();
+	m_NumTileBuffers = m_pLayers->NumLayers();
+	if(m_NumTileBuffers)
+		m_pTileBuffers = new CTileLayerBuffer[m_NumTileBuffers];
+}
+
+void CMapLayers::OnShutdown()
+{
+	FreeTileBuffers();
+}
+
 void CMapLayers::EnvelopeUpdate()
 {
 	if(Client()->State() == IClient::STATE_DEMOPLAYBACK)
@@ -215,13 +240,27 @@ void CMapLayers::OnRender()
 						Graphics()->TextureSet(m_pClient->m_pMapimages->Get(pTMap->m_Image));
 
 					CTile *pTiles = (CTile *)m_pLayers->Map()->GetData(pTMap->m_Data);
-					Graphics()->BlendNone();
 					vec4 Color = vec4(pTMap->m_Color.r/255.0f, pTMap->m_Color.g/255.0f, pTMap->m_Color.b/255.0f, pTMap->m_Color.a/255.0f);
-					RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
-													EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
-					Graphics()->BlendNormal();
-					RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
-													EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+					int LayerIndex = pGroup->m_StartLayer+l;
+					if(g_Config.m_GfxTileBuffers && LayerIndex < m_NumTileBuffers)
+					{
+						CTileLayerBuffer *pBuffer = &m_pTileBuffers[LayerIndex];
+						Graphics()->BlendNone();
+						RenderTools()->RenderTilemapBuffered(pBuffer, pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						Graphics()->BlendNormal();
+						RenderTools()->RenderTilemapBuffered(pBuffer, pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+					}
+					else
+					{
+						Graphics()->BlendNone();
+						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_OPAQUE,
+														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+						Graphics()->BlendNormal();
+						RenderTools()->RenderTilemap(pTiles, pTMap->m_Width, pTMap->m_Height, 32.0f, Color, TILERENDERFLAG_EXTEND|LAYERRENDERFLAG_TRANSPARENT,
+														EnvelopeEval, this, pTMap->m_ColorEnv, pTMap->m_ColorEnvOffset);
+					}
 				}
 				else if(pLayer->m_Type == LAYERTYPE_QUADS)
 				{
@@ -12,6 +12,12 @@ class CMapLayers : public CComponent
 	int m_LastLocalTick;
 	bool m_EnvelopeUpdate;
 
+	// one per map layer, only tile layers rendered by this component get filled
+	class CTileLayerBuffer *m_pTileBuffers;
+	int m_NumTileBuffers;
+
+	void FreeTileBuffers();
+
 	void MapScreenToGroup(float CenterX, float CenterY, CMapItemGroup *pGroup);
 	static void EnvelopeEval(float TimeOffset, int Env, float *pChannels, void *pUser);
 public:
@@ -23,6 +29,8 @@ public:
 
 	CMapLayers(int Type);
 	virtual void OnInit();
+	virtual void OnMapLoad();
+	virtual void OnShutdown();
 	virtual void OnRender();
 
 	void EnvelopeUpdate();
@@ -30,19 +30,21 @@ void CNamePlates::RenderNameplate(
 			a = clamp(1-powf(distance(m_pClient->m_pControls->m_TargetPos, Position)/200.0f,16.0f), 0.0f, 1.0f);
 
 		const char *pName = m_pClient->m_aClients[pPlayerInfo->m_ClientID].m_aName;
-		float tw = TextRender()->TextWidth(0, FontSize, pName, -1);
+		// the name is laid out once and kept in the layout cache
+		CTextLayout *pLayout = TextRender()->TextLayout(FontSize, pName, -1, -1);
+		float tw = TextRender()->TextLayoutWidth(pLayout);
 
-		TextRender()->TextOutlineColor(0.0f, 0.0f, 0.0f, 0.5f*a);
-		TextRender()->TextColor(1.0f, 1.0f, 1.0f, a);
+		vec3 Color(1.0f, 1.0f, 1.0f);
 		if(g_Config.m_ClNameplatesTeamcolors && m_pClient->m_Snap.m_pGameInfoObj && m_pClient->m_Snap.m_pGameInfoObj->m_GameFlags&GAMEFLAG_TEAMS)
 		{
 			if(pPlayerInfo->m_Team == TEAM_RED)
-				TextRender()->TextColor(1.0f, 0.5f, 0.5f, a);
+				Color = vec3(1.0f, 0.5f, 0.5f);
 			else if(pPlayerInfo->m_Team == TEAM_BLUE)
-				TextRender()->TextColor(0.7f, 0.7f, 1.0f, a);
+				Color = vec3(0.7f, 0.7f, 1.0f);
 		}
 
-		TextRender()->Text(0, Position.x-tw/2.0f, Position.y-FontSize-38.0f, FontSize, pName, -1);
+		TextRender()->TextOutlineColor(0.0f, 0.0f, 0.0f, 0.5f*a);
+		TextRender()->TextLayoutDraw(pLayout, Position.x-tw/2.0f, Position.y-FontSize-38.0f, Color.r, Color.g, Color.b, a);
 
 		if(g_Config.m_Debug) // render client id when in debug aswell
 		{
@@ -51,7 +53,6 @@ void CNamePlates::RenderNameplate(
 			TextRender()->Text(0, Position.x, Position.y-90, 28.0f, aBuf, -1);
 		}
 
-		TextRender()->TextColor(1,1,1,1);
 		TextRender()->TextOutlineColor(0.0f, 0.0f, 0.0f, 0.3f);
 	}
 }
@@ -21,18 +21,12 @@ CParticles::CParticles()
 void CParticles::OnReset()
 {
 	// reset particles
-	for(int i = 0; i < MAX_PARTICLES; i++)
+	for(int i = 0; i < NUM_GROUPS; i++)
 	{
-		m_aParticles[i].m_PrevPart = i-1;
-		m_aParticles[i].m_NextPart = i+1;
+		m_aGroups[i].m_Start = 0;
+		m_aGroups[i].m_Num = 0;
 	}
-
-	m_aParticles[0].m_PrevPart = 0;
-	m_aParticles[MAX_PARTICLES-1].m_NextPart = -1;
-	m_FirstFree = 0;
-
-	for(int i = 0; i < NUM_GROUPS; i++)
-		m_aFirstPart[i] = -1;
+	m_NumParticles = 0;
 }
 
 void CParticles::Add(int Group, CParticle *pPart)
@@ -49,27 +43,73 @@ void CParticles::Add(int Group, CParticle *pPart)
 			return;
 	}
 
-	if (m_FirstFree == -1)
+	if(m_NumParticles == MAX_PARTICLES)
 		return;
 
-	// remove from the free list
-	int Id = m_FirstFree;
-	m_FirstFree = m_aParticles[Id].m_NextPart;
-	if(m_FirstFree != -1)
-		m_aParticles[m_FirstFree].m_PrevPart = -1;
+	// make room behind the group, the first particle of each group behind it moves to its end
+	for(int g = NUM_GROUPS-1; g > Group; g--)
+	{
+		CGroup *pGroup = &m_aGroups[g];
+		if(pGroup->m_Num)
+			Move(pGroup->m_Start, pGroup->m_Start+pGroup->m_Num);
+		pGroup->m_Start++;
+	}
 
-	// copy data
-	m_aParticles[Id] = *pPart;
+	// append to the group
+	CGroup *pGroup = &m_aGroups[Group];
+	int i = pGroup->m_Start + pGroup->m_Num++;
+	m_NumParticles++;
+
+	m_aPosX[i] = pPart->m_Pos.x;
+	m_aPosY[i] = pPart->m_Pos.y;
+	m_aVelX[i] = pPart->m_Vel.x;
+	m_aVelY[i] = pPart->m_Vel.y;
+	m_aLife[i] = 0;
+	m_aLifeSpan[i] = pPart->m_LifeSpan;
+	m_aStartSize[i] = pPart->m_StartSize;
+	m_aEndSize[i] = pPart->m_EndSize;
+	m_aRot[i] = pPart->m_Rot;
+	m_aRotspeed[i] = pPart->m_Rotspeed;
+	m_aGravity[i] = pPart->m_Gravity;
+	m_aFriction[i] = pPart->m_Friction;
+	m_aColor[i] = pPart->m_Color;
+	m_aSpr[i] = pPart->m_Spr;
+}
 
-	// insert to the group list
-	m_aParticles[Id].m_PrevPart = -1;
-	m_aParticles[Id].m_NextPart = m_aFirstPart[Group];
-	if(m_aFirstPart[Group] != -1)
-		m_aParticles[m_aFirstPart[Group]].m_PrevPart = Id;
-	m_aFirstPart[Group] = Id;
+void CParticles::Move(int From, int To)
+{
+	m_aPosX[To] = m_aPosX[From];
+	m_aPosY[To] = m_aPosY[From];
+	m_aVelX[To] = m_aVelX[From];
+	m_aVelY[To] = m_aVelY[From];
+	m_aLife[To] = m_aLife[From];
+	m_aLifeSpan[To] = m_aLifeSpan[From];
+	m_aStartSize[To] = m_aStartSize[From];
+	m_aEndSize[To] = m_aEndSize[From];
+	m_aRot[To] = m_aRot[From];
+	m_aRotspeed[To] = m_aRotspeed[From];
+	m_aGravity[To] = m_aGravity[From];
+	m_aFriction[To] = m_aFriction[From];
+	m_aColor[To] = m_aColor[From];
+	m_aSpr[To] = m_aSpr[From];
+}
 
-	// set some parameters
-	m_aParticles[Id].m_Life = 0;
+void CParticles::Remove(int Group, int Index)
+{
+	CGroup *pGroup = &m_aGroups[Group];
+	int Last = pGroup->m_Start + --pGroup->m_Num;
+	m_NumParticles--;
+	if(Index != Last)
+		Move(Last, Index);
+
+	// close the gap, the last particle of each group behind it moves to its front
+	for(int g = Group+1; g < NUM_GROUPS; g++)
+	{
+		pGroup = &m_aGroups[g];
+		pGroup->m_Start--;
+		if(pGroup->m_Num)
+			Move(pGroup->m_Start+pGroup->m_Num, pGroup->m_Start);
+	}
 }
 
 void CParticles::Update(float TimePassed)
@@ -89,45 +129,57 @@ void CParticles::Update(float TimePassed)
 
 	for(int g = 0; g < NUM_GROUPS; g++)
 	{
-		int i = m_aFirstPart[g];
-		while(i != -1)
-		{
-			int Next = m_aParticles[i].m_NextPart;
-			//m_aParticles[i].vel += flow_get(m_aParticles[i].pos)*time_passed * m_aParticles[i].flow_affected;
-			m_aParticles[i].m_Vel.y += m_aParticles[i].m_Gravity*TimePassed;
+		int Start = m_aGroups[g].m_Start;
+		int End = Start+m_aGroups[g].m_Num;
 
-			for(int f = 0; f < FrictionCount; f++) // apply friction
-				m_aParticles[i].m_Vel *= m_aParticles[i].m_Friction;
+		// the plain loops over the arrays get vectorised by the compiler
+		for(int i = Start; i < End; i++)
+			m_aVelY[i] += m_aGravity[i]*TimePassed;
 
-			// move the point
-			vec2 Vel = m_aParticles[i].m_Vel*TimePassed;
-			Collision()->MovePoint(&m_aParticles[i].m_Pos, &Vel, 0.1f+0.9f*frandom(), NULL);
-			m_aParticles[i].m_Vel = Vel* (1.0f/TimePassed);
+		for(int f = 0; f < FrictionCount; f++) // apply friction
+		{
+			for(int i = Start; i < End; i++)
+			{
+				m_aVelX[i] *= m_aFriction[i];
+				m_aVelY[i] *= m_aFriction[i];
+			}
+		}
 
-			m_aParticles[i].m_Life += TimePassed;
-			m_aParticles[i].m_Rot += TimePassed * m_aParticles[i].m_Rotspeed;
+		for(int i = Start; i < End; i++)
+		{
+			m_aNextX[i] = m_aPosX[i] + m_aVelX[i]*TimePassed;
+			m_aNextY[i] = m_aPosY[i] + m_aVelY[i]*TimePassed;
+			m_aLife[i] += TimePassed;
+			m_aRot[i] += TimePassed * m_aRotspeed[i];
+		}
 
-			// check particle death
-			if(m_aParticles[i].m_Life > m_aParticles[i].m_LifeSpan)
+		// move the points, the ones that hit something bounce like in CCollision::MovePoint
+		Collision()->CheckPoints(&m_aNextX[Start], &m_aNextY[Start], End-Start, &m_aSolid[Start]);
+		for(int i = Start; i < End; i++)
+		{
+			if(!m_aSolid[i])
 			{
-				// remove it from the group list
-				if(m_aParticles[i].m_PrevPart != -1)
-					m_aParticles[m_aParticles[i].m_PrevPart].m_NextPart = m_aParticles[i].m_NextPart;
-				else
-					m_aFirstPart[g] = m_aParticles[i].m_NextPart;
-
-				if(m_aParticles[i].m_NextPart != -1)
-					m_aParticles[m_aParticles[i].m_NextPart].m_PrevPart = m_aParticles[i].m_PrevPart;
-
-				// insert to the free list
-				if(m_FirstFree != -1)
-					m_aParticles[m_FirstFree].m_PrevPart = i;
-				m_aParticles[i].m_PrevPart = -1;
-				m_aParticles[i].m_NextPart = m_FirstFree;
-				m_FirstFree = i;
+				m_aPosX[i] = m_aNextX[i];
+				m_aPosY[i] = m_aNextY[i];
+				continue;
 			}
 
-			i = Next;
+			float Elasticity = 0.1f+0.9f*frandom();
+			bool HitX = Collision()->CheckPoint(m_aNextX[i], m_aPosY[i]);
+			bool HitY = Collision()->CheckPoint(m_aPosX[i], m_aNextY[i]);
+			if(HitX || !HitY)
+				m_aVelX[i] *= -Elasticity;
+			if(HitY || !HitX)
+				m_aVelY[i] *= -Elasticity;
+		}
+
+		// check particle death, this moves the groups behind but not this one
+		for(int i = Start; i < m_aGroups[g].m_Start+m_aGroups[g].m_Num;)
+		{
+			if(m_aLife[i] > m_aLifeSpan[i])
+				Remove(g, i);
+			else
+				i++;
 		}
 	}
 }
@@ -157,32 +209,62 @@ void CParticles::OnRender()
 
 void CParticles::RenderGroup(int Group)
 {
+	int Start = m_aGroups[Group].m_Start;
+	int Num = m_aGroups[Group].m_Num;
+
 	Graphics()->BlendNormal();
 	//gfx_blend_additive();
 	Graphics()->TextureSet(g_pData->m_aImages[IMAGE_PARTICLES].m_Id);
 	Graphics()->QuadsBegin();
 
-	int i = m_aFirstPart[Group];
-	while(i != -1)
+	for(int First = 0; First < Num; First += RENDER_BATCH)
 	{
-		RenderTools()->SelectSprite(m_aParticles[i].m_Spr);
-		float a = m_aParticles[i].m_Life / m_aParticles[i].m_LifeSpan;
-		vec2 p = m_aParticles[i].m_Pos;
-		float Size = mix(m_aParticles[i].m_StartSize, m_aParticles[i].m_EndSize, a);
+		int Batch = min(Num-First, (int)RENDER_BATCH);
+		for(int j = 0; j < Batch; j++)
+		{
+			int i = Start+First+j;
+
+			// the texture coordinates of the sprite, the whole texture if there is none
+			float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+			if(m_aSpr[i] >= 0 && m_aSpr[i] < g_pData->m_NumSprites)
+			{
+				const CDataSprite *pSpr = &g_pData->m_aSprites[m_aSpr[i]];
+				float GridX = (float)pSpr->m_pSet->m_Gridx;
+				float GridY = (float)pSpr->m_pSet->m_Gridy;
+				u0 = pSpr->m_X/GridX;
+				v0 = pSpr->m_Y/GridY;
+				u1 = (pSpr->m_X+pSpr->m_W)/GridX;
+				v1 = (pSpr->m_Y+pSpr->m_H)/GridY;
+			}
 
-		Graphics()->QuadsSetRotation(m_aParticles[i].m_Rot);
+			float a = m_aLife[i] / m_aLifeSpan[i];
+			float Half = mix(m_aStartSize[i], m_aEndSize[i], a)/2;
 
-		Graphics()->SetColor(
-			m_aParticles[i].m_Color.r,
-			m_aParticles[i].m_Color.g,
-			m_aParticles[i].m_Color.b,
-			m_aParticles[i].m_Color.a); // pow(a, 0.75f) *
+			// the corners go around the quad, rotated around its center
+			float c = cosf(m_aRot[i])*Half;
+			float s = sinf(m_aRot[i])*Half;
+			static const float s_aCornerX[4] = {-1, 1, 1, -1};
+			static const float s_aCornerY[4] = {-1, -1, 1, 1};
+			const float aU[4] = {u0, u1, u1, u0};
+			const float aV[4] = {v0, v0, v1, v1};
 
-		IGraphics::CQuadItem QuadItem(p.x, p.y, Size, Size);
-		Graphics()->QuadsDraw(&QuadItem, 1);
+			IGraphics::CQuadVertex *pVertex = &m_aVertices[j*4];
+			for(int k = 0; k < 4; k++)
+			{
+				pVertex[k].m_X = m_aPosX[i] + s_aCornerX[k]*c - s_aCornerY[k]*s;
+				pVertex[k].m_Y = m_aPosY[i] + s_aCornerX[k]*s + s_aCornerY[k]*c;
+				pVertex[k].m_U = aU[k];
+				pVertex[k].m_V = aV[k];
+				pVertex[k].m_R = m_aColor[i].r;
+				pVertex[k].m_G = m_aColor[i].g;
+				pVertex[k].m_B = m_aColor[i].b;
+				pVertex[k].m_A = m_aColor[i].a; // pow(a, 0.75f) *
+			}
+		}
 
-		i = m_aParticles[i].m_NextPart;
+		Graphics()->QuadsDrawVertices(m_aVertices, Batch);
 	}
+
 	Graphics()->QuadsEnd();
 	Graphics()->BlendNormal();
 }
@@ -3,6 +3,7 @@
 #ifndef GAME_CLIENT_COMPONENTS_PARTICLES_H
 #define GAME_CLIENT_COMPONENTS_PARTICLES_H
 #include <base/vmath.h>
+#include <engine/graphics.h>
 #include <game/client/component.h>
 
 // particles
@@ -41,11 +42,6 @@ struct CParticle
 	float m_Friction;
 
 	vec4 m_Color;
-
-	// set by the particle system
-	float m_Life;
-	int m_PrevPart;
-	int m_NextPart;
 };
 
 class CParticles : public CComponent
@@ -72,12 +68,46 @@ private:
 	enum
 	{
 		MAX_PARTICLES=1024*8,
+
+		// quads that are filled in before they are handed to the graphics
+		RENDER_BATCH=512,
 	};
 
-	CParticle m_aParticles[MAX_PARTICLES];
-	int m_FirstFree;
-	int m_aFirstPart[NUM_GROUPS];
+	// all particles share one pool. the groups are packed after each other
+	// in the order of their ids, a dead one is replaced by the last of its
+	// group and the groups behind it move down by one
+	struct CGroup
+	{
+		int m_Start;
+		int m_Num;
+	};
 
+	CGroup m_aGroups[NUM_GROUPS];
+	int m_NumParticles;
+
+	float m_aPosX[MAX_PARTICLES];
+	float m_aPosY[MAX_PARTICLES];
+	float m_aVelX[MAX_PARTICLES];
+	float m_aVelY[MAX_PARTICLES];
+	float m_aLife[MAX_PARTICLES];
+	float m_aLifeSpan[MAX_PARTICLES];
+	float m_aStartSize[MAX_PARTICLES];
+	float m_aEndSize[MAX_PARTICLES];
+	float m_aRot[MAX_PARTICLES];
+	float m_aRotspeed[MAX_PARTICLES];
+	float m_aGravity[MAX_PARTICLES];
+	float m_aFriction[MAX_PARTICLES];
+	vec4 m_aColor[MAX_PARTICLES];
+	int m_aSpr[MAX_PARTICLES];
+
+	// scratch space of the update and the rendering
+	float m_aNextX[MAX_PARTICLES];
+	float m_aNextY[MAX_PARTICLES];
+	unsigned char m_aSolid[MAX_PARTICLES];
+	IGraphics::CQuadVertex m_aVertices[RENDER_BATCH*4];
+
+	void Move(int From, int To);
+	void Remove(int Group, int Index);
 	void RenderGroup(int Group);
 	void Update(float TimePassed);
 
@@ -9,6 +9,8 @@
 #include <engine/storage.h>
 #include <engine/shared/config.h>
 
+#include <game/client/components/imageloader.h>
+
 #include "skins.h"
 
 int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
@@ -18,18 +20,50 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 	if(l < 4 || IsDir || str_comp(pName+l-4, ".png") != 0)
 		return 0;
 
+	// the textures stay empty until the image got decoded
+	CSkin Skin;
+	Skin.m_OrgTexture = pSelf->m_pClient->m_pImageLoader->CreateTexture();
+	Skin.m_ColorTexture = pSelf->m_pClient->m_pImageLoader->CreateTexture();
+	Skin.m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
+	str_copy(Skin.m_aName, pName, min((int)sizeof(Skin.m_aName),l-3));
+	pSelf->m_aSkins.add(Skin);
+
 	char aBuf[512];
 	str_format(aBuf, sizeof(aBuf), "skins/%s", pName);
-	CImageInfo Info;
-	if(!pSelf->Graphics()->LoadPNG(&Info, aBuf, DirType))
+	pSelf->m_pClient->m_pImageLoader->Load(aBuf, DirType, SkinLoaded, pSelf);
+	return 0;
+}
+
+void CSkins::SkinLoaded(const char *pFilename, CImageInfo *pInfo, void *pUser)
+{
+	CSkins *pSelf = (CSkins *)pUser;
+
+	// find the skin by the name, the sorted list moves the entries
+	CSkin Skin;
+	const char *pName = pFilename+str_length("skins/");
+	str_copy(Skin.m_aName, pName, min((int)sizeof(Skin.m_aName), str_length(pName)-3));
+	int Index = pSelf->Find(Skin.m_aName);
+	if(Index < 0)
+		return;
+	CSkin *pSkin = &pSelf->m_aSkins[Index];
+
+	char aBuf[512];
+	if(!pInfo)
 	{
 		str_format(aBuf, sizeof(aBuf), "failed to load skin from %s", pName);
 		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
-		return 0;
+
+		// broken skins don't get listed, the clients look up their skins by name again with every snapshot
+		pSelf->Graphics()->UnloadTexture(pSkin->m_OrgTexture);
+		pSelf->Graphics()->UnloadTexture(pSkin->m_ColorTexture);
+		pSelf->m_aSkins.remove_index(Index);
+		if(!pSelf->m_aSkins.size())
+			pSelf->AddDummy();
+		return;
 	}
+	CImageInfo Info = *pInfo;
 
-	CSkin Skin;
-	Skin.m_OrgTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
+	pSelf->Graphics()->LoadTextureRawReplace(pSkin->m_OrgTexture, Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
 
 	int BodySize = 96; // body size
 	unsigned char *d = (unsigned char *)Info.m_pData;
@@ -49,7 +83,7 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 				}
 			}
 
-		Skin.m_BloodColor = normalize(vec3(aColors[0], aColors[1], aColors[2]));
+		pSkin->m_BloodColor = normalize(vec3(aColors[0], aColors[1], aColors[2]));
 	}
 
 	// create colorless version
@@ -99,19 +133,13 @@ int CSkins::SkinScan(const char *pName, int IsDir, int DirType, void *pUser)
 			d[y*Pitch+x*4+2] = v;
 		}
 
-	Skin.m_ColorTexture = pSelf->Graphics()->LoadTextureRaw(Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
-	mem_free(Info.m_pData);
+	pSelf->Graphics()->LoadTextureRawReplace(pSkin->m_ColorTexture, Info.m_Width, Info.m_Height, Info.m_Format, Info.m_pData, Info.m_Format, 0);
 
-	// set skin data
-	str_copy(Skin.m_aName, pName, min((int)sizeof(Skin.m_aName),l-3));
 	if(g_Config.m_Debug)
 	{
-		str_format(aBuf, sizeof(aBuf), "load skin %s", Skin.m_aName);
+		str_format(aBuf, sizeof(aBuf), "load skin %s", pSkin->m_aName);
 		pSelf->Console()->Print(IConsole::OUTPUT_LEVEL_ADDINFO, "game", aBuf);
 	}
-	pSelf->m_aSkins.add(Skin);
-
-	return 0;
 }
 
 
@@ -123,15 +151,20 @@ void CSkins::OnInit()
 	if(!m_aSkins.size())
 	{
 		Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "gameclient", "failed to load skins. folder='skins/'");
-		CSkin DummySkin;
-		DummySkin.m_OrgTexture = -1;
-		DummySkin.m_ColorTexture = -1;
-		str_copy(DummySkin.m_aName, "dummy", sizeof(DummySkin.m_aName));
-		DummySkin.m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
-		m_aSkins.add(DummySkin);
+		AddDummy();
 	}
 }
 
+void CSkins::AddDummy()
+{
+	CSkin DummySkin;
+	DummySkin.m_OrgTexture = -1;
+	DummySkin.m_ColorTexture = -1;
+	str_copy(DummySkin.m_aName, "dummy", sizeof(DummySkin.m_aName));
+	DummySkin.m_BloodColor = vec3(1.0f, 1.0f, 1.0f);
+	m_aSkins.add(DummySkin);
+}
+
 int CSkins::Num()
 {
 	return m_aSkins.size();
@@ -31,6 +31,9 @@ public:
 private:
 	sorted_array<CSkin> m_aSkins;
 
+	void AddDummy();
+
 	static int SkinScan(const char *pName, int IsDir, int DirType, void *pUser);
+	static void SkinLoaded(const char *pFilename, class CImageInfo *pInfo, void *pUser);
 };
 #endif
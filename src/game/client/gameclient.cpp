@@ -16,6 +16,7 @@
 #include <game/generated/protocol.h>
 #include <game/generated/client_data.h>
 
+#include <game/gamecore_batch.h>
 #include <game/localization.h>
 #include <game/version.h>
 #include "render.h"
@@ -35,6 +36,7 @@
 #include "components/emoticon.h"
 #include "components/flow.h"
 #include "components/hud.h"
+#include "components/imageloader.h"
 #include "components/items.h"
 #include "components/killmessages.h"
 #include "components/mapimages.h"
@@ -80,6 +82,7 @@ static CPlayers gs_Players;
 static CNamePlates gs_NamePlates;
 static CItems gs_Items;
 static CMapImages gs_MapImages;
+static CImageLoader gs_ImageLoader;
 
 static CMapLayers gs_MapLayersBackGround(CMapLayers::TYPE_BACKGROUND);
 static CMapLayers gs_MapLayersForeGround(CMapLayers::TYPE_FOREGROUND);
@@ -122,6 +125,7 @@ void CGameClient::OnConsoleInit()
 	m_pMotd = &::gs_Motd;
 	m_pDamageind = &::gsDamageInd;
 	m_pMapimages = &::gs_MapImages;
+	m_pImageLoader = &::gs_ImageLoader;
 	m_pVoting = &::gs_Voting;
 	m_pScoreboard = &::gs_Scoreboard;
 	m_pItems = &::gs_Items;
@@ -132,6 +136,7 @@ void CGameClient::OnConsoleInit()
 	m_All.Add(m_pSkins);
 	m_All.Add(m_pCountryFlags);
 	m_All.Add(m_pMapimages);
+	m_All.Add(m_pImageLoader); // gets initialised before the ones above, uploads the images they load
 	m_All.Add(m_pEffects); // doesn't render anything, just updates effects
 	m_All.Add(m_pParticles);
 	m_All.Add(m_pBinds);
@@ -257,7 +262,7 @@ void CGameClient::OnInit()
 	// setup load amount// load textures
 	for(int i = 0; i < g_pData->m_NumImages; i++)
 	{
-		g_pData->m_aImages[i].m_Id = Graphics()->LoadTexture(g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
+		g_pData->m_aImages[i].m_Id = m_pImageLoader->LoadTexture(g_pData->m_aImages[i].m_pFilename, IStorage::TYPE_ALL, CImageInfo::FORMAT_AUTO, 0);
 		g_GameClient.m_pMenus->RenderLoading();
 	}
 
@@ -338,6 +343,10 @@ void CGameClient::OnReset()
 {
 	// clear out the invalid pointers
 	m_LastNewPredictedTick = -1;
+	m_PredictionSnapTick = -1;
+	m_NumPredictedTicks = 0;
+	m_PredictionChecks = 0;
+	m_PredictionErrors = 0;
 	mem_zero(&g_GameClient.m_Snap, sizeof(g_GameClient.m_Snap));
 
 	for(int i = 0; i < MAX_CLIENTS; i++)
@@ -566,7 +575,13 @@ void CGameClient::OnStateChange(int NewState, int OldState)
 		m_All.m_paComponents[i]->OnStateChange(NewState, OldState);
 }
 
-void CGameClient::OnShutdown() {}
+void CGameClient::OnShutdown()
+{
+	// the graphics and sound are still there
+	for(int i = 0; i < m_All.m_Num; i++)
+		m_All.m_paComponents[i]->OnShutdown();
+}
+
 void CGameClient::OnEnterGame() {}
 
 void CGameClient::OnGameOver()
@@ -904,6 +919,23 @@ void CGameClient::OnNewSnapshot()
 	}
 }
 
+void CGameClient::CheckPrediction(int SnapTick)
+{
+	// the snapshot of a tick we predicted shows if the prediction was right
+	int Index = SnapTick-m_PredictionSnapTick-1;
+	if(Index < 0 || Index >= m_NumPredictedTicks || !m_Snap.m_aCharacters[m_PredictionLocalID].m_Active)
+		return;
+
+	CNetObj_CharacterCore Predicted = {0};
+	CNetObj_CharacterCore Received = m_Snap.m_aCharacters[m_PredictionLocalID].m_Cur;
+	m_aPredictedTicks[Index].m_aCores[m_PredictionLocalID].Write(&Predicted);
+	Predicted.m_Tick = Received.m_Tick;
+
+	m_PredictionChecks++;
+	if(mem_comp(&Predicted, &Received, sizeof(CNetObj_CharacterCore)) != 0)
+		m_PredictionErrors++;
+}
+
 void CGameClient::OnPredict()
 {
 	// store the previous values so we can detect prediction errors
@@ -917,6 +949,7 @@ void CGameClient::OnPredict()
 	// don't predict anything if we are paused
 	if(m_Snap.m_pGameInfoObj && m_Snap.m_pGameInfoObj->m_GameStateFlags&GAMESTATEFLAG_PAUSED)
 	{
+		m_PredictionSnapTick = -1;
 		if(m_Snap.m_pLocalCharacter)
 			m_PredictedChar.Read(m_Snap.m_pLocalCharacter);
 		if(m_Snap.m_pLocalPrevCharacter)
@@ -924,56 +957,111 @@ void CGameClient::OnPredict()
 		return;
 	}
 
-	// repredict character
-	CWorldCore World;
-	World.m_Tuning = m_Tuning;
+	int LocalID = m_Snap.m_LocalClientID;
+	int SnapTick = Client()->GameTick();
+	int PredTick = Client()->PredGameTick();
+
+	// a new snapshot, another local player or new tuning make the cached ticks useless
+	if(m_PredictionSnapTick != SnapTick || m_PredictionLocalID != LocalID ||
+		mem_comp(&m_PredictionWorld.m_Tuning, &m_Tuning, sizeof(m_Tuning)) != 0)
+	{
+		if(m_PredictionSnapTick != -1 && m_PredictionLocalID == LocalID)
+			CheckPrediction(SnapTick);
+
+		m_PredictionSnapTick = SnapTick;
+		m_PredictionLocalID = LocalID;
+		m_NumPredictedTicks = 0;
+		m_PredictionWorld.m_Tuning = m_Tuning;
+	}
+
+	// keep the ticks that were simulated with the input we still have for them
+	int NumValid = 0;
+	while(NumValid < m_NumPredictedTicks && SnapTick+NumValid+1 <= PredTick)
+	{
+		const CPredictedTick *pCached = &m_aPredictedTicks[NumValid];
+		int *pInput = Client()->GetInput(SnapTick+NumValid+1);
+		if((pInput != 0) != pCached->m_HasInput || (pInput && mem_comp(pInput, &pCached->m_Input, sizeof(CNetObj_PlayerInput)) != 0))
+			break;
+		NumValid++;
+	}
+	m_NumPredictedTicks = NumValid;
 
-	// search for players
+	// set up the characters from the snapshot or the last valid tick
+	CWorldCore *pWorld = &m_PredictionWorld;
 	for(int i = 0; i < MAX_CLIENTS; i++)
 	{
+		pWorld->m_apCharacters[i] = 0;
 		if(!m_Snap.m_aCharacters[i].m_Active)
 			continue;
 
-		g_GameClient.m_aClients[i].m_Predicted.Init(&World, Collision());
-		World.m_apCharacters[i] = &g_GameClient.m_aClients[i].m_Predicted;
-		g_GameClient.m_aClients[i].m_Predicted.Read(&m_Snap.m_aCharacters[i].m_Cur);
+		if(NumValid)
+			g_GameClient.m_aClients[i].m_Predicted = m_aPredictedTicks[NumValid-1].m_aCores[i];
+		else
+		{
+			g_GameClient.m_aClients[i].m_Predicted.Init(pWorld, Collision());
+			g_GameClient.m_aClients[i].m_Predicted.Read(&m_Snap.m_aCharacters[i].m_Cur);
+		}
+		pWorld->m_apCharacters[i] = &g_GameClient.m_aClients[i].m_Predicted;
 	}
 
-	// predict
-	for(int Tick = Client()->GameTick()+1; Tick <= Client()->PredGameTick(); Tick++)
+	if(SnapTick+NumValid == PredTick)
+	{
+		// nothing new to simulate, the state before the last tick is cached as well
+		if(NumValid >= 2)
+			m_PredictedPrevChar = m_aPredictedTicks[NumValid-2].m_aCores[LocalID];
+		else
+			m_PredictedPrevChar.Read(&m_Snap.m_aCharacters[LocalID].m_Cur);
+		m_PredictedChar = *pWorld->m_apCharacters[LocalID];
+	}
+
+	// only the local player uses its input
+	CWorldCoreBatch Batch;
+	Batch.Init(pWorld, Collision());
+	bool aUseInput[MAX_CLIENTS] = {0};
+	aUseInput[LocalID] = true;
+
+	// predict the ticks that are not cached. with a very high ping the
+	// ticks past the cache are simulated on every prediction again
+	CPredictedTick Uncached;
+	for(int Tick = SnapTick+NumValid+1; Tick <= PredTick; Tick++)
 	{
 		// fetch the local
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_Snap.m_LocalClientID])
-			m_PredictedPrevChar = *World.m_apCharacters[m_Snap.m_LocalClientID];
+		if(Tick == PredTick && pWorld->m_apCharacters[LocalID])
+			m_PredictedPrevChar = *pWorld->m_apCharacters[LocalID];
+
+		bool Cache = Tick-SnapTick <= MAX_PREDICTED_TICKS;
+		CPredictedTick *pCached = Cache ? &m_aPredictedTicks[Tick-SnapTick-1] : &Uncached;
+		pCached->m_HasInput = false;
+		mem_zero(&pCached->m_Input, sizeof(pCached->m_Input));
 
-		// first calculate where everyone should move
 		for(int c = 0; c < MAX_CLIENTS; c++)
 		{
-			if(!World.m_apCharacters[c])
+			if(!pWorld->m_apCharacters[c])
 				continue;
 
-			mem_zero(&World.m_apCharacters[c]->m_Input, sizeof(World.m_apCharacters[c]->m_Input));
-			if(m_Snap.m_LocalClientID == c)
+			mem_zero(&pWorld->m_apCharacters[c]->m_Input, sizeof(pWorld->m_apCharacters[c]->m_Input));
+			if(LocalID == c)
 			{
 				// apply player input
 				int *pInput = Client()->GetInput(Tick);
 				if(pInput)
-					World.m_apCharacters[c]->m_Input = *((CNetObj_PlayerInput*)pInput);
-				World.m_apCharacters[c]->Tick(true);
+				{
+					pWorld->m_apCharacters[c]->m_Input = *((CNetObj_PlayerInput*)pInput);
+					pCached->m_HasInput = true;
+					pCached->m_Input = pWorld->m_apCharacters[c]->m_Input;
+				}
 			}
-			else
-				World.m_apCharacters[c]->Tick(false);
-
 		}
 
-		// move all players and quantize their data
-		for(int c = 0; c < MAX_CLIENTS; c++)
-		{
-			if(!World.m_apCharacters[c])
-				continue;
+		// calculate where everyone should move, move all players and quantize their data
+		Batch.Step(aUseInput, true);
 
-			World.m_apCharacters[c]->Move();
-			World.m_apCharacters[c]->Quantize();
+		if(Cache)
+		{
+			for(int c = 0; c < MAX_CLIENTS; c++)
+				if(pWorld->m_apCharacters[c])
+					pCached->m_aCores[c] = *pWorld->m_apCharacters[c];
+			m_NumPredictedTicks = Tick-SnapTick;
 		}
 
 		// check if we want to trigger effects
@@ -982,10 +1070,10 @@ void CGameClient::OnPredict()
 			m_LastNewPredictedTick = Tick;
 			m_NewPredictedTick = true;
 
-			if(m_Snap.m_LocalClientID != -1 && World.m_apCharacters[m_Snap.m_LocalClientID])
+			if(LocalID != -1 && pWorld->m_apCharacters[LocalID])
 			{
-				vec2 Pos = World.m_apCharacters[m_Snap.m_LocalClientID]->m_Pos;
-				int Events = World.m_apCharacters[m_Snap.m_LocalClientID]->m_TriggeredEvents;
+				vec2 Pos = pWorld->m_apCharacters[LocalID]->m_Pos;
+				int Events = pWorld->m_apCharacters[LocalID]->m_TriggeredEvents;
 				if(Events&COREEVENT_GROUND_JUMP) g_GameClient.m_pSounds->PlayAndRecord(CSounds::CHN_WORLD, SOUND_PLAYER_JUMP, 1.0f, Pos);
 
 				/*if(events&COREEVENT_AIR_JUMP)
@@ -1002,8 +1090,8 @@ void CGameClient::OnPredict()
 			}
 		}
 
-		if(Tick == Client()->PredGameTick() && World.m_apCharacters[m_Snap.m_LocalClientID])
-			m_PredictedChar = *World.m_apCharacters[m_Snap.m_LocalClientID];
+		if(Tick == PredTick && pWorld->m_apCharacters[LocalID])
+			m_PredictedChar = *pWorld->m_apCharacters[LocalID];
 	}
 
 	if(g_Config.m_Debug && g_Config.m_ClPredict && m_PredictedTick == Client()->PredGameTick())
@@ -56,6 +56,28 @@ class CGameClient : public IGameClient
 	int m_PredictedTick;
 	int m_LastNewPredictedTick;
 
+	// the predicted world after every tick since the last snapshot, so
+	// a new prediction tick only simulates the ticks that were added
+	enum
+	{
+		MAX_PREDICTED_TICKS=50,
+	};
+
+	struct CPredictedTick
+	{
+		bool m_HasInput;
+		CNetObj_PlayerInput m_Input; // local input the tick was simulated with
+		CCharacterCore m_aCores[MAX_CLIENTS];
+	};
+
+	CWorldCore m_PredictionWorld;
+	int m_PredictionSnapTick; // -1 if nothing is cached
+	int m_PredictionLocalID;
+	int m_NumPredictedTicks;
+	CPredictedTick m_aPredictedTicks[MAX_PREDICTED_TICKS]; // index is the tick after the snapshot tick minus one
+
+	void CheckPrediction(int SnapTick);
+
 	int64 m_LastSendInfo;
 
 	static void ConTeam(IConsole::IResult *pResult, void *pUserData);
@@ -110,6 +132,10 @@ public:
 	CCharacterCore m_PredictedPrevChar;
 	CCharacterCore m_PredictedChar;
 
+	// local character of new snapshots compared with the prediction of that tick
+	int m_PredictionChecks;
+	int m_PredictionErrors;
+
 	// snap pointers
 	struct CSnapState
 	{
@@ -239,6 +265,7 @@ public:
 	class CSounds *m_pSounds;
 	class CMotd *m_pMotd;
 	class CMapImages *m_pMapimages;
+	class CImageLoader *m_pImageLoader;
 	class CVoting *m_pVoting;
 	class CScoreboard *m_pScoreboard;
 	class CItems *m_pItems;
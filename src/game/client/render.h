@@ -37,6 +37,34 @@ enum
 	LAYERRENDERFLAG_TRANSPARENT=2,
 
 	TILERENDERFLAG_EXTEND=4,
+	TILERENDERFLAG_OUTSIDE=8, // only the tiles around the layer, used with TILERENDERFLAG_EXTEND
+};
+
+// static quads of a tile layer, split into chunks that are drawn with one call each.
+// the transparent quads of a chunk come first, then the opaque ones
+class CTileLayerBuffer
+{
+public:
+	enum
+	{
+		CHUNK_SIZE=32,
+	};
+
+	struct CChunk
+	{
+		int m_FirstQuad;
+		int m_NumTransparent;
+		int m_NumOpaque;
+	};
+
+	int m_BufferID;
+	int m_NumQuads;
+	float m_TilesetScale;
+	int m_NumChunksX;
+	int m_NumChunksY;
+	CChunk *m_pChunks;
+
+	CTileLayerBuffer() : m_BufferID(-1), m_NumQuads(0), m_TilesetScale(0), m_NumChunksX(0), m_NumChunksY(0), m_pChunks(0) {}
 };
 
 typedef void (*ENVELOPE_EVAL)(float TimeOffset, int Env, float *pChannels, void *pUser);
@@ -73,6 +101,9 @@ public:
 	static void RenderEvalEnvelope(CEnvPoint *pPoints, int NumPoints, int Channels, float Time, float *pResult);
 	void RenderQuads(CQuad *pQuads, int NumQuads, int Flags, ENVELOPE_EVAL pfnEval, void *pUser);
 	void RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
+	void RenderTilemapUpload(CTileLayerBuffer *pBuffer, CTile *pTiles, int w, int h, float Scale, float TilesetScale);
+	void RenderTilemapFree(CTileLayerBuffer *pBuffer);
+	void RenderTilemapBuffered(CTileLayerBuffer *pBuffer, CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags, ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset);
 
 	// helpers
 	void MapscreenToWorld(float CenterX, float CenterY, float ParallaxX, float ParallaxY,
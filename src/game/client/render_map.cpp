@@ -163,6 +163,61 @@ void CRenderTools::RenderQuads(CQuad *pQuads, int NumQuads, int RenderFlags, ENV
 	Graphics()->QuadsEnd();
 }
 
+static void TileTexCoords(unsigned char Index, unsigned char Flags, float Frac, float Nudge, float *pCoords)
+{
+	float TexSize = 1024.0f;
+	int tx = Index%16;
+	int ty = Index/16;
+	int Px0 = tx*(1024/16);
+	int Py0 = ty*(1024/16);
+	int Px1 = Px0+(1024/16)-1;
+	int Py1 = Py0+(1024/16)-1;
+
+	float x0 = Nudge + Px0/TexSize+Frac;
+	float y0 = Nudge + Py0/TexSize+Frac;
+	float x1 = Nudge + Px1/TexSize-Frac;
+	float y1 = Nudge + Py0/TexSize+Frac;
+	float x2 = Nudge + Px1/TexSize-Frac;
+	float y2 = Nudge + Py1/TexSize-Frac;
+	float x3 = Nudge + Px0/TexSize+Frac;
+	float y3 = Nudge + Py1/TexSize-Frac;
+
+	if(Flags&TILEFLAG_VFLIP)
+	{
+		x0 = x2;
+		x1 = x3;
+		x2 = x3;
+		x3 = x0;
+	}
+
+	if(Flags&TILEFLAG_HFLIP)
+	{
+		y0 = y3;
+		y2 = y1;
+		y3 = y1;
+		y1 = y0;
+	}
+
+	if(Flags&TILEFLAG_ROTATE)
+	{
+		float Tmp = x0;
+		x0 = x3;
+		x3 = x2;
+		x2 = x1;
+		x1 = Tmp;
+		Tmp = y0;
+		y0 = y3;
+		y3 = y2;
+		y2 = y1;
+		y1 = Tmp;
+	}
+
+	pCoords[0] = x0; pCoords[1] = y0;
+	pCoords[2] = x1; pCoords[3] = y1;
+	pCoords[4] = x2; pCoords[5] = y2;
+	pCoords[6] = x3; pCoords[7] = y3;
+}
+
 void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags,
 									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
 {
@@ -206,6 +261,13 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 			int mx = x;
 			int my = y;
 
+			if(RenderFlags&TILERENDERFLAG_OUTSIDE && mx >= 0 && mx < w && my >= 0 && my < h)
+			{
+				// the inside comes from the layer buffer
+				x = w-1;
+				continue;
+			}
+
 			if(RenderFlags&TILERENDERFLAG_EXTEND)
 			{
 				if(mx<0)
@@ -250,54 +312,10 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 
 				if(Render)
 				{
-
-					int tx = Index%16;
-					int ty = Index/16;
-					int Px0 = tx*(1024/16);
-					int Py0 = ty*(1024/16);
-					int Px1 = Px0+(1024/16)-1;
-					int Py1 = Py0+(1024/16)-1;
-
-					float x0 = Nudge + Px0/TexSize+Frac;
-					float y0 = Nudge + Py0/TexSize+Frac;
-					float x1 = Nudge + Px1/TexSize-Frac;
-					float y1 = Nudge + Py0/TexSize+Frac;
-					float x2 = Nudge + Px1/TexSize-Frac;
-					float y2 = Nudge + Py1/TexSize-Frac;
-					float x3 = Nudge + Px0/TexSize+Frac;
-					float y3 = Nudge + Py1/TexSize-Frac;
-
-					if(Flags&TILEFLAG_VFLIP)
-					{
-						x0 = x2;
-						x1 = x3;
-						x2 = x3;
-						x3 = x0;
-					}
-
-					if(Flags&TILEFLAG_HFLIP)
-					{
-						y0 = y3;
-						y2 = y1;
-						y3 = y1;
-						y1 = y0;
-					}
-
-					if(Flags&TILEFLAG_ROTATE)
-					{
-						float Tmp = x0;
-						x0 = x3;
-						x3 = x2;
-						x2 = x1;
-						x1 = Tmp;
-						Tmp = y0;
-						y0 = y3;
-						y3 = y2;
-						y2 = y1;
-						y1 = Tmp;
- 					}
-
-					Graphics()->QuadsSetSubsetFree(x0, y0, x1, y1, x2, y2, x3, y3);
+					float aTexCoords[8];
+					TileTexCoords(Index, Flags, Frac, Nudge, aTexCoords);
+					Graphics()->QuadsSetSubsetFree(aTexCoords[0], aTexCoords[1], aTexCoords[2], aTexCoords[3],
+						aTexCoords[4], aTexCoords[5], aTexCoords[6], aTexCoords[7]);
 					IGraphics::CQuadItem QuadItem(x*Scale, y*Scale, Scale, Scale);
 					Graphics()->QuadsDrawTL(&QuadItem, 1);
 				}
@@ -308,3 +326,169 @@ void CRenderTools::RenderTilemap(CTile *pTiles, int w, int h, float Scale, vec4
 	Graphics()->QuadsEnd();
 	Graphics()->MapScreen(ScreenX0, ScreenY0, ScreenX1, ScreenY1);
 }
+
+void CRenderTools::RenderTilemapUpload(CTileLayerBuffer *pBuffer, CTile *pTiles, int w, int h, float Scale, float TilesetScale)
+{
+	RenderTilemapFree(pBuffer);
+
+	const int ChunkSize = CTileLayerBuffer::CHUNK_SIZE;
+	pBuffer->m_TilesetScale = TilesetScale;
+	pBuffer->m_NumChunksX = (w+ChunkSize-1)/ChunkSize;
+	pBuffer->m_NumChunksY = (h+ChunkSize-1)/ChunkSize;
+	pBuffer->m_pChunks = new CTileLayerBuffer::CChunk[pBuffer->m_NumChunksX*pBuffer->m_NumChunksY];
+
+	int NumQuads = 0;
+	for(int i = 0; i < w*h; i++)
+		if(pTiles[i].m_Index)
+			NumQuads++;
+
+	// same texture shift as RenderTilemap uses at this tileset scale
+	float TexSize = 1024.0f;
+	float Frac = (1.25f/TexSize) * (1/TilesetScale);
+	float Nudge = (0.5f/TexSize) * (1/TilesetScale);
+
+	IGraphics::CBufferVertex *pVertices = new IGraphics::CBufferVertex[max(NumQuads, 1)*4];
+	IGraphics::CBufferVertex *pVertex = pVertices;
+	int Quad = 0;
+
+	for(int cy = 0; cy < pBuffer->m_NumChunksY; cy++)
+		for(int cx = 0; cx < pBuffer->m_NumChunksX; cx++)
+		{
+			CTileLayerBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+			pChunk->m_FirstQuad = Quad;
+			pChunk->m_NumTransparent = 0;
+			pChunk->m_NumOpaque = 0;
+
+			int EndX = min((cx+1)*ChunkSize, w);
+			int EndY = min((cy+1)*ChunkSize, h);
+
+			// the transparent tiles first, then the opaque ones
+			for(int Pass = 0; Pass < 2; Pass++)
+				for(int y = cy*ChunkSize; y < EndY; y++)
+					for(int x = cx*ChunkSize; x < EndX; x++)
+					{
+						const CTile *pTile = &pTiles[y*w+x];
+						if(!pTile->m_Index || (pTile->m_Flags&TILEFLAG_OPAQUE ? 1 : 0) != Pass)
+							continue;
+
+						float aTexCoords[8];
+						TileTexCoords(pTile->m_Index, pTile->m_Flags, Frac, Nudge, aTexCoords);
+						*pVertex++ = IGraphics::CBufferVertex(x*Scale, y*Scale, aTexCoords[0], aTexCoords[1]);
+						*pVertex++ = IGraphics::CBufferVertex(x*Scale+Scale, y*Scale, aTexCoords[2], aTexCoords[3]);
+						*pVertex++ = IGraphics::CBufferVertex(x*Scale+Scale, y*Scale+Scale, aTexCoords[4], aTexCoords[5]);
+						*pVertex++ = IGraphics::CBufferVertex(x*Scale, y*Scale+Scale, aTexCoords[6], aTexCoords[7]);
+
+						if(Pass)
+							pChunk->m_NumOpaque++;
+						else
+							pChunk->m_NumTransparent++;
+						Quad++;
+					}
+		}
+
+	pBuffer->m_NumQuads = NumQuads;
+	pBuffer->m_BufferID = NumQuads ? Graphics()->CreateQuadBuffer(pVertices, NumQuads) : -1;
+	delete [] pVertices;
+}
+
+void CRenderTools::RenderTilemapFree(CTileLayerBuffer *pBuffer)
+{
+	if(pBuffer->m_BufferID >= 0)
+		Graphics()->DeleteQuadBuffer(pBuffer->m_BufferID);
+	delete [] pBuffer->m_pChunks;
+	pBuffer->m_BufferID = -1;
+	pBuffer->m_pChunks = 0;
+	pBuffer->m_NumQuads = 0;
+}
+
+void CRenderTools::RenderTilemapBuffered(CTileLayerBuffer *pBuffer, CTile *pTiles, int w, int h, float Scale, vec4 Color, int RenderFlags,
+									ENVELOPE_EVAL pfnEval, void *pUser, int ColorEnv, int ColorEnvOffset)
+{
+	float ScreenX0, ScreenY0, ScreenX1, ScreenY1;
+	Graphics()->GetScreen(&ScreenX0, &ScreenY0, &ScreenX1, &ScreenY1);
+
+	// the texture shift depends on the tile size on screen, rebuild when it changed
+	float TilePixelSize = 1024/32.0f;
+	float FinalTileSize = Scale/(ScreenX1-ScreenX0) * Graphics()->ScreenWidth();
+	float FinalTilesetScale = FinalTileSize/TilePixelSize;
+	if(!pBuffer->m_pChunks || pBuffer->m_TilesetScale != FinalTilesetScale)
+		RenderTilemapUpload(pBuffer, pTiles, w, h, Scale, FinalTilesetScale);
+
+	// out of buffers, draw it the slow way
+	if(pBuffer->m_NumQuads && pBuffer->m_BufferID < 0)
+	{
+		RenderTilemap(pTiles, w, h, Scale, Color, RenderFlags, pfnEval, pUser, ColorEnv, ColorEnvOffset);
+		return;
+	}
+
+	float r=1, g=1, b=1, a=1;
+	if(ColorEnv >= 0)
+	{
+		float aChannels[4];
+		pfnEval(ColorEnvOffset/1000.0f, ColorEnv, aChannels, pUser);
+		r = aChannels[0];
+		g = aChannels[1];
+		b = aChannels[2];
+		a = aChannels[3];
+	}
+
+	int StartY = (int)(ScreenY0/Scale)-1;
+	int StartX = (int)(ScreenX0/Scale)-1;
+	int EndY = (int)(ScreenY1/Scale)+1;
+	int EndX = (int)(ScreenX1/Scale)+1;
+
+	// the tiles around the layer are not in the buffer
+	if(RenderFlags&TILERENDERFLAG_EXTEND && (StartX < 0 || StartY < 0 || EndX > w || EndY > h))
+		RenderTilemap(pTiles, w, h, Scale, Color, RenderFlags|TILERENDERFLAG_OUTSIDE, pfnEval, pUser, ColorEnv, ColorEnvOffset);
+
+	if(pBuffer->m_BufferID < 0)
+		return;
+
+	bool Opaque = Color.a*a > 254.0f/255.0f;
+	const int ChunkSize = CTileLayerBuffer::CHUNK_SIZE;
+	int ChunkX0 = max(StartX, 0)/ChunkSize;
+	int ChunkY0 = max(StartY, 0)/ChunkSize;
+	int ChunkX1 = min((max(EndX, 0)+ChunkSize-1)/ChunkSize, pBuffer->m_NumChunksX);
+	int ChunkY1 = min((max(EndY, 0)+ChunkSize-1)/ChunkSize, pBuffer->m_NumChunksY);
+
+	for(int cy = ChunkY0; cy < ChunkY1; cy++)
+	{
+		// neighbouring chunks are next to each other in the buffer, join their draws when possible
+		int First = 0;
+		int Num = 0;
+		for(int cx = ChunkX0; cx < ChunkX1; cx++)
+		{
+			const CTileLayerBuffer::CChunk *pChunk = &pBuffer->m_pChunks[cy*pBuffer->m_NumChunksX+cx];
+			int ChunkFirst = pChunk->m_FirstQuad;
+			int ChunkNum = 0;
+			if(!Opaque)
+			{
+				if(RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+					ChunkNum = pChunk->m_NumTransparent+pChunk->m_NumOpaque;
+			}
+			else if((RenderFlags&LAYERRENDERFLAG_OPAQUE) && (RenderFlags&LAYERRENDERFLAG_TRANSPARENT))
+				ChunkNum = pChunk->m_NumTransparent+pChunk->m_NumOpaque;
+			else if(RenderFlags&LAYERRENDERFLAG_OPAQUE)
+			{
+				ChunkFirst += pChunk->m_NumTransparent;
+				ChunkNum = pChunk->m_NumOpaque;
+			}
+			else if(RenderFlags&LAYERRENDERFLAG_TRANSPARENT)
+				ChunkNum = pChunk->m_NumTransparent;
+
+			if(!ChunkNum)
+				continue;
+			if(Num && First+Num == ChunkFirst)
+			{
+				Num += ChunkNum;
+				continue;
+			}
+			if(Num)
+				Graphics()->RenderQuadBuffer(pBuffer->m_BufferID, First, Num, Color.r*r, Color.g*g, Color.b*b, Color.a*a);
+			First = ChunkFirst;
+			Num = ChunkNum;
+		}
+		if(Num)
+			Graphics()->RenderQuadBuffer(pBuffer->m_BufferID, First, Num, Color.r*r, Color.g*g, Color.b*b, Color.a*a);
+	}
+}
@@ -18,22 +18,28 @@ CCollision::CCollision()
 	m_Width = 0;
 	m_Height = 0;
 	m_pLayers = 0;
+	m_pVisibility = 0;
+	m_VisWidth = 0;
+	m_VisHeight = 0;
 }
 
-void CCollision::Init(class CLayers *pLayers)
+CCollision::~CCollision()
 {
-	m_pLayers = pLayers;
-	m_Width = m_pLayers->GameLayer()->m_Width;
-	m_Height = m_pLayers->GameLayer()->m_Height;
-	m_pTiles = static_cast<CTile *>(m_pLayers->Map()->GetData(m_pLayers->GameLayer()->m_Data));
+	mem_free(m_pVisibility);
+}
 
-	for(int i = 0; i < m_Width*m_Height; i++)
+static void ConvertTiles(void *pData, void *pUser)
+{
+	CTile *pTiles = static_cast<CTile *>(pData);
+	int NumTiles = *static_cast<int *>(pUser);
+
+	for(int i = 0; i < NumTiles; i++)
 	{
-		int Index = m_pTiles[i].m_Index;
+		int Index = pTiles[i].m_Index;
 
 		if (Index >= 208 && Index <= 210) // backwards compatibility to fng maps
 		{
-			m_pTiles[i].m_Index = TILE_SHRINE_ALL + Index - 208;
+			pTiles[i].m_Index = TILE_SHRINE_ALL + Index - 208;
 		}
 		if(Index > 128)
 			continue;
@@ -41,13 +47,13 @@ void CCollision::Init(class CLayers *pLayers)
 		switch(Index)
 		{
 		case TILE_DEATH:
-			m_pTiles[i].m_Index = COLFLAG_DEATH;
+			pTiles[i].m_Index = CCollision::COLFLAG_DEATH;
 			break;
 		case TILE_SOLID:
-			m_pTiles[i].m_Index = COLFLAG_SOLID;
+			pTiles[i].m_Index = CCollision::COLFLAG_SOLID;
 			break;
 		case TILE_NOHOOK:
-			m_pTiles[i].m_Index = COLFLAG_SOLID|COLFLAG_NOHOOK;
+			pTiles[i].m_Index = CCollision::COLFLAG_SOLID|CCollision::COLFLAG_NOHOOK;
 			break;
 		case TILE_SHRINE_ALL:
 		case TILE_SHRINE_RED:
@@ -56,11 +62,167 @@ void CCollision::Init(class CLayers *pLayers)
 		case TILE_BLUESCORE:
 			break;// don't touch custom stuff as their indices are fine
 		default:
-			m_pTiles[i].m_Index = 0;
+			pTiles[i].m_Index = 0;
 		}
 	}
 }
 
+void CCollision::Init(class CLayers *pLayers)
+{
+	m_pLayers = pLayers;
+	m_Width = m_pLayers->GameLayer()->m_Width;
+	m_Height = m_pLayers->GameLayer()->m_Height;
+
+	// the conversion is done in place, only once per loaded map data
+	int NumTiles = m_Width*m_Height;
+	m_pTiles = static_cast<CTile *>(m_pLayers->Map()->PrepareData(m_pLayers->GameLayer()->m_Data, ConvertTiles, &NumTiles));
+
+	mem_free(m_pVisibility);
+	m_pVisibility = 0;
+}
+
+bool CCollision::IsSolidIndex(int Tx, int Ty) const
+{
+	int Index = m_pTiles[Ty*m_Width+Tx].m_Index;
+	return Index <= 5 && (Index&COLFLAG_SOLID);
+}
+
+bool CCollision::LineOfSight(int Tx0, int Ty0, int Tx1, int Ty1) const
+{
+	// bresenham over the tiles, slipping through diagonal gaps is fine here
+	int Dx = absolute(Tx1-Tx0), Dy = -absolute(Ty1-Ty0);
+	int Sx = Tx0 < Tx1 ? 1 : -1, Sy = Ty0 < Ty1 ? 1 : -1;
+	int Error = Dx+Dy;
+	while(Tx0 != Tx1 || Ty0 != Ty1)
+	{
+		if(IsSolidIndex(Tx0, Ty0))
+			return false;
+		int Error2 = Error*2;
+		if(Error2 >= Dy)
+		{
+			Error += Dy;
+			Tx0 += Sx;
+		}
+		if(Error2 <= Dx)
+		{
+			Error += Dx;
+			Ty0 += Sy;
+		}
+	}
+	return true;
+}
+
+bool CCollision::CellsVisible(int Cx0, int Cy0, int Cx1, int Cy1) const
+{
+	// a few open tiles of each cell: the middle and close to the corners
+	static const int s_aSamples[] = {1, 4, 6};
+	int aaSamples[2][9][2];
+	int aNumSamples[2] = {0, 0};
+	for(int c = 0; c < 2; c++)
+	{
+		int Cx = c ? Cx1 : Cx0, Cy = c ? Cy1 : Cy0;
+		for(int sy = 0; sy < 3; sy++)
+		{
+			for(int sx = 0; sx < 3; sx++)
+			{
+				if((sx == 1) != (sy == 1))
+					continue;
+				int Tx = min(Cx*VIS_CELL_TILES+s_aSamples[sx], m_Width-1);
+				int Ty = min(Cy*VIS_CELL_TILES+s_aSamples[sy], m_Height-1);
+				if(IsSolidIndex(Tx, Ty))
+					continue;
+				aaSamples[c][aNumSamples[c]][0] = Tx;
+				aaSamples[c][aNumSamples[c]][1] = Ty;
+				aNumSamples[c]++;
+			}
+		}
+
+		// nothing open at the samples, take any open tile
+		for(int Ty = Cy*VIS_CELL_TILES; !aNumSamples[c] && Ty < min((Cy+1)*VIS_CELL_TILES, m_Height); Ty++)
+		{
+			for(int Tx = Cx*VIS_CELL_TILES; Tx < min((Cx+1)*VIS_CELL_TILES, m_Width); Tx++)
+			{
+				if(!IsSolidIndex(Tx, Ty))
+				{
+					aaSamples[c][0][0] = Tx;
+					aaSamples[c][0][1] = Ty;
+					aNumSamples[c] = 1;
+					break;
+				}
+			}
+		}
+
+		// a solid cell can not hide anything
+		if(!aNumSamples[c])
+			return true;
+	}
+
+	for(int i = 0; i < aNumSamples[0]; i++)
+	{
+		for(int j = 0; j < aNumSamples[1]; j++)
+		{
+			if(LineOfSight(aaSamples[0][i][0], aaSamples[0][i][1], aaSamples[1][j][0], aaSamples[1][j][1]))
+				return true;
+		}
+	}
+	return false;
+}
+
+void CCollision::InitVisibility()
+{
+	mem_free(m_pVisibility);
+	m_VisWidth = (m_Width+VIS_CELL_TILES-1)/VIS_CELL_TILES;
+	m_VisHeight = (m_Height+VIS_CELL_TILES-1)/VIS_CELL_TILES;
+	m_pVisibility = (unsigned char *)mem_alloc(m_VisWidth*m_VisHeight*VIS_CELL_BYTES, 1);
+	mem_zero(m_pVisibility, m_VisWidth*m_VisHeight*VIS_CELL_BYTES);
+
+	const int RangeWidth = 2*VIS_RANGE_X+1;
+	for(int Cy = 0; Cy < m_VisHeight; Cy++)
+	{
+		for(int Cx = 0; Cx < m_VisWidth; Cx++)
+		{
+			for(int Dy = -VIS_RANGE_Y; Dy <= VIS_RANGE_Y; Dy++)
+			{
+				for(int Dx = -VIS_RANGE_X; Dx <= VIS_RANGE_X; Dx++)
+				{
+					// every pair once, from the cell that comes first
+					if(Dy < 0 || (Dy == 0 && Dx < 0))
+						continue;
+					int Ox = Cx+Dx, Oy = Cy+Dy;
+					if(Ox < 0 || Ox >= m_VisWidth || Oy >= m_VisHeight)
+						continue;
+					if(absolute(Dx) > 1 || Dy > 1)
+					{
+						if(!CellsVisible(Cx, Cy, Ox, Oy))
+							continue;
+					}
+
+					int Bit = (Dy+VIS_RANGE_Y)*RangeWidth+Dx+VIS_RANGE_X;
+					m_pVisibility[(Cy*m_VisWidth+Cx)*VIS_CELL_BYTES+Bit/8] |= 1<<(Bit%8);
+					Bit = (-Dy+VIS_RANGE_Y)*RangeWidth-Dx+VIS_RANGE_X;
+					m_pVisibility[(Oy*m_VisWidth+Ox)*VIS_CELL_BYTES+Bit/8] |= 1<<(Bit%8);
+				}
+			}
+		}
+	}
+}
+
+bool CCollision::IsVisible(vec2 ViewPos, vec2 Pos) const
+{
+	if(!m_pVisibility)
+		return true;
+
+	int Cx = clamp(round_to_int(ViewPos.x)/VIS_CELL_SIZE, 0, m_VisWidth-1);
+	int Cy = clamp(round_to_int(ViewPos.y)/VIS_CELL_SIZE, 0, m_VisHeight-1);
+	int Dx = clamp(round_to_int(Pos.x)/VIS_CELL_SIZE, 0, m_VisWidth-1)-Cx;
+	int Dy = clamp(round_to_int(Pos.y)/VIS_CELL_SIZE, 0, m_VisHeight-1)-Cy;
+	if(absolute(Dx) > VIS_RANGE_X || absolute(Dy) > VIS_RANGE_Y)
+		return false;
+
+	int Bit = (Dy+VIS_RANGE_Y)*(2*VIS_RANGE_X+1)+Dx+VIS_RANGE_X;
+	return (m_pVisibility[(Cy*m_VisWidth+Cx)*VIS_CELL_BYTES+Bit/8]>>(Bit%8))&1;
+}
+
 int CCollision::GetTile(int x, int y)
 {
 	int Nx = clamp(x/32, 0, m_Width-1);
@@ -75,6 +237,12 @@ bool CCollision::IsTileSolid(int x, int y)
 	return (Tile&COLFLAG_SOLID) && Tile <= 5;
 }
 
+void CCollision::CheckPoints(const float *pX, const float *pY, int Num, unsigned char *pSolid)
+{
+	for(int i = 0; i < Num; i++)
+		pSolid[i] = IsTileSolid(round_to_int(pX[i]), round_to_int(pY[i])) ? 1 : 0;
+}
+
 // TODO: rewrite this smarter!
 int CCollision::IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision)
 {
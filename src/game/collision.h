@@ -12,8 +12,16 @@ class CCollision
 	int m_Height;
 	class CLayers *m_pLayers;
 
+	// coarse visibility, one bit per cell in reach for every cell
+	unsigned char *m_pVisibility;
+	int m_VisWidth;
+	int m_VisHeight;
+
 	bool IsTileSolid(int x, int y);
 	int GetTile(int x, int y);
+	bool IsSolidIndex(int Tx, int Ty) const;
+	bool LineOfSight(int Tx0, int Ty0, int Tx1, int Ty1) const;
+	bool CellsVisible(int Cx0, int Cy0, int Cx1, int Cy1) const;
 
 public:
 	enum
@@ -21,16 +29,33 @@ public:
 		COLFLAG_SOLID=1,
 		COLFLAG_DEATH=2,
 		COLFLAG_NOHOOK=4,
+
+		// cells of the visibility table and how many of them a client sees to each side
+		VIS_CELL_TILES=8,
+		VIS_CELL_SIZE=VIS_CELL_TILES*32,
+		VIS_RANGE_X=5,
+		VIS_RANGE_Y=4,
+		VIS_CELL_BYTES=((2*VIS_RANGE_X+1)*(2*VIS_RANGE_Y+1)+7)/8,
 	};
 
 	CCollision();
+	~CCollision();
 	void Init(class CLayers *pLayers);
+
+	// builds the table for IsVisible, cells see each other when a line between
+	// open tiles of both gets through, so it errs on the side of visible
+	void InitVisibility();
+	bool HasVisibility() const { return m_pVisibility != 0; }
+	// whether something at Pos can be seen from the cell ViewPos is in
+	bool IsVisible(vec2 ViewPos, vec2 Pos) const;
 	bool CheckPoint(float x, float y) { return IsTileSolid(round_to_int(x), round_to_int(y)); }
 	bool CheckPoint(vec2 Pos) { return CheckPoint(Pos.x, Pos.y); }
 	int GetCollisionAt(float x, float y) { return GetTile(round_to_int(x), round_to_int(y)); }
 	int GetWidth() { return m_Width; };
 	int GetHeight() { return m_Height; };
 	int IntersectLine(vec2 Pos0, vec2 Pos1, vec2 *pOutCollision, vec2 *pOutBeforeCollision);
+	// CheckPoint for many points, pSolid is set to 1 for the points in solid tiles
+	void CheckPoints(const float *pX, const float *pY, int Num, unsigned char *pSolid);
 	void MovePoint(vec2 *pInoutPos, vec2 *pInoutVel, float Elasticity, int *pBounces);
 	void MoveBox(vec2 *pInoutPos, vec2 *pInoutVel, vec2 Size, float Elasticity);
 	bool TestBox(vec2 Pos, vec2 Size);
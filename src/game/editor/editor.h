@@ -362,7 +362,7 @@ public:
 	void CreateDefault(int EntitiesTexture);
 
 	// io
-	int Save(class IStorage *pStorage, const char *pFilename);
+	int Save(class IStorage *pStorage, const char *pFilename, class CJobPool *pJobPool = 0);
 	int Load(class IStorage *pStorage, const char *pFilename, int StorageType);
 };
 
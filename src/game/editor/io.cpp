@@ -2,6 +2,7 @@
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 #include <engine/client.h>
 #include <engine/console.h>
+#include <engine/engine.h>
 #include <engine/graphics.h>
 #include <engine/serverbrowser.h>
 #include <engine/storage.h>
@@ -197,16 +198,16 @@ void editor_load_old(DATAFILE *df, MAP *map)
 
 int CEditor::Save(const char *pFilename)
 {
-	return m_Map.Save(Kernel()->RequestInterface<IStorage>(), pFilename);
+	return m_Map.Save(Kernel()->RequestInterface<IStorage>(), pFilename, Kernel()->RequestInterface<IEngine>()->JobPool());
 }
 
-int CEditorMap::Save(class IStorage *pStorage, const char *pFileName)
+int CEditorMap::Save(class IStorage *pStorage, const char *pFileName, CJobPool *pJobPool)
 {
 	char aBuf[256];
 	str_format(aBuf, sizeof(aBuf), "saving to '%s'...", pFileName);
 	m_pEditor->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "editor", aBuf);
 	CDataFileWriter df;
-	if(!df.Open(pStorage, pFileName))
+	if(!df.Open(pStorage, pFileName, pJobPool))
 	{
 		str_format(aBuf, sizeof(aBuf), "failed to open file '%s'...", pFileName);
 		m_pEditor->Console()->Print(IConsole::OUTPUT_LEVEL_STANDARD, "editor", aBuf);
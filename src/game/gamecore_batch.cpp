@@ -0,0 +1,715 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include "gamecore_batch.h"
+
+// this file is not part of the nethash on purpose. everything in here
+// has to produce exactly the same results as CCharacterCore::Tick() and
+// CCharacterCore::Move() in gamecore.cpp
+
+static const float s_PhysSize = 28.0f;
+
+// how far a point computed with mix() can end up outside of the bounding
+// box of its end points due to rounding
+static inline float BoxSlack(float a, float b)
+{
+	return 1.0f + (absolute(a)+absolute(b))/(float)(1<<20);
+}
+
+static inline float StepVelX(float VelX, int Frozen, int Direction, float MaxSpeed, float Accel, float Friction)
+{
+	if(!Frozen && Direction < 0)
+		VelX = SaturatedAdd(-MaxSpeed, MaxSpeed, VelX, -Accel);
+	if(!Frozen && Direction > 0)
+		VelX = SaturatedAdd(-MaxSpeed, MaxSpeed, VelX, Accel);
+	if(Frozen || Direction == 0)
+		VelX *= Friction;
+	return VelX;
+}
+
+CWorldCoreBatch::CWorldCoreBatch()
+{
+	m_pWorld = 0;
+	m_pCollision = 0;
+	mem_zero(m_aActive, sizeof(m_aActive));
+}
+
+void CWorldCoreBatch::Init(CWorldCore *pWorld, CCollision *pCollision)
+{
+	m_pWorld = pWorld;
+	m_pCollision = pCollision;
+}
+
+void CWorldCoreBatch::Gather()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		CCharacterCore *pCore = m_pWorld->m_apCharacters[i];
+		m_aActive[i] = pCore != 0;
+		m_aBatched[i] = false;
+		if(!pCore)
+		{
+			// keep the unused lanes defined for the flat loops
+			m_aPosX[i] = m_aPosY[i] = 0.0f;
+			m_aVelX[i] = m_aVelY[i] = 0.0f;
+			m_aFrozen[i] = m_aFrozenBefore[i] = 0;
+			m_aDirection[i] = 0;
+			m_aGrounded[i] = false;
+			m_aJumpVel[i] = false;
+			m_aJumpVelY[i] = 0.0f;
+			continue;
+		}
+
+		m_aPosX[i] = pCore->m_Pos.x;
+		m_aPosY[i] = pCore->m_Pos.y;
+		m_aVelX[i] = pCore->m_Vel.x;
+		m_aVelY[i] = pCore->m_Vel.y;
+		m_aHookPosX[i] = pCore->m_HookPos.x;
+		m_aHookPosY[i] = pCore->m_HookPos.y;
+		m_aHookDirX[i] = pCore->m_HookDir.x;
+		m_aHookDirY[i] = pCore->m_HookDir.y;
+		m_aHookTick[i] = pCore->m_HookTick;
+		m_aHookState[i] = pCore->m_HookState;
+		m_aHookedPlayer[i] = pCore->m_HookedPlayer;
+		m_aJumped[i] = pCore->m_Jumped;
+		m_aDirection[i] = pCore->m_Direction;
+		m_aAngle[i] = pCore->m_Angle;
+		m_aFrozen[i] = pCore->m_Frozen;
+		m_aTriggeredEvents[i] = pCore->m_TriggeredEvents;
+		m_aHooking[i] = pCore->m_Hooking;
+		m_aCollision[i] = pCore->m_Collision;
+		m_aProtected[i] = pCore->m_Protected;
+		m_aProtectedBy[i] = pCore->m_ProtectedBy;
+	}
+}
+
+void CWorldCoreBatch::Scatter()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aActive[i])
+			continue;
+
+		CCharacterCore *pCore = m_pWorld->m_apCharacters[i];
+		pCore->m_Pos = vec2(m_aPosX[i], m_aPosY[i]);
+		pCore->m_Vel = vec2(m_aVelX[i], m_aVelY[i]);
+		pCore->m_HookPos = vec2(m_aHookPosX[i], m_aHookPosY[i]);
+		pCore->m_HookDir = vec2(m_aHookDirX[i], m_aHookDirY[i]);
+		pCore->m_HookTick = m_aHookTick[i];
+		pCore->m_HookState = m_aHookState[i];
+		pCore->m_HookedPlayer = m_aHookedPlayer[i];
+		pCore->m_Jumped = m_aJumped[i];
+		pCore->m_Direction = m_aDirection[i];
+		pCore->m_Angle = m_aAngle[i];
+		pCore->m_Frozen = m_aFrozen[i];
+		pCore->m_TriggeredEvents = m_aTriggeredEvents[i];
+	}
+}
+
+// everything of CCharacterCore::Tick() that does not touch a velocity.
+// it only reads the positions of the other characters, which don't change
+// until the move, so the lanes are independent of each other
+void CWorldCoreBatch::TickState(int i, bool UseInput)
+{
+	const CTuningParams &Tuning = m_pWorld->m_Tuning;
+	const CNetObj_PlayerInput &Input = m_pWorld->m_apCharacters[i]->m_Input;
+	float PhysSize = s_PhysSize;
+	vec2 Pos(m_aPosX[i], m_aPosY[i]);
+	vec2 HookPos(m_aHookPosX[i], m_aHookPosY[i]);
+	vec2 HookDir(m_aHookDirX[i], m_aHookDirY[i]);
+	int HookState = m_aHookState[i];
+	int HookedPlayer = m_aHookedPlayer[i];
+	int HookTick = m_aHookTick[i];
+	int Jumped = m_aJumped[i];
+	int Events = 0;
+
+	// get ground state
+	bool Grounded = false;
+	if(m_pCollision->CheckPoint(Pos.x+PhysSize/2, Pos.y+PhysSize/2+5))
+		Grounded = true;
+	if(m_pCollision->CheckPoint(Pos.x-PhysSize/2, Pos.y+PhysSize/2+5))
+		Grounded = true;
+	m_aGrounded[i] = Grounded;
+
+	m_aFrozenBefore[i] = m_aFrozen[i];
+	if(m_aFrozen[i] > 0)
+		m_aFrozen[i]--;
+
+	vec2 TargetDirection = normalize(vec2(Input.m_TargetX, Input.m_TargetY));
+
+	int JumpBackup = Jumped;
+	m_aJumpVel[i] = false;
+
+	// handle input
+	if(UseInput)
+	{
+		m_aDirection[i] = Input.m_Direction;
+
+		// setup angle
+		float a = 0;
+		if(Input.m_TargetX == 0)
+			a = atanf((float)Input.m_TargetY);
+		else
+			a = atanf((float)Input.m_TargetY/(float)Input.m_TargetX);
+
+		if(Input.m_TargetX < 0)
+			a = a+pi;
+
+		m_aAngle[i] = (int)(a*256.0f);
+
+		// handle jump
+		if(Input.m_Jump)
+		{
+			if(!(Jumped&1))
+			{
+				if(Grounded)
+				{
+					Events |= COREEVENT_GROUND_JUMP;
+					m_aJumpVel[i] = true;
+					m_aJumpVelY[i] = -Tuning.m_GroundJumpImpulse;
+					Jumped |= 1;
+				}
+				else if(!(Jumped&2))
+				{
+					Events |= COREEVENT_AIR_JUMP;
+					m_aJumpVel[i] = true;
+					m_aJumpVelY[i] = -Tuning.m_AirJumpImpulse;
+					Jumped |= 3;
+				}
+			}
+		}
+		else
+			Jumped &= ~1;
+
+		// handle hook
+		if(Input.m_Hook)
+		{
+			if(HookState == HOOK_IDLE)
+			{
+				HookState = HOOK_FLYING;
+				HookPos = Pos+TargetDirection*PhysSize*1.5f;
+				HookDir = TargetDirection;
+				HookedPlayer = -1;
+				HookTick = 0;
+				Events |= COREEVENT_HOOK_LAUNCH;
+			}
+		}
+		else
+		{
+			HookedPlayer = -1;
+			HookState = HOOK_IDLE;
+			HookPos = Pos;
+		}
+	}
+
+	if(m_aFrozen[i] > 0)
+	{
+		Jumped = JumpBackup;
+		HookedPlayer = -1;
+		m_aJumpVel[i] = false;
+		HookState = HOOK_IDLE;
+		HookPos = Pos;
+		Events &= ~(COREEVENT_AIR_JUMP | COREEVENT_GROUND_JUMP | COREEVENT_HOOK_LAUNCH);
+	}
+
+	if(Grounded)
+		Jumped &= ~2;
+
+	// do hook
+	if(HookState == HOOK_IDLE)
+	{
+		HookedPlayer = -1;
+		HookState = HOOK_IDLE;
+		HookPos = Pos;
+	}
+	else if(HookState >= HOOK_RETRACT_START && HookState < HOOK_RETRACT_END)
+	{
+		HookState++;
+	}
+	else if(HookState == HOOK_RETRACT_END)
+	{
+		Events |= COREEVENT_HOOK_RETRACT;
+		HookState = HOOK_RETRACTED;
+	}
+	else if(HookState == HOOK_FLYING)
+	{
+		vec2 NewPos = HookPos+HookDir*Tuning.m_HookFireSpeed;
+		if(distance(Pos, NewPos) > Tuning.m_HookLength)
+		{
+			HookState = HOOK_RETRACT_START;
+			NewPos = Pos + normalize(NewPos-Pos) * Tuning.m_HookLength;
+		}
+
+		// make sure that the hook doesn't go though the ground
+		bool GoingToHitGround = false;
+		bool GoingToRetract = false;
+		int Hit = m_pCollision->IntersectLine(HookPos, NewPos, &NewPos, 0);
+		if(Hit)
+		{
+			if(Hit&CCollision::COLFLAG_NOHOOK)
+				GoingToRetract = true;
+			else
+				GoingToHitGround = true;
+		}
+
+		// Check against other players first
+		if(m_aHooking[i] && Tuning.m_PlayerHooking)
+		{
+			// only players near the hook segment can be hit
+			float Reach = PhysSize+2.0f+BoxSlack(HookPos.x, NewPos.x)+BoxSlack(HookPos.y, NewPos.y);
+			float MinX = min(HookPos.x, NewPos.x)-Reach;
+			float MaxX = max(HookPos.x, NewPos.x)+Reach;
+			float MinY = min(HookPos.y, NewPos.y)-Reach;
+			float MaxY = max(HookPos.y, NewPos.y)+Reach;
+
+			float Distance = 0.0f;
+			for(int k = 0; k < MAX_CLIENTS; k++)
+			{
+				if(!m_aActive[k] || k == i)
+					continue;
+				if(m_aPosX[k] < MinX || m_aPosX[k] > MaxX || m_aPosY[k] < MinY || m_aPosY[k] > MaxY)
+					continue;
+
+				vec2 OtherPos(m_aPosX[k], m_aPosY[k]);
+				vec2 ClosestPoint = closest_point_on_line(HookPos, NewPos, OtherPos);
+				if(distance(OtherPos, ClosestPoint) < PhysSize+2.0f)
+				{
+					if(HookedPlayer == -1 || distance(HookPos, OtherPos) < Distance)
+					{
+						Events |= COREEVENT_HOOK_ATTACH_PLAYER;
+						HookState = HOOK_GRABBED;
+						HookedPlayer = k;
+						Distance = distance(HookPos, OtherPos);
+					}
+				}
+			}
+		}
+
+		if(HookState == HOOK_FLYING)
+		{
+			// check against ground
+			if(GoingToHitGround)
+			{
+				Events |= COREEVENT_HOOK_ATTACH_GROUND;
+				HookState = HOOK_GRABBED;
+			}
+			else if(GoingToRetract)
+			{
+				Events |= COREEVENT_HOOK_HIT_NOHOOK;
+				HookState = HOOK_RETRACT_START;
+			}
+
+			HookPos = NewPos;
+		}
+	}
+
+	m_aHookDrag[i] = false;
+	if(HookState == HOOK_GRABBED)
+	{
+		if(HookedPlayer != -1)
+		{
+			if(HookedPlayer >= 0 && HookedPlayer < MAX_CLIENTS && m_aActive[HookedPlayer])
+				HookPos = vec2(m_aPosX[HookedPlayer], m_aPosY[HookedPlayer]);
+			else
+			{
+				// release hook
+				HookedPlayer = -1;
+				HookState = HOOK_RETRACTED;
+				HookPos = Pos;
+			}
+		}
+
+		// don't do this hook rutine when we are hook to a player
+		if(HookedPlayer == -1 && distance(HookPos, Pos) > 46.0f)
+		{
+			vec2 HookVel = normalize(HookPos-Pos)*Tuning.m_HookDragAccel;
+			// the hook as more power to drag you up then down.
+			// this makes it easier to get on top of an platform
+			if(HookVel.y > 0)
+				HookVel.y *= 0.3f;
+
+			// the hook will boost it's power if the player wants to move
+			// in that direction. otherwise it will dampen everything abit
+			if((HookVel.x < 0 && m_aDirection[i] < 0) || (HookVel.x > 0 && m_aDirection[i] > 0))
+				HookVel.x *= 0.95f;
+			else
+				HookVel.x *= 0.75f;
+
+			// applied together with the other velocity changes
+			m_aHookDrag[i] = true;
+			m_aHookDragX[i] = HookVel.x;
+			m_aHookDragY[i] = HookVel.y;
+		}
+
+		// release hook (max hook time is 1.25
+		HookTick++;
+		if(HookedPlayer != -1 && (HookTick > SERVER_TICK_SPEED+SERVER_TICK_SPEED/5 || !m_aActive[HookedPlayer]))
+		{
+			HookedPlayer = -1;
+			HookState = HOOK_RETRACTED;
+			HookPos = Pos;
+		}
+	}
+
+	m_aHookPosX[i] = HookPos.x;
+	m_aHookPosY[i] = HookPos.y;
+	m_aHookDirX[i] = HookDir.x;
+	m_aHookDirY[i] = HookDir.y;
+	m_aHookState[i] = HookState;
+	m_aHookedPlayer[i] = HookedPlayer;
+	m_aHookTick[i] = HookTick;
+	m_aJumped[i] = Jumped;
+	m_aTriggeredEvents[i] = Events;
+}
+
+// finds the players that get dragged by a hook. those pairs have to be
+// stepped in client id order, everyone else can go through the flat loops
+void CWorldCoreBatch::BuildHookTargets()
+{
+	const CTuningParams &Tuning = m_pWorld->m_Tuning;
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aBatched[i] = m_aActive[i];
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		m_aHookTarget[i] = -1;
+		int k = m_aHookedPlayer[i];
+		if(!m_aActive[i] || !m_aHooking[i] || !Tuning.m_PlayerHooking || k < 0 || k >= MAX_CLIENTS || k == i || !m_aActive[k])
+			continue;
+
+		// the scalar path sees the freeze of players with a lower id after their tick
+		int Frozen = k < i ? m_aFrozen[k] : m_aFrozenBefore[k];
+		if((m_aProtected[k] || m_aProtectedBy[k]) && !(m_aProtected[k] && Frozen <= 0))
+			continue;
+
+		if(distance(vec2(m_aPosX[i], m_aPosY[i]), vec2(m_aPosX[k], m_aPosY[k])) > s_PhysSize*1.50f)
+		{
+			m_aHookTarget[i] = k;
+			m_aBatched[i] = false;
+			m_aBatched[k] = false;
+		}
+	}
+}
+
+// sweep over the x axis to find the players that collide with each other
+void CWorldCoreBatch::BuildPairs()
+{
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aNumNeighbours[i] = 0;
+
+	if(!m_pWorld->m_Tuning.m_PlayerCollision)
+		return;
+
+	int aOrder[MAX_CLIENTS];
+	int Num = 0;
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aActive[i] || !m_aCollision[i])
+			continue;
+
+		// insertion sort by x
+		int j = Num++;
+		while(j > 0 && m_aPosX[aOrder[j-1]] > m_aPosX[i])
+		{
+			aOrder[j] = aOrder[j-1];
+			j--;
+		}
+		aOrder[j] = i;
+	}
+
+	for(int a = 0; a < Num; a++)
+	{
+		int i = aOrder[a];
+		for(int b = a+1; b < Num; b++)
+		{
+			int k = aOrder[b];
+			if(m_aPosX[k]-m_aPosX[i] >= s_PhysSize*1.25f)
+				break;
+
+			float Distance = distance(vec2(m_aPosX[i], m_aPosY[i]), vec2(m_aPosX[k], m_aPosY[k]));
+			if(Distance < s_PhysSize*1.25f && Distance > 0.0f)
+			{
+				m_aaNeighbours[i][m_aNumNeighbours[i]++] = k;
+				m_aaNeighbours[k][m_aNumNeighbours[k]++] = i;
+			}
+		}
+	}
+
+	// the nudges have to be applied in client id order
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		int *pList = m_aaNeighbours[i];
+		for(int a = 1; a < m_aNumNeighbours[i]; a++)
+		{
+			int Value = pList[a];
+			int j = a;
+			while(j > 0 && pList[j-1] > Value)
+			{
+				pList[j] = pList[j-1];
+				j--;
+			}
+			pList[j] = Value;
+		}
+	}
+}
+
+void CWorldCoreBatch::ApplyHookDrag(int i)
+{
+	if(!m_aHookDrag[i])
+		return;
+
+	vec2 Vel(m_aVelX[i], m_aVelY[i]);
+	vec2 NewVel = Vel+vec2(m_aHookDragX[i], m_aHookDragY[i]);
+
+	// check if we are under the legal limit for the hook
+	if(length(NewVel) < m_pWorld->m_Tuning.m_HookDragSpeed || length(NewVel) < length(Vel))
+	{
+		m_aVelX[i] = NewVel.x;
+		m_aVelY[i] = NewVel.y;
+	}
+}
+
+void CWorldCoreBatch::ApplyCollision(int i, int Other)
+{
+	vec2 Pos(m_aPosX[i], m_aPosY[i]);
+	vec2 OtherPos(m_aPosX[Other], m_aPosY[Other]);
+	vec2 Vel(m_aVelX[i], m_aVelY[i]);
+
+	float Distance = distance(Pos, OtherPos);
+	vec2 Dir = normalize(Pos - OtherPos);
+	float a = (s_PhysSize*1.45f - Distance);
+	float Velocity = 0.5f;
+
+	// make sure that we don't add excess force by checking the
+	// direction against the current velocity. if not zero.
+	if (length(Vel) > 0.0001)
+		Velocity = 1-(dot(normalize(Vel), Dir)+1)/2;
+
+	Vel += Dir*a*(Velocity*0.75f);
+	Vel *= 0.85f;
+
+	m_aVelX[i] = Vel.x;
+	m_aVelY[i] = Vel.y;
+}
+
+void CWorldCoreBatch::ApplyHookForce(int i, int Other)
+{
+	const CTuningParams &Tuning = m_pWorld->m_Tuning;
+	vec2 Pos(m_aPosX[i], m_aPosY[i]);
+	vec2 OtherPos(m_aPosX[Other], m_aPosY[Other]);
+
+	float Distance = distance(Pos, OtherPos);
+	vec2 Dir = normalize(Pos - OtherPos);
+	float Accel = Tuning.m_HookDragAccel * (Distance/Tuning.m_HookLength);
+	float DragSpeed = Tuning.m_HookDragSpeed;
+
+	// add force to the hooked player
+	m_aVelX[Other] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelX[Other], Accel*Dir.x*1.5f);
+	m_aVelY[Other] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelY[Other], Accel*Dir.y*1.5f);
+
+	// add a little bit force to the guy who has the grip
+	m_aVelX[i] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelX[i], -Accel*Dir.x*0.25f);
+	m_aVelY[i] = SaturatedAdd(-DragSpeed, DragSpeed, m_aVelY[i], -Accel*Dir.y*0.25f);
+}
+
+void CWorldCoreBatch::Interact(int i)
+{
+	int Target = m_aHookTarget[i];
+	for(int n = 0; n < m_aNumNeighbours[i]; n++)
+	{
+		int Other = m_aaNeighbours[i][n];
+		if(Target != -1 && Target < Other)
+		{
+			ApplyHookForce(i, Target);
+			Target = -1;
+		}
+		ApplyCollision(i, Other);
+	}
+	if(Target != -1)
+		ApplyHookForce(i, Target);
+}
+
+void CWorldCoreBatch::TickVelocities()
+{
+	const CTuningParams &Tuning = m_pWorld->m_Tuning;
+	const float Gravity = Tuning.m_Gravity;
+	float aMaxSpeed[2] = { Tuning.m_AirControlSpeed, Tuning.m_GroundControlSpeed };
+	float aAccel[2] = { Tuning.m_AirControlAccel, Tuning.m_GroundControlAccel };
+	float aFriction[2] = { Tuning.m_AirFriction, Tuning.m_GroundFriction };
+
+	// flat loops over all lanes that don't depend on each other
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aVelY[i] = m_aBatched[i] ? m_aVelY[i]+Gravity : m_aVelY[i];
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		m_aVelY[i] = m_aBatched[i] && m_aJumpVel[i] ? m_aJumpVelY[i] : m_aVelY[i];
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		int g = m_aGrounded[i];
+		float VelX = StepVelX(m_aVelX[i], m_aFrozen[i], m_aDirection[i], aMaxSpeed[g], aAccel[g], aFriction[g]);
+		m_aVelX[i] = m_aBatched[i] ? VelX : m_aVelX[i];
+	}
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aBatched[i])
+			continue;
+		ApplyHookDrag(i);
+		Interact(i);
+	}
+
+	// clamp the velocity to something sane
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		float VelX = m_aVelX[i];
+		float VelY = m_aVelY[i];
+		float Length = sqrtf(VelX*VelX + VelY*VelY);
+		float Scale = 1.0f/Length;
+		bool Clamp = m_aBatched[i] && Length > 6000;
+		m_aVelX[i] = Clamp ? VelX*Scale*6000 : VelX;
+		m_aVelY[i] = Clamp ? VelY*Scale*6000 : VelY;
+	}
+
+	// players that are dragged by a hook are stepped in client id order
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aActive[i] || m_aBatched[i])
+			continue;
+
+		int g = m_aGrounded[i];
+		m_aVelY[i] += Gravity;
+		if(m_aJumpVel[i])
+			m_aVelY[i] = m_aJumpVelY[i];
+		m_aVelX[i] = StepVelX(m_aVelX[i], m_aFrozen[i], m_aDirection[i], aMaxSpeed[g], aAccel[g], aFriction[g]);
+		ApplyHookDrag(i);
+		Interact(i);
+
+		vec2 Vel(m_aVelX[i], m_aVelY[i]);
+		if(length(Vel) > 6000)
+			Vel = normalize(Vel) * 6000;
+		m_aVelX[i] = Vel.x;
+		m_aVelY[i] = Vel.y;
+	}
+}
+
+void CWorldCoreBatch::MoveAll(bool Quantize)
+{
+	const CTuningParams &Tuning = m_pWorld->m_Tuning;
+
+	// the collision with the map doesn't depend on the other players
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aActive[i])
+			continue;
+
+		vec2 Vel(m_aVelX[i], m_aVelY[i]);
+		float RampValue = VelocityRamp(length(Vel)*50, Tuning.m_VelrampStart, Tuning.m_VelrampRange, Tuning.m_VelrampCurvature);
+
+		Vel.x = Vel.x*RampValue;
+
+		vec2 NewPos(m_aPosX[i], m_aPosY[i]);
+		m_pCollision->MoveBox(&NewPos, &Vel, vec2(28.0f, 28.0f), 0);
+
+		Vel.x = Vel.x*(1.0f/RampValue);
+
+		m_aVelX[i] = Vel.x;
+		m_aVelY[i] = Vel.y;
+		m_aNewPosX[i] = NewPos.x;
+		m_aNewPosY[i] = NewPos.y;
+	}
+
+	// players block each other in client id order
+	for(int i = 0; i < MAX_CLIENTS; i++)
+	{
+		if(!m_aActive[i])
+			continue;
+
+		vec2 Pos(m_aPosX[i], m_aPosY[i]);
+		vec2 NewPos(m_aNewPosX[i], m_aNewPosY[i]);
+		vec2 FinalPos = NewPos;
+
+		if(Tuning.m_PlayerCollision && m_aCollision[i])
+		{
+			// only players near the path can block it
+			float Reach = 28.0f+BoxSlack(Pos.x, NewPos.x)+BoxSlack(Pos.y, NewPos.y);
+			float MinX = min(Pos.x, NewPos.x)-Reach;
+			float MaxX = max(Pos.x, NewPos.x)+Reach;
+			float MinY = min(Pos.y, NewPos.y)-Reach;
+			float MaxY = max(Pos.y, NewPos.y)+Reach;
+
+			int aCandidates[MAX_CLIENTS];
+			int NumCandidates = 0;
+			for(int k = 0; k < MAX_CLIENTS; k++)
+			{
+				if(!m_aActive[k] || k == i || !m_aCollision[k])
+					continue;
+				if(m_aPosX[k] < MinX || m_aPosX[k] > MaxX || m_aPosY[k] < MinY || m_aPosY[k] > MaxY)
+					continue;
+				aCandidates[NumCandidates++] = k;
+			}
+
+			if(NumCandidates)
+			{
+				// check player collision
+				float Distance = distance(Pos, NewPos);
+				int End = Distance+1;
+				vec2 LastPos = Pos;
+				bool Blocked = false;
+				for(int s = 0; s < End && !Blocked; s++)
+				{
+					float a = s/Distance;
+					vec2 StepPos = mix(Pos, NewPos, a);
+					for(int c = 0; c < NumCandidates; c++)
+					{
+						vec2 OtherPos(m_aPosX[aCandidates[c]], m_aPosY[aCandidates[c]]);
+						float D = distance(StepPos, OtherPos);
+						if((D < 28.0f && D > 0.0f) || (D <= 0.001f && D >= -0.001f))
+						{
+							FinalPos = Pos;
+							if(a > 0.0f)
+								FinalPos = LastPos;
+							else if(distance(NewPos, OtherPos) > D)
+								FinalPos = NewPos;
+							Blocked = true;
+							break;
+						}
+					}
+					LastPos = StepPos;
+				}
+			}
+		}
+
+		m_aPosX[i] = FinalPos.x;
+		m_aPosY[i] = FinalPos.y;
+
+		// the following players have to see the quantized position
+		if(Quantize)
+		{
+			m_aPosX[i] = round_to_int(m_aPosX[i]);
+			m_aPosY[i] = round_to_int(m_aPosY[i]);
+			m_aVelX[i] = round_to_int(m_aVelX[i]*256.0f)/256.0f;
+			m_aVelY[i] = round_to_int(m_aVelY[i]*256.0f)/256.0f;
+			m_aHookPosX[i] = round_to_int(m_aHookPosX[i]);
+			m_aHookPosY[i] = round_to_int(m_aHookPosY[i]);
+			m_aHookDirX[i] = round_to_int(m_aHookDirX[i]*256.0f)/256.0f;
+			m_aHookDirY[i] = round_to_int(m_aHookDirY[i]*256.0f)/256.0f;
+		}
+	}
+}
+
+void CWorldCoreBatch::Step(const bool *pUseInput, bool Quantize)
+{
+	Gather();
+
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		if(m_aActive[i])
+			TickState(i, pUseInput[i]);
+
+	BuildHookTargets();
+	BuildPairs();
+	TickVelocities();
+	MoveAll(Quantize);
+
+	Scatter();
+}
@@ -0,0 +1,92 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#ifndef GAME_GAMECORE_BATCH_H
+#define GAME_GAMECORE_BATCH_H
+
+#include "gamecore.h"
+
+/*
+	Class: CWorldCoreBatch
+		Steps all characters of a CWorldCore at once.
+
+		The character state is gathered into structure-of-arrays form
+		(indexed by client id) so that the per-character phases like
+		gravity, friction and the velocity clamp run as flat loops over
+		all lanes. Player <-> player collision only looks at the pairs
+		found by a sweep over the x axis.
+
+		The results are bit-identical to calling CCharacterCore::Tick()
+		on every character followed by CCharacterCore::Move() (and
+		CCharacterCore::Quantize()) on every character in client id
+		order. Characters that exert hook force on each other depend on
+		that order and are therefore stepped one after another.
+*/
+class CWorldCoreBatch
+{
+	CWorldCore *m_pWorld;
+	CCollision *m_pCollision;
+
+	// lane state
+	bool m_aActive[MAX_CLIENTS];
+	float m_aPosX[MAX_CLIENTS];
+	float m_aPosY[MAX_CLIENTS];
+	float m_aVelX[MAX_CLIENTS];
+	float m_aVelY[MAX_CLIENTS];
+	float m_aHookPosX[MAX_CLIENTS];
+	float m_aHookPosY[MAX_CLIENTS];
+	float m_aHookDirX[MAX_CLIENTS];
+	float m_aHookDirY[MAX_CLIENTS];
+	int m_aHookTick[MAX_CLIENTS];
+	int m_aHookState[MAX_CLIENTS];
+	int m_aHookedPlayer[MAX_CLIENTS];
+	int m_aJumped[MAX_CLIENTS];
+	int m_aDirection[MAX_CLIENTS];
+	int m_aAngle[MAX_CLIENTS];
+	int m_aFrozen[MAX_CLIENTS];
+	int m_aTriggeredEvents[MAX_CLIENTS];
+	bool m_aHooking[MAX_CLIENTS];
+	bool m_aCollision[MAX_CLIENTS];
+	bool m_aProtected[MAX_CLIENTS];
+	bool m_aProtectedBy[MAX_CLIENTS];
+
+	// per tick scratch
+	bool m_aGrounded[MAX_CLIENTS];
+	bool m_aBatched[MAX_CLIENTS];
+	bool m_aJumpVel[MAX_CLIENTS];
+	float m_aJumpVelY[MAX_CLIENTS];
+	int m_aFrozenBefore[MAX_CLIENTS];
+	bool m_aHookDrag[MAX_CLIENTS];
+	float m_aHookDragX[MAX_CLIENTS];
+	float m_aHookDragY[MAX_CLIENTS];
+	int m_aHookTarget[MAX_CLIENTS];
+	float m_aNewPosX[MAX_CLIENTS];
+	float m_aNewPosY[MAX_CLIENTS];
+
+	// pruned player <-> player pairs, sorted by client id
+	int m_aNumNeighbours[MAX_CLIENTS];
+	int m_aaNeighbours[MAX_CLIENTS][MAX_CLIENTS];
+
+	void Gather();
+	void Scatter();
+
+	void TickState(int i, bool UseInput);
+	void BuildHookTargets();
+	void BuildPairs();
+	void ApplyHookDrag(int i);
+	void ApplyCollision(int i, int Other);
+	void ApplyHookForce(int i, int Other);
+	void Interact(int i);
+	void TickVelocities();
+	void MoveAll(bool Quantize);
+
+public:
+	CWorldCoreBatch();
+
+	void Init(CWorldCore *pWorld, CCollision *pCollision);
+
+	// ticks and moves every character of the world once. pUseInput is
+	// indexed by client id, like CWorldCore::m_apCharacters
+	void Step(const bool *pUseInput, bool Quantize);
+};
+
+#endif
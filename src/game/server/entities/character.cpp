@@ -312,25 +312,27 @@ void CCharacter::FireWeapon()
 
 			CCharacter *apEnts[MAX_CLIENTS];
 			int Hits = 0;
-			int Num = GameServer()->m_World.FindEntities(ProjStartPos, m_ProximityRadius*0.5f, (CEntity**)apEnts,
-														MAX_CLIENTS, CGameWorld::ENTTYPE_CHARACTER);
+			int RewindTick = GameServer()->m_World.RewindTick(m_pPlayer->GetCID());
+			int Num = GameServer()->m_World.FindCharacters(ProjStartPos, m_ProximityRadius*0.5f, apEnts,
+														MAX_CLIENTS, RewindTick);
 
 			for (int i = 0; i < Num; ++i)
 			{
 				CCharacter *pTarget = apEnts[i];
+				vec2 TargetPos = GameServer()->m_World.CharacterPos(pTarget, RewindTick);
 
-				if ((pTarget == this) || GameServer()->Collision()->IntersectLine(ProjStartPos, pTarget->m_Pos, NULL, NULL))
+				if ((pTarget == this) || GameServer()->Collision()->IntersectLine(ProjStartPos, TargetPos, NULL, NULL))
 					continue;
 
 				// set his velocity to fast upward (for now)
-				if(length(pTarget->m_Pos-ProjStartPos) > 0.0f)
-					GameServer()->CreateHammerHit(pTarget->m_Pos-normalize(pTarget->m_Pos-ProjStartPos)*m_ProximityRadius*0.5f);
+				if(length(TargetPos-ProjStartPos) > 0.0f)
+					GameServer()->CreateHammerHit(TargetPos-normalize(TargetPos-ProjStartPos)*m_ProximityRadius*0.5f);
 				else
 					GameServer()->CreateHammerHit(ProjStartPos);
 
 				vec2 Dir;
-				if (length(pTarget->m_Pos - m_Pos) > 0.0f)
-					Dir = normalize(pTarget->m_Pos - m_Pos);
+				if (length(TargetPos - m_Pos) > 0.0f)
+					Dir = normalize(TargetPos - m_Pos);
 				else
 					Dir = vec2(0.f, -1.f);
 
@@ -1175,7 +1177,7 @@ void CCharacter::Snap(int SnappingClient)
 	if(NetworkClipped(SnappingClient))
 		return;
 	
-	if(GetPlayer()->m_Invisible && GetPlayer()->GetCID() != SnappingClient && m_Invisible == 1 && GameServer()->m_apPlayers[SnappingClient]->GetTeam() != TEAM_SPECTATORS && GetFreezeTicks() <= 0 && !GetPlayer()->m_Paused)
+	if(GetPlayer()->m_Invisible && SnappingClient > -1 && GetPlayer()->GetCID() != SnappingClient && m_Invisible == 1 && GameServer()->m_apPlayers[SnappingClient]->GetTeam() != TEAM_SPECTATORS && GetFreezeTicks() <= 0 && !GetPlayer()->m_Paused)
 		return;
 	
 	if(SnappingClient > -1)
@@ -1190,8 +1192,11 @@ void CCharacter::Snap(int SnappingClient)
 	if (m_Paused)
 		return;
 
+	// demos and checksums (-1) get the vanilla character
 	IServer::CClientInfo CltInfo;
-	Server()->GetClientInfo(SnappingClient, &CltInfo);
+	CltInfo.m_CustClt = false;
+	if(SnappingClient > -1)
+		Server()->GetClientInfo(SnappingClient, &CltInfo);
 
 	// measure distance between start and and first vanilla field
 	size_t Offset = (char*)(&Measure.m_Tick) - (char*)(&Measure);
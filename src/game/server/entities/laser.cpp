@@ -15,6 +15,11 @@ CLaser::CLaser(CGameWorld *pGameWorld, vec2 Pos, vec2 Direction, float StartEner
 	m_Dir = Direction;
 	m_Bounces = 0;
 	m_EvalTick = 0;
+
+	// keep the same distance to the shooter's view for the whole laser
+	int RewindTick = GameWorld()->RewindTick(Owner);
+	m_RewindTicks = RewindTick < 0 ? 0 : Server()->Tick()-RewindTick;
+
 	GameWorld()->InsertEntity(this);
 	DoBounce();
 }
@@ -27,9 +32,10 @@ bool CLaser::HitCharacter(vec2 From, vec2 To)
 	CCharacter *pHit = 0;
 	CCharacter *pSkipChar = pOwnerChar;
 	vec2 Pos = m_Pos;
+	int RewindTick = m_RewindTicks ? Server()->Tick()-m_RewindTicks : -1;
 	while (length(From-Pos) + length(Pos-To) < length(From-To) + 1e-5)
 	{
-		pSkipChar = GameServer()->m_World.IntersectCharacter(Pos, To, 0.f, At, pSkipChar);
+		pSkipChar = GameServer()->m_World.IntersectCharacter(Pos, To, 0.f, At, pSkipChar, RewindTick);
 		if (!pSkipChar)
 			break;
 		Pos = At + normalize(To-From)*(pSkipChar->m_ProximityRadius+1e-5);
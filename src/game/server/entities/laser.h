@@ -26,6 +26,7 @@ private:
 	int m_Bounces;
 	int m_EvalTick;
 	int m_Owner;
+	int m_RewindTicks;
 };
 
 #endif
@@ -3,9 +3,6 @@
 #include <game/server/gamecontext.h>
 #include "loltext.h"
 
-CLolPlasma *CLoltext::s_aapPlasma[MAX_LOLTEXTS][MAX_PLASMA_PER_LOLTEXT];
-int CLoltext::s_aExpire[MAX_LOLTEXTS];
-
 CLolPlasma::CLolPlasma(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Vel, int Lifespan, int ltid, int plid)
 : CEntity(pGameWorld, CGameWorld::ENTTYPE_LASER), m_ltid(ltid), m_plid(plid)
 {
@@ -23,7 +20,7 @@ void CLolPlasma::Reset()
 {
 	GameWorld()->DestroyEntity(this);
 	if (m_ltid >= 0)
-		CLoltext::PlasmaGone(m_ltid, m_plid);
+		CLoltext::PlasmaGone(GameWorld(), m_ltid, m_plid);
 	m_ltid = -1;
 }
 
@@ -87,9 +84,9 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 
 	int TextID = 0;
 	for(; TextID < MAX_LOLTEXTS; ++TextID)
-		if (s_aExpire[TextID] < pGameWorld->Server()->Tick())
+		if (pGameWorld->m_aLoltextExpire[TextID] < pGameWorld->Server()->Tick())
 		{
-			s_aExpire[TextID] = pGameWorld->Server()->Tick() + Lifespan;
+			pGameWorld->m_aLoltextExpire[TextID] = pGameWorld->Server()->Tick() + Lifespan;
 			break;
 		}
 
@@ -99,7 +96,7 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 	int NumPlasmas = 0;
 
 	for(int i = 0; i < MAX_PLASMA_PER_LOLTEXT; i++)
-		s_aapPlasma[TextID][i] = 0;
+		pGameWorld->m_aapLoltextPlasma[TextID][i] = 0;
 
 	while((c = *pText++))
 	{
@@ -111,7 +108,7 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 		for(int y = 0; y < 5/*XXX*/; ++y)
 			for(int x = 0; x < 3/*XXX*/; ++x)
 				if (s_aaaChars[(unsigned)c][y][x] && NumPlasmas < MAX_PLASMA_PER_LOLTEXT) {
-					s_aapPlasma[TextID][NumPlasmas] =
+					pGameWorld->m_aapLoltextPlasma[TextID][NumPlasmas] =
 					    new CLolPlasma(pGameWorld, pParent, CurPos + vec2(x*g_Config.m_SvLoltextHspace, y*g_Config.m_SvLoltextVspace),
 					    Vel, Lifespan, TextID, NumPlasmas);
 					NumPlasmas++;
@@ -121,18 +118,18 @@ int CLoltext::Create(CGameWorld *pGameWorld, CEntity *pParent, vec2 Pos, vec2 Ve
 	return TextID;
 }
 
-void CLoltext::Dump()
+void CLoltext::Dump(CGameWorld *pGameWorld)
 {
 	for(int i = 0; i < MAX_LOLTEXTS; i++)
-		dbg_msg("lt", "s_aExpire[%d] = %d", i, s_aExpire[i]);
+		dbg_msg("lt", "m_aLoltextExpire[%d] = %d", i, pGameWorld->m_aLoltextExpire[i]);
 
 	for(int i = 0; i < MAX_LOLTEXTS; i++)
 	{
 		int Count = 0;
 		for(int j = 0; j < MAX_PLASMA_PER_LOLTEXT; j++)
-			if (s_aapPlasma[i][j])
+			if (pGameWorld->m_aapLoltextPlasma[i][j])
 				Count++;
-		dbg_msg("tl", "|s_aapPlasma[%d]| = %d", i, Count);
+		dbg_msg("tl", "|m_aapLoltextPlasma[%d]| = %d", i, Count);
 	}
 
 }
@@ -149,22 +146,22 @@ void CLoltext::Destroy(CGameWorld *pGameWorld, int TextID)
 	if (TextID < 0 || TextID >= MAX_LOLTEXTS)
 		return;
 
-	if (s_aExpire[TextID] < pGameWorld->Server()->Tick())
+	if (pGameWorld->m_aLoltextExpire[TextID] < pGameWorld->Server()->Tick())
 	{
-		s_aExpire[TextID] = 0; //explicitly unset incase map cycles because Tick counting starts over with 0 then.
+		pGameWorld->m_aLoltextExpire[TextID] = 0; //explicitly unset incase map cycles because Tick counting starts over with 0 then.
 		return;
 	}
 	
 	for(int i = 0; i < MAX_PLASMA_PER_LOLTEXT; i++)
-		if (s_aapPlasma[TextID][i])
-			s_aapPlasma[TextID][i]->Reset();
+		if (pGameWorld->m_aapLoltextPlasma[TextID][i])
+			pGameWorld->m_aapLoltextPlasma[TextID][i]->Reset();
 
-	s_aExpire[TextID] = 0;
+	pGameWorld->m_aLoltextExpire[TextID] = 0;
 }
 
-void CLoltext::PlasmaGone(int TextID, int plid)
+void CLoltext::PlasmaGone(CGameWorld *pGameWorld, int TextID, int plid)
 {
-	s_aapPlasma[TextID][plid] = 0;
+	pGameWorld->m_aapLoltextPlasma[TextID][plid] = 0;
 }
 
 bool CLoltext::HasRepr(char c) // can be removed when we have a full character set
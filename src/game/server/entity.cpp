@@ -4,6 +4,39 @@
 #include "entity.h"
 #include "gamecontext.h"
 
+//////////////////////////////////////////////////
+// Id pool
+//////////////////////////////////////////////////
+CIdPool::CIdPool()
+{
+	mem_zero(m_aUsed, sizeof(m_aUsed));
+}
+
+void *CIdPool::Alloc(int Size, int ID)
+{
+	dbg_assert(!m_aUsed[ID], "already used");
+	m_aUsed[ID] = true;
+
+	// the header is a multiple of 8 bytes, so the object stays aligned
+	CHeader *pHeader = (CHeader *)mem_alloc(sizeof(CHeader)+Size, sizeof(double));
+	pHeader->m_pPool = this;
+	pHeader->m_ID = ID;
+	mem_zero(pHeader+1, Size);
+	return pHeader+1;
+}
+
+void CIdPool::Free(void *pData)
+{
+	if(!pData)
+		return;
+
+	CHeader *pHeader = (CHeader *)pData-1;
+	CIdPool *pPool = pHeader->m_pPool;
+	dbg_assert(pPool->m_aUsed[pHeader->m_ID], "not used");
+	pPool->m_aUsed[pHeader->m_ID] = false;
+	mem_free(pHeader);
+}
+
 //////////////////////////////////////////////////
 // Entity
 //////////////////////////////////////////////////
@@ -46,7 +79,7 @@ int CEntity::NetworkClipped(int SnappingClient, vec2 CheckPos)
 
 	if(distance(GameServer()->m_apPlayers[SnappingClient]->m_ViewPos, CheckPos) > 1100.0f)
 		return 1;
-	return 0;
+	return GameServer()->InInterest(CheckPos) ? 0 : 1;
 }
 
 bool CEntity::GameLayerClipped(vec2 CheckPos)
@@ -25,29 +25,45 @@
 
 #define MACRO_ALLOC_POOL_ID() \
 	public: \
-	void *operator new(size_t Size, int id); \
+	void *operator new(size_t Size, int id, class CIdPool *pPool); \
 	void operator delete(void *p); \
 	private:
 
+/*
+	Class: CIdPool
+		Slots for the objects with one instance per client id. Every game
+		context has its own pools, so several game servers can share the
+		process. The objects live on the heap behind a small header that
+		leads them back to their slot.
+*/
+class CIdPool
+{
+	struct CHeader
+	{
+		CIdPool *m_pPool;
+		int m_ID;
+	};
+
+	bool m_aUsed[MAX_CLIENTS];
+
+public:
+	CIdPool();
+	void *Alloc(int Size, int ID);
+	static void Free(void *pData);
+};
+
 #define MACRO_ALLOC_POOL_ID_IMPL(POOLTYPE, PoolSize) \
-	static char ms_PoolData##POOLTYPE[PoolSize][sizeof(POOLTYPE)] = {{0}}; \
-	static int ms_PoolUsed##POOLTYPE[PoolSize] = {0}; \
-	void *POOLTYPE::operator new(size_t Size, int id) \
+	void *POOLTYPE::operator new(size_t Size, int id, CIdPool *pPool) \
 	{ \
 		dbg_assert(sizeof(POOLTYPE) == Size, "size error"); \
-		dbg_assert(!ms_PoolUsed##POOLTYPE[id], "already used"); \
+		dbg_assert(id >= 0 && id < PoolSize && id < MAX_CLIENTS, "invalid id"); \
 		/*dbg_msg("pool", "++ %s %d", #POOLTYPE, id);*/ \
-		ms_PoolUsed##POOLTYPE[id] = 1; \
-		mem_zero(ms_PoolData##POOLTYPE[id], Size); \
-		return ms_PoolData##POOLTYPE[id]; \
+		return pPool->Alloc(Size, id); \
 	} \
 	void POOLTYPE::operator delete(void *p) \
 	{ \
-		int id = (POOLTYPE*)p - (POOLTYPE*)ms_PoolData##POOLTYPE; \
-		dbg_assert(ms_PoolUsed##POOLTYPE[id], "not used"); \
-		/*dbg_msg("pool", "-- %s %d", #POOLTYPE, id);*/ \
-		ms_PoolUsed##POOLTYPE[id] = 0; \
-		mem_zero(ms_PoolData##POOLTYPE[id], sizeof(POOLTYPE)); \
+		/*dbg_msg("pool", "-- %s", #POOLTYPE);*/ \
+		CIdPool::Free(p); \
 	}
 
 /*
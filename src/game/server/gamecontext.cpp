@@ -703,7 +703,7 @@ void CGameContext::OnClientConnected(int ClientID)
 	// Check which team the player should be on
 	const int StartTeam = g_Config.m_SvTournamentMode ? TEAM_SPECTATORS : m_pController->GetAutoTeam(ClientID);
 
-	m_apPlayers[ClientID] = new(ClientID) CPlayer(this, ClientID, StartTeam);
+	m_apPlayers[ClientID] = new(ClientID, &m_PlayerPool) CPlayer(this, ClientID, StartTeam);
 	//players[client_id].init(client_id);
 	//players[client_id].client_id = client_id;
 
@@ -2004,6 +2004,14 @@ void CGameContext::OnInit(/*class IKernel *pKernel*/)
 
 	m_Layers.Init(Kernel());
 	m_Collision.Init(&m_Layers);
+	if(g_Config.m_SvPvs)
+	{
+		int64 Start = time_get();
+		m_Collision.InitVisibility();
+		char aBuf[128];
+		str_format(aBuf, sizeof(aBuf), "visibility table built in %.2fms", (time_get()-Start)*1000.0f/time_freq());
+		Console()->Print(IConsole::OUTPUT_LEVEL_DEBUG, "game", aBuf);
+	}
 
 	// reset everything here
 	//world = new GAMEWORLD;
@@ -2091,6 +2099,16 @@ void CGameContext::OnSnap(int ClientID)
 		Server()->SendMsg(&Msg, MSGFLAG_RECORD|MSGFLAG_NOSEND, ClientID);
 	}
 
+	// free view moves the camera anywhere at once, stay with the plain distance checks there
+	m_Interest.m_Active = false;
+	if(ClientID != -1 && m_apPlayers[ClientID] && m_Collision.HasVisibility())
+	{
+		CPlayer *pPlayer = m_apPlayers[ClientID];
+		m_Interest.m_Active = !((pPlayer->GetTeam() == TEAM_SPECTATORS || pPlayer->m_Paused) && pPlayer->m_SpectatorID == SPEC_FREEVIEW);
+		m_Interest.m_ViewPos = pPlayer->m_ViewPos;
+		m_Interest.m_RadiusSquared = (float)g_Config.m_SvPvsRadius*g_Config.m_SvPvsRadius;
+	}
+
 	m_World.Snap(ClientID);
 	m_pController->Snap(ClientID);
 	m_Events.Snap(ClientID);
@@ -2101,6 +2119,17 @@ void CGameContext::OnSnap(int ClientID)
 			m_apPlayers[i]->Snap(ClientID);
 	}
 }
+
+bool CGameContext::InInterest(vec2 Pos) const
+{
+	if(!m_Interest.m_Active)
+		return true;
+	vec2 Delta = Pos-m_Interest.m_ViewPos;
+	if(Delta.x*Delta.x+Delta.y*Delta.y < m_Interest.m_RadiusSquared)
+		return true;
+	return m_Collision.IsVisible(m_Interest.m_ViewPos, Pos);
+}
+
 void CGameContext::OnPreSnap() {}
 void CGameContext::OnPostSnap()
 {
@@ -2121,6 +2150,8 @@ const char *CGameContext::GameType() { return m_pController && m_pController->m_
 const char *CGameContext::Version() { return GAME_VERSION; }
 const char *CGameContext::NetVersion() { return GAME_NETVERSION; }
 const char *CGameContext::NetVersionCust() { return GAME_NETVERSION_CUST; }
+const char *CGameContext::NetObjName(int Type) { return m_NetObjHandler.GetObjName(Type); }
+const char *CGameContext::NetMsgName(int MsgID) { return m_NetObjHandler.GetMsgName(MsgID); }
 
 IGameServer *CreateGameServer() { return new CGameContext; }
 
@@ -2343,6 +2374,21 @@ void CGameContext::Converse(int ClientID, char *pStr)
 	}
 }
 
+int CGameContext::CountEntities(int *pCounts, const char **ppNames, int MaxTypes)
+{
+	static const char *s_apNames[CGameWorld::NUM_ENTTYPES] = {"projectile", "laser", "pickup", "flag", "character"};
+
+	int NumTypes = min((int)CGameWorld::NUM_ENTTYPES, MaxTypes);
+	for(int t = 0; t < NumTypes; t++)
+	{
+		pCounts[t] = 0;
+		for(CEntity *pEnt = m_World.FindFirst(t); pEnt; pEnt = pEnt->TypeNext())
+			pCounts[t]++;
+		ppNames[t] = s_apNames[t];
+	}
+	return NumTypes;
+}
+
 void CGameContext::OnSetAuthed(int ClientID, int Level)
 {
 	CServer* pServ = (CServer*)Server();
@@ -99,6 +99,17 @@ public:
 
 	CEventHandler m_Events;
 	CPlayer *m_apPlayers[MAX_CLIENTS];
+	CIdPool m_PlayerPool;
+	CIdPool m_CharacterPool;
+
+	// what the client that is snapped can see, set up once per snap
+	struct CInterest
+	{
+		bool m_Active;
+		vec2 m_ViewPos;
+		float m_RadiusSquared;
+	} m_Interest;
+	bool InInterest(vec2 Pos) const;
 
 	IGameController *m_pController;
 	CGameWorld m_World;
@@ -205,6 +216,9 @@ public:
 	virtual bool PlayerCollision();
 	
 	virtual void OnSetAuthed(int ClientID,int Level);
+	virtual int CountEntities(int *pCounts, const char **ppNames, int MaxTypes);
+	virtual const char *NetObjName(int Type);
+	virtual const char *NetMsgName(int MsgID);
 
 	bool IsFilteredWord(const char* pSentence);
 	int ProcessSpamProtection(int ClientID);
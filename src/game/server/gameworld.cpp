@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
 
+#include <engine/shared/config.h>
+
 #include "gameworld.h"
 #include "entity.h"
 #include "gamecontext.h"
@@ -17,6 +19,9 @@ CGameWorld::CGameWorld()
 	m_ResetRequested = false;
 	for(int i = 0; i < NUM_ENTTYPES; i++)
 		m_apFirstEntityTypes[i] = 0;
+	mem_zero(m_aapLoltextPlasma, sizeof(m_aapLoltextPlasma));
+	mem_zero(m_aLoltextExpire, sizeof(m_aLoltextExpire));
+	ClearHistory();
 }
 
 CGameWorld::~CGameWorld()
@@ -128,6 +133,9 @@ void CGameWorld::Reset()
 	GameServer()->m_pController->PostReset();
 	RemoveEntities();
 
+	// the characters got respawned, old positions are of no use anymore
+	ClearHistory();
+
 	m_ResetRequested = false;
 }
 
@@ -186,24 +194,117 @@ void CGameWorld::Tick()
 	}
 
 	RemoveEntities();
+
+	RecordHistory();
+}
+
+void CGameWorld::ClearHistory()
+{
+	for(int i = 0; i < HISTORY_SIZE; i++)
+		m_aHistory[i].m_Tick = -1;
+}
+
+void CGameWorld::RecordHistory()
+{
+	CCharacterHistory *pHistory = &m_aHistory[Server()->Tick()%HISTORY_SIZE];
+	pHistory->m_Tick = Server()->Tick();
+	for(int i = 0; i < MAX_CLIENTS; i++)
+		pHistory->m_aAlive[i] = false;
+
+	for(CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+	{
+		int ClientID = p->GetPlayer()->GetCID();
+		pHistory->m_aAlive[ClientID] = true;
+		pHistory->m_aPos[ClientID] = p->m_Pos;
+	}
+}
+
+const CGameWorld::CCharacterHistory *CGameWorld::FindHistory(int Tick) const
+{
+	if(Tick < 0)
+		return 0;
+	const CCharacterHistory *pHistory = &m_aHistory[Tick%HISTORY_SIZE];
+	return pHistory->m_Tick == Tick ? pHistory : 0;
+}
+
+int CGameWorld::RewindTick(int ClientID)
+{
+	if(!g_Config.m_SvLagCompensation || ClientID < 0 || ClientID >= MAX_CLIENTS)
+		return -1;
+
+	int AckedTick = Server()->ClientLastAckedSnapshot(ClientID);
+	if(AckedTick < 0)
+		return -1;
+
+	// the snapshot shows the world as it was after that tick
+	int Now = Server()->Tick();
+	int MaxTicks = min(g_Config.m_SvLagCompensationMax*Server()->TickSpeed()/1000, (int)HISTORY_SIZE-1);
+	int Tick = clamp(AckedTick, Now-MaxTicks, Now);
+	return Tick == Now ? -1 : Tick;
+}
+
+vec2 CGameWorld::CharacterPos(CCharacter *pChr, int Tick)
+{
+	const CCharacterHistory *pHistory = FindHistory(Tick);
+	int ClientID = pChr->GetPlayer()->GetCID();
+	if(pHistory && pHistory->m_aAlive[ClientID])
+		return pHistory->m_aPos[ClientID];
+	return pChr->m_Pos;
+}
+
+int CGameWorld::FindCharacters(vec2 Pos, float Radius, CCharacter **ppChars, int Max, int RewindTick)
+{
+	const CCharacterHistory *pHistory = FindHistory(RewindTick);
+
+	int Num = 0;
+	for(CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER); p; p = (CCharacter *)p->TypeNext())
+	{
+		int ClientID = p->GetPlayer()->GetCID();
+		vec2 CharPos = pHistory && pHistory->m_aAlive[ClientID] ? pHistory->m_aPos[ClientID] : p->m_Pos;
+		if(distance(CharPos, Pos) < Radius+p->m_ProximityRadius)
+		{
+			if(ppChars)
+				ppChars[Num] = p;
+			Num++;
+			if(Num == Max)
+				break;
+		}
+	}
+
+	return Num;
 }
 
 
 // TODO: should be more general
-CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2& NewPos, CEntity *pNotThis)
+CCharacter *CGameWorld::IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2& NewPos, CEntity *pNotThis, int RewindTick)
 {
+	// live and rewound traces take the same path, only the positions differ
+	const CCharacterHistory *pHistory = FindHistory(RewindTick);
+
 	// Find other players
 	float ClosestLen = distance(Pos0, Pos1) * 100.0f;
 	CCharacter *pClosest = 0;
 
+	// bounding box of the trace, characters outside of it can't be hit
+	vec2 BoxMin = vec2(min(Pos0.x, Pos1.x), min(Pos0.y, Pos1.y));
+	vec2 BoxMax = vec2(max(Pos0.x, Pos1.x), max(Pos0.y, Pos1.y));
+
 	CCharacter *p = (CCharacter *)FindFirst(ENTTYPE_CHARACTER);
 	for(; p; p = (CCharacter *)p->TypeNext())
  	{
 		if(p == pNotThis)
 			continue;
 
-		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, p->m_Pos);
-		float Len = distance(p->m_Pos, IntersectPos);
+		int ClientID = p->GetPlayer()->GetCID();
+		vec2 CharPos = pHistory && pHistory->m_aAlive[ClientID] ? pHistory->m_aPos[ClientID] : p->m_Pos;
+
+		float Reach = p->m_ProximityRadius+Radius;
+		if(CharPos.x+Reach < BoxMin.x || CharPos.x-Reach > BoxMax.x ||
+			CharPos.y+Reach < BoxMin.y || CharPos.y-Reach > BoxMax.y)
+			continue;
+
+		vec2 IntersectPos = closest_point_on_line(Pos0, Pos1, CharPos);
+		float Len = distance(CharPos, IntersectPos);
 		if(Len < p->m_ProximityRadius+Radius)
 		{
 			Len = distance(Pos0, IntersectPos);
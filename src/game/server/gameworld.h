@@ -7,6 +7,10 @@
 
 class CEntity;
 class CCharacter;
+class CLolPlasma;
+
+#define MAX_LOLTEXTS 16
+#define MAX_PLASMA_PER_LOLTEXT 128
 
 /*
 	Class: Game World
@@ -26,10 +30,29 @@ public:
 		NUM_ENTTYPES
 	};
 
+	enum
+	{
+		HISTORY_SIZE=16, // a bit more than 300ms at 50 ticks per second
+	};
+
 private:
 	void Reset();
 	void RemoveEntities();
 
+	// only positions are kept. the laser and hammer hit checks don't look
+	// at hooks, so the hook states the request asked for are left out
+	struct CCharacterHistory
+	{
+		int m_Tick;
+		bool m_aAlive[MAX_CLIENTS];
+		vec2 m_aPos[MAX_CLIENTS];
+	};
+	CCharacterHistory m_aHistory[HISTORY_SIZE];
+
+	void ClearHistory();
+	void RecordHistory();
+	const CCharacterHistory *FindHistory(int Tick) const;
+
 	CEntity *m_pNextTraverseEntity;
 	CEntity *m_apFirstEntityTypes[NUM_ENTTYPES];
 
@@ -44,6 +67,10 @@ public:
 	bool m_Paused;
 	CWorldCore m_Core;
 
+	// loltexts living in this world, see CLoltext
+	CLolPlasma *m_aapLoltextPlasma[MAX_LOLTEXTS][MAX_PLASMA_PER_LOLTEXT];
+	int m_aLoltextExpire[MAX_LOLTEXTS];
+
 	CGameWorld();
 	~CGameWorld();
 
@@ -82,7 +109,54 @@ public:
 		Returns:
 			Returns a pointer to the closest hit or NULL of there is no intersection.
 	*/
-	class CCharacter *IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis = 0);
+	class CCharacter *IntersectCharacter(vec2 Pos0, vec2 Pos1, float Radius, vec2 &NewPos, class CEntity *pNotThis = 0, int RewindTick = -1);
+
+	/*
+		Function: find_characters
+			Finds characters close to a position, like find_entities.
+
+		Arguments:
+			pos - Position.
+			radius - How close the characters have to be.
+			chars - Pointer to a list that should be filled with the pointers
+				to the characters.
+			max - Number of characters that fits into the chars array.
+			rewind_tick - Tick to take the character positions from, -1 for
+				the current positions.
+
+		Returns:
+			Number of characters found and added to the chars array.
+	*/
+	int FindCharacters(vec2 Pos, float Radius, class CCharacter **ppChars, int Max, int RewindTick = -1);
+
+	/*
+		Function: rewind_tick
+			Tick the hits of a client's weapons get checked against when
+			lag compensation is enabled.
+
+		Arguments:
+			client_id - Client that shoots.
+
+		Returns:
+			The tick of the client's last acknowledged snapshot, limited by
+			sv_lag_compensation_max, or -1 if there is nothing to rewind.
+	*/
+	int RewindTick(int ClientID);
+
+	/*
+		Function: character_pos
+			Position of a character at a past tick.
+
+		Arguments:
+			chr - The character.
+			tick - Tick to take the position from, -1 for the current
+				position.
+
+		Returns:
+			The recorded position, or the current one if the character
+			wasn't alive at that tick.
+	*/
+	vec2 CharacterPos(class CCharacter *pChr, int Tick);
 
 	/*
 		Function: closest_CCharacter
@@ -19,6 +19,9 @@ MACRO_CONFIG_INT(ClShowfps, cl_showfps, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "S
 
 MACRO_CONFIG_INT(ClAirjumpindicator, cl_airjumpindicator, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "")
 MACRO_CONFIG_INT(ClThreadsoundloading, cl_threadsoundloading, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Load sound files threaded")
+MACRO_CONFIG_INT(ClThreadimageloading, cl_threadimageloading, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Decode skins and map images threaded")
+MACRO_CONFIG_INT(ClImageThreads, cl_image_threads, 3, 1, 16, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Number of threads that decode images")
+MACRO_CONFIG_INT(ClImageUploadBudget, cl_image_upload_budget, 4096, 0, 65536, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Kilobytes of decoded images uploaded per frame (0 = no limit)")
 
 MACRO_CONFIG_INT(ClWarningTeambalance, cl_warning_teambalance, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Warn about team balance")
 
@@ -54,6 +57,7 @@ MACRO_CONFIG_INT(UiColorLht, ui_color_lht, 175, 0, 255, CFGFLAG_CLIENT|CFGFLAG_S
 MACRO_CONFIG_INT(UiColorAlpha, ui_color_alpha, 228, 0, 255, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Interface alpha")
 
 MACRO_CONFIG_INT(GfxNoclip, gfx_noclip, 0, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Disable clipping")
+MACRO_CONFIG_INT(GfxTileBuffers, gfx_tile_buffers, 1, 0, 1, CFGFLAG_CLIENT|CFGFLAG_SAVE, "Keep the tile layers of the map in static vertex buffers")
 
 // server
 MACRO_CONFIG_INT(SvWarmup, sv_warmup, 0, 0, 0, CFGFLAG_SERVER, "Number of seconds to do warmup before round starts")
@@ -107,6 +111,8 @@ MACRO_CONFIG_INT(SvEndvoteScore, sv_endvote_score, 10, 0, 100, CFGFLAG_SERVER, "
 MACRO_CONFIG_INT(SvExtend, sv_extend, 0, 0, 0, CFGFLAG_SERVER, "when set to 1 before round ends, another round on the same map is enforced and this is reset to 0")
 MACRO_CONFIG_INT(SvLoltextHspace, sv_loltext_hspace, 14, 10, 25, CFGFLAG_SERVER, "horizontal offset between loltext 'pixels'")
 MACRO_CONFIG_INT(SvLoltextVspace, sv_loltext_vspace, 14, 10, 25, CFGFLAG_SERVER, "vertical offset between loltext 'pixels'")
+MACRO_CONFIG_INT(SvPvs, sv_pvs, 0, 0, 1, CFGFLAG_SERVER, "don't send entities and events that solid parts of the map hide from a player (takes effect on map change)")
+MACRO_CONFIG_INT(SvPvsRadius, sv_pvs_radius, 750, 0, 1100, CFGFLAG_SERVER, "entities and events closer than this to a player are always sent with sv_pvs")
 MACRO_CONFIG_INT(SvBloodInterval, sv_blood_interval, 1, 1, 300, CFGFLAG_SERVER, "should stay at 1 for openfng (as we bleed for only 1 tick)")
 MACRO_CONFIG_INT(SvBleedOnFreeze, sv_bleed_on_freeze, 1, 0, 1, CFGFLAG_SERVER, "'blood' splash + sound on freezing someone")
 
@@ -136,6 +142,9 @@ MACRO_CONFIG_INT(SvMeltLoltext, sv_melt_loltext, 0, 0, 1, CFGFLAG_SERVER, "displ
 MACRO_CONFIG_INT(SvLaserSkipFrozen, sv_laser_skip_frozen, 0, 0, 1, CFGFLAG_SERVER, "allow/disallow shooting through frozen tees")
 MACRO_CONFIG_INT(SvLaserSkipTeammates, sv_laser_skip_teammates, 0, 0, 1, CFGFLAG_SERVER, "allow/disallow shooting through teammates")
 
+MACRO_CONFIG_INT(SvLagCompensation, sv_lag_compensation, 0, 0, 1, CFGFLAG_SERVER, "check laser and hammer hits against the positions the shooter saw")
+MACRO_CONFIG_INT(SvLagCompensationMax, sv_lag_compensation_max, 200, 0, 300, CFGFLAG_SERVER, "maximum time in milliseconds hits get rewound")
+
 MACRO_CONFIG_INT(SvSacrSound, sv_sacr_sound, 1, 0, 2, CFGFLAG_SERVER, "play ctf capture sound on sacrification (0 = off, 1 = global, 2 = local")
 
 MACRO_CONFIG_INT(SvAllYourBase, sv_all_your_base, 50, 0, 200, CFGFLAG_SERVER, "display AYB if one team does only need this many score in order to win")
@@ -0,0 +1,770 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+
+#include <engine/shared/compression.h>
+#include <engine/shared/linereader.h>
+#include <engine/shared/network.h>
+#include <engine/shared/packer.h>
+#include <engine/shared/protocol.h>
+#include <engine/shared/snapshot.h>
+
+#include <game/generated/protocol.h>
+#include <game/version.h>
+
+/*
+	Load client, puts a game server under load.
+
+	Connects a number of headless clients to a server. Each one goes
+	through the connect, map download and enter game handshake, then
+	sends an input every tick and unpacks and acks the snapshots like
+	the real client does. The inputs are random or come from a script.
+
+	At the end every connection reports its snapshot latency (from
+	sending the input for a tick to receiving the snapshot of that
+	tick), the payload bandwidth and the snapshots that never arrived.
+
+	The server should allow enough clients per address for this
+	(sv_max_clients_per_ip).
+
+	Usage: load_client [-n clients] [-t seconds] [-ramp ms] [-script file] [-seed n] [-password pw] [address]
+
+	The script has one input per line, which is held for a number of ticks:
+		ticks direction jump fire hook weapon targetx targety
+	It starts over when it reaches the end.
+*/
+
+enum
+{
+	MAX_LOAD_CLIENTS=64,
+	MAX_SCRIPT_INPUTS=1024,
+	NUM_INPUT_TIMES=200,
+	MAX_LATENCY=1000,
+	REPORT_INTERVAL=5,
+};
+
+class CScriptInput
+{
+public:
+	int m_Ticks;
+	CNetObj_PlayerInput m_Input;
+};
+
+static CScriptInput s_aScript[MAX_SCRIPT_INPUTS];
+static int s_NumScriptInputs = 0;
+
+static const char *s_pPassword = "";
+static CNetObjHandler s_NetObjHandler;
+
+class CLoadClient
+{
+public:
+	enum
+	{
+		STATE_IDLE=0,
+		STATE_CONNECTING,
+		STATE_LOADING,
+		STATE_READY,
+		STATE_ENTERING,
+		STATE_INGAME,
+		STATE_OFFLINE,
+	};
+
+	int m_ID;
+	int m_State;
+	CNetClient m_NetClient;
+
+	// handshake
+	int64 m_ConnectTime;
+	int64 m_EnterTime;
+	int m_MapCrc;
+	int m_MapSize;
+	int m_MapChunk;
+	int m_MapReceived;
+
+	// snapshots
+	CSnapshotDelta m_SnapshotDelta;
+	CSnapshotStorage m_SnapshotStorage;
+	char m_aSnapshotIncomingData[CSnapshot::MAX_SIZE];
+	unsigned m_SnapshotParts;
+	int m_CurrentRecvTick;
+	int m_AckGameTick;
+	int64 m_AckTime;
+
+	// input
+	unsigned m_Seed;
+	CNetObj_PlayerInput m_Input;
+	int m_InputTicksLeft;
+	int m_ScriptPos;
+	int m_PredMargin;
+	int m_LastInputTick;
+	int64 m_NextInputTime;
+	int m_aInputTicks[NUM_INPUT_TIMES];
+	int64 m_aInputTimes[NUM_INPUT_TIMES];
+	int m_CurrentInput;
+
+	// statistics
+	int m_NumSnaps;
+	int m_NumEmptySnaps;
+	int m_SnapErrors;
+	int m_FirstSnapTick;
+	int m_LastSnapTick;
+	int m_SnapStep;
+	int m_aLatencies[MAX_LATENCY+1];
+	int m_NumLatencies;
+	int64 m_LatencySum;
+	int64 m_RecvBytes;
+	int64 m_SentBytes;
+	char m_aError[128];
+
+	CLoadClient(int ID, unsigned Seed);
+
+	int NextRandom();
+	void SetError(const char *pError);
+	void SendMsg(CMsgPacker *pMsg, int Flags, bool System);
+	void Connect(NETADDR *pAddr);
+	void Update();
+	void ProcessPacket(CNetChunk *pPacket);
+	void ProcessSnapshot(int Msg, CUnpacker *pUnpacker);
+	void NextInput();
+	void SendInput();
+	int LatencyPercentile(int Percent) const;
+};
+
+CLoadClient::CLoadClient(int ID, unsigned Seed)
+{
+	m_ID = ID;
+	m_State = STATE_IDLE;
+	m_ConnectTime = 0;
+	m_EnterTime = 0;
+	m_MapCrc = 0;
+	m_MapSize = 0;
+	m_MapChunk = 0;
+	m_MapReceived = 0;
+
+	for(int i = 0; i < NUM_NETOBJTYPES; i++)
+		m_SnapshotDelta.SetStaticsize(i, s_NetObjHandler.GetObjSize(i));
+	m_SnapshotStorage.Init();
+	m_SnapshotParts = 0;
+	m_CurrentRecvTick = 0;
+	m_AckGameTick = -1;
+	m_AckTime = 0;
+
+	m_Seed = Seed;
+	mem_zero(&m_Input, sizeof(m_Input));
+	m_InputTicksLeft = 0;
+	m_ScriptPos = 0;
+	m_PredMargin = 3;
+	m_LastInputTick = 0;
+	m_NextInputTime = 0;
+	for(int i = 0; i < NUM_INPUT_TIMES; i++)
+		m_aInputTicks[i] = -1;
+	mem_zero(m_aInputTimes, sizeof(m_aInputTimes));
+	m_CurrentInput = 0;
+
+	m_NumSnaps = 0;
+	m_NumEmptySnaps = 0;
+	m_SnapErrors = 0;
+	m_FirstSnapTick = -1;
+	m_LastSnapTick = -1;
+	m_SnapStep = 0;
+	mem_zero(m_aLatencies, sizeof(m_aLatencies));
+	m_NumLatencies = 0;
+	m_LatencySum = 0;
+	m_RecvBytes = 0;
+	m_SentBytes = 0;
+	m_aError[0] = 0;
+}
+
+int CLoadClient::NextRandom()
+{
+	m_Seed = m_Seed*1103515245+12345;
+	return (m_Seed>>16)&0x7fff;
+}
+
+void CLoadClient::SetError(const char *pError)
+{
+	if(m_State == STATE_OFFLINE)
+		return;
+	str_copy(m_aError, pError, sizeof(m_aError));
+	dbg_msg("load_client", "client %d: %s", m_ID, pError);
+	m_NetClient.Disconnect(pError);
+	m_State = STATE_OFFLINE;
+}
+
+void CLoadClient::SendMsg(CMsgPacker *pMsg, int Flags, bool System)
+{
+	CNetChunk Packet;
+	mem_zero(&Packet, sizeof(Packet));
+	Packet.m_ClientID = 0;
+	Packet.m_pData = pMsg->Data();
+	Packet.m_DataSize = pMsg->Size();
+
+	// the message id carries the system flag
+	*((unsigned char*)Packet.m_pData) <<= 1;
+	if(System)
+		*((unsigned char*)Packet.m_pData) |= 1;
+
+	if(Flags&MSGFLAG_VITAL)
+		Packet.m_Flags |= NETSENDFLAG_VITAL;
+	if(Flags&MSGFLAG_FLUSH)
+		Packet.m_Flags |= NETSENDFLAG_FLUSH;
+
+	m_SentBytes += Packet.m_DataSize;
+	m_NetClient.Send(&Packet);
+}
+
+void CLoadClient::Connect(NETADDR *pAddr)
+{
+	NETADDR BindAddr;
+	mem_zero(&BindAddr, sizeof(BindAddr));
+	BindAddr.type = pAddr->type;
+	if(!m_NetClient.Open(BindAddr, 0))
+	{
+		str_copy(m_aError, "could not open socket", sizeof(m_aError));
+		m_State = STATE_OFFLINE;
+		return;
+	}
+
+	m_NetClient.Connect(pAddr);
+	m_ConnectTime = time_get();
+	m_State = STATE_CONNECTING;
+}
+
+void CLoadClient::Update()
+{
+	if(m_State == STATE_IDLE || m_State == STATE_OFFLINE)
+		return;
+
+	m_NetClient.Update();
+
+	if(m_NetClient.State() == NETSTATE_OFFLINE)
+	{
+		SetError(m_NetClient.ErrorString()[0] ? m_NetClient.ErrorString() : "connection lost");
+		return;
+	}
+
+	if(m_State == STATE_CONNECTING && m_NetClient.State() == NETSTATE_ONLINE)
+	{
+		m_State = STATE_LOADING;
+		// the snapshots of the own client carry the extended character
+		CMsgPacker Msg(NETMSG_INFO);
+		Msg.AddString(GAME_NETVERSION_CUST, 128);
+		Msg.AddString(s_pPassword, 128);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+
+	CNetChunk Packet;
+	while(m_State != STATE_OFFLINE && m_NetClient.Recv(&Packet))
+	{
+		if(Packet.m_ClientID != -1)
+			ProcessPacket(&Packet);
+	}
+
+	if(m_State == STATE_INGAME && time_get() >= m_NextInputTime)
+		SendInput();
+}
+
+void CLoadClient::ProcessPacket(CNetChunk *pPacket)
+{
+	m_RecvBytes += pPacket->m_DataSize;
+
+	CUnpacker Unpacker;
+	Unpacker.Reset(pPacket->m_pData, pPacket->m_DataSize);
+	int Msg = Unpacker.GetInt();
+	int Sys = Msg&1;
+	Msg >>= 1;
+	if(Unpacker.Error())
+		return;
+
+	if(!Sys)
+	{
+		// only the go ahead to enter is of interest from the game
+		if(Msg == NETMSGTYPE_SV_READYTOENTER && m_State == STATE_READY)
+		{
+			CMsgPacker Msg(NETMSG_ENTERGAME);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+			m_State = STATE_ENTERING;
+		}
+		return;
+	}
+
+	if(Msg == NETMSG_MAP_CHANGE)
+	{
+		Unpacker.GetString(CUnpacker::SANITIZE_CC);
+		m_MapCrc = Unpacker.GetInt();
+		m_MapSize = Unpacker.GetInt();
+		if(Unpacker.Error() || m_MapSize < 0)
+		{
+			SetError("invalid map change");
+			return;
+		}
+
+		// the map is downloaded like a client without it does, but thrown away
+		m_MapChunk = 0;
+		m_MapReceived = 0;
+		CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
+		Msg.AddInt(m_MapChunk);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+	}
+	else if(Msg == NETMSG_MAP_DATA)
+	{
+		int Last = Unpacker.GetInt();
+		int MapCrc = Unpacker.GetInt();
+		int Chunk = Unpacker.GetInt();
+		int Size = Unpacker.GetInt();
+		Unpacker.GetRaw(Size);
+		if(Unpacker.Error() || Size <= 0 || MapCrc != m_MapCrc || Chunk != m_MapChunk)
+			return;
+
+		m_MapReceived += Size;
+		if(Last)
+		{
+			if(m_MapReceived != m_MapSize)
+			{
+				SetError("map download size mismatch");
+				return;
+			}
+			CMsgPacker Msg(NETMSG_READY);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		}
+		else
+		{
+			m_MapChunk++;
+			CMsgPacker Msg(NETMSG_REQUEST_MAP_DATA);
+			Msg.AddInt(m_MapChunk);
+			SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, true);
+		}
+	}
+	else if(Msg == NETMSG_CON_READY)
+	{
+		char aName[16];
+		str_format(aName, sizeof(aName), "load %d", m_ID);
+		CNetMsg_Cl_StartInfo StartInfo;
+		StartInfo.m_pName = aName;
+		StartInfo.m_pClan = "";
+		StartInfo.m_Country = -1;
+		StartInfo.m_pSkin = "default";
+		StartInfo.m_UseCustomColor = 0;
+		StartInfo.m_ColorBody = 0;
+		StartInfo.m_ColorFeet = 0;
+
+		CMsgPacker Msg(StartInfo.MsgID());
+		StartInfo.Pack(&Msg);
+		SendMsg(&Msg, MSGFLAG_VITAL|MSGFLAG_FLUSH, false);
+		m_State = STATE_READY;
+	}
+	else if(Msg == NETMSG_PING)
+	{
+		CMsgPacker Msg(NETMSG_PING_REPLY);
+		SendMsg(&Msg, MSGFLAG_FLUSH, true);
+	}
+	else if(Msg == NETMSG_INPUTTIMING)
+	{
+		Unpacker.GetInt();
+		int TimeLeft = Unpacker.GetInt();
+		if(Unpacker.Error())
+			return;
+
+		// keep the inputs arriving one to three ticks early
+		if(TimeLeft < 10)
+			m_PredMargin = min(m_PredMargin+1, 50);
+		else if(TimeLeft > 70)
+			m_PredMargin = max(m_PredMargin-1, 1);
+	}
+	else if(Msg == NETMSG_SNAP || Msg == NETMSG_SNAPSINGLE || Msg == NETMSG_SNAPEMPTY)
+		ProcessSnapshot(Msg, &Unpacker);
+}
+
+void CLoadClient::ProcessSnapshot(int Msg, CUnpacker *pUnpacker)
+{
+	int NumParts = 1;
+	int Part = 0;
+	int GameTick = pUnpacker->GetInt();
+	int DeltaTick = GameTick-pUnpacker->GetInt();
+	int PartSize = 0;
+	int Crc = 0;
+
+	if(Msg == NETMSG_SNAP)
+	{
+		NumParts = pUnpacker->GetInt();
+		Part = pUnpacker->GetInt();
+	}
+
+	if(Msg != NETMSG_SNAPEMPTY)
+	{
+		Crc = pUnpacker->GetInt();
+		PartSize = pUnpacker->GetInt();
+	}
+
+	const char *pData = (const char *)pUnpacker->GetRaw(PartSize);
+	if(pUnpacker->Error() || NumParts < 1 || NumParts > 32 || Part < 0 || Part >= NumParts ||
+		(Part+1)*MAX_SNAPSHOT_PACKSIZE > CSnapshot::MAX_SIZE || GameTick < m_CurrentRecvTick)
+		return;
+
+	if(GameTick != m_CurrentRecvTick)
+	{
+		m_SnapshotParts = 0;
+		m_CurrentRecvTick = GameTick;
+	}
+
+	mem_copy(m_aSnapshotIncomingData + Part*MAX_SNAPSHOT_PACKSIZE, pData, PartSize);
+	m_SnapshotParts |= 1<<Part;
+	if(m_SnapshotParts != (unsigned)((1<<NumParts)-1))
+		return;
+	m_SnapshotParts = 0;
+
+	// find the snapshot the delta is against
+	static CSnapshot s_EmptySnap;
+	CSnapshot *pDeltaShot = &s_EmptySnap;
+	s_EmptySnap.Clear();
+	if(DeltaTick >= 0 && m_SnapshotStorage.Get(DeltaTick, 0, &pDeltaShot, 0) < 0)
+	{
+		// the server has to start over
+		m_SnapErrors++;
+		m_AckGameTick = -1;
+		return;
+	}
+
+	// decompress and unpack
+	unsigned char aDeltaData[CSnapshot::MAX_SIZE];
+	unsigned char aSnapData[CSnapshot::MAX_SIZE];
+	CSnapshot *pSnap = (CSnapshot *)aSnapData;
+	void *pDeltaData = m_SnapshotDelta.EmptyDelta();
+	int DeltaSize = sizeof(int)*3;
+	int CompleteSize = (NumParts-1)*MAX_SNAPSHOT_PACKSIZE + PartSize;
+	if(CompleteSize)
+	{
+		DeltaSize = CVariableInt::Decompress(m_aSnapshotIncomingData, CompleteSize, aDeltaData);
+		if(DeltaSize < 0)
+		{
+			m_SnapErrors++;
+			return;
+		}
+		pDeltaData = aDeltaData;
+	}
+
+	int SnapSize = m_SnapshotDelta.UnpackDelta(pDeltaShot, pSnap, pDeltaData, DeltaSize);
+	if(SnapSize < 0 || (Msg != NETMSG_SNAPEMPTY && pSnap->Crc() != Crc))
+	{
+		m_SnapErrors++;
+		m_AckGameTick = -1;
+		return;
+	}
+
+	int64 Now = time_get();
+	m_SnapshotStorage.PurgeUntil(DeltaTick);
+	m_SnapshotStorage.Add(GameTick, Now, SnapSize, pSnap, 0);
+	m_AckGameTick = GameTick;
+	m_AckTime = Now;
+
+	if(m_State == STATE_ENTERING)
+	{
+		m_State = STATE_INGAME;
+		m_EnterTime = Now;
+		m_NextInputTime = Now;
+	}
+
+	// count the snapshots and the gaps between them
+	m_NumSnaps++;
+	if(Msg == NETMSG_SNAPEMPTY)
+		m_NumEmptySnaps++;
+	if(m_FirstSnapTick < 0)
+		m_FirstSnapTick = GameTick;
+	else if(GameTick > m_LastSnapTick && (!m_SnapStep || GameTick-m_LastSnapTick < m_SnapStep))
+		m_SnapStep = GameTick-m_LastSnapTick;
+	m_LastSnapTick = GameTick;
+
+	// the inputs that made it into this snapshot
+	for(int i = 0; i < NUM_INPUT_TIMES; i++)
+	{
+		if(m_aInputTicks[i] < 0 || m_aInputTicks[i] > GameTick)
+			continue;
+		int Latency = (int)((Now-m_aInputTimes[i])*1000/time_freq());
+		m_aLatencies[clamp(Latency, 0, (int)MAX_LATENCY)]++;
+		m_NumLatencies++;
+		m_LatencySum += Latency;
+		m_aInputTicks[i] = -1;
+	}
+}
+
+void CLoadClient::NextInput()
+{
+	if(s_NumScriptInputs)
+	{
+		const CScriptInput *pScript = &s_aScript[m_ScriptPos];
+		m_ScriptPos = (m_ScriptPos+1)%s_NumScriptInputs;
+
+		// presses are counted on the server, keep counting them up
+		int Fire = m_Input.m_Fire;
+		if((Fire&1) != pScript->m_Input.m_Fire)
+			Fire++;
+		m_Input = pScript->m_Input;
+		m_Input.m_Fire = Fire;
+		m_InputTicksLeft = max(pScript->m_Ticks, 1);
+		return;
+	}
+
+	// run around, jump, hook and shoot somewhat like a player would
+	m_Input.m_Direction = NextRandom()%3-1;
+	m_Input.m_Jump = NextRandom()%4 == 0;
+	m_Input.m_Hook = NextRandom()%3 == 0;
+	if((m_Input.m_Fire&1) || NextRandom()%3 == 0)
+		m_Input.m_Fire++;
+	m_Input.m_TargetX = NextRandom()%400-200;
+	m_Input.m_TargetY = NextRandom()%400-200;
+	m_Input.m_WantedWeapon = 0;
+	m_InputTicksLeft = 3+NextRandom()%20;
+}
+
+void CLoadClient::SendInput()
+{
+	int64 Now = time_get();
+	int64 Freq = time_freq();
+
+	if(--m_InputTicksLeft <= 0)
+		NextInput();
+	m_Input.m_PlayerFlags = PLAYERFLAG_PLAYING;
+
+	// the server tick right now from the last snapshot on, plus some margin
+	int PredTick = m_LastSnapTick + (int)((Now-m_AckTime)*SERVER_TICK_SPEED/Freq) + m_PredMargin;
+	PredTick = max(PredTick, m_LastInputTick+1);
+	m_LastInputTick = PredTick;
+
+	CMsgPacker Msg(NETMSG_INPUT);
+	Msg.AddInt(m_AckGameTick);
+	Msg.AddInt(PredTick);
+	Msg.AddInt(sizeof(m_Input));
+	const int *pData = (const int *)&m_Input;
+	for(unsigned i = 0; i < sizeof(m_Input)/sizeof(int); i++)
+		Msg.AddInt(pData[i]);
+	SendMsg(&Msg, MSGFLAG_FLUSH, true);
+
+	m_aInputTicks[m_CurrentInput] = PredTick;
+	m_aInputTimes[m_CurrentInput] = Now;
+	m_CurrentInput = (m_CurrentInput+1)%NUM_INPUT_TIMES;
+
+	m_NextInputTime += Freq/SERVER_TICK_SPEED;
+	if(m_NextInputTime < Now)
+		m_NextInputTime = Now;
+}
+
+int CLoadClient::LatencyPercentile(int Percent) const
+{
+	int Wanted = (m_NumLatencies*Percent+99)/100;
+	int Seen = 0;
+	for(int i = 0; i <= MAX_LATENCY; i++)
+	{
+		Seen += m_aLatencies[i];
+		if(Seen >= Wanted && Seen > 0)
+			return i;
+	}
+	return 0;
+}
+
+static bool LoadScript(const char *pFilename)
+{
+	IOHANDLE File = io_open(pFilename, IOFLAG_READ);
+	if(!File)
+		return false;
+
+	CLineReader LineReader;
+	LineReader.Init(File);
+	char *pLine;
+	while((pLine = LineReader.Get()) && s_NumScriptInputs < MAX_SCRIPT_INPUTS)
+	{
+		int aValues[8] = {0};
+		int NumValues = 0;
+		char *p = str_skip_whitespaces(pLine);
+		if(!*p || *p == '#')
+			continue;
+		while(*p && NumValues < 8)
+		{
+			aValues[NumValues++] = str_toint(p);
+			p = str_skip_whitespaces(str_skip_to_whitespace(p));
+		}
+
+		CScriptInput *pInput = &s_aScript[s_NumScriptInputs++];
+		mem_zero(pInput, sizeof(*pInput));
+		pInput->m_Ticks = aValues[0];
+		pInput->m_Input.m_Direction = clamp(aValues[1], -1, 1);
+		pInput->m_Input.m_Jump = aValues[2] != 0;
+		pInput->m_Input.m_Fire = aValues[3] != 0;
+		pInput->m_Input.m_Hook = aValues[4] != 0;
+		pInput->m_Input.m_WantedWeapon = aValues[5];
+		pInput->m_Input.m_TargetX = aValues[6];
+		pInput->m_Input.m_TargetY = aValues[7];
+	}
+	io_close(File);
+	return s_NumScriptInputs > 0;
+}
+
+static void PrintStatus(CLoadClient **ppClients, int NumClients, int64 Interval)
+{
+	int Ingame = 0;
+	int64 RecvBytes = 0;
+	int Snaps = 0;
+	static int64 s_LastRecvBytes = 0;
+	static int s_LastSnaps = 0;
+	for(int i = 0; i < NumClients; i++)
+	{
+		if(ppClients[i]->m_State == CLoadClient::STATE_INGAME)
+			Ingame++;
+		RecvBytes += ppClients[i]->m_RecvBytes;
+		Snaps += ppClients[i]->m_NumSnaps;
+	}
+
+	float Seconds = Interval/(float)time_freq();
+	dbg_msg("load_client", "%d/%d ingame, %.0f snaps/s, %.1f KB/s in", Ingame, NumClients,
+		(Snaps-s_LastSnaps)/Seconds, (RecvBytes-s_LastRecvBytes)/1024.0f/Seconds);
+	s_LastRecvBytes = RecvBytes;
+	s_LastSnaps = Snaps;
+}
+
+static void PrintReport(CLoadClient **ppClients, int NumClients, int64 End)
+{
+	int64 Freq = time_freq();
+	int TotalSnaps = 0, TotalMissed = 0, TotalErrors = 0;
+	int64 TotalRecv = 0, TotalSent = 0;
+
+	dbg_msg("load_client", "client  enter(ms)  snaps  missed  errors  lat avg/p50/p99/max(ms)    in KB/s  out KB/s  error");
+	for(int i = 0; i < NumClients; i++)
+	{
+		const CLoadClient *pClient = ppClients[i];
+		float Seconds = pClient->m_EnterTime ? (End-pClient->m_EnterTime)/(float)Freq : 0.0f;
+
+		int Missed = 0;
+		if(pClient->m_SnapStep > 0)
+			Missed = max((pClient->m_LastSnapTick-pClient->m_FirstSnapTick)/pClient->m_SnapStep+1-pClient->m_NumSnaps, 0);
+
+		int MaxLatency = 0;
+		for(int l = MAX_LATENCY; l >= 0; l--)
+		{
+			if(pClient->m_aLatencies[l])
+			{
+				MaxLatency = l;
+				break;
+			}
+		}
+
+		dbg_msg("load_client", "%6d  %9.1f  %5d  %6d  %6d  %5.1f/%3d/%3d/%4d     %8.1f  %8.1f  %s", pClient->m_ID,
+			pClient->m_EnterTime ? (pClient->m_EnterTime-pClient->m_ConnectTime)*1000.0f/Freq : -1.0f,
+			pClient->m_NumSnaps, Missed, pClient->m_SnapErrors,
+			pClient->m_NumLatencies ? pClient->m_LatencySum/(float)pClient->m_NumLatencies : 0.0f,
+			pClient->LatencyPercentile(50), pClient->LatencyPercentile(99), MaxLatency,
+			Seconds > 0 ? pClient->m_RecvBytes/1024.0f/Seconds : 0.0f, Seconds > 0 ? pClient->m_SentBytes/1024.0f/Seconds : 0.0f,
+			pClient->m_aError);
+
+		TotalSnaps += pClient->m_NumSnaps;
+		TotalMissed += Missed;
+		TotalErrors += pClient->m_SnapErrors;
+		TotalRecv += pClient->m_RecvBytes;
+		TotalSent += pClient->m_SentBytes;
+	}
+
+	dbg_msg("load_client", "total: %d snaps, %d missed (%.2f%%), %d errors, %.1f KB in, %.1f KB out", TotalSnaps, TotalMissed,
+		TotalSnaps+TotalMissed ? TotalMissed*100.0f/(TotalSnaps+TotalMissed) : 0.0f, TotalErrors, TotalRecv/1024.0f, TotalSent/1024.0f);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	dbg_logger_stdout();
+
+	int NumClients = 16;
+	int Duration = 60;
+	int Ramp = 100;
+	unsigned Seed = 1337;
+	const char *pAddress = "localhost:8303";
+	const char *pScript = 0;
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-n") == 0 && i+1 < argc) // ignore_convention
+			NumClients = clamp(str_toint(argv[++i]), 1, (int)MAX_LOAD_CLIENTS); // ignore_convention
+		else if(str_comp(argv[i], "-t") == 0 && i+1 < argc) // ignore_convention
+			Duration = max(str_toint(argv[++i]), 1); // ignore_convention
+		else if(str_comp(argv[i], "-ramp") == 0 && i+1 < argc) // ignore_convention
+			Ramp = max(str_toint(argv[++i]), 0); // ignore_convention
+		else if(str_comp(argv[i], "-script") == 0 && i+1 < argc) // ignore_convention
+			pScript = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-seed") == 0 && i+1 < argc) // ignore_convention
+			Seed = str_toint(argv[++i]); // ignore_convention
+		else if(str_comp(argv[i], "-password") == 0 && i+1 < argc) // ignore_convention
+			s_pPassword = argv[++i]; // ignore_convention
+		else
+			pAddress = argv[i]; // ignore_convention
+	}
+
+	if(pScript && !LoadScript(pScript))
+	{
+		dbg_msg("load_client", "couldn't load the input script '%s'", pScript);
+		return -1;
+	}
+
+	NETADDR Addr;
+	if(net_host_lookup(pAddress, &Addr, NETTYPE_ALL) != 0)
+	{
+		dbg_msg("load_client", "couldn't resolve '%s'", pAddress);
+		return -1;
+	}
+	if(!Addr.port)
+		Addr.port = 8303;
+
+	net_init();
+	CNetBase::Init();
+
+	CLoadClient *apClients[MAX_LOAD_CLIENTS];
+	NETSOCKET aSockets[MAX_LOAD_CLIENTS];
+	for(int i = 0; i < NumClients; i++)
+		apClients[i] = new CLoadClient(i, Seed+i);
+
+	dbg_msg("load_client", "connecting %d clients to %s, running for %d seconds", NumClients, pAddress, Duration);
+
+	int64 Freq = time_freq();
+	int64 Start = time_get();
+	int64 End = Start+Duration*Freq;
+	int64 NextReport = Start+REPORT_INTERVAL*Freq;
+	int NumConnected = 0;
+
+	while(time_get() < End)
+	{
+		int64 Now = time_get();
+
+		// connect them one after the other
+		while(NumConnected < NumClients && Now >= Start+NumConnected*Ramp*Freq/1000)
+			apClients[NumConnected++]->Connect(&Addr);
+
+		int NumSockets = 0;
+		for(int i = 0; i < NumConnected; i++)
+		{
+			apClients[i]->Update();
+			if(apClients[i]->m_State != CLoadClient::STATE_OFFLINE)
+				aSockets[NumSockets++] = apClients[i]->m_NetClient.Socket();
+		}
+
+		if(Now >= NextReport)
+		{
+			PrintStatus(apClients, NumConnected, REPORT_INTERVAL*Freq);
+			NextReport += REPORT_INTERVAL*Freq;
+		}
+
+		// the inputs go out every tick, wake up a few times per tick
+		if(NumSockets)
+			net_socket_read_wait_multi(aSockets, NumSockets, 2000);
+		else
+			thread_sleep(2);
+	}
+
+	for(int i = 0; i < NumConnected; i++)
+	{
+		if(apClients[i]->m_State != CLoadClient::STATE_OFFLINE)
+			apClients[i]->m_NetClient.Disconnect("load test done");
+	}
+
+	PrintReport(apClients, NumClients, time_get());
+
+	for(int i = 0; i < NumClients; i++)
+		delete apClients[i];
+	return 0;
+}
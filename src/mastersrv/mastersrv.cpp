@@ -1,6 +1,8 @@
 /* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
 /* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
 #include <base/system.h>
+#include <base/tl/array.h>
 
 #include <engine/config.h>
 #include <engine/console.h>
@@ -17,58 +19,234 @@
 enum {
 	MTU = 1400,
 	MAX_SERVERS_PER_PACKET=75,
-	MAX_PACKETS=16,
-	MAX_SERVERS=MAX_SERVERS_PER_PACKET*MAX_PACKETS,
-	EXPIRE_TIME = 90
+	EXPIRE_TIME = 90,
+	CHECK_TRIES = 10,
+	HASH_SIZE = 1<<12,
+	WHEEL_SIZE = 128, // in seconds, has to be larger than EXPIRE_TIME
+	NUM_SERVERTYPES = SERVERTYPE_LEGACY+1
 };
 
+/*
+	Class: CAddrHash
+		Maps addresses to integer values using chained buckets.
+*/
+class CAddrHash
+{
+	struct CNode
+	{
+		NETADDR m_Addr;
+		int m_Value;
+		int m_Next;
+	};
+
+	array<CNode> m_aNodes;
+	int m_FirstFree;
+	int m_aBuckets[HASH_SIZE];
+
+	static unsigned Hash(const NETADDR *pAddr)
+	{
+		// FNV-1a over the parts net_addr_comp looks at
+		unsigned Hash = 2166136261u;
+		const unsigned char *pData = (const unsigned char *)pAddr;
+		for(unsigned i = 0; i < sizeof(NETADDR); i++)
+			Hash = (Hash^pData[i])*16777619u;
+		return Hash&(HASH_SIZE-1);
+	}
+
+public:
+	CAddrHash()
+	{
+		m_FirstFree = -1;
+		for(int i = 0; i < HASH_SIZE; i++)
+			m_aBuckets[i] = -1;
+	}
+
+	void Insert(const NETADDR *pAddr, int Value)
+	{
+		int Node = m_FirstFree;
+		if(Node != -1)
+			m_FirstFree = m_aNodes[Node].m_Next;
+		else
+			Node = m_aNodes.add(CNode());
+
+		unsigned Bucket = Hash(pAddr);
+		m_aNodes[Node].m_Addr = *pAddr;
+		m_aNodes[Node].m_Value = Value;
+		m_aNodes[Node].m_Next = m_aBuckets[Bucket];
+		m_aBuckets[Bucket] = Node;
+	}
+
+	void Remove(const NETADDR *pAddr, int Value)
+	{
+		for(int *pLink = &m_aBuckets[Hash(pAddr)]; *pLink != -1; pLink = &m_aNodes[*pLink].m_Next)
+		{
+			int Node = *pLink;
+			if(m_aNodes[Node].m_Value == Value && net_addr_comp(&m_aNodes[Node].m_Addr, pAddr) == 0)
+			{
+				*pLink = m_aNodes[Node].m_Next;
+				m_aNodes[Node].m_Next = m_FirstFree;
+				m_FirstFree = Node;
+				return;
+			}
+		}
+	}
+
+	// returns -1 if the address isn't in the table
+	int Find(const NETADDR *pAddr) const
+	{
+		for(int Node = m_aBuckets[Hash(pAddr)]; Node != -1; Node = m_aNodes[Node].m_Next)
+			if(net_addr_comp(&m_aNodes[Node].m_Addr, pAddr) == 0)
+				return m_aNodes[Node].m_Value;
+		return -1;
+	}
+};
+
+/*
+	Class: CTimerWheel
+		Timers with a resolution of one second. Adding, removing and
+		popping a due timer don't depend on the number of timers.
+*/
+class CTimerWheel
+{
+	struct CTimer
+	{
+		int64 m_Time;
+		int m_Data;
+		int m_Prev;
+		int m_Next;
+	};
+
+	array<CTimer> m_aTimers;
+	int m_FirstFree;
+	int m_aSlots[WHEEL_SIZE];
+	int64 m_Current; // second of the slot that gets processed next
+
+	static int64 Second(int64 Time) { return Time/time_freq(); }
+
+public:
+	CTimerWheel()
+	{
+		m_FirstFree = -1;
+		m_Current = Second(time_get());
+		for(int i = 0; i < WHEEL_SIZE; i++)
+			m_aSlots[i] = -1;
+	}
+
+	int Add(int64 Time, int Data)
+	{
+		int Timer = m_FirstFree;
+		if(Timer != -1)
+			m_FirstFree = m_aTimers[Timer].m_Next;
+		else
+			Timer = m_aTimers.add(CTimer());
+
+		// timers that are already due go into the slot processed next
+		int Slot = (int)(max(Second(Time), m_Current)%WHEEL_SIZE);
+		m_aTimers[Timer].m_Time = Time;
+		m_aTimers[Timer].m_Data = Data;
+		m_aTimers[Timer].m_Prev = -1 - Slot;
+		m_aTimers[Timer].m_Next = m_aSlots[Slot];
+		if(m_aSlots[Slot] != -1)
+			m_aTimers[m_aSlots[Slot]].m_Prev = Timer;
+		m_aSlots[Slot] = Timer;
+		return Timer;
+	}
+
+	void Remove(int Timer)
+	{
+		// a negative previous link encodes the slot of the first timer
+		CTimer *pTimer = &m_aTimers[Timer];
+		if(pTimer->m_Prev < 0)
+			m_aSlots[-1 - pTimer->m_Prev] = pTimer->m_Next;
+		else
+			m_aTimers[pTimer->m_Prev].m_Next = pTimer->m_Next;
+		if(pTimer->m_Next != -1)
+			m_aTimers[pTimer->m_Next].m_Prev = pTimer->m_Prev;
+
+		pTimer->m_Next = m_FirstFree;
+		m_FirstFree = Timer;
+	}
+
+	// removes one due timer and returns its data, -1 if none is due
+	int PopDue(int64 Now)
+	{
+		int64 NowSecond = Second(Now);
+		while(m_Current <= NowSecond)
+		{
+			for(int Timer = m_aSlots[m_Current%WHEEL_SIZE]; Timer != -1; Timer = m_aTimers[Timer].m_Next)
+			{
+				// later laps of the wheel stay in the slot
+				if(m_aTimers[Timer].m_Time <= Now)
+				{
+					int Data = m_aTimers[Timer].m_Data;
+					Remove(Timer);
+					return Data;
+				}
+			}
+
+			if(m_Current == NowSecond)
+				break;
+			m_Current++;
+		}
+		return -1;
+	}
+};
+
+enum
+{
+	TIMER_EXPIRE=0,
+	TIMER_CHECK,
+	NUM_TIMERTYPES
+};
+
+static CTimerWheel m_Timers;
+
 struct CCheckServer
 {
-	enum ServerType m_Type;
+	enum ServerType m_Type; // SERVERTYPE_INVALID for unused entries
 	NETADDR m_Address;
 	NETADDR m_AltAddress;
 	int m_TryCount;
-	int64 m_TryTime;
+	int m_Timer;
 };
 
-static CCheckServer m_aCheckServers[MAX_SERVERS];
+static array<CCheckServer> m_aCheckServers;
+static array<int> m_aFreeCheckServers;
+static CAddrHash m_CheckServerHash;
+static CAddrHash m_CheckServerAltHash;
 static int m_NumCheckServers = 0;
 
 struct CServerEntry
 {
-	enum ServerType m_Type;
+	enum ServerType m_Type; // SERVERTYPE_INVALID for unused entries
 	NETADDR m_Address;
-	int64 m_Expire;
+	int m_Timer;
+	int m_Slot; // index into the list of its type
 };
 
-static CServerEntry m_aServers[MAX_SERVERS];
+static array<CServerEntry> m_aServers;
+static array<int> m_aFreeServers;
+static CAddrHash m_ServerHash;
 static int m_NumServers = 0;
 
 struct CPacketData
 {
+	bool m_Dirty;
 	int m_Size;
-	struct {
-		unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST)];
-		CMastersrvAddr m_aServers[MAX_SERVERS_PER_PACKET];
-	} m_Data;
+	unsigned char m_aData[MTU];
 };
 
-CPacketData m_aPackets[MAX_PACKETS];
-static int m_NumPackets = 0;
-
-// legacy code
-struct CPacketDataLegacy
+// servers of one type in the order they appear in the list packets,
+// each packet holds a slice of MAX_SERVERS_PER_PACKET slots
+struct CServerList
 {
-	int m_Size;
-	struct {
-		unsigned char m_aHeader[sizeof(SERVERBROWSE_LIST_LEGACY)];
-		CMastersrvAddrLegacy m_aServers[MAX_SERVERS_PER_PACKET];
-	} m_Data;
+	array<int> m_aSlots;
+	array<CPacketData> m_aPackets;
+	int m_NumPackets;
+	bool m_Dirty;
 };
 
-CPacketDataLegacy m_aPacketsLegacy[MAX_PACKETS];
-static int m_NumPacketsLegacy = 0;
-
+static CServerList m_aServerLists[NUM_SERVERTYPES];
 
 struct CCountPacketData
 {
@@ -88,83 +266,89 @@ static CNetClient m_NetOp; // main
 
 IConsole *m_pConsole;
 
-void BuildPackets()
+void MarkSlot(CServerList *pList, int Slot)
 {
-	CServerEntry *pCurrent = &m_aServers[0];
-	int ServersLeft = m_NumServers;
-	m_NumPackets = 0;
-	m_NumPacketsLegacy = 0;
-	int PacketIndex = 0;
-	int PacketIndexLegacy = 0;
-	while(ServersLeft-- && (m_NumPackets + m_NumPacketsLegacy) < MAX_PACKETS)
+	int Packet = Slot/MAX_SERVERS_PER_PACKET;
+	while(pList->m_aPackets.size() <= Packet)
 	{
-		if(pCurrent->m_Type == SERVERTYPE_NORMAL)
-		{
-			if(PacketIndex % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndex = 0;
-				m_NumPackets++;
-			}
-
-			// copy header
-			mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aHeader, SERVERBROWSE_LIST, sizeof(SERVERBROWSE_LIST));
-
-			// copy server addresses
-			if(pCurrent->m_Address.type == NETTYPE_IPV6)
-			{
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, pCurrent->m_Address.ip,
-					sizeof(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp));
-			}
-			else
-			{
-				static char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
-
-				mem_copy(m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[12] = pCurrent->m_Address.ip[0];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[13] = pCurrent->m_Address.ip[1];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[14] = pCurrent->m_Address.ip[2];
-				m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aIp[15] = pCurrent->m_Address.ip[3];
-			}
-
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[0] = (pCurrent->m_Address.port>>8)&0xff;
-			m_aPackets[m_NumPackets-1].m_Data.m_aServers[PacketIndex].m_aPort[1] = pCurrent->m_Address.port&0xff;
-
-			PacketIndex++;
+		CPacketData Data;
+		Data.m_Dirty = false;
+		Data.m_Size = 0;
+		pList->m_aPackets.add(Data);
+	}
+	pList->m_aPackets[Packet].m_Dirty = true;
+	pList->m_Dirty = true;
+}
 
-			m_aPackets[m_NumPackets-1].m_Size = sizeof(SERVERBROWSE_LIST) + sizeof(CMastersrvAddr)*PacketIndex;
+void WriteServer(ServerType Type, unsigned char *pData, const NETADDR *pAddr)
+{
+	if(Type == SERVERTYPE_NORMAL)
+	{
+		CMastersrvAddr *pServer = (CMastersrvAddr *)pData;
 
-			pCurrent++;
+		// copy server addresses
+		if(pAddr->type == NETTYPE_IPV6)
+		{
+			mem_copy(pServer->m_aIp, pAddr->ip, sizeof(pServer->m_aIp));
 		}
-		else if(pCurrent->m_Type == SERVERTYPE_LEGACY)
+		else
 		{
-			if(PacketIndexLegacy % MAX_SERVERS_PER_PACKET == 0)
-			{
-				PacketIndexLegacy = 0;
-				m_NumPacketsLegacy++;
-			}
+			static unsigned char IPV4Mapping[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF };
 
-			// copy header
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aHeader, SERVERBROWSE_LIST_LEGACY, sizeof(SERVERBROWSE_LIST_LEGACY));
+			mem_copy(pServer->m_aIp, IPV4Mapping, sizeof(IPV4Mapping));
+			pServer->m_aIp[12] = pAddr->ip[0];
+			pServer->m_aIp[13] = pAddr->ip[1];
+			pServer->m_aIp[14] = pAddr->ip[2];
+			pServer->m_aIp[15] = pAddr->ip[3];
+		}
+
+		pServer->m_aPort[0] = (pAddr->port>>8)&0xff;
+		pServer->m_aPort[1] = pAddr->port&0xff;
+	}
+	else
+	{
+		CMastersrvAddrLegacy *pServer = (CMastersrvAddrLegacy *)pData;
 
-			// copy server addresses
-			mem_copy(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp, pCurrent->m_Address.ip,
-				sizeof(m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aIp));
-			// 0.5 has the port in little endian on the network
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[0] = pCurrent->m_Address.port&0xff;
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Data.m_aServers[PacketIndexLegacy].m_aPort[1] = (pCurrent->m_Address.port>>8)&0xff;
+		// copy server addresses
+		mem_copy(pServer->m_aIp, pAddr->ip, sizeof(pServer->m_aIp));
+		// 0.5 has the port in little endian on the network
+		pServer->m_aPort[0] = pAddr->port&0xff;
+		pServer->m_aPort[1] = (pAddr->port>>8)&0xff;
+	}
+}
 
-			PacketIndexLegacy++;
+void BuildPackets()
+{
+	// only the slices that changed get rebuilt
+	for(int t = 0; t < NUM_SERVERTYPES; t++)
+	{
+		CServerList *pList = &m_aServerLists[t];
+		if(!pList->m_Dirty)
+			continue;
 
-			m_aPacketsLegacy[m_NumPacketsLegacy-1].m_Size = sizeof(SERVERBROWSE_LIST_LEGACY) + sizeof(CMastersrvAddrLegacy)*PacketIndexLegacy;
+		const unsigned char *pHeader = t == SERVERTYPE_NORMAL ? SERVERBROWSE_LIST : SERVERBROWSE_LIST_LEGACY;
+		int HeaderSize = t == SERVERTYPE_NORMAL ? sizeof(SERVERBROWSE_LIST) : sizeof(SERVERBROWSE_LIST_LEGACY);
+		int AddrSize = t == SERVERTYPE_NORMAL ? sizeof(CMastersrvAddr) : sizeof(CMastersrvAddrLegacy);
+		int NumSlots = pList->m_aSlots.size();
 
-			pCurrent++;
-		}
-		else
+		pList->m_NumPackets = (NumSlots+MAX_SERVERS_PER_PACKET-1)/MAX_SERVERS_PER_PACKET;
+		for(int p = 0; p < pList->m_NumPackets; p++)
 		{
-			*pCurrent = m_aServers[m_NumServers-1];
-			m_NumServers--;
-			dbg_msg("mastersrv", "error: server of invalid type, dropping it");
+			CPacketData *pPacket = &pList->m_aPackets[p];
+			if(!pPacket->m_Dirty)
+				continue;
+
+			int First = p*MAX_SERVERS_PER_PACKET;
+			int Num = min(NumSlots-First, (int)MAX_SERVERS_PER_PACKET);
+
+			// copy header
+			mem_copy(pPacket->m_aData, pHeader, HeaderSize);
+			for(int i = 0; i < Num; i++)
+				WriteServer((ServerType)t, pPacket->m_aData+HeaderSize+AddrSize*i, &m_aServers[pList->m_aSlots[First+i]].m_Address);
+			pPacket->m_Size = HeaderSize+AddrSize*Num;
+			pPacket->m_Dirty = false;
 		}
+		pList->m_Dirty = false;
 	}
 }
 
@@ -206,10 +390,18 @@ void SendCheck(NETADDR *pAddr)
 
 void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type)
 {
-	// add server
-	if(m_NumCheckServers == MAX_SERVERS)
+	// a repeated heartbeat keeps the check that is already running
+	int Index = m_CheckServerHash.Find(pInfo);
+	if(Index != -1)
 	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
+		CCheckServer *pCheck = &m_aCheckServers[Index];
+		if(net_addr_comp(&pCheck->m_AltAddress, pAlt) != 0)
+		{
+			m_CheckServerAltHash.Remove(&pCheck->m_AltAddress, Index);
+			pCheck->m_AltAddress = *pAlt;
+			m_CheckServerAltHash.Insert(pAlt, Index);
+		}
+		pCheck->m_Type = Type;
 		return;
 	}
 
@@ -218,97 +410,153 @@ void AddCheckserver(NETADDR *pInfo, NETADDR *pAlt, ServerType Type)
 	char aAltAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pAlt, aAltAddrStr, sizeof(aAltAddrStr), true);
 	dbg_msg("mastersrv", "checking: %s (%s)", aAddrStr, aAltAddrStr);
-	m_aCheckServers[m_NumCheckServers].m_Address = *pInfo;
-	m_aCheckServers[m_NumCheckServers].m_AltAddress = *pAlt;
-	m_aCheckServers[m_NumCheckServers].m_TryCount = 0;
-	m_aCheckServers[m_NumCheckServers].m_TryTime = 0;
-	m_aCheckServers[m_NumCheckServers].m_Type = Type;
+
+	// add server
+	if(m_aFreeCheckServers.size())
+	{
+		Index = m_aFreeCheckServers[m_aFreeCheckServers.size()-1];
+		m_aFreeCheckServers.remove_index_fast(m_aFreeCheckServers.size()-1);
+	}
+	else
+		Index = m_aCheckServers.add(CCheckServer());
+
+	CCheckServer *pCheck = &m_aCheckServers[Index];
+	pCheck->m_Address = *pInfo;
+	pCheck->m_AltAddress = *pAlt;
+	pCheck->m_TryCount = 0;
+	pCheck->m_Type = Type;
+	pCheck->m_Timer = m_Timers.Add(time_get(), Index*NUM_TIMERTYPES+TIMER_CHECK);
+	m_CheckServerHash.Insert(pInfo, Index);
+	m_CheckServerAltHash.Insert(pAlt, Index);
 	m_NumCheckServers++;
 }
 
+void RemoveCheckserver(int Index, bool StopTimer)
+{
+	CCheckServer *pCheck = &m_aCheckServers[Index];
+	if(StopTimer)
+		m_Timers.Remove(pCheck->m_Timer);
+	m_CheckServerHash.Remove(&pCheck->m_Address, Index);
+	m_CheckServerAltHash.Remove(&pCheck->m_AltAddress, Index);
+	pCheck->m_Type = SERVERTYPE_INVALID;
+	m_aFreeCheckServers.add(Index);
+	m_NumCheckServers--;
+}
+
 void AddServer(NETADDR *pInfo, ServerType Type)
 {
-	// see if server already exists in list
-	for(int i = 0; i < m_NumServers; i++)
+	if(Type != SERVERTYPE_NORMAL && Type != SERVERTYPE_LEGACY)
 	{
-		if(net_addr_comp(&m_aServers[i].m_Address, pInfo) == 0)
-		{
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "updated: %s", aAddrStr);
-			m_aServers[i].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-			return;
-		}
+		dbg_msg("mastersrv", "error: server of invalid type, dropping it");
+		return;
 	}
 
-	// add server
-	if(m_NumServers == MAX_SERVERS)
+	int64 Expire = time_get()+time_freq()*EXPIRE_TIME;
+
+	// see if server already exists in list
+	int Index = m_ServerHash.Find(pInfo);
+	if(Index != -1)
 	{
-		dbg_msg("mastersrv", "error: mastersrv is full");
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
+		dbg_msg("mastersrv", "updated: %s", aAddrStr);
+		m_Timers.Remove(m_aServers[Index].m_Timer);
+		m_aServers[Index].m_Timer = m_Timers.Add(Expire, Index*NUM_TIMERTYPES+TIMER_EXPIRE);
 		return;
 	}
 
 	char aAddrStr[NETADDR_MAXSTRSIZE];
 	net_addr_str(pInfo, aAddrStr, sizeof(aAddrStr), true);
 	dbg_msg("mastersrv", "added: %s", aAddrStr);
-	m_aServers[m_NumServers].m_Address = *pInfo;
-	m_aServers[m_NumServers].m_Expire = time_get()+time_freq()*EXPIRE_TIME;
-	m_aServers[m_NumServers].m_Type = Type;
+
+	// add server
+	if(m_aFreeServers.size())
+	{
+		Index = m_aFreeServers[m_aFreeServers.size()-1];
+		m_aFreeServers.remove_index_fast(m_aFreeServers.size()-1);
+	}
+	else
+		Index = m_aServers.add(CServerEntry());
+
+	CServerList *pList = &m_aServerLists[Type];
+	CServerEntry *pServer = &m_aServers[Index];
+	pServer->m_Address = *pInfo;
+	pServer->m_Type = Type;
+	pServer->m_Timer = m_Timers.Add(Expire, Index*NUM_TIMERTYPES+TIMER_EXPIRE);
+	pServer->m_Slot = pList->m_aSlots.add(Index);
+	MarkSlot(pList, pServer->m_Slot);
+	m_ServerHash.Insert(pInfo, Index);
 	m_NumServers++;
 }
 
-void UpdateServers()
+void RemoveServer(int Index)
 {
-	int64 Now = time_get();
-	int64 Freq = time_freq();
-	for(int i = 0; i < m_NumCheckServers; i++)
+	CServerEntry *pServer = &m_aServers[Index];
+	CServerList *pList = &m_aServerLists[pServer->m_Type];
+
+	// move the last server of the list into the free slot
+	int Last = pList->m_aSlots.size()-1;
+	if(pServer->m_Slot != Last)
 	{
-		if(Now > m_aCheckServers[i].m_TryTime+Freq)
-		{
-			if(m_aCheckServers[i].m_TryCount == 10)
-			{
-				char aAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-				char aAltAddrStr[NETADDR_MAXSTRSIZE];
-				net_addr_str(&m_aCheckServers[i].m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
-				dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
-
-				// FAIL!!
-				SendError(&m_aCheckServers[i].m_Address);
-				m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers-1];
-				m_NumCheckServers--;
-				i--;
-			}
-			else
-			{
-				m_aCheckServers[i].m_TryCount++;
-				m_aCheckServers[i].m_TryTime = Now;
-				if(m_aCheckServers[i].m_TryCount&1)
-					SendCheck(&m_aCheckServers[i].m_Address);
-				else
-					SendCheck(&m_aCheckServers[i].m_AltAddress);
-			}
-		}
+		int Moved = pList->m_aSlots[Last];
+		pList->m_aSlots[pServer->m_Slot] = Moved;
+		m_aServers[Moved].m_Slot = pServer->m_Slot;
+		MarkSlot(pList, pServer->m_Slot);
+	}
+	pList->m_aSlots.remove_index_fast(Last);
+	MarkSlot(pList, Last);
+
+	m_ServerHash.Remove(&pServer->m_Address, Index);
+	pServer->m_Type = SERVERTYPE_INVALID;
+	m_aFreeServers.add(Index);
+	m_NumServers--;
+}
+
+void UpdateCheckserver(int Index, int64 Now)
+{
+	CCheckServer *pCheck = &m_aCheckServers[Index];
+	if(pCheck->m_TryCount == CHECK_TRIES)
+	{
+		char aAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&pCheck->m_Address, aAddrStr, sizeof(aAddrStr), true);
+		char aAltAddrStr[NETADDR_MAXSTRSIZE];
+		net_addr_str(&pCheck->m_AltAddress, aAltAddrStr, sizeof(aAltAddrStr), true);
+		dbg_msg("mastersrv", "check failed: %s (%s)", aAddrStr, aAltAddrStr);
+
+		// FAIL!!
+		SendError(&pCheck->m_Address);
+		RemoveCheckserver(Index, false);
+	}
+	else
+	{
+		pCheck->m_TryCount++;
+		pCheck->m_Timer = m_Timers.Add(Now+time_freq(), Index*NUM_TIMERTYPES+TIMER_CHECK);
+		if(pCheck->m_TryCount&1)
+			SendCheck(&pCheck->m_Address);
+		else
+			SendCheck(&pCheck->m_AltAddress);
 	}
 }
 
-void PurgeServers()
+void ExpireServer(int Index)
+{
+	// remove server
+	char aAddrStr[NETADDR_MAXSTRSIZE];
+	net_addr_str(&m_aServers[Index].m_Address, aAddrStr, sizeof(aAddrStr), true);
+	dbg_msg("mastersrv", "expired: %s", aAddrStr);
+	RemoveServer(Index);
+}
+
+void UpdateTimers()
 {
 	int64 Now = time_get();
-	int i = 0;
-	while(i < m_NumServers)
+	int Data;
+	while((Data = m_Timers.PopDue(Now)) != -1)
 	{
-		if(m_aServers[i].m_Expire < Now)
-		{
-			// remove server
-			char aAddrStr[NETADDR_MAXSTRSIZE];
-			net_addr_str(&m_aServers[i].m_Address, aAddrStr, sizeof(aAddrStr), true);
-			dbg_msg("mastersrv", "expired: %s", aAddrStr);
-			m_aServers[i] = m_aServers[m_NumServers-1];
-			m_NumServers--;
-		}
+		if(Data%NUM_TIMERTYPES == TIMER_CHECK)
+			UpdateCheckserver(Data/NUM_TIMERTYPES, Now);
 		else
-			i++;
+			ExpireServer(Data/NUM_TIMERTYPES);
 	}
 }
 
@@ -320,8 +568,7 @@ void ReloadBans()
 
 int main(int argc, const char **argv) // ignore_convention
 {
-	int64 LastBuild = 0, LastBanReload = 0;
-	ServerType Type = SERVERTYPE_INVALID;
+	int64 LastBanReload = 0;
 	NETADDR BindAddr;
 
 	dbg_logger_stdout();
@@ -428,8 +675,8 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 				p.m_DataSize = sizeof(m_CountData);
 				p.m_pData = &m_CountData;
-				m_CountData.m_High = (m_NumServers>>8)&0xff;
-				m_CountData.m_Low = m_NumServers&0xff;
+				m_CountData.m_High = (min(m_NumServers, 0xffff)>>8)&0xff;
+				m_CountData.m_Low = min(m_NumServers, 0xffff)&0xff;
 				m_NetOp.Send(&p);
 			}
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETCOUNT_LEGACY) &&
@@ -443,8 +690,8 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 				p.m_DataSize = sizeof(m_CountData);
 				p.m_pData = &m_CountDataLegacy;
-				m_CountDataLegacy.m_High = (m_NumServers>>8)&0xff;
-				m_CountDataLegacy.m_Low = m_NumServers&0xff;
+				m_CountDataLegacy.m_High = (min(m_NumServers, 0xffff)>>8)&0xff;
+				m_CountDataLegacy.m_Low = min(m_NumServers, 0xffff)&0xff;
 				m_NetOp.Send(&p);
 			}
 			else if(Packet.m_DataSize == sizeof(SERVERBROWSE_GETLIST) &&
@@ -458,10 +705,12 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Address = Packet.m_Address;
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 
-				for(int i = 0; i < m_NumPackets; i++)
+				BuildPackets();
+				CServerList *pList = &m_aServerLists[SERVERTYPE_NORMAL];
+				for(int i = 0; i < pList->m_NumPackets; i++)
 				{
-					p.m_DataSize = m_aPackets[i].m_Size;
-					p.m_pData = &m_aPackets[i].m_Data;
+					p.m_DataSize = pList->m_aPackets[i].m_Size;
+					p.m_pData = pList->m_aPackets[i].m_aData;
 					m_NetOp.Send(&p);
 				}
 			}
@@ -476,10 +725,12 @@ int main(int argc, const char **argv) // ignore_convention
 				p.m_Address = Packet.m_Address;
 				p.m_Flags = NETSENDFLAG_CONNLESS;
 
-				for(int i = 0; i < m_NumPacketsLegacy; i++)
+				BuildPackets();
+				CServerList *pList = &m_aServerLists[SERVERTYPE_LEGACY];
+				for(int i = 0; i < pList->m_NumPackets; i++)
 				{
-					p.m_DataSize = m_aPacketsLegacy[i].m_Size;
-					p.m_pData = &m_aPacketsLegacy[i].m_Data;
+					p.m_DataSize = pList->m_aPackets[i].m_Size;
+					p.m_pData = pList->m_aPackets[i].m_aData;
 					m_NetOp.Send(&p);
 				}
 			}
@@ -495,24 +746,18 @@ int main(int argc, const char **argv) // ignore_convention
 			if(Packet.m_DataSize == sizeof(SERVERBROWSE_FWRESPONSE) &&
 				mem_comp(Packet.m_pData, SERVERBROWSE_FWRESPONSE, sizeof(SERVERBROWSE_FWRESPONSE)) == 0)
 			{
-				Type = SERVERTYPE_INVALID;
 				// remove it from checking
-				for(int i = 0; i < m_NumCheckServers; i++)
-				{
-					if(net_addr_comp(&m_aCheckServers[i].m_Address, &Packet.m_Address) == 0 ||
-						net_addr_comp(&m_aCheckServers[i].m_AltAddress, &Packet.m_Address) == 0)
-					{
-						Type = m_aCheckServers[i].m_Type;
-						m_NumCheckServers--;
-						m_aCheckServers[i] = m_aCheckServers[m_NumCheckServers];
-						break;
-					}
-				}
+				int Index = m_CheckServerHash.Find(&Packet.m_Address);
+				if(Index == -1)
+					Index = m_CheckServerAltHash.Find(&Packet.m_Address);
 
 				// drops servers that were not in the CheckServers list
-				if(Type == SERVERTYPE_INVALID)
+				if(Index == -1)
 					continue;
 
+				ServerType Type = m_aCheckServers[Index].m_Type;
+				RemoveCheckserver(Index, true);
+
 				AddServer(&Packet.m_Address, Type);
 				SendOk(&Packet.m_Address);
 			}
@@ -525,14 +770,8 @@ int main(int argc, const char **argv) // ignore_convention
 			ReloadBans();
 		}
 
-		if(time_get()-LastBuild > time_freq()*5)
-		{
-			LastBuild = time_get();
-
-			PurgeServers();
-			UpdateServers();
-			BuildPackets();
-		}
+		// expire servers and retry checks
+		UpdateTimers();
 
 		// be nice to the CPU
 		thread_sleep(1);
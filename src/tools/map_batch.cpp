@@ -0,0 +1,478 @@
+/* (c) Magnus Auvinen. See licence.txt in the root of the distribution for more information. */
+/* If you are missing that file, acquire a complete release at teeworlds.com.                */
+#include <base/math.h>
+#include <base/system.h>
+#include <base/tl/array.h>
+
+#include <engine/kernel.h>
+#include <engine/storage.h>
+#include <engine/shared/datafile.h>
+#include <engine/shared/jobs.h>
+#include <engine/shared/mapchecker.h>
+
+#include <game/mapitems.h>
+
+/*
+	Batch map tool.
+
+	Checks and crcs all maps of a directory on a pool of threads and
+	optionally resaves them. Writes a report with one json object per map
+	and can write the map version list that map_version makes.
+
+	Results are cached by modification time and size, maps that did not
+	change since the last run are taken from the cache and not opened.
+	With -resave every map has to be written, so the cache is only
+	updated then.
+
+	Usage: map_batch [-threads n] [-resave outdir] [-report file] [-cache file] [-versions file] [-v] [directory]
+*/
+
+enum
+{
+	ERROR_OPEN=1,
+	ERROR_VERSION=2,
+	ERROR_GAMELAYER=4,
+	ERROR_LAYERDATA=8,
+	ERROR_WHITELIST=16,
+	ERROR_RESAVE=32,
+	NUM_ERRORS=6,
+
+	MAX_NAME_LENGTH=128,
+};
+
+static const char *s_apErrorNames[NUM_ERRORS] = {"open", "version", "gamelayer", "layerdata", "whitelist", "resave"};
+
+class CBatchMap
+{
+public:
+	CJob m_Job;
+	char m_aName[MAX_NAME_LENGTH];
+	char m_aPath[512];
+	int m_StorageType;
+	int64 m_Modified;
+
+	bool m_Cached;
+	unsigned m_Crc;
+	unsigned m_Size;
+	int m_Version;
+	int m_Errors;
+
+	int64 m_ReadTime;
+	int64 m_CheckTime;
+	int64 m_ResaveTime;
+
+	CBatchMap()
+	{
+		m_aName[0] = 0;
+		m_aPath[0] = 0;
+		m_StorageType = 0;
+		m_Modified = -1;
+		m_Cached = false;
+		m_Crc = 0;
+		m_Size = 0;
+		m_Version = -1;
+		m_Errors = 0;
+		m_ReadTime = 0;
+		m_CheckTime = 0;
+		m_ResaveTime = 0;
+	}
+};
+
+static IStorage *s_pStorage = 0;
+static CMapChecker s_MapChecker;
+static const char *s_pDirectory = "maps";
+static const char *s_pResaveDirectory = 0;
+static array<CBatchMap *> s_lpMaps;
+
+// goes to stdout directly, dbg_msg is only used for the verbose output
+static void Print(const char *pLine)
+{
+	io_write(io_stdout(), pLine, str_length(pLine));
+	io_write_newline(io_stdout());
+}
+
+static int MaplistCallback(const char *pName, int IsDir, int StorageType, void *pUser)
+{
+	int l = str_length(pName);
+	if(l < 4 || IsDir || str_comp(pName+l-4, ".map") != 0 || l >= MAX_NAME_LENGTH)
+		return 0;
+
+	// the same map can be in several storage paths, the first one wins
+	for(int i = 0; i < s_lpMaps.size(); i++)
+		if(str_comp(s_lpMaps[i]->m_aName, pName) == 0)
+			return 0;
+
+	CBatchMap *pMap = new CBatchMap;
+	str_copy(pMap->m_aName, pName, sizeof(pMap->m_aName));
+	str_format(pMap->m_aPath, sizeof(pMap->m_aPath), "%s/%s", s_pDirectory, pName);
+	pMap->m_StorageType = StorageType;
+
+	char aCompletePath[512];
+	s_pStorage->GetCompletePath(StorageType, pMap->m_aPath, aCompletePath, sizeof(aCompletePath));
+	if(fs_file_time(aCompletePath, &pMap->m_Modified))
+		pMap->m_Modified = -1;
+	IOHANDLE File = io_open(aCompletePath, IOFLAG_READ);
+	if(File)
+	{
+		pMap->m_Size = (unsigned)io_length(File);
+		io_close(File);
+	}
+
+	s_lpMaps.add(pMap);
+	return 0;
+}
+
+static int CheckLayers(CDataFileReader *pDataFile)
+{
+	int Errors = 0;
+	int NumGameLayers = 0;
+	int Start, Num;
+	pDataFile->GetType(MAPITEMTYPE_LAYER, &Start, &Num);
+	for(int i = 0; i < Num; i++)
+	{
+		CMapItemLayer *pLayer = (CMapItemLayer *)pDataFile->GetItem(Start+i, 0, 0);
+		if(pLayer->m_Type != LAYERTYPE_TILES)
+			continue;
+
+		CMapItemLayerTilemap *pTilemap = (CMapItemLayerTilemap *)pLayer;
+		if(pTilemap->m_Flags&TILESLAYERFLAG_GAME)
+			NumGameLayers++;
+
+		// the tiles have to fill the layer
+		if(pTilemap->m_Data < 0 || pTilemap->m_Data >= pDataFile->NumData() || pTilemap->m_Width <= 0 || pTilemap->m_Height <= 0 ||
+			pDataFile->GetUncompressedDataSize(pTilemap->m_Data) != pTilemap->m_Width*pTilemap->m_Height*(int)sizeof(CTile))
+			Errors |= ERROR_LAYERDATA;
+	}
+
+	if(NumGameLayers != 1)
+		Errors |= ERROR_GAMELAYER;
+	return Errors;
+}
+
+static bool Resave(CDataFileReader *pDataFile, const char *pFilename)
+{
+	CDataFileWriter Writer;
+	if(!Writer.Open(s_pStorage, pFilename))
+		return false;
+
+	for(int i = 0; i < pDataFile->NumItems(); i++)
+	{
+		int Type, ID;
+		void *pItem = pDataFile->GetItem(i, &Type, &ID);
+		Writer.AddItem(Type, ID, pDataFile->GetItemSize(i), pItem);
+	}
+
+	for(int i = 0; i < pDataFile->NumData(); i++)
+	{
+		Writer.AddData(pDataFile->GetUncompressedDataSize(i), pDataFile->GetData(i));
+		pDataFile->UnloadData(i);
+	}
+
+	return Writer.Finish() == 0;
+}
+
+static int ProcessMap(void *pUser)
+{
+	CBatchMap *pMap = static_cast<CBatchMap *>(pUser);
+
+	int64 Start = time_get();
+	CDataFileReader DataFile;
+	if(!DataFile.Open(s_pStorage, pMap->m_aPath, pMap->m_StorageType))
+	{
+		pMap->m_Errors |= ERROR_OPEN;
+		pMap->m_ReadTime = time_get()-Start;
+		return 0;
+	}
+	pMap->m_Crc = DataFile.Crc();
+
+	int64 Read = time_get();
+	pMap->m_ReadTime = Read-Start;
+
+	CMapItemVersion *pVersion = (CMapItemVersion *)DataFile.FindItem(MAPITEMTYPE_VERSION, 0);
+	if(pVersion)
+		pMap->m_Version = pVersion->m_Version;
+	if(pMap->m_Version != 1)
+		pMap->m_Errors |= ERROR_VERSION;
+	pMap->m_Errors |= CheckLayers(&DataFile);
+
+	char aMapName[128];
+	str_copy(aMapName, pMap->m_aName, str_length(pMap->m_aName)-3);
+	if(!s_MapChecker.IsMapValid(aMapName, pMap->m_Crc, pMap->m_Size))
+		pMap->m_Errors |= ERROR_WHITELIST;
+
+	int64 Checked = time_get();
+	pMap->m_CheckTime = Checked-Read;
+
+	if(s_pResaveDirectory)
+	{
+		char aFilename[512];
+		str_format(aFilename, sizeof(aFilename), "%s/%s", s_pResaveDirectory, pMap->m_aName);
+		if(!Resave(&DataFile, aFilename))
+			pMap->m_Errors |= ERROR_RESAVE;
+		pMap->m_ResaveTime = time_get()-Checked;
+	}
+
+	DataFile.Close();
+	return 0;
+}
+
+// cache lines are: name, modification time, size, crc, version, errors
+static void LoadCache(const char *pFilename)
+{
+	IOHANDLE File = s_pStorage->OpenFile(pFilename, IOFLAG_READ, IStorage::TYPE_SAVE);
+	if(!File)
+		return;
+
+	int FileSize = (int)io_length(File);
+	char *pFileData = (char *)mem_alloc(FileSize+1, 1);
+	io_read(File, pFileData, FileSize);
+	pFileData[FileSize] = 0;
+	io_close(File);
+
+	int NumCached = 0;
+	char *pLine = pFileData;
+	while(*pLine)
+	{
+		char *pNext = pLine;
+		while(*pNext && *pNext != '\n')
+			pNext++;
+		if(*pNext)
+			*pNext++ = 0;
+
+		char *apFields[6];
+		int NumFields = 0;
+		for(char *p = pLine; NumFields < 6; p++)
+		{
+			apFields[NumFields++] = p;
+			while(*p && *p != '\t')
+				p++;
+			if(!*p)
+				break;
+			*p = 0;
+		}
+
+		if(NumFields == 6)
+		{
+			for(int i = 0; i < s_lpMaps.size(); i++)
+			{
+				CBatchMap *pMap = s_lpMaps[i];
+				if(str_comp(pMap->m_aName, apFields[0]) != 0)
+					continue;
+				if(pMap->m_Modified < 0 || pMap->m_Modified != str_toint(apFields[1]) || (int)pMap->m_Size != str_toint(apFields[2]))
+					break;
+
+				pMap->m_Cached = true;
+				pMap->m_Crc = (unsigned)str_toint(apFields[3]);
+				pMap->m_Version = str_toint(apFields[4]);
+				pMap->m_Errors = str_toint(apFields[5]);
+				NumCached++;
+				break;
+			}
+		}
+
+		pLine = pNext;
+	}
+
+	mem_free(pFileData);
+	char aBuf[128];
+	str_format(aBuf, sizeof(aBuf), "%d of %d maps are unchanged", NumCached, s_lpMaps.size());
+	Print(aBuf);
+}
+
+static void SaveCache(const char *pFilename)
+{
+	IOHANDLE File = s_pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "failed to write cache '%s'", pFilename);
+		Print(aBuf);
+		return;
+	}
+
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		const CBatchMap *pMap = s_lpMaps[i];
+		// maps that could not be read are checked again next time
+		if(pMap->m_Modified < 0 || pMap->m_Errors&ERROR_OPEN)
+			continue;
+
+		char aBuf[256];
+		str_format(aBuf, sizeof(aBuf), "%s\t%d\t%d\t%d\t%d\t%d\n", pMap->m_aName, (int)pMap->m_Modified, (int)pMap->m_Size,
+			(int)pMap->m_Crc, pMap->m_Version, pMap->m_Errors);
+		io_write(File, aBuf, str_length(aBuf));
+	}
+	io_close(File);
+}
+
+static void SaveReport(const char *pFilename)
+{
+	IOHANDLE File = s_pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "failed to write report '%s'", pFilename);
+		Print(aBuf);
+		return;
+	}
+
+	float Freq = (float)time_freq();
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		const CBatchMap *pMap = s_lpMaps[i];
+
+		char aErrors[128] = {0};
+		for(int e = 0; e < NUM_ERRORS; e++)
+		{
+			if(!(pMap->m_Errors&(1<<e)))
+				continue;
+			if(aErrors[0])
+				str_append(aErrors, ", ", sizeof(aErrors));
+			str_append(aErrors, "\"", sizeof(aErrors));
+			str_append(aErrors, s_apErrorNames[e], sizeof(aErrors));
+			str_append(aErrors, "\"", sizeof(aErrors));
+		}
+
+		// map file names do not need escaping apart from these
+		char aName[256];
+		int Length = 0;
+		for(const char *p = pMap->m_aName; *p && Length < (int)sizeof(aName)-2; p++)
+		{
+			if(*p == '"' || *p == '\\')
+				aName[Length++] = '\\';
+			aName[Length++] = *p;
+		}
+		aName[Length] = 0;
+
+		char aBuf[1024];
+		str_format(aBuf, sizeof(aBuf), "{\"name\": \"%s\", \"crc\": \"%08x\", \"size\": %u, \"version\": %d, \"errors\": [%s], \"cached\": %s, "
+			"\"read_ms\": %.2f, \"check_ms\": %.2f, \"resave_ms\": %.2f}\n",
+			aName, pMap->m_Crc, pMap->m_Size, pMap->m_Version, aErrors, pMap->m_Cached ? "true" : "false",
+			pMap->m_ReadTime*1000.0f/Freq, pMap->m_CheckTime*1000.0f/Freq, pMap->m_ResaveTime*1000.0f/Freq);
+		io_write(File, aBuf, str_length(aBuf));
+	}
+	io_close(File);
+}
+
+// the same format as map_version
+static void SaveVersions(const char *pFilename)
+{
+	IOHANDLE File = s_pStorage->OpenFile(pFilename, IOFLAG_WRITE, IStorage::TYPE_SAVE);
+	if(!File)
+	{
+		char aBuf[512];
+		str_format(aBuf, sizeof(aBuf), "failed to write version list '%s'", pFilename);
+		Print(aBuf);
+		return;
+	}
+
+	io_write(File, "static CMapVersion s_aMapVersionList[] = {\n", str_length("static CMapVersion s_aMapVersionList[] = {\n"));
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		const CBatchMap *pMap = s_lpMaps[i];
+		if(pMap->m_Errors&ERROR_OPEN)
+			continue;
+
+		char aMapName[8];
+		str_copy(aMapName, pMap->m_aName, min((int)sizeof(aMapName), str_length(pMap->m_aName)-3));
+
+		char aBuf[128];
+		unsigned MapCrc = pMap->m_Crc;
+		unsigned MapSize = pMap->m_Size;
+		str_format(aBuf, sizeof(aBuf), "\t{\"%s\", {0x%02x, 0x%02x, 0x%02x, 0x%02x}, {0x%02x, 0x%02x, 0x%02x, 0x%02x}},\n", aMapName,
+			(MapCrc>>24)&0xff, (MapCrc>>16)&0xff, (MapCrc>>8)&0xff, MapCrc&0xff,
+			(MapSize>>24)&0xff, (MapSize>>16)&0xff, (MapSize>>8)&0xff, MapSize&0xff);
+		io_write(File, aBuf, str_length(aBuf));
+	}
+	io_write(File, "};\n", str_length("};\n"));
+	io_close(File);
+}
+
+int main(int argc, const char **argv) // ignore_convention
+{
+	int NumThreads = 4;
+	const char *pReport = "map_batch.txt";
+	const char *pCache = 0;
+	const char *pVersions = 0;
+	bool Verbose = false;
+
+	for(int i = 1; i < argc; i++) // ignore_convention
+	{
+		if(str_comp(argv[i], "-threads") == 0 && i+1 < argc) // ignore_convention
+			NumThreads = clamp(str_toint(argv[++i]), 1, 64); // ignore_convention
+		else if(str_comp(argv[i], "-resave") == 0 && i+1 < argc) // ignore_convention
+			s_pResaveDirectory = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-report") == 0 && i+1 < argc) // ignore_convention
+			pReport = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-cache") == 0 && i+1 < argc) // ignore_convention
+			pCache = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-versions") == 0 && i+1 < argc) // ignore_convention
+			pVersions = argv[++i]; // ignore_convention
+		else if(str_comp(argv[i], "-v") == 0) // ignore_convention
+			Verbose = true;
+		else
+			s_pDirectory = argv[i]; // ignore_convention
+	}
+
+	// the datafile reader is chatty, only listen to it when asked for
+	if(Verbose)
+		dbg_logger_stdout();
+
+	IKernel *pKernel = IKernel::Create();
+	s_pStorage = CreateStorage("Teeworlds", IStorage::STORAGETYPE_BASIC, argc, argv); // ignore_convention
+	if(!s_pStorage || !pKernel->RegisterInterface(s_pStorage))
+		return -1;
+
+	// everything is written to the save path, basic storage does not create it
+	char aSavePath[512];
+	s_pStorage->GetCompletePath(IStorage::TYPE_SAVE, "", aSavePath, sizeof(aSavePath));
+	fs_makedir(aSavePath);
+	if(s_pResaveDirectory)
+		s_pStorage->CreateFolder(s_pResaveDirectory, IStorage::TYPE_SAVE);
+
+	s_pStorage->ListDirectory(IStorage::TYPE_ALL, s_pDirectory, MaplistCallback, 0);
+	if(pCache && s_pResaveDirectory)
+		Print("resaving all maps, the cache is not used");
+	else if(pCache)
+		LoadCache(pCache);
+
+	int64 Start = time_get();
+	CJobPool JobPool;
+	JobPool.Init(NumThreads);
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		if(!s_lpMaps[i]->m_Cached)
+			JobPool.Add(&s_lpMaps[i]->m_Job, ProcessMap, s_lpMaps[i]);
+	}
+
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		while(s_lpMaps[i]->m_Job.Status() != CJob::STATE_DONE)
+			thread_sleep(1);
+	}
+
+	int NumProcessed = 0;
+	int NumFailed = 0;
+	for(int i = 0; i < s_lpMaps.size(); i++)
+	{
+		if(!s_lpMaps[i]->m_Cached)
+			NumProcessed++;
+		if(s_lpMaps[i]->m_Errors)
+			NumFailed++;
+	}
+
+	SaveReport(pReport);
+	if(pCache)
+		SaveCache(pCache);
+	if(pVersions)
+		SaveVersions(pVersions);
+
+	char aBuf[256];
+	str_format(aBuf, sizeof(aBuf), "%d maps, %d processed on %d threads in %.2fs, %d with errors", s_lpMaps.size(), NumProcessed, NumThreads,
+		(time_get()-Start)/(float)time_freq(), NumFailed);
+	Print(aBuf);
+
+	for(int i = 0; i < s_lpMaps.size(); i++)
+		delete s_lpMaps[i];
+	return NumFailed ? 1 : 0;
+}
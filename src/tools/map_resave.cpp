@@ -12,15 +12,18 @@ int main(int argc, const char **argv)
 	char aFileName[1024];
 	CDataFileReader DataFile;
 	CDataFileWriter df;
+	CJobPool JobPool;
 
 	if(!pStorage || argc != 3)
 		return -1;
 
+	JobPool.Init(4);
+
 	str_format(aFileName, sizeof(aFileName), "%s", argv[2]);
 
 	if(!DataFile.Open(pStorage, argv[1], IStorage::TYPE_ALL))
 		return -1;
-	if(!df.Open(pStorage, aFileName))
+	if(!df.Open(pStorage, aFileName, &JobPool, true))
 		return -1;
 
 	// add all items
@@ -35,7 +38,7 @@ int main(int argc, const char **argv)
 	for(Index = 0; Index < DataFile.NumData(); Index++)
 	{
 		pPtr = DataFile.GetData(Index);
-		Size = DataFile.GetDataSize(Index);
+		Size = DataFile.GetUncompressedDataSize(Index);
 		df.AddData(Size, pPtr);
 	}
 